@@ -3,6 +3,8 @@
  * SPDX-FileCopyrightText: 2021 Rafael Silva <perigoso@riseup.net>
  */
 
+#include <string.h>
+
 #include "driver/pixart/pixart_pmw.h"
 
 /*
@@ -79,169 +81,424 @@ struct motion_burst_t {
 	s16 dy;
 } __attribute__((packed));
 
-u8 pixart_pmw_read(struct pixart_pmw_driver_t driver, u8 address)
+_Static_assert(sizeof(struct motion_burst_t) == PIXART_PMW_MOTION_BURST_SIZE, "invalid size");
+
+/*
+ * Waits
+ *
+ * Nothing in the driver spins, every wait arms a timeout and returns, the
+ * timeout posts the driver work item, which calls pixart_pmw_task again. The
+ * milisec gaps (reset, SROM enable, Tbexit) use an event loop timer, the
+ * register access timings and the SROM byte gap use the microsec one shot of
+ * the timer HAL.
+ */
+
+static void pixart_pmw_wake(void *data)
+{
+	struct pixart_pmw_driver_t *driver = data;
+
+	driver->waiting = 0;
+	event_loop_post(driver->work);
+}
+
+static void pixart_pmw_wait_us(struct pixart_pmw_driver_t *driver, u32 us)
 {
-	driver.spi_hal.select(driver.spi_hal, 1);
+	driver->waiting = 1;
+	driver->timer_hal.start_us(driver->timer_hal, us, pixart_pmw_wake, driver);
+}
 
-	driver.spi_hal.transfer(driver.spi_hal, address & 0x7F); /* 7 bit address + read bit(0) */
+static void pixart_pmw_wait_ms(struct pixart_pmw_driver_t *driver, u32 ms)
+{
+	driver->waiting = 1;
+	/* the next tick may be right around the corner, one more makes sure the full gap passes */
+	event_timer_start(driver->work->loop, &driver->timer, ms + 1, 0);
+}
 
-	driver.ticks_hal.delay_us(120); /* Tsrad */
+/*
+ * Asynchronous register access
+ *
+ * The address is sent, Tsrad later the data byte is exchanged, and the sensor
+ * is given some time before the next access. The value read is in access_value
+ * once access_state is back to idle.
+ */
 
-	u8 value = driver.spi_hal.transfer(driver.spi_hal, 0x00);
+static void pixart_pmw_access(struct pixart_pmw_driver_t *driver, u8 address, u8 value)
+{
+	driver->spi_hal.select(driver->spi_hal, 1);
 
-	driver.spi_hal.select(driver.spi_hal, 0);
+	driver->spi_hal.transfer(driver->spi_hal, address);
 
-	driver.ticks_hal.delay_us(160);
+	driver->access_value = value;
+	driver->access_state = PIXART_PMW_ACCESS_ADDRESS;
+	pixart_pmw_wait_us(driver, 120); /* Tsrad */
+}
 
-	return value;
+static void pixart_pmw_read(struct pixart_pmw_driver_t *driver, u8 address)
+{
+	pixart_pmw_access(driver, address & 0x7F, 0x00); /* 7 bit address + read bit(0) */
 }
 
-void pixart_pmw_write(struct pixart_pmw_driver_t driver, u8 address, u8 value)
+static void pixart_pmw_write(struct pixart_pmw_driver_t *driver, u8 address, u8 value)
 {
-	driver.spi_hal.select(driver.spi_hal, 1);
+	pixart_pmw_access(driver, address | 0x80, value); /* 7 bit address + write bit(1) */
+}
 
-	driver.spi_hal.transfer(driver.spi_hal, address | 0x80); /* 7 bit address + write bit(1) */
+/* returns true while the access is in progress */
+static u8 pixart_pmw_access_task(struct pixart_pmw_driver_t *driver)
+{
+	switch (driver->access_state) {
+		case PIXART_PMW_ACCESS_ADDRESS:
+			driver->access_value = driver->spi_hal.transfer(driver->spi_hal, driver->access_value);
 
-	driver.ticks_hal.delay_us(120); /* Tsrad */
+			driver->spi_hal.select(driver->spi_hal, 0);
 
-	driver.spi_hal.transfer(driver.spi_hal, value);
+			driver->access_state = PIXART_PMW_ACCESS_HOLD;
+			pixart_pmw_wait_us(driver, 160);
+			return 1;
 
-	driver.spi_hal.select(driver.spi_hal, 0);
+		case PIXART_PMW_ACCESS_HOLD:
+			driver->access_state = PIXART_PMW_ACCESS_IDLE;
+			return 0;
 
-	driver.ticks_hal.delay_us(160);
+		default:
+			return 0;
+	}
 }
 
-void pixart_pmw_upload_srom(struct pixart_pmw_driver_t driver, const u8 *firmware)
+/*
+ * Incremental initialization
+ *
+ * The reset, SROM download and SROM exit waits add up to more than 100ms, the
+ * SROM alone is 4094 bytes with a 15us gap after each one. Instead of spinning,
+ * pixart_pmw_init only sets up the driver and pixart_pmw_task advances the
+ * bring-up one step at a time, each step starts a single register access or
+ * wait, so the main loop (eg. USB) keeps running and sleeps in between.
+ */
+
+static void pixart_pmw_init_task(struct pixart_pmw_driver_t *driver)
 {
-	pixart_pmw_write(driver, PIXART_PMW_REG_SROM_EN, PIXART_PMW_SROM_DWNLD_CMD); /* Initialize SROM download */
+	int byte;
+
+	switch (driver->init_state) {
+		case PIXART_PMW_INIT_POWER_UP:
+			driver->spi_hal.select(driver->spi_hal, 0);
+			driver->init_state = PIXART_PMW_INIT_RESET;
+			pixart_pmw_wait_ms(driver, 1);
+			break;
 
-	driver.ticks_hal.delay_ms(15);
+		case PIXART_PMW_INIT_RESET:
+			/* Software Reset */
+			driver->init_state = PIXART_PMW_INIT_RESET_WAIT;
+			pixart_pmw_write(driver, PIXART_PMW_REG_PWR_UP_RST, PIXART_PMW_RESET_CMD);
+			break;
 
-	pixart_pmw_write(driver, PIXART_PMW_REG_SROM_EN, PIXART_PMW_SROM_DWNLD_START_CMD); /* Start SROM download */
+		case PIXART_PMW_INIT_RESET_WAIT:
+			driver->init_state = PIXART_PMW_INIT_READ_PID;
+			pixart_pmw_wait_ms(driver, 50);
+			break;
 
-	driver.spi_hal.select(driver.spi_hal, 1);
+		case PIXART_PMW_INIT_READ_PID:
+			driver->init_state = PIXART_PMW_INIT_CHECK_PID;
+			pixart_pmw_read(driver, PIXART_PMW_REG_PID);
+			break;
 
-	driver.spi_hal.transfer(
-		driver.spi_hal, PIXART_PMW_REG_SROM_BURST | 0x80); /* 7 bit srom_burst address + write bit(1) */
-	driver.ticks_hal.delay_us(15);
+		case PIXART_PMW_INIT_CHECK_PID:
+			/* Check Known and supported ID */
+			driver->pid = driver->access_value;
+			if (driver->pid != PIXART_PMW_PID_PMW3360 && driver->pid != PIXART_PMW_PID_PMW3389)
+				goto failed_init;
 
-	for (size_t b = 0; b < 4094; b++) /* write firmware image (4094 bytes) */
-	{
-		driver.spi_hal.transfer(driver.spi_hal, firmware[b]);
-		driver.ticks_hal.delay_us(15);
-	}
+			driver->init_state = PIXART_PMW_INIT_SROM_ENABLE;
+			pixart_pmw_write(driver, PIXART_PMW_REG_CONFIG2, 0x00); /* Clear REST enable bit */
+			break;
 
-	driver.spi_hal.select(driver.spi_hal, 0);
+		case PIXART_PMW_INIT_SROM_ENABLE:
+			/* Initialize SROM download */
+			driver->init_state = PIXART_PMW_INIT_SROM_ENABLE_WAIT;
+			pixart_pmw_write(driver, PIXART_PMW_REG_SROM_EN, PIXART_PMW_SROM_DWNLD_CMD);
+			break;
 
-	driver.ticks_hal.delay_ms(2); /* Tbexit */
-}
+		case PIXART_PMW_INIT_SROM_ENABLE_WAIT:
+			driver->init_state = PIXART_PMW_INIT_SROM_START;
+			pixart_pmw_wait_ms(driver, 15);
+			break;
 
-struct motion_burst_t pixart_pmw_read_motion_burst(struct pixart_pmw_driver_t driver)
-{
-	struct motion_burst_t motion_burst;
+		case PIXART_PMW_INIT_SROM_START:
+			/* Start SROM download */
+			driver->init_state = PIXART_PMW_INIT_SROM_BURST;
+			pixart_pmw_write(driver, PIXART_PMW_REG_SROM_EN, PIXART_PMW_SROM_DWNLD_START_CMD);
+			break;
 
-	driver.spi_hal.select(driver.spi_hal, 1);
+		case PIXART_PMW_INIT_SROM_BURST:
+			driver->spi_hal.select(driver->spi_hal, 1);
+			driver->spi_hal.transfer(
+				driver->spi_hal, PIXART_PMW_REG_SROM_BURST | 0x80); /* 7 bit srom_burst address + write bit(1) */
 
-	driver.spi_hal.transfer(driver.spi_hal, PIXART_PMW_REG_BURST); /* 7 bit address + read bit(0) */
+			driver->srom_index = 0;
+			driver->init_state = PIXART_PMW_INIT_SROM_UPLOAD;
+			pixart_pmw_wait_us(driver, 15);
+			break;
 
-	driver.ticks_hal.delay_us(35); /* Tsrad_motbr */
+		case PIXART_PMW_INIT_SROM_UPLOAD:
+			/* write firmware image, one byte per call, 15us apart */
+			byte = blob_stream_getc(&driver->srom);
+			if (byte < 0)
+				goto failed_upload;
+			driver->spi_hal.transfer(driver->spi_hal, byte);
+
+			/* the next chunk is read from the blob device during the gap */
+			if (++driver->srom_index < PIXART_PMW_SROM_SIZE) {
+				pixart_pmw_wait_us(driver, 15);
+				if (blob_stream_prefetch(&driver->srom) < 0)
+					goto failed_upload;
+				break;
+			}
+
+			driver->spi_hal.select(driver->spi_hal, 0);
+			driver->init_state = PIXART_PMW_INIT_READ_OBSERVATION;
+			pixart_pmw_wait_ms(driver, 2); /* Tbexit */
+			break;
 
-	for (u8 i = 0; i < sizeof(motion_burst); i++)
-		((u8 *) &motion_burst)[i] = driver.spi_hal.transfer(driver.spi_hal, 0x00);
+		case PIXART_PMW_INIT_READ_OBSERVATION:
+			driver->init_state = PIXART_PMW_INIT_CHECK_OBSERVATION;
+			pixart_pmw_read(driver, PIXART_PMW_REG_OBSERVATION);
+			break;
 
-	driver.spi_hal.select(driver.spi_hal, 0);
+		case PIXART_PMW_INIT_CHECK_OBSERVATION:
+			/* check SROM running bit */
+			if (!(driver->access_value & PIXART_PMW_SROM_RUN))
+				goto failed_init;
 
-	return motion_burst;
-}
+			/* read srom firmware id */
+			driver->init_state = PIXART_PMW_INIT_CHECK_SROM_ID;
+			pixart_pmw_read(driver, PIXART_PMW_REG_SROM_ID);
+			break;
 
-struct pixart_pmw_driver_t pixart_pmw_init(const u8 *firmware, struct spi_hal_t spi_hal, struct ticks_hal_t ticks_hal)
-{
-	struct pixart_pmw_driver_t driver = {};
+		case PIXART_PMW_INIT_CHECK_SROM_ID:
+			if (!driver->access_value)
+				goto failed_init;
 
-	driver.spi_hal = spi_hal;
-	driver.ticks_hal = ticks_hal;
+			driver->init_state = PIXART_PMW_INIT_BURST_MODE;
+			pixart_pmw_write(driver, PIXART_PMW_REG_CONFIG2, 0x00); /* clear REST enable bit */
+			break;
 
-	if (!firmware)
-		goto failed_init;
+		case PIXART_PMW_INIT_BURST_MODE:
+			driver->init_state = PIXART_PMW_INIT_FLUSH;
+			pixart_pmw_write(driver, PIXART_PMW_REG_BURST, 0x01);
+			break;
 
-	spi_hal.select(spi_hal, 0);
-	ticks_hal.delay_ms(1);
+		case PIXART_PMW_INIT_FLUSH:
+			/* Read motion and discard the data */
+			driver->spi_hal.select(driver->spi_hal, 1);
+			driver->spi_hal.transfer(driver->spi_hal, PIXART_PMW_REG_BURST); /* 7 bit address + read bit(0) */
 
-	/* Software Reset */
-	pixart_pmw_write(driver, PIXART_PMW_REG_PWR_UP_RST, PIXART_PMW_RESET_CMD);
-	ticks_hal.delay_ms(50);
+			driver->init_state = PIXART_PMW_INIT_FLUSH_READ;
+			pixart_pmw_wait_us(driver, 35); /* Tsrad_motbr */
+			break;
 
-	/* Check Known and supported ID */
-	u8 pid = pixart_pmw_read(driver, PIXART_PMW_REG_PID);
-	if (pid != PIXART_PMW_PID_PMW3360 && pid != PIXART_PMW_PID_PMW3389)
-		goto failed_init;
+		case PIXART_PMW_INIT_FLUSH_READ:
+			driver->spi_hal.transfer_buf(driver->spi_hal, NULL, driver->burst_data, sizeof(driver->burst_data));
+			driver->spi_hal.select(driver->spi_hal, 0);
 
-	driver.pid = pid;
+			/* motion seen during the bring-up was just discarded */
+			driver->motion_flag = 0;
+			driver->init_state = PIXART_PMW_INIT_DONE;
+			break;
 
-	pixart_pmw_write(driver, PIXART_PMW_REG_CONFIG2, 0x00); /* Clear REST enable bit */
+		default:
+			break;
+	}
 
-	pixart_pmw_upload_srom(driver, firmware); /* Upload firmware blob */
+	return;
 
-	if (!(pixart_pmw_read(driver, PIXART_PMW_REG_OBSERVATION) & PIXART_PMW_SROM_RUN)) /* check SROM running bit */
-		goto failed_init;
+failed_upload:
+	driver->spi_hal.select(driver->spi_hal, 0);
+failed_init:
+	driver->pid = 0; /* pid == 0 means failed initialization */
+	driver->init_state = PIXART_PMW_INIT_DONE;
+}
 
-	u8 srom_id = pixart_pmw_read(driver, PIXART_PMW_REG_SROM_ID); /* read srom firmware id */
-	if (!srom_id)
-		goto failed_init;
+/* only sets up the driver, the sensor is brought up by pixart_pmw_task */
+void pixart_pmw_init(struct pixart_pmw_driver_t *driver,
+		     const struct blob_t *firmware,
+		     struct spi_hal_t spi_hal,
+		     struct ticks_hal_t ticks_hal,
+		     struct timer_hal_t timer_hal,
+		     struct event_work_t *work)
+{
+	struct blob_t srom;
 
-	pixart_pmw_write(driver, PIXART_PMW_REG_CONFIG2, 0x00); /* clear REST enable bit */
+	memset(driver, 0, sizeof(*driver));
 
-	pixart_pmw_write(driver, PIXART_PMW_REG_BURST, 0x01);
+	driver->spi_hal = spi_hal;
+	driver->ticks_hal = ticks_hal;
+	driver->timer_hal = timer_hal;
+	driver->work = work;
+	event_timer_init(&driver->timer, pixart_pmw_wake, driver);
 
-	pixart_pmw_read_motion_burst(driver); /* Read motion and discard the data*/
+	if (!firmware || firmware->size < PIXART_PMW_SROM_SIZE)
+		return;
 
-	return driver;
+	/* the first chunk is read here, the rest is streamed by the upload steps */
+	srom = *firmware;
+	srom.size = PIXART_PMW_SROM_SIZE;
+	if (blob_stream_open(&driver->srom, &srom) < 0)
+		return;
 
-failed_init:
-	driver.pid = 0; /* pid == 0 means failed initialization */
-	return driver;
+	driver->init_state = PIXART_PMW_INIT_POWER_UP;
 }
 
-void pixart_pmw_read_motion(struct pixart_pmw_driver_t *driver)
+/*
+ * Asynchronous motion burst
+ *
+ * pixart_pmw_motion_event selects the sensor and sends the burst address, the
+ * timer HAL starts the background burst transfer from interrupt context once
+ * Tsrad_motbr has elapsed, and the transfer completion posts the driver work,
+ * so pixart_pmw_task consumes the sample. No CPU time is spent waiting on the
+ * sensor or the SPI peripheral.
+ */
+
+static void pixart_pmw_burst_complete(void *data)
 {
-	struct motion_burst_t motion_burst = pixart_pmw_read_motion_burst(*driver);
+	struct pixart_pmw_driver_t *driver = data;
 
-	driver->deltas.dx += motion_burst.dx;
-	driver->deltas.dy += motion_burst.dy;
+	driver->spi_hal.select(driver->spi_hal, 0);
 
-	driver->motion_flag = 0;
+	driver->burst_state = PIXART_PMW_BURST_DONE;
+	event_loop_post(driver->work);
 }
 
-void pixart_pmw_motion_event(struct pixart_pmw_driver_t *driver)
+static void pixart_pmw_burst_transfer(void *data)
 {
-	driver->motion_flag++;
+	struct pixart_pmw_driver_t *driver = data;
+
+	driver->burst_state = PIXART_PMW_BURST_TRANSFER;
+	driver->spi_hal.transfer_async(
+		driver->spi_hal, NULL, driver->burst_data, sizeof(driver->burst_data), pixart_pmw_burst_complete, driver);
 }
 
-struct deltas_t pixart_pmw_get_deltas(struct pixart_pmw_driver_t *driver)
+static void pixart_pmw_burst_start(struct pixart_pmw_driver_t *driver)
 {
-	struct deltas_t deltas = driver->deltas;
+	driver->spi_hal.select(driver->spi_hal, 1);
 
-	driver->deltas.dx = 0;
-	driver->deltas.dy = 0;
+	driver->spi_hal.transfer(driver->spi_hal, PIXART_PMW_REG_BURST); /* 7 bit address + read bit(0) */
 
-	return deltas;
+	driver->burst_state = PIXART_PMW_BURST_ADDRESS;
+	driver->timer_hal.start_us(driver->timer_hal, 35, pixart_pmw_burst_transfer, driver); /* Tsrad_motbr */
+}
+
+/* called from the driver work, if a register access is in progress the burst starts once it is done */
+void pixart_pmw_motion_event(struct pixart_pmw_driver_t *driver)
+{
+	driver->motion_flag = 1;
+
+	if (driver->init_state != PIXART_PMW_INIT_DONE || !driver->pid)
+		return;
+
+	if (driver->burst_state != PIXART_PMW_BURST_IDLE || driver->access_state != PIXART_PMW_ACCESS_IDLE ||
+	    !driver->spi_hal.transfer_async)
+		return;
+
+	pixart_pmw_burst_start(driver);
 }
 
-void pixart_pmw_set_cpi(struct pixart_pmw_driver_t driver, u16 cpi)
+static void pixart_pmw_cpi_task(struct pixart_pmw_driver_t *driver)
 {
-	switch (driver.pid) {
+	u16 cpi = driver->cpi;
+
+	switch (driver->pid) {
 		case PIXART_PMW_PID_PMW3360:
+			driver->cpi_pending = 0;
 			if (cpi >= 100 && cpi <= 12000)
 				pixart_pmw_write(
 					driver, PIXART_PMW3360_REG_CPI, ((cpi / 100) - 1)); /* 100-12000, 100 cpi LSb */
 			break;
 
 		case PIXART_PMW_PID_PMW3389:
-			if (cpi >= 50 && cpi <= 16000) {
-				cpi /= 50;
-				pixart_pmw_write(driver, PIXART_PMW3389_REG_CPI_L, cpi & 0xFF); /* 50-16000, 50 cpi LSb */
-				pixart_pmw_write(driver, PIXART_PMW3389_REG_CPI_H, cpi >> 8); /* 50-16000, 50 cpi LSb */
+			if (cpi < 50 || cpi > 16000) {
+				driver->cpi_pending = 0;
+				break;
+			}
+
+			/* 50-16000, 50 cpi LSb, one register per access */
+			cpi /= 50;
+			if (driver->cpi_pending == 1) {
+				driver->cpi_pending = 2;
+				pixart_pmw_write(driver, PIXART_PMW3389_REG_CPI_L, cpi & 0xFF);
+			} else {
+				driver->cpi_pending = 0;
+				pixart_pmw_write(driver, PIXART_PMW3389_REG_CPI_H, cpi >> 8);
 			}
 			break;
+
+		default:
+			driver->cpi_pending = 0;
+			break;
 	}
 }
+
+u8 pixart_pmw_task(struct pixart_pmw_driver_t *driver)
+{
+	struct motion_burst_t *motion_burst = (struct motion_burst_t *) driver->burst_data;
+
+	if (driver->waiting || pixart_pmw_access_task(driver))
+		return 0;
+
+	if (driver->init_state != PIXART_PMW_INIT_DONE) {
+		pixart_pmw_init_task(driver);
+		return 0;
+	}
+
+	switch (driver->burst_state) {
+		case PIXART_PMW_BURST_IDLE:
+			/* settings first, the deferred burst then samples with them */
+			if (driver->cpi_pending)
+				pixart_pmw_cpi_task(driver);
+			else if (driver->motion_flag && driver->pid && driver->spi_hal.transfer_async)
+				pixart_pmw_burst_start(driver);
+			break;
+
+		case PIXART_PMW_BURST_DONE:
+			driver->deltas.dx += motion_burst->dx;
+			driver->deltas.dy += motion_burst->dy;
+
+			driver->motion_flag = 0;
+			driver->burst_state = PIXART_PMW_BURST_IDLE;
+
+			/* the burst may have held back a setting */
+			if (driver->cpi_pending)
+				event_loop_post(driver->work);
+			return 1;
+
+		default:
+			break;
+	}
+
+	return 0;
+}
+
+/* pixart_pmw_task has work to do, the sensor is still booting, being configured, or a motion burst is in flight */
+u8 pixart_pmw_busy(const struct pixart_pmw_driver_t *driver)
+{
+	return driver->init_state != PIXART_PMW_INIT_DONE || driver->access_state != PIXART_PMW_ACCESS_IDLE ||
+	       driver->cpi_pending || driver->burst_state != PIXART_PMW_BURST_IDLE;
+}
+
+struct deltas_t pixart_pmw_get_deltas(struct pixart_pmw_driver_t *driver)
+{
+	struct deltas_t deltas = driver->deltas;
+
+	driver->deltas.dx = 0;
+	driver->deltas.dy = 0;
+
+	return deltas;
+}
+
+/* the registers are written by pixart_pmw_task, between bursts */
+void pixart_pmw_set_cpi(struct pixart_pmw_driver_t *driver, u16 cpi)
+{
+	driver->cpi = cpi;
+	driver->cpi_pending = 1;
+
+	event_loop_post(driver->work);
+}
@@ -8,27 +8,95 @@
 
 #include "hal/spi.h"
 #include "hal/ticks.h"
+#include "hal/timer.h"
+#include "util/blob/blob.h"
+#include "util/event_loop/event_loop.h"
 #include "util/types.h"
 
+#define PIXART_PMW_MOTION_BURST_SIZE 6
+#define PIXART_PMW_SROM_SIZE	     4094
+
 struct deltas_t {
 	s16 dx;
 	s16 dy;
 };
 
+enum pixart_pmw_burst_state_t {
+	PIXART_PMW_BURST_IDLE = 0,
+	PIXART_PMW_BURST_ADDRESS, /* burst address sent, waiting for Tsrad_motbr */
+	PIXART_PMW_BURST_TRANSFER, /* burst data is being clocked in the background */
+	PIXART_PMW_BURST_DONE, /* burst data is ready to be consumed */
+};
+
+enum pixart_pmw_access_state_t {
+	PIXART_PMW_ACCESS_IDLE = 0,
+	PIXART_PMW_ACCESS_ADDRESS, /* register address sent, waiting for Tsrad */
+	PIXART_PMW_ACCESS_HOLD, /* data exchanged, waiting before the next access */
+};
+
+enum pixart_pmw_init_state_t {
+	PIXART_PMW_INIT_DONE = 0, /* pid == 0 means failed initialization */
+	PIXART_PMW_INIT_POWER_UP,
+	PIXART_PMW_INIT_RESET,
+	PIXART_PMW_INIT_RESET_WAIT,
+	PIXART_PMW_INIT_READ_PID,
+	PIXART_PMW_INIT_CHECK_PID,
+	PIXART_PMW_INIT_SROM_ENABLE,
+	PIXART_PMW_INIT_SROM_ENABLE_WAIT,
+	PIXART_PMW_INIT_SROM_START,
+	PIXART_PMW_INIT_SROM_BURST,
+	PIXART_PMW_INIT_SROM_UPLOAD,
+	PIXART_PMW_INIT_READ_OBSERVATION,
+	PIXART_PMW_INIT_CHECK_OBSERVATION,
+	PIXART_PMW_INIT_CHECK_SROM_ID,
+	PIXART_PMW_INIT_BURST_MODE,
+	PIXART_PMW_INIT_FLUSH,
+	PIXART_PMW_INIT_FLUSH_READ,
+};
+
 struct pixart_pmw_driver_t {
 	u8 pid;
 	u8 motion_flag;
 	struct deltas_t deltas;
 	struct spi_hal_t spi_hal;
 	struct ticks_hal_t ticks_hal;
+	struct timer_hal_t timer_hal;
+	/* runs pixart_pmw_task, posted when a wait is over */
+	struct event_work_t *work;
+	struct event_timer_t timer;
+	volatile u8 waiting;
+	/* incremental initialization */
+	u8 init_state;
+	struct blob_stream_t srom;
+	u16 srom_index;
+	/* asynchronous register access */
+	u8 access_state;
+	u8 access_value;
+	/* settings waiting for the bus, written by pixart_pmw_task */
+	u8 cpi_pending;
+	u16 cpi;
+	/* asynchronous motion burst */
+	volatile u8 burst_state;
+	u8 burst_data[PIXART_PMW_MOTION_BURST_SIZE];
 };
 
-struct pixart_pmw_driver_t pixart_pmw_init(const u8 *firmware, struct spi_hal_t spi_hal, struct ticks_hal_t ticks_hal);
-
-void pixart_pmw_read_motion(struct pixart_pmw_driver_t *driver);
+/*
+ * the SROM is streamed from the firmware blob during the bring-up, the blob must stay valid until then,
+ * work must call pixart_pmw_task, and be added to its event loop before the first call
+ */
+void pixart_pmw_init(struct pixart_pmw_driver_t *driver,
+		     const struct blob_t *firmware,
+		     struct spi_hal_t spi_hal,
+		     struct ticks_hal_t ticks_hal,
+		     struct timer_hal_t timer_hal,
+		     struct event_work_t *work);
 
 void pixart_pmw_motion_event(struct pixart_pmw_driver_t *driver);
 
+u8 pixart_pmw_task(struct pixart_pmw_driver_t *driver);
+
+u8 pixart_pmw_busy(const struct pixart_pmw_driver_t *driver);
+
 struct deltas_t pixart_pmw_get_deltas(struct pixart_pmw_driver_t *driver);
 
-void pixart_pmw_set_cpi(struct pixart_pmw_driver_t driver, u16 cpi);
+void pixart_pmw_set_cpi(struct pixart_pmw_driver_t *driver, u16 cpi);
@@ -8,7 +8,7 @@
 #include "util/types.h"
 
 struct hid_hal_t {
-	/* send packet to the host */
+	/* send packet to the host, -EBUSY if the endpoint can't take it yet */
 	int (*send)(struct hid_hal_t interface, u8 *buffer, size_t buffer_size);
 	/* arbitrary user data */
 	void *drv_data;
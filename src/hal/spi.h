@@ -10,6 +10,14 @@
 struct spi_hal_t {
 	/* bidirectional byte transfer */
 	u8 (*transfer)(struct spi_hal_t interface, u8 data);
+	/* bidirectional buffer transfer, src and/or dst may be NULL (0x00 is sent when src is NULL) */
+	void (*transfer_buf)(struct spi_hal_t interface, const u8 *src, u8 *dst, size_t size);
+	/*
+	 * start a bidirectional buffer transfer in the background (eg. DMA), src and/or dst may be NULL
+	 * callback is called from interrupt context once the transfer is complete
+	 */
+	void (*transfer_async)(
+		struct spi_hal_t interface, const u8 *src, u8 *dst, size_t size, void (*callback)(void *data), void *data);
 	/* select/unselect device */
 	void (*select)(struct spi_hal_t interface, u8 state);
 	/* arbitrary user data */
@@ -12,6 +12,10 @@ struct ticks_hal_t {
 	void (*delay_ms)(u32 ticks);
 	/* wait for x microsecs */
 	void (*delay_us)(u32 ticks);
+	/* microsecs since boot, monotonic, 64 bits so it never wraps in practice */
+	u64 (*now_us)(void);
+	/* cycles of the finest counter available (usually the CPU clock) since boot, monotonic */
+	u64 (*now_cycles)(void);
 	/* arbitrary user data */
 	void *drv_data;
 };
@@ -0,0 +1,20 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "util/types.h"
+
+struct timer_hal_t {
+	/*
+	 * call callback from interrupt context once x microsecs have passed, one shot, starting it again
+	 * replaces the pending timeout. Meant for sub-milisec waits, it's only guaranteed to reach 50ms.
+	 */
+	void (*start_us)(struct timer_hal_t interface, u32 ticks, void (*callback)(void *data), void *data);
+	/* cancel the pending timeout, if any */
+	void (*stop)(struct timer_hal_t interface);
+	/* arbitrary user data */
+	void *drv_data;
+};
@@ -0,0 +1,11 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/ticks.h"
+#include "util/types.h"
+
+struct ticks_hal_t ticks_hal_init();
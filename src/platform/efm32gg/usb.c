@@ -5,19 +5,34 @@
 
 #include <em_device.h>
 
+#include "platform/efm32gg/atomic.h"
 #include "platform/efm32gg/usb.h"
 #include "util/types.h"
 
 #define CFG_TUSB_CONFIG_FILE "targets/efm32gg12b-generic/tusb_config.h"
 #include "tusb.h"
 
-static struct protocol_config_t protocol_config;
+static const struct protocol_config_t *protocol_config;
 
-void usb_attach_protocol_config(struct protocol_config_t config)
+static void (*irq_callback)(void *data);
+static void *irq_data;
+
+void usb_attach_protocol_config(const struct protocol_config_t *config)
 {
 	protocol_config = config;
 }
 
+/* callback is called from interrupt context after the USB stack queued its events, tud_task needs to run */
+void usb_attach_irq_callback(void (*callback)(void *data), void *data)
+{
+	/* the USB ISR must never see the new callback with the old data */
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		irq_callback = callback;
+		irq_data = data;
+	}
+}
+
 void usb_init()
 {
 	/* Enable USB peripheral clock */
@@ -36,6 +51,9 @@ void usb_init()
 void _usb_isr()
 {
 	tud_int_handler(0);
+
+	if (irq_callback)
+		irq_callback(irq_data);
 }
 
 /* TinyUSB Callbacks */
@@ -59,6 +77,9 @@ void tud_suspend_cb(bool remote_wakeup_en)
 /* Invoked when usb bus is resumed */
 void tud_resume_cb(void)
 {
+	/* responses queued while the bus was suspended */
+	if (protocol_config)
+		protocol_flush(protocol_config);
 }
 
 /* Invoked when received GET_REPORT control request */
@@ -82,3 +103,13 @@ void tud_hid_set_report_cb(u8 itf, u8 report_id, hid_report_type_t report_type,
 	if (itf == 0)
 		protocol_dispatch(protocol_config, (u8 *) buffer, bufsize);
 }
+
+/* Invoked when an IN report was sent, the endpoint can take the next queued response */
+void tud_hid_report_complete_cb(u8 itf, u8 const *report, u16 len)
+{
+	(void) report;
+	(void) len;
+
+	if (itf == 0)
+		protocol_flush(protocol_config);
+}
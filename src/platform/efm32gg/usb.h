@@ -8,4 +8,5 @@
 #include "protocol/protocol.h"
 
 void usb_init();
-void usb_attach_protocol_config(struct protocol_config_t config);
+void usb_attach_protocol_config(const struct protocol_config_t *config);
+void usb_attach_irq_callback(void (*callback)(void *data), void *data);
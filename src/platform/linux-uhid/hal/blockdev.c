@@ -0,0 +1,108 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "platform/linux-uhid/hal/blockdev.h"
+#include "platform/linux-uhid/hal/ticks.h"
+
+static size_t blockdev_file_size(struct blockdev_file_t *file)
+{
+	return (size_t) file->ram.block_size * file->ram.block_count;
+}
+
+int blockdev_file_open(struct blockdev_file_t *file, const char *path, u16 block_size, u16 block_count, u16 write_size)
+{
+	struct stat st;
+	u8 erased = 0;
+	int ret;
+
+	memset(file, 0, sizeof(*file));
+	file->ram.block_size = block_size;
+	file->ram.block_count = block_count;
+	file->ram.write_size = write_size;
+	/* latencies are real time here, set erase_latency_us/program_latency_us to simulate them */
+	file->ram.ticks = ticks_hal_init();
+
+	file->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (file->fd == -1) {
+		fprintf(stderr, "error: cannot open storage file '%s' (%m)\n", path);
+		return -errno;
+	}
+
+	if (fstat(file->fd, &st)) {
+		ret = -errno;
+		goto error;
+	}
+
+	if (st.st_size == 0) {
+		if (ftruncate(file->fd, blockdev_file_size(file))) {
+			ret = -errno;
+			goto error;
+		}
+		erased = 1;
+	} else if ((size_t) st.st_size != blockdev_file_size(file)) {
+		fprintf(stderr, "error: storage file '%s' doesn't match the flash geometry\n", path);
+		ret = -EINVAL;
+		goto error;
+	}
+
+	file->ram.data = mmap(NULL, blockdev_file_size(file), PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+	if (file->ram.data == MAP_FAILED) {
+		file->ram.data = NULL;
+		ret = -errno;
+		goto error;
+	}
+
+	/* new flash chips come erased */
+	if (erased)
+		memset(file->ram.data, 0xFF, blockdev_file_size(file));
+
+	return 0;
+
+error:
+	close(file->fd);
+	file->fd = -1;
+	return ret;
+}
+
+void blockdev_file_close(struct blockdev_file_t *file)
+{
+	if (file->ram.data) {
+		msync(file->ram.data, blockdev_file_size(file), MS_SYNC);
+		munmap(file->ram.data, blockdev_file_size(file));
+	}
+	if (file->fd != -1)
+		close(file->fd);
+
+	file->ram.data = NULL;
+	file->fd = -1;
+}
+
+s8 blockdev_file_sync(struct blockdev_hal_t mem_block)
+{
+	struct blockdev_file_t *file = mem_block.drv_data;
+
+	if (msync(file->ram.data, blockdev_file_size(file), MS_SYNC))
+		return -errno;
+
+	return 0;
+}
+
+struct blockdev_hal_t blockdev_hal_init_file(struct blockdev_file_t *file)
+{
+	/* same NOR emulation as the RAM device, the mapping just survives us */
+	struct blockdev_hal_t hal = blockdev_hal_init_ram(&file->ram);
+
+	hal.sync = blockdev_file_sync;
+
+	return hal;
+}
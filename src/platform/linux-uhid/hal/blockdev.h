@@ -0,0 +1,23 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/blockdev.h"
+#include "util/ram_blockdev/ram_blockdev.h"
+#include "util/types.h"
+
+/* NOR flash emulated on top of a mmaped file, the file holds the raw flash image */
+struct blockdev_file_t {
+	struct ram_blockdev_t ram; /* must be the first member */
+	int fd;
+};
+
+/* creates an erased image if the file is empty, the size of existing images must match the geometry */
+int blockdev_file_open(struct blockdev_file_t *file, const char *path, u16 block_size, u16 block_count, u16 write_size);
+/* writes the image back and unmaps it */
+void blockdev_file_close(struct blockdev_file_t *file);
+
+struct blockdev_hal_t blockdev_hal_init_file(struct blockdev_file_t *file);
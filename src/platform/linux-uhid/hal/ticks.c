@@ -0,0 +1,67 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <time.h>
+
+#include "platform/linux-uhid/hal/ticks.h"
+
+static u64 ticks_get_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void ticks_sleep_ns(u64 ns)
+{
+	struct timespec ts = {
+		.tv_sec = ns / 1000000000,
+		.tv_nsec = ns % 1000000000,
+	};
+
+	/* sleep the remaining time if we get interrupted by a signal */
+	while (nanosleep(&ts, &ts) && errno == EINTR) continue;
+}
+
+/* milisecs since boot, for the event loop */
+u64 ticks_get_ms()
+{
+	return ticks_get_ns() / 1000000;
+}
+
+void ticks_hal_delay_ms(u32 ticks)
+{
+	ticks_sleep_ns((u64) ticks * 1000000);
+}
+
+void ticks_hal_delay_us(u32 ticks)
+{
+	ticks_sleep_ns((u64) ticks * 1000);
+}
+
+u64 ticks_hal_now_us()
+{
+	return ticks_get_ns() / 1000;
+}
+
+/* there is no portable cycle counter, use the monotonic clock in nanosecs */
+u64 ticks_hal_now_cycles()
+{
+	return ticks_get_ns();
+}
+
+struct ticks_hal_t ticks_hal_init()
+{
+	struct ticks_hal_t hal = {
+		.delay_ms = ticks_hal_delay_ms,
+		.delay_us = ticks_hal_delay_us,
+		.now_us = ticks_hal_now_us,
+		.now_cycles = ticks_hal_now_cycles,
+		.drv_data = NULL,
+	};
+	return hal;
+}
@@ -0,0 +1,12 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/ticks.h"
+#include "util/types.h"
+
+struct ticks_hal_t ticks_hal_init();
+u64 ticks_get_ms();
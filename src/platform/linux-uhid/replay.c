@@ -0,0 +1,316 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <time.h>
+
+#include "platform/linux-uhid/replay.h"
+#include "util/data.h"
+#include "util/hid_descriptors.h"
+
+#define NSEC_PER_SEC 1000000000ull
+
+static u64 replay_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static void replay_sleep_until(u64 deadline)
+{
+	struct timespec ts = {
+		.tv_sec = deadline / NSEC_PER_SEC,
+		.tv_nsec = deadline % NSEC_PER_SEC,
+	};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) continue;
+}
+
+static int replay_parse_value(const char *token, long min, long max, long *value)
+{
+	char *end;
+
+	errno = 0;
+	*value = strtol(token, &end, 0);
+	if (errno || *end || end == token || *value < min || *value > max)
+		return -EINVAL;
+
+	return 0;
+}
+
+static int replay_parse_line(char *line, struct replay_frame_t *frame)
+{
+	long values[4] = {};
+	size_t count = 0;
+	char *token, *save;
+
+	for (token = strtok_r(line, " \t\r\n", &save); token; token = strtok_r(NULL, " \t\r\n", &save)) {
+		if (count == 4)
+			return -EINVAL;
+		/* buttons is a bitmask, the rest are signed deltas */
+		if (replay_parse_value(token, count == 2 ? 0 : -127, count == 2 ? 0x7 : 127, &values[count]))
+			return -EINVAL;
+		count++;
+	}
+
+	if (count < 2)
+		return -EINVAL;
+
+	frame->x = values[0];
+	frame->y = values[1];
+	frame->buttons = values[2];
+	frame->wheel = values[3];
+
+	return 0;
+}
+
+int replay_trace_load(struct replay_trace_t *trace, FILE *file, const char *name)
+{
+	struct replay_frame_t *frames;
+	size_t line_size = 0, line_number = 0;
+	char *line = NULL;
+	char *start;
+
+	memset(trace, 0, sizeof(*trace));
+
+	while (getline(&line, &line_size, file) != -1) {
+		line_number++;
+
+		start = line + strspn(line, " \t\r\n");
+		if (!*start || *start == '#')
+			continue;
+
+		if (trace->count == trace->capacity) {
+			trace->capacity = trace->capacity ? trace->capacity * 2 : 1024;
+			frames = realloc(trace->frames, trace->capacity * sizeof(*frames));
+			if (!frames) {
+				free(line);
+				replay_trace_free(trace);
+				return -ENOMEM;
+			}
+			trace->frames = frames;
+		}
+
+		if (replay_parse_line(start, &trace->frames[trace->count])) {
+			fprintf(stderr, "warning: %s:%zu: malformed report, skipping it\n", name, line_number);
+			trace->skipped++;
+			continue;
+		}
+		trace->count++;
+	}
+
+	free(line);
+
+	if (ferror(file)) {
+		fprintf(stderr, "error: failed to read '%s'\n", name);
+		replay_trace_free(trace);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+void replay_trace_free(struct replay_trace_t *trace)
+{
+	free(trace->frames);
+	memset(trace, 0, sizeof(*trace));
+}
+
+/* xorshift32, only to pick reservoir slots */
+static u32 replay_random(struct replay_stats_t *stats)
+{
+	stats->random ^= stats->random << 13;
+	stats->random ^= stats->random >> 17;
+	stats->random ^= stats->random << 5;
+	return stats->random;
+}
+
+static void replay_record_latency(struct replay_stats_t *stats, u32 latency)
+{
+	u64 slot;
+
+	if (latency > stats->max_latency_ns)
+		stats->max_latency_ns = latency;
+
+	/* reservoir sampling, every write has the same chance of being in the sample */
+	slot = stats->latency_seen++;
+	if (slot >= REPLAY_LATENCY_SAMPLES)
+		slot = ((u64) replay_random(stats) << 32 | replay_random(stats)) % stats->latency_seen;
+	if (slot < REPLAY_LATENCY_SAMPLES) {
+		stats->latencies[slot] = latency;
+		stats->latency_count = min(stats->latency_count + 1, REPLAY_LATENCY_SAMPLES);
+	}
+}
+
+static void replay_fill_report(u8 *buffer, const struct replay_frame_t *frame)
+{
+	struct mouse_report *report = (struct mouse_report *) buffer;
+
+	memset(report, 0, sizeof(*report));
+	report->id = MOUSE_REPORT_ID;
+	report->x = frame->x;
+	report->y = frame->y;
+	report->wheel = frame->wheel;
+	report->button1 = frame->buttons & 0x1;
+	report->button2 = (frame->buttons >> 1) & 0x1;
+	report->button3 = (frame->buttons >> 2) & 0x1;
+}
+
+int replay_run(struct uhid_data_t uhid,
+	       const struct replay_trace_t *trace,
+	       u32 rate,
+	       u32 repeat,
+	       volatile sig_atomic_t *stop,
+	       struct replay_stats_t *stats)
+{
+	const struct replay_frame_t *frame;
+	struct uhid_pool_t *pool;
+	u64 total, period, start, deadline, before, after;
+	size_t count;
+	int ret;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->random = 0x9E3779B9;
+
+	if (!trace->count || !rate || rate > REPLAY_MAX_RATE)
+		return -EINVAL;
+
+	stats->latencies = malloc(REPLAY_LATENCY_SAMPLES * sizeof(*stats->latencies));
+	pool = malloc(sizeof(*pool));
+	if (!stats->latencies || !pool) {
+		free(pool);
+		return -ENOMEM;
+	}
+	uhid_pool_init(pool);
+
+	/* the default 50us of timer slack is a big part of a 125us period */
+	prctl(PR_SET_TIMERSLACK, 1);
+
+	total = repeat ? (u64) repeat * trace->count : UINT64_MAX;
+	period = NSEC_PER_SEC / rate;
+	start = deadline = replay_now_ns();
+
+	for (u64 n = 0; n < total && !(stop && *stop);) {
+		replay_sleep_until(deadline);
+		before = replay_now_ns();
+
+		/* when behind schedule, everything that is due goes out in a single write */
+		do {
+			if (before - deadline > period)
+				stats->late++;
+			frame = &trace->frames[n % trace->count];
+			replay_fill_report(uhid_pool_reserve(pool, sizeof(struct mouse_report)), frame);
+			deadline += period;
+			n++;
+		} while (n < total && deadline <= before && pool->count < UHID_POOL_SIZE);
+
+		count = pool->count;
+		ret = uhid_pool_submit(uhid, pool);
+		after = replay_now_ns();
+
+		stats->sent += ret < 0 ? 0 : ret;
+		stats->failed += ret < 0 ? count : count - ret;
+		replay_record_latency(stats, min(after - before, UINT32_MAX));
+	}
+
+	stats->elapsed_ns = replay_now_ns() - start;
+	free(pool);
+	return 0;
+}
+
+int replay_benchmark(struct uhid_data_t uhid, u32 count, FILE *file)
+{
+	static const size_t batch_sizes[] = {1, 8, UHID_POOL_SIZE};
+	const struct replay_frame_t idle = {};
+	struct mouse_report report;
+	struct uhid_pool_t *pool;
+	u64 start, elapsed;
+	size_t batch;
+	int ret = 0;
+
+	pool = malloc(sizeof(*pool));
+	if (!pool)
+		return -ENOMEM;
+	uhid_pool_init(pool);
+
+	/* reports without motion or buttons, so the benchmark doesn't move the pointer */
+	replay_fill_report((u8 *) &report, &idle);
+
+	for (size_t i = 0; i < sizeof(batch_sizes) / sizeof(*batch_sizes); i++) {
+		batch = batch_sizes[i];
+		start = replay_now_ns();
+
+		for (u32 sent = 0; sent < count; sent += batch) {
+			if (batch == 1) {
+				ret = uhid_send(uhid, (u8 *) &report, sizeof(report));
+			} else {
+				for (size_t j = 0; j < min(batch, count - sent); j++)
+					memcpy(uhid_pool_reserve(pool, sizeof(report)), &report, sizeof(report));
+				ret = uhid_pool_submit(uhid, pool);
+			}
+			if (ret < 0)
+				goto out;
+		}
+
+		elapsed = replay_now_ns() - start;
+		fprintf(file,
+			"%s, %2zu per write: %10.0f reports/s\n",
+			batch == 1 ? "uhid_send" : "uhid_pool",
+			batch,
+			(double) count * NSEC_PER_SEC / elapsed);
+	}
+
+out:
+	free(pool);
+	return ret < 0 ? ret : 0;
+}
+
+static int replay_compare_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *) a, y = *(const u32 *) b;
+
+	return (x > y) - (x < y);
+}
+
+void replay_print_stats(FILE *file, struct replay_stats_t *stats, u32 rate)
+{
+	static const double percentiles[] = {50, 90, 99, 99.9};
+	double elapsed = (double) stats->elapsed_ns / NSEC_PER_SEC;
+	size_t index;
+
+	fprintf(file,
+		"sent %llu reports in %.3fs (%llu writes), %.1f Hz (target %u Hz), %llu late, %llu failed\n",
+		(unsigned long long) stats->sent,
+		elapsed,
+		(unsigned long long) stats->latency_seen,
+		elapsed > 0 ? stats->sent / elapsed : 0, /* failed writes are not throughput */
+		rate,
+		(unsigned long long) stats->late,
+		(unsigned long long) stats->failed);
+
+	if (!stats->latency_count)
+		return;
+
+	qsort(stats->latencies, stats->latency_count, sizeof(*stats->latencies), replay_compare_u32);
+
+	fprintf(file, "write latency (us):");
+	for (size_t i = 0; i < sizeof(percentiles) / sizeof(*percentiles); i++) {
+		index = (size_t) (percentiles[i] / 100 * (stats->latency_count - 1) + 0.5);
+		fprintf(file, " p%g %.1f", percentiles[i], stats->latencies[index] / 1000.0);
+	}
+	fprintf(file, " max %.1f\n", stats->max_latency_ns / 1000.0);
+}
+
+void replay_stats_free(struct replay_stats_t *stats)
+{
+	free(stats->latencies);
+	stats->latencies = NULL;
+	stats->latency_count = 0;
+}
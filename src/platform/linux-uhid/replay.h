@@ -0,0 +1,73 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include <signal.h>
+#include <stdio.h>
+
+#include "platform/linux-uhid/uhid.h"
+#include "util/types.h"
+
+/*
+ * Headless motion replay, to load test the host input stack
+ *
+ * A trace is a text file with one mouse report per line, "<dx> <dy> [buttons
+ * [wheel]]", buttons being a bitmask (bit 0 is the left button). Empty lines and
+ * lines starting with # are ignored, malformed lines are reported and skipped.
+ * The whole trace is loaded before the replay starts, so reading it (eg. from a
+ * pipe) doesn't disturb the timing.
+ *
+ * Reports are sent one per period on an absolute schedule, a late report doesn't
+ * push the following ones back, and when the replay falls behind all the reports
+ * that are due go out in a single write. Every write to uhid is timed, the
+ * latencies are kept in a fixed size reservoir sample so long runs don't grow
+ * memory.
+ */
+
+#define REPLAY_MAX_RATE	       8000
+#define REPLAY_LATENCY_SAMPLES (1 << 20)
+
+struct replay_frame_t {
+	s8 x;
+	s8 y;
+	s8 wheel;
+	u8 buttons;
+};
+
+struct replay_trace_t {
+	struct replay_frame_t *frames;
+	size_t count;
+	size_t capacity;
+	size_t skipped; /* malformed lines */
+};
+
+struct replay_stats_t {
+	u64 sent;
+	u64 failed;
+	u64 late; /* reports sent more than a period after their slot */
+	u64 elapsed_ns;
+	u32 max_latency_ns;
+	/* write latency sample, a write can carry several late reports */
+	u32 *latencies;
+	size_t latency_count;
+	u64 latency_seen;
+	u32 random;
+};
+
+int replay_trace_load(struct replay_trace_t *trace, FILE *file, const char *name);
+void replay_trace_free(struct replay_trace_t *trace);
+
+/* repeat 0 replays the trace until stop is set, stop may be NULL */
+int replay_run(struct uhid_data_t uhid,
+	       const struct replay_trace_t *trace,
+	       u32 rate,
+	       u32 repeat,
+	       volatile sig_atomic_t *stop,
+	       struct replay_stats_t *stats);
+/* sends count idle reports per write size, and prints the throughput in reports/s */
+int replay_benchmark(struct uhid_data_t uhid, u32 count, FILE *file);
+void replay_print_stats(FILE *file, struct replay_stats_t *stats, u32 rate);
+void replay_stats_free(struct replay_stats_t *stats);
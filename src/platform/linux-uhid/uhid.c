@@ -5,6 +5,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
@@ -14,22 +15,34 @@
 #include "uhid.h"
 #include "util/types.h"
 
-static int uhid_write(struct uhid_data_t data, struct uhid_event event)
+static int uhid_write(struct uhid_data_t data, const struct uhid_event *event, size_t size)
 {
-	size_t ret = write(data.uhid_fd, &event, sizeof(event));
+	ssize_t ret = write(data.uhid_fd, event, size);
 	if (ret < 0) {
 		fprintf(stderr, "error: couldn't write to uhid (%m)\n");
 		return -errno;
-	} else if (ret != sizeof(event)) {
-		fprintf(stderr, "error: failed to write to uhid (tried to write %d, wrote %d)", sizeof(event), ret);
+	} else if ((size_t) ret != size) {
+		fprintf(stderr, "error: failed to write to uhid (tried to write %zu, wrote %zd)\n", size, ret);
 		return -EFAULT;
 	}
 	return 0;
 }
 
-int uhid_open(struct uhid_data_t *data)
+int uhid_epoll_create(void)
+{
+	int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+	if (epoll_fd == -1) {
+		fprintf(stderr, "error: failed to open epoll fd (%m)\n");
+		return -errno;
+	}
+	return epoll_fd;
+}
+
+int uhid_open(struct uhid_data_t *data, int epoll_fd, void *epoll_data)
 {
 	struct epoll_event epoll_event;
+	int ret;
 
 	/* open uhid fd */
 	data->uhid_fd = open("/dev/uhid", O_RDWR | O_CLOEXEC);
@@ -38,19 +51,15 @@ int uhid_open(struct uhid_data_t *data)
 		return -errno;
 	}
 
-	/* create epoll */
-	data->epoll_fd = epoll_create1(0);
-	if (data->epoll_fd == -1) {
-		fprintf(stderr, "error: failed to open epoll fd (%m)\n");
-		return -errno;
-	}
-
 	/* register uhid fd in epoll */
 	epoll_event.events = EPOLLIN;
-	epoll_event.data.fd = data->uhid_fd;
-	if (epoll_ctl(data->epoll_fd, EPOLL_CTL_ADD, data->uhid_fd, &epoll_event)) {
+	epoll_event.data.ptr = epoll_data;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, data->uhid_fd, &epoll_event)) {
 		fprintf(stderr, "error: failed to register uhid fd in epoll (%m)\n");
-		return -errno;
+		ret = -errno;
+		close(data->uhid_fd);
+		data->uhid_fd = -1;
+		return ret;
 	}
 
 	return 0;
@@ -58,14 +67,14 @@ int uhid_open(struct uhid_data_t *data)
 
 void uhid_close(struct uhid_data_t data)
 {
-	close(data.uhid_fd);
-	close(data.epoll_fd);
+	if (data.uhid_fd >= 0)
+		close(data.uhid_fd);
 }
 
 int uhid_create(struct uhid_data_t data, struct uhid_create2_req request)
 {
 	struct uhid_event event = {UHID_CREATE2, .u.create2 = request};
-	int ret = uhid_write(data, event);
+	int ret = uhid_write(data, &event, sizeof(event));
 	if (ret)
 		fprintf(stderr, "failed to create uhid device\n");
 	return ret;
@@ -90,39 +99,141 @@ int uhid_read_event(struct uhid_data_t data, struct uhid_event *event)
 	return 0;
 }
 
-void uhid_wait_for_kernel_start(struct uhid_data_t data)
+int uhid_wait_for_kernel_start(struct uhid_data_t data, int timeout)
 {
-	int event_count;
+	/* the shared epoll would also report the other devices, poll this one alone */
+	struct pollfd pollfd = {.fd = data.uhid_fd, .events = POLLIN};
 	struct uhid_event event;
+	int ret;
+
 	for (;;) {
-		event_count = epoll_wait(data.epoll_fd, data.epoll_events, 1, 3000);
-		uhid_read_event(data, &event);
+		ret = poll(&pollfd, 1, timeout);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret < 0) {
+			fprintf(stderr, "error: failed to wait for the kernel (%m)\n");
+			return -errno;
+		}
+		if (ret == 0) {
+			fprintf(stderr, "error: the kernel didn't start the device in %d ms\n", timeout);
+			return -ETIMEDOUT;
+		}
+
+		ret = uhid_read_event(data, &event);
+		if (ret)
+			return ret;
 		if (event.type == UHID_START)
-			break;
+			return 0;
 	}
 }
 
-int uhid_wait_for_events(struct uhid_data_t data, int timeout)
+int uhid_wait_for_events(int epoll_fd, struct epoll_event *events, int timeout)
 {
-	return epoll_wait(data.epoll_fd, data.epoll_events, MAX_EPOLL_EVENTS, timeout);
+	return epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, timeout);
 }
 
 int uhid_send(struct uhid_data_t data, u8 *buffer, size_t buffer_len)
 {
+	/* reports come from the dispatch thread and the main thread, each gets its own event */
+	static __thread struct uhid_event event = {.type = UHID_INPUT2};
 	int ret;
-	struct uhid_event event = {
-		.type = UHID_INPUT2,
-		.u.input2.size = buffer_len,
-	};
-	memcpy(event.u.input2.data, buffer, buffer_len);
 
 	if (buffer_len > sizeof(event.u.input2.data)) {
-		fprintf(stderr, "error: packet too big (size is %d, max is %d)\n", buffer_len, sizeof(event.u.input2.data));
+		fprintf(stderr, "error: packet too big (size is %zu, max is %zu)\n", buffer_len, sizeof(event.u.input2.data));
 		return -EINVAL;
 	}
 
-	ret = uhid_write(data, event);
+	event.u.input2.size = buffer_len;
+	memcpy(event.u.input2.data, buffer, buffer_len);
+
+	ret = uhid_write(data, &event, UHID_INPUT2_HEADER_SIZE + buffer_len);
 	if (ret)
 		fprintf(stderr, "failed to send report to device\n");
 	return ret;
 }
+
+int uhid_get_report_reply(struct uhid_data_t data, u32 id, u16 err, const u8 *buffer, size_t buffer_len)
+{
+	static __thread struct uhid_event event = {.type = UHID_GET_REPORT_REPLY};
+
+	if (buffer_len > sizeof(event.u.get_report_reply.data)) {
+		fprintf(stderr,
+			"error: report too big (size is %zu, max is %zu)\n",
+			buffer_len,
+			sizeof(event.u.get_report_reply.data));
+		return -EINVAL;
+	}
+
+	event.u.get_report_reply.id = id;
+	event.u.get_report_reply.err = err;
+	event.u.get_report_reply.size = buffer_len;
+	if (buffer_len)
+		memcpy(event.u.get_report_reply.data, buffer, buffer_len);
+
+	return uhid_write(data, &event, offsetof(struct uhid_event, u.get_report_reply.data) + buffer_len);
+}
+
+int uhid_set_report_reply(struct uhid_data_t data, u32 id, u16 err)
+{
+	static __thread struct uhid_event event = {.type = UHID_SET_REPORT_REPLY};
+
+	event.u.set_report_reply.id = id;
+	event.u.set_report_reply.err = err;
+
+	return uhid_write(data, &event, offsetof(struct uhid_event, u.set_report_reply) + sizeof(event.u.set_report_reply));
+}
+
+void uhid_pool_init(struct uhid_pool_t *pool)
+{
+	for (size_t i = 0; i < UHID_POOL_SIZE; i++) {
+		pool->events[i].type = UHID_INPUT2;
+		pool->iov[i].iov_base = &pool->events[i];
+	}
+	pool->count = 0;
+}
+
+u8 *uhid_pool_reserve(struct uhid_pool_t *pool, size_t size)
+{
+	struct uhid_event *event;
+
+	if (pool->count == UHID_POOL_SIZE || size > sizeof(event->u.input2.data))
+		return NULL;
+
+	event = &pool->events[pool->count];
+	event->u.input2.size = size;
+	pool->iov[pool->count].iov_len = UHID_INPUT2_HEADER_SIZE + size;
+	pool->count++;
+
+	return event->u.input2.data;
+}
+
+int uhid_pool_submit(struct uhid_data_t data, struct uhid_pool_t *pool)
+{
+	size_t sent = 0;
+	ssize_t ret;
+
+	while (sent < pool->count) {
+		ret = writev(data.uhid_fd, pool->iov + sent, pool->count - sent);
+		if (ret < 0) {
+			fprintf(stderr, "error: couldn't write to uhid (%m)\n");
+			if (!sent) {
+				ret = -errno;
+				pool->count = 0;
+				return ret;
+			}
+			break;
+		} else if (!ret) {
+			break;
+		}
+
+		/* the kernel stops at the first event it rejects */
+		for (; sent < pool->count && (size_t) ret >= pool->iov[sent].iov_len; sent++) ret -= pool->iov[sent].iov_len;
+		if (ret) {
+			fprintf(stderr, "error: failed to write to uhid (partial event)\n");
+			break;
+		}
+	}
+
+	pool->count = 0;
+	return sent;
+}
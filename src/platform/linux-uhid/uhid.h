@@ -6,20 +6,52 @@
 #pragma once
 
 #include <linux/uhid.h>
+#include <stddef.h>
 #include <sys/epoll.h>
+#include <sys/uio.h>
 
-#define MAX_EPOLL_EVENTS 10
+#include "util/types.h"
+
+#define MAX_EPOLL_EVENTS 64
+#define UHID_POOL_SIZE	 64
+
+/* the kernel takes shorter writes, the rest of the event is zeroed */
+#define UHID_INPUT2_HEADER_SIZE offsetof(struct uhid_event, u.input2.data)
 
 struct uhid_data_t {
 	int uhid_fd;
-	int epoll_fd;
-	struct epoll_event epoll_events[MAX_EPOLL_EVENTS];
 };
 
-int uhid_open(struct uhid_data_t *data);
+/*
+ * Input report pool, for sending several reports in a single syscall
+ *
+ * Reports are built in place in preallocated events, and submitted with a
+ * single writev. uhid has no write_iter, so the kernel handles each iovec as a
+ * write of its own, one event each. Only the header and the report data are
+ * written, not the whole 4K event.
+ */
+struct uhid_pool_t {
+	struct uhid_event events[UHID_POOL_SIZE];
+	struct iovec iov[UHID_POOL_SIZE];
+	size_t count;
+};
+
+/* a single epoll instance serves every device, epoll_data identifies the device in the events */
+int uhid_epoll_create(void);
+int uhid_open(struct uhid_data_t *data, int epoll_fd, void *epoll_data);
 void uhid_close(struct uhid_data_t data);
 int uhid_create(struct uhid_data_t data, struct uhid_create2_req request);
 int uhid_read_event(struct uhid_data_t data, struct uhid_event *event);
-void uhid_wait_for_kernel_start(struct uhid_data_t data);
-int uhid_wait_for_events(struct uhid_data_t data, int timeout);
+/* waits for UHID_START, up to timeout ms for each event */
+int uhid_wait_for_kernel_start(struct uhid_data_t data, int timeout);
+int uhid_wait_for_events(int epoll_fd, struct epoll_event *events, int timeout);
 int uhid_send(struct uhid_data_t data, u8 *buffer, size_t buffer_len);
+/* the kernel blocks the requester until the reply, err is an errno value, 0 on success */
+int uhid_get_report_reply(struct uhid_data_t data, u32 id, u16 err, const u8 *buffer, size_t buffer_len);
+int uhid_set_report_reply(struct uhid_data_t data, u32 id, u16 err);
+
+void uhid_pool_init(struct uhid_pool_t *pool);
+/* returns the buffer to build the report in, NULL if the pool is full or the report too big */
+u8 *uhid_pool_reserve(struct uhid_pool_t *pool, size_t size);
+/* sends the reserved reports and empties the pool, returns how many were sent or a negative error */
+int uhid_pool_submit(struct uhid_data_t data, struct uhid_pool_t *pool);
@@ -25,7 +25,7 @@ extern u32 eefc_perform_fcr(u32 fcr);
 
 static u32 eefc_get_result();
 static u32 eefc_get_status();
-static void eefc_perform_command(u32 command, u32 argument);
+static u32 eefc_perform_command(u32 command, u32 argument);
 
 void eefc_init()
 {
@@ -98,9 +98,13 @@ u32 eefc_erase_16(u32 addr)
 {
 	u32 page = eefc_addr_to_page(addr);
 
+	u32 errors;
+
 	/* give erase and write page command */
-	eefc_perform_command(EEFC_FCR_FCMD_EPA, (page & ~0xF) | 2); /* 16 pages (minimum for large sectors) */
+	errors = eefc_perform_command(EEFC_FCR_FCMD_EPA, (page & ~0xF) | 2); /* 16 pages (minimum for large sectors) */
 	while (!(eefc_get_status() & EEFC_FSR_FRDY_Msk)) continue;
+
+	return errors;
 }
 
 void eefc_read(void *buffer, u32 addr, u32 size)
@@ -112,11 +116,13 @@ void eefc_read(void *buffer, u32 addr, u32 size)
 	}
 }
 
-void eefc_write(u32 addr, void *buffer, u32 size)
+u32 eefc_write(u32 addr, void *buffer, u32 size)
 {
+	u32 errors;
+
 	/* require 128 bit alignment, and single page writes */
-	if ((addr % 16) || (size % 16) || ((size + (addr % 16)) > flash_info.page_size)) {
-		return;
+	if ((addr % 16) || (size % 16) || ((addr % flash_info.page_size) + size > flash_info.page_size)) {
+		return EEFC_FSR_FCMDE_Msk;
 	}
 
 	size /= 4;
@@ -129,8 +135,10 @@ void eefc_write(u32 addr, void *buffer, u32 size)
 	u32 page = eefc_addr_to_page(addr);
 
 	/* give erase and write page command */
-	eefc_perform_command(EEFC_FCR_FCMD_WP, page);
+	errors = eefc_perform_command(EEFC_FCR_FCMD_WP, page);
 	while (!(eefc_get_status() & EEFC_FSR_FRDY_Msk)) continue;
+
+	return errors;
 }
 
 static u32 eefc_get_status()
@@ -143,18 +151,23 @@ static u32 eefc_get_result()
 	return EFC->EEFC_FRR;
 }
 
-static void eefc_perform_command(u32 command, u32 argument)
+/* returns the error flags of the command */
+static u32 eefc_perform_command(u32 command, u32 argument)
 {
+	u32 errors = 0;
+
 	/* Unique ID commands are not supported. */
 	if (command == EEFC_FCR_FCMD_STUI || command == EEFC_FCR_FCMD_SPUI) {
-		return;
+		return EEFC_FSR_FCMDE_Msk;
 	}
 
 	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
 		/* Use RAM Function. */
-		eefc_perform_fcr(EEFC_FCR_FKEY_PASSWD | EEFC_FCR_FARG(argument) | EEFC_FCR_FCMD(command));
+		errors = eefc_perform_fcr(EEFC_FCR_FKEY_PASSWD | EEFC_FCR_FARG(argument) | EEFC_FCR_FCMD(command));
 	}
+
+	return errors;
 }
 
 __attribute__((noinline, section(".ramfunc"))) void eefc_write_fmr(u32 fmr)
@@ -26,6 +26,7 @@ const struct flash_info_t *eefc_get_info();
 s32 eefc_addr_to_page(u32 addr);
 u32 eefc_page_to_addr(u32 page);
 
+/* erase and write return the EEFC error flags, 0 on success */
 u32 eefc_erase_16(u32 addr);
 void eefc_read(void *buffer, u32 addr, u32 size);
-void eefc_write(u32 addr, void *buffer, u32 size);
+u32 eefc_write(u32 addr, void *buffer, u32 size);
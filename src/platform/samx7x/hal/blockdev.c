@@ -3,31 +3,56 @@
  * SPDX-FileCopyrightText: 2022 Rafael Silva <perigoso@riseup.net>
  */
 
+#include <errno.h>
+
 #include "platform/samx7x/hal/blockdev.h"
+#include "util/data.h"
 
 s8 eefc_hal_read(struct blockdev_hal_t mem_block, u16 block, u16 offset, void *buffer, u16 size)
 {
 	struct blockdev_drv_t *drv_data = mem_block.drv_data;
 	eefc_read(buffer, (block * mem_block.block_size) + drv_data->start_addr + offset, size);
+	return 0;
 }
 
 s8 eefc_hal_write(struct blockdev_hal_t mem_block, u16 block, u16 offset, void *buffer, u16 size)
 {
 	struct blockdev_drv_t *drv_data = mem_block.drv_data;
-	eefc_write((block * mem_block.block_size) + drv_data->start_addr + offset, buffer, size);
+	u32 page_size = eefc_get_info()->page_size;
+	u32 addr = (block * mem_block.block_size) + drv_data->start_addr + offset;
+	u8 *data = buffer;
+	u32 count;
+
+	if (offset % mem_block.write_size || size % mem_block.write_size)
+		return -EINVAL;
+
+	/* the EEFC programs one page at a time */
+	while (size) {
+		count = min(size, page_size - (addr % page_size));
+		if (eefc_write(addr, data, count))
+			return -EIO;
+		addr += count;
+		data += count;
+		size -= count;
+	}
+
+	return 0;
 }
 
 s8 eefc_hal_erase(struct blockdev_hal_t mem_block, u16 block)
 {
 	struct blockdev_drv_t *drv_data = mem_block.drv_data;
 	/* erase in 16 page groups */
-	eefc_erase_16((block * mem_block.block_size) + drv_data->start_addr);
+	if (eefc_erase_16((block * mem_block.block_size) + drv_data->start_addr))
+		return -EIO;
+	return 0;
 }
 
 s8 eefc_hal_sync(struct blockdev_hal_t mem_block)
 {
-	/* not used */
+	/* programs and erases are synchronous, put a block_cache_t on top to batch them */
 	(void) mem_block;
+	return 0;
 }
 
 struct blockdev_hal_t blockdev_hal_init_eefc(struct blockdev_drv_t *drv_data)
@@ -3,6 +3,8 @@
  * SPDX-FileCopyrightText: 2021 Rafael Silva <silvagracarafael@gmail.com>
  */
 
+#include <errno.h>
+
 #include "platform/samx7x/hal/hid.h"
 
 #define CFG_TUSB_CONFIG_FILE "targets/sams70-generic/tusb_config.h"
@@ -10,7 +12,8 @@
 
 int hid_hal_send(struct hid_hal_t interface, u8 *buffer, size_t buffer_size)
 {
-	tud_hid_n_report(0, 0, buffer, buffer_size);
+	/* the endpoint only holds one report, the previous one is still waiting for the host */
+	return tud_hid_n_report(0, 0, buffer, buffer_size) ? 0 : -EBUSY;
 }
 
 struct hid_hal_t hid_hal_init(void)
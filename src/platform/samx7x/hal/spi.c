@@ -17,10 +17,23 @@ u8 qspi_hal_transfer(struct spi_hal_t interface, u8 data)
 	return qspi_transfer_byte(data);
 }
 
+void qspi_hal_transfer_buf(struct spi_hal_t interface, const u8 *src, u8 *dst, size_t size)
+{
+	return qspi_transfer(src, size, dst);
+}
+
+void qspi_hal_transfer_async(
+	struct spi_hal_t interface, const u8 *src, u8 *dst, size_t size, void (*callback)(void *data), void *data)
+{
+	return qspi_transfer_async(src, size, dst, callback, data);
+}
+
 struct spi_hal_t spi_hal_init_qspi(struct qspi_device_t *drv_data)
 {
 	struct spi_hal_t hal = {
 		.transfer = qspi_hal_transfer,
+		.transfer_buf = qspi_hal_transfer_buf,
+		.transfer_async = qspi_hal_transfer_async,
 		.select = qspi_hal_select,
 		.drv_data = drv_data,
 	};
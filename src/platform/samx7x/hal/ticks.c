@@ -16,11 +16,23 @@ void ticks_hal_delay_us(u32 ticks)
 	return delay_us(ticks);
 }
 
+u64 ticks_hal_now_us()
+{
+	return systick_get_us();
+}
+
+u64 ticks_hal_now_cycles()
+{
+	return systick_get_cycles();
+}
+
 struct ticks_hal_t ticks_hal_init()
 {
 	struct ticks_hal_t hal = {
 		.delay_ms = ticks_hal_delay_ms,
 		.delay_us = ticks_hal_delay_us,
+		.now_us = ticks_hal_now_us,
+		.now_cycles = ticks_hal_now_cycles,
 		.drv_data = NULL,
 	};
 	return hal;
@@ -0,0 +1,12 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/timer.h"
+#include "platform/samx7x/timer.h"
+#include "util/types.h"
+
+struct timer_hal_t timer_hal_init(enum timer_channel_no channel_no);
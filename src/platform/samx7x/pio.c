@@ -25,6 +25,17 @@
 	_PIO(port)->PIO_ABCDSR[0] = (_PIO(port)->PIO_ABCDSR[0] & ~BIT(pin)) | (!!((sel) &BIT(0)) << (pin)); \
 	_PIO(port)->PIO_ABCDSR[1] = (_PIO(port)->PIO_ABCDSR[1] & ~BIT(pin)) | (!!((sel) &BIT(1)) << (pin));
 
+/* maximum number of pins with an interrupt callback attached */
+#define PIO_INTERRUPT_COUNT 8
+
+struct pio_interrupt_t {
+	struct pio_pin_t pin;
+	void (*callback)(void *data);
+	void *data;
+};
+
+static struct pio_interrupt_t pio_interrupts[PIO_INTERRUPT_COUNT];
+
 void pio_init()
 {
 /**
@@ -318,3 +329,113 @@ u8 pio_get(struct pio_pin_t pin)
 {
 	return !!(_PIO(pin.port)->PIO_PDSR & BIT(pin.pin));
 }
+
+/*
+ * calls callback, from interrupt context, on the selected edges of pin
+ * a NULL callback detaches the pin
+ */
+void pio_attach_interrupt(struct pio_pin_t pin, enum pio_edge_t edge, void (*callback)(void *data), void *data)
+{
+	struct pio_interrupt_t *slot = NULL;
+	IRQn_Type irqn;
+
+	_PIO(pin.port)->PIO_IDR = BIT(pin.pin);
+
+	for (size_t i = 0; i < PIO_INTERRUPT_COUNT; i++) {
+		if (pio_interrupts[i].callback && pio_interrupts[i].pin.port == pin.port && pio_interrupts[i].pin.pin == pin.pin) {
+			slot = &pio_interrupts[i];
+			break;
+		}
+		if (!slot && !pio_interrupts[i].callback)
+			slot = &pio_interrupts[i];
+	}
+
+	if (!slot) /* out of slots */
+		return;
+
+	slot->pin = pin;
+	slot->callback = callback;
+	slot->data = data;
+
+	if (!callback)
+		return;
+
+	if (edge == PIO_EDGE_BOTH) {
+		_PIO(pin.port)->PIO_AIMDR = BIT(pin.pin); /* both edges is the default mode */
+	} else {
+		_PIO(pin.port)->PIO_ESR = BIT(pin.pin);
+		if (edge == PIO_EDGE_RISING)
+			_PIO(pin.port)->PIO_REHLSR = BIT(pin.pin);
+		else
+			_PIO(pin.port)->PIO_FELLSR = BIT(pin.pin);
+		_PIO(pin.port)->PIO_AIMER = BIT(pin.pin);
+	}
+
+	(void) _PIO(pin.port)->PIO_ISR; /* clear stale events */
+	_PIO(pin.port)->PIO_IER = BIT(pin.pin);
+
+	switch (pin.port) {
+		case PIO_PORT_A:
+			irqn = PIOA_IRQn;
+			break;
+		case PIO_PORT_B:
+			irqn = PIOB_IRQn;
+			break;
+#if defined(PIOC)
+		case PIO_PORT_C:
+			irqn = PIOC_IRQn;
+			break;
+#endif
+		case PIO_PORT_D:
+			irqn = PIOD_IRQn;
+			break;
+#if defined(PIOE)
+		case PIO_PORT_E:
+			irqn = PIOE_IRQn;
+			break;
+#endif
+		default:
+			return;
+	}
+
+	NVIC_EnableIRQ(irqn);
+}
+
+static void pio_dispatch_interrupts(u8 port)
+{
+	/* reading ISR clears all the port flags, so we service every pin from a single read */
+	u32 pending = _PIO(port)->PIO_ISR & _PIO(port)->PIO_IMR;
+
+	for (size_t i = 0; i < PIO_INTERRUPT_COUNT; i++)
+		if (pio_interrupts[i].callback && pio_interrupts[i].pin.port == port && (pending & BIT(pio_interrupts[i].pin.pin)))
+			pio_interrupts[i].callback(pio_interrupts[i].data);
+}
+
+void _pioa_isr()
+{
+	pio_dispatch_interrupts(PIO_PORT_A);
+}
+
+void _piob_isr()
+{
+	pio_dispatch_interrupts(PIO_PORT_B);
+}
+
+#if defined(PIOC)
+void _pioc_isr()
+{
+	pio_dispatch_interrupts(PIO_PORT_C);
+}
+#endif
+
+void _piod_isr()
+{
+	pio_dispatch_interrupts(PIO_PORT_D);
+}
+
+#if defined(PIOE)
+void _pioe_isr()
+{
+	pio_dispatch_interrupts(PIO_PORT_E);
+}
+#endif
@@ -52,6 +52,12 @@ enum pio_config_flags_t {
 	PIO_PERIPHERAL_CTRL = 0x40, // bit 7
 };
 
+enum pio_edge_t {
+	PIO_EDGE_RISING = 0x1,
+	PIO_EDGE_FALLING = 0x2,
+	PIO_EDGE_BOTH = 0x3,
+};
+
 void pio_init();
 
 void pio_config(
@@ -73,3 +79,5 @@ void pio_pull(struct pio_pin_t pin, enum pio_pull_t pull);
 void pio_set(struct pio_pin_t pin, u8 state);
 
 u8 pio_get(struct pio_pin_t pin);
+
+void pio_attach_interrupt(struct pio_pin_t pin, enum pio_edge_t edge, void (*callback)(void *data), void *data);
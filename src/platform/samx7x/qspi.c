@@ -9,8 +9,18 @@
 #include "platform/samx7x/pmc.h"
 #include "platform/samx7x/qspi.h"
 
+#include "util/data.h"
 #include "util/types.h"
 
+/* XDMAC channels and hardware interface IDs (peripheral IDs) used for the background transfers */
+#define QSPI_XDMAC_TX_CHANNEL 0
+#define QSPI_XDMAC_RX_CHANNEL 1
+#define QSPI_XDMAC_TX_PERID   5
+#define QSPI_XDMAC_RX_PERID   6
+
+static void (*qspi_async_callback)(void *data);
+static void *qspi_async_data;
+
 void qspi_init_interface(enum qspi_mode mode, u32 frequency)
 {
 	const struct pmc_clock_tree_t *clock_tree = pmc_get_clock_tree();
@@ -49,6 +59,10 @@ void qspi_init_interface(enum qspi_mode mode, u32 frequency)
 	}
 	/* Enable QSPI */
 	QSPI->QSPI_CR = QSPI_CR_QSPIEN_Msk;
+
+	/* Enable XDMAC, used by qspi_transfer_async */
+	pmc_peripheral_clock_gate(XDMAC_CLOCK_ID, 1);
+	NVIC_EnableIRQ(XDMAC_IRQn);
 }
 
 struct qspi_device_t qspi_init_device(struct pio_pin_t cs_pio, u8 cs_inverted)
@@ -93,3 +107,71 @@ void qspi_transfer(const u8 *src, u32 size, u8 *dst)
 		while (size--) *(dst++) = qspi_transfer_byte(0x00);
 	}
 }
+
+static void qspi_xdmac_setup(u8 channel, u32 src, u32 dst, u32 size, u32 config)
+{
+	(void) XDMAC->XDMAC_CHID[channel].XDMAC_CIS; /* clear stale interrupt flags */
+
+	XDMAC->XDMAC_CHID[channel].XDMAC_CSA = src;
+	XDMAC->XDMAC_CHID[channel].XDMAC_CDA = dst;
+	XDMAC->XDMAC_CHID[channel].XDMAC_CUBC = XDMAC_CUBC_UBLEN(size);
+	XDMAC->XDMAC_CHID[channel].XDMAC_CC = XDMAC_CC_TYPE_PER_TRAN | XDMAC_CC_MBSIZE_SINGLE | XDMAC_CC_CSIZE_CHK_1 |
+					      XDMAC_CC_DWIDTH_BYTE | config;
+	XDMAC->XDMAC_CHID[channel].XDMAC_CNDC = 0;
+	XDMAC->XDMAC_CHID[channel].XDMAC_CBC = 0;
+	XDMAC->XDMAC_CHID[channel].XDMAC_CDS_MSP = 0;
+	XDMAC->XDMAC_CHID[channel].XDMAC_CSUS = 0;
+	XDMAC->XDMAC_CHID[channel].XDMAC_CDUS = 0;
+}
+
+/*
+ * transfers size bytes in the background with XDMAC, src and/or dst may be NULL
+ * callback is called from interrupt context once the transfer is complete
+ */
+void qspi_transfer_async(const u8 *src, u32 size, u8 *dst, void (*callback)(void *data), void *data)
+{
+	static const u8 tx_dummy = 0x00;
+	static u8 rx_dummy;
+
+	if (!size) {
+		if (callback)
+			callback(data);
+		return;
+	}
+
+	qspi_async_callback = callback;
+	qspi_async_data = data;
+
+	(void) QSPI->QSPI_RDR; /* drop stale data */
+
+	qspi_xdmac_setup(
+		QSPI_XDMAC_RX_CHANNEL,
+		(u32) &QSPI->QSPI_RDR,
+		(u32) (dst ? dst : &rx_dummy),
+		size,
+		XDMAC_CC_DSYNC_PER2MEM | XDMAC_CC_SIF_AHB_IF1 | XDMAC_CC_DIF_AHB_IF0 | XDMAC_CC_SAM_FIXED_AM |
+			(dst ? XDMAC_CC_DAM_INCREMENTED_AM : XDMAC_CC_DAM_FIXED_AM) | XDMAC_CC_PERID(QSPI_XDMAC_RX_PERID));
+	qspi_xdmac_setup(
+		QSPI_XDMAC_TX_CHANNEL,
+		(u32) (src ? src : &tx_dummy),
+		(u32) &QSPI->QSPI_TDR,
+		size,
+		XDMAC_CC_DSYNC_MEM2PER | XDMAC_CC_SIF_AHB_IF0 | XDMAC_CC_DIF_AHB_IF1 | XDMAC_CC_DAM_FIXED_AM |
+			(src ? XDMAC_CC_SAM_INCREMENTED_AM : XDMAC_CC_SAM_FIXED_AM) | XDMAC_CC_PERID(QSPI_XDMAC_TX_PERID));
+
+	/* the RX channel finishes last, its block end interrupt ends the transfer */
+	XDMAC->XDMAC_CHID[QSPI_XDMAC_RX_CHANNEL].XDMAC_CIE = XDMAC_CIE_BIE;
+	XDMAC->XDMAC_GIE = BIT(QSPI_XDMAC_RX_CHANNEL);
+	XDMAC->XDMAC_GE = BIT(QSPI_XDMAC_RX_CHANNEL) | BIT(QSPI_XDMAC_TX_CHANNEL);
+}
+
+void _xdmac_isr()
+{
+	if (!(XDMAC->XDMAC_CHID[QSPI_XDMAC_RX_CHANNEL].XDMAC_CIS & XDMAC_CIS_BIS))
+		return;
+
+	XDMAC->XDMAC_GID = BIT(QSPI_XDMAC_RX_CHANNEL);
+
+	if (qspi_async_callback)
+		qspi_async_callback(qspi_async_data);
+}
@@ -25,3 +25,4 @@ struct qspi_device_t qspi_init_device(struct pio_pin_t cs_pio, u8 cs_inverted);
 void qspi_select(struct qspi_device_t device, u8 state);
 u8 qspi_transfer_byte(const u8 data);
 void qspi_transfer(const u8 *src, u32 size, u8 *dst);
+void qspi_transfer_async(const u8 *src, u32 size, u8 *dst, void (*callback)(void *data), void *data);
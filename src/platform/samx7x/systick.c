@@ -12,11 +12,16 @@
 
 static volatile u64 system_tick = 0;
 
+static u32 cycle_count_last;
+static u32 cycle_count_wraps;
+
 static u32 systick_clock_freq;
 
 void _systick_isr()
 {
 	system_tick++;
+
+	systick_get_cycles();
 }
 
 void systick_init()
@@ -44,6 +49,47 @@ u64 systick_get_ticks()
 	return system_tick;
 }
 
+/* microsecs since boot */
+u64 systick_get_us()
+{
+	u64 tick;
+	u32 val;
+	u32 pending;
+	u32 load = SysTick->LOAD;
+
+	/* retry if the tick interrupt ran while we were sampling */
+	do {
+		tick = system_tick;
+		val = SysTick->VAL;
+		pending = SCB->ICSR & SCB_ICSR_PENDSTSET_Msk;
+	} while (tick != system_tick);
+
+	/* the counter reloaded but the interrupt is masked (eg. we are in a higher priority ISR) */
+	if (pending && val > load / 2)
+		tick++;
+
+	return tick * 1000 + (u64) (load - val) * 1000 / (load + 1);
+}
+
+/* DWT->CYCCNT extended to 64 bits, the tick ISR reads it every ms so we never miss a wrap */
+u64 systick_get_cycles()
+{
+	u64 cycles;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		u32 count = DWT->CYCCNT;
+
+		if (count < cycle_count_last)
+			cycle_count_wraps++;
+		cycle_count_last = count;
+
+		cycles = ((u64) cycle_count_wraps << 32) | count;
+	}
+
+	return cycles;
+}
+
 void delay_ms(u32 ticks)
 {
 	NONATOMIC_BLOCK(NONATOMIC_RESTORESTATE)
@@ -9,5 +9,7 @@
 
 void systick_init();
 u64 systick_get_ticks();
+u64 systick_get_us();
+u64 systick_get_cycles();
 void delay_ms(u32 ticks);
 void delay_us(u32 ticks);
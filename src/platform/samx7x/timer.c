@@ -0,0 +1,104 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <sam.h>
+
+#include "platform/samx7x/atomic.h"
+#include "platform/samx7x/pmc.h"
+#include "platform/samx7x/timer.h"
+#include "util/data.h"
+
+/*
+ * Every TC0 channel runs from MCK/128 (~1.2MHz at 150MHz) in waveform mode, it
+ * counts up to RC and stops there, raising the RC compare interrupt. The counter
+ * is 16 bits, so a timeout can be up to ~55ms away.
+ */
+
+#define TIMER_MAX_TICKS 0xFFFF
+
+/* each TC0 channel has its own peripheral ID, which is also its interrupt number */
+#define TIMER_CHANNEL_ID(channel_no) (23 + (channel_no))
+
+struct timer_channel_t {
+	void (*callback)(void *data);
+	void *data;
+};
+
+static struct timer_channel_t timer_channels[TIMER_CHANNEL_COUNT];
+static u32 timer_clock_freq;
+
+void timer_init()
+{
+	timer_clock_freq = pmc_get_clock_tree()->mck_freq / 128;
+
+	for (u8 i = 0; i < TIMER_CHANNEL_COUNT; i++) {
+		pmc_peripheral_clock_gate(TIMER_CHANNEL_ID(i), 1); // Enable peripheral clock
+
+		TC0->TC_CHANNEL[i].TC_CCR = TC_CCR_CLKDIS_Msk;
+		TC0->TC_CHANNEL[i].TC_IDR = 0xFFFFFFFF;
+		TC0->TC_CHANNEL[i].TC_CMR = TC_CMR_TCCLKS_TIMER_CLOCK4 | TC_CMR_WAVE_Msk | TC_CMR_WAVEFORM_WAVSEL_UP_RC |
+					    TC_CMR_WAVEFORM_CPCSTOP_Msk;
+		(void) TC0->TC_CHANNEL[i].TC_SR; /* clear status */
+
+		NVIC_EnableIRQ((IRQn_Type) TIMER_CHANNEL_ID(i));
+	}
+}
+
+/* callback is called from interrupt context, starting a channel again replaces its pending timeout */
+void timer_start_us(enum timer_channel_no channel_no, u32 ticks, void (*callback)(void *data), void *data)
+{
+	struct timer_channel_t *channel = &timer_channels[channel_no];
+	u32 count = min((u64) ticks * timer_clock_freq / 1000000 + 1, TIMER_MAX_TICKS);
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		channel->callback = callback;
+		channel->data = data;
+
+		TC0->TC_CHANNEL[channel_no].TC_RC = TC_RC_RC(count);
+		(void) TC0->TC_CHANNEL[channel_no].TC_SR; /* clear a compare from the previous timeout */
+		TC0->TC_CHANNEL[channel_no].TC_IER = TC_IER_CPCS_Msk;
+		TC0->TC_CHANNEL[channel_no].TC_CCR = TC_CCR_CLKEN_Msk | TC_CCR_SWTRG_Msk; /* reset and start the counter */
+	}
+}
+
+void timer_stop(enum timer_channel_no channel_no)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TC0->TC_CHANNEL[channel_no].TC_IDR = TC_IDR_CPCS_Msk;
+		TC0->TC_CHANNEL[channel_no].TC_CCR = TC_CCR_CLKDIS_Msk;
+	}
+}
+
+static void timer_channel_isr(enum timer_channel_no channel_no)
+{
+	struct timer_channel_t *channel = &timer_channels[channel_no];
+
+	/* reading the status clears it */
+	if (!(TC0->TC_CHANNEL[channel_no].TC_SR & TC_SR_CPCS_Msk))
+		return;
+
+	/* one shot, the callback may start it again */
+	TC0->TC_CHANNEL[channel_no].TC_IDR = TC_IDR_CPCS_Msk;
+
+	if (channel->callback)
+		channel->callback(channel->data);
+}
+
+void _tc0_ch0_isr()
+{
+	timer_channel_isr(TIMER_CHANNEL_0);
+}
+
+void _tc0_ch1_isr()
+{
+	timer_channel_isr(TIMER_CHANNEL_1);
+}
+
+void _tc0_ch2_isr()
+{
+	timer_channel_isr(TIMER_CHANNEL_2);
+}
@@ -5,6 +5,7 @@
 
 #include <sam.h>
 
+#include "platform/samx7x/atomic.h"
 #include "platform/samx7x/pmc.h"
 #include "platform/samx7x/usb.h"
 #include "util/types.h"
@@ -12,13 +13,40 @@
 #define CFG_TUSB_CONFIG_FILE "targets/sams70-generic/tusb_config.h"
 #include "tusb.h"
 
-static struct protocol_config_t protocol_config;
+static const struct protocol_config_t *protocol_config;
 
-void usb_attach_protocol_config(struct protocol_config_t config)
+static void (*sof_callback)(void *data);
+static void *sof_data;
+
+static void (*irq_callback)(void *data);
+static void *irq_data;
+
+void usb_attach_protocol_config(const struct protocol_config_t *config)
 {
 	protocol_config = config;
 }
 
+/* callback is called from interrupt context after the USB stack queued its events, tud_task needs to run */
+void usb_attach_irq_callback(void (*callback)(void *data), void *data)
+{
+	/* the USB ISR must never see the new callback with the old data */
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		irq_callback = callback;
+		irq_data = data;
+	}
+}
+
+/* callback is called from interrupt context on every start of (micro)frame */
+void usb_attach_sof_callback(void (*callback)(void *data), void *data)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		sof_callback = callback;
+		sof_data = data;
+	}
+}
+
 void usb_init()
 {
 	/* Enable USB peripheral clock */
@@ -29,13 +57,32 @@ void usb_init()
 
 	/* Init USB stack */
 	tusb_init(); /* USB Stack handles the rest of the peripheral init */
+
+	/* make sure we get SOF interrupts, for usb_attach_sof_callback, MSOF are the high speed microframes */
+	USBHS->USBHS_DEVIER = USBHS_DEVIER_SOFES_Msk | USBHS_DEVIER_MSOFES_Msk;
+}
+
+/* length of a (micro)frame at the negotiated speed, the full speed one until the host reset the bus */
+u32 usb_get_frame_us()
+{
+	return tud_speed_get() == TUSB_SPEED_HIGH ? 125 : 1000;
 }
 
 /* USB ISR mapping */
 
 void _usbhs_isr()
 {
+	/* check before the stack clears SOF, the microframe one (MSOF) is only ours */
+	if (USBHS->USBHS_DEVISR & (USBHS_DEVISR_SOF_Msk | USBHS_DEVISR_MSOF_Msk)) {
+		USBHS->USBHS_DEVICR = USBHS_DEVICR_MSOFC_Msk;
+		if (sof_callback)
+			sof_callback(sof_data);
+	}
+
 	tud_int_handler(0);
+
+	if (irq_callback)
+		irq_callback(irq_data);
 }
 
 /* TinyUSB Callbacks */
@@ -59,6 +106,9 @@ void tud_suspend_cb(bool remote_wakeup_en)
 /* Invoked when usb bus is resumed */
 void tud_resume_cb(void)
 {
+	/* responses queued while the bus was suspended */
+	if (protocol_config)
+		protocol_flush(protocol_config);
 }
 
 /* Invoked when received GET_REPORT control request */
@@ -82,3 +132,13 @@ void tud_hid_set_report_cb(u8 itf, u8 report_id, hid_report_type_t report_type,
 	if (itf == 0)
 		protocol_dispatch(protocol_config, (u8 *) buffer, bufsize);
 }
+
+/* Invoked when an IN report was sent, the endpoint can take the next queued response */
+void tud_hid_report_complete_cb(u8 itf, u8 const *report, u16 len)
+{
+	(void) report;
+	(void) len;
+
+	if (itf == 0)
+		protocol_flush(protocol_config);
+}
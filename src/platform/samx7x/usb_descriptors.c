@@ -11,82 +11,19 @@
 #define CFG_TUSB_CONFIG_FILE "targets/sams70-generic/tusb_config.h"
 #include "tusb.h"
 
-/* Configuration Descriptor */
-const u8 desc_configuration[] = {
-	/* clang-format off */
-	/* configuration */
-	0x09,			/* LENGTH */
-	0x02,			/* DESCRIPTOR TYPE (Configuration) */
-	0x42, 0x00,		/* TOTAL LENGTH (66) */
-	0x02,			/* NUM INTERFACES (2) */
-	0x01,			/* CONFIG NUMBER (1) */
-	0x00,			/* STRING INDEX (null) */
-	0xA0,			/* ATTRIBUTES (Bus powered, Remote wakeup) */
-	0xFA,			/* MAX POWER (500mA) */
-
-	/* Interface 0 - openinput protocol */
-	0x09,			/* LENGTH */
-	0x04,			/* DESCRIPTOR TYPE (Interface) */
-	0x00,			/* INTERFACE NO (0) */
-	0x00,			/* ALTERNATE SETTING (none) */
-	0x02,			/* NUM ENDPOINTS (2) */
-	0x03,			/* INTERFACE CLASS (HID) */
-	0x00,			/* INTERFACE SUBCLASS (None) */
-	0x00,			/* INTERFACE PROTOCOL (None) */
-	0x00,			/* INTERFACE STRING (Null) */
-	/* HID */
-	0x09,			/* LENGTH */
-	0x21,			/* DESCRIPTOR TYPE (hid) */
-	0x11, 0x01,		/* HID VERSION (0x0111) */
-	0x00,			/* COUNTRY CODE (None) */
-	0x01,			/* NO DESCRIPTORS (1) */
-	0x22,			/* DESCRIPTOR TYPE (Report) */
-	sizeof(oi_rdesc),
-	0x00,			/* DESCRIPTOR LENGTH () */
-	/* Endpoint in */
-	0x07,			/* LENGTH */
-	0x05,			/* DESCRIPTOR TYPE (Endpoint) */
-	0x81,			/* ENDPOINT ADDRESS (Endpoint 1, IN) */
-	0x03,			/* ATTRIBUTES (Interrupt) */
-	0x40, 0x00,		/* MAX PACKET SIZE (64) */
-	0x0A,			/* POLLING INTERVAL (100Hz) */
-	/* Endpoint out */
-	0x07,			/* LENGTH */
-	0x05,			/* DESCRIPTOR TYPE (Endpoint) */
-	0x01,			/* ENDPOINT ADDRESS (Endpoint 1, OUT) */
-	0x03,			/* ATTRIBUTES (Interrupt) */
-	0x40, 0x00,		/* MAX PACKET SIZE (64) */
-	0x0A,			/* POLLING INTERVAL (100Hz) */
-
-
-	/* Interface 1 - HID Mouse */
-	0x09,			/* LENGTH */
-	0x04,			/* DESCRIPTOR TYPE (Interface) */
-	0x01,			/* INTERFACE NO (1) */
-	0x00,			/* ALTERNATE SETTING (none) */
-	0x01,			/* NUM ENDPOINTS (1) */
-	0x03,			/* INTERFACE CLASS (HID) */
-	0x00,			/* INTERFACE SUBCLASS (None) */
-	0x00,			/* INTERFACE PROTOCOL (None) */
-	0x00,			/* INTERFACE STRING (Null) */
-	/* HID */
-	0x09,			/* LENGTH */
-	0x21,			/* DESCRIPTOR TYPE (hid) */
-	0x11, 0x01,		/* HID VERSION (0x0111) */
-	0x00,			/* COUNTRY CODE (None) */
-	0x01,			/* NO DESCRIPTORS (1) */
-	0x22,			/* DESCRIPTOR TYPE (Report) */
-	sizeof(desc_hid_mouse_report),
-	0x00,			/* DESCRIPTOR LENGTH () */
-	/* Endpoint in */
-	0x07,			/* LENGTH */
-	0x05,			/* DESCRIPTOR TYPE (Endpoint) */
-	0x82,			/* ENDPOINT ADDRESS (Endpoint 2, IN) */
-	0x03,			/* ATTRIBUTES (Interrupt) */
-	0x40, 0x00,		/* MAX PACKET SIZE (64) */
-	0x01,			/* POLLING INTERVAL (1000Hz) */
-	/* clang-format on */
-};
+/* openinput protocol endpoints polling rate (Hz) */
+#define OI_POLLING_RATE 100
+
+/* Configuration Descriptors, the polling interval unit depends on the bus speed */
+static const u8 desc_configuration_fs[] = USB_DESC_CONFIGURATION_OI_MOUSE(
+	sizeof(oi_rdesc), sizeof(desc_hid_mouse_report_16), USB_FS_INTERVAL(OI_POLLING_RATE), USB_FS_INTERVAL(USB_POLLING_RATE));
+
+#if TUD_OPT_HIGH_SPEED
+static const u8 desc_configuration_hs[] = USB_DESC_CONFIGURATION_OI_MOUSE(
+	sizeof(oi_rdesc), sizeof(desc_hid_mouse_report_16), USB_HS_INTERVAL(OI_POLLING_RATE), USB_HS_INTERVAL(USB_POLLING_RATE));
+
+_Static_assert(sizeof(desc_configuration_fs) == sizeof(desc_configuration_hs), "configuration descriptors differ in size");
+#endif
 
 /* Invoked when received GET DEVICE DESCRIPTOR */
 /* Application returns pointer to descriptor */
@@ -96,7 +33,7 @@ u8 const *tud_descriptor_device_cb(void)
 }
 
 #if TUD_OPT_HIGH_SPEED
-u8 desc_other_speed_config[sizeof(desc_configuration)];
+u8 desc_other_speed_config[sizeof(desc_configuration_fs)];
 
 /**
  * Invoked when received GET DEVICE QUALIFIER DESCRIPTOR request
@@ -111,14 +48,15 @@ u8 const *tud_descriptor_device_qualifier_cb(void)
 /*
  * Invoked when received GET OTHER SEED CONFIGURATION DESCRIPTOR request
  * Configuration descriptor in the other speed e.g if high speed then this is for full speed and vice versa
- * We use the same config for both Full and High speed
  */
 u8 const *tud_descriptor_other_speed_configuration_cb(u8 index)
 {
 	(void) index; /* For multiple configurations */
 
+	const u8 *other = tud_speed_get() == TUSB_SPEED_HIGH ? desc_configuration_fs : desc_configuration_hs;
+
 	// other speed config is basically configuration with type = OHER_SPEED_CONFIG
-	memcpy(desc_other_speed_config, desc_configuration, sizeof(desc_configuration));
+	memcpy(desc_other_speed_config, other, sizeof(desc_other_speed_config));
 	desc_other_speed_config[1] = 0x07; // descripor type OTHER_SPEED_CONFIG
 
 	return desc_other_speed_config;
@@ -139,7 +77,7 @@ u8 const *tud_hid_descriptor_report_cb(u8 itf)
 			break;
 
 		case 1:
-			return desc_hid_mouse_report;
+			return desc_hid_mouse_report_16;
 			break;
 
 		default:
@@ -156,7 +94,13 @@ u8 const *tud_hid_descriptor_report_cb(u8 itf)
 u8 const *tud_descriptor_configuration_cb(u8 index)
 {
 	(void) index; /* For multiple configurations */
-	return desc_configuration;
+
+#if TUD_OPT_HIGH_SPEED
+	if (tud_speed_get() == TUSB_SPEED_HIGH)
+		return desc_configuration_hs;
+#endif
+
+	return desc_configuration_fs;
 }
 
 /* String Descriptors */
@@ -15,6 +15,14 @@
  */
 #define _GPIO(port) ((GPIO_TypeDef *) (GPIOA_BASE + ((port & 0b11) * 0x00000400UL)))
 
+struct gpio_interrupt_t {
+	void (*callback)(void *data);
+	void *data;
+};
+
+/* one entry per EXTI line, only one port can be routed to each line */
+static struct gpio_interrupt_t gpio_interrupts[16];
+
 /* initiates all pins to a safe known state, inputs pull down */
 void gpio_init_config(struct gpio_config_t *config)
 {
@@ -105,3 +113,84 @@ u8 gpio_get(struct gpio_pin_t pin)
 {
 	return !!(_GPIO(pin.port)->IDR & BIT(pin.pin));
 }
+
+/*
+ * routes the pin to its EXTI line and calls callback, from interrupt context, on the selected edges
+ * must be called after gpio_apply_config, as that resets the AFIO peripheral
+ */
+void gpio_attach_interrupt(struct gpio_pin_t pin, u8 edge, void (*callback)(void *data), void *data)
+{
+	IRQn_Type irqn;
+	u8 line = pin.pin & 0xF;
+
+	EXTI->IMR &= ~BIT(line);
+
+	gpio_interrupts[line].callback = callback;
+	gpio_interrupts[line].data = data;
+
+	AFIO->EXTICR[line / 4] = (AFIO->EXTICR[line / 4] & ~(0xF << ((line % 4) * 4))) | ((pin.port & 0b11) << ((line % 4) * 4));
+
+	EXTI->RTSR = (EXTI->RTSR & ~BIT(line)) | (!!(edge & GPIO_EDGE_RISING) << line);
+	EXTI->FTSR = (EXTI->FTSR & ~BIT(line)) | (!!(edge & GPIO_EDGE_FALLING) << line);
+	EXTI->PR = BIT(line); /* clear stale events */
+
+	if (!callback)
+		return;
+
+	EXTI->IMR |= BIT(line);
+
+	if (line <= 4)
+		irqn = EXTI0_IRQn + line;
+	else if (line <= 9)
+		irqn = EXTI9_5_IRQn;
+	else
+		irqn = EXTI15_10_IRQn;
+
+	NVIC_EnableIRQ(irqn);
+}
+
+static void gpio_dispatch_interrupts(u32 lines)
+{
+	u32 pending = EXTI->PR & lines;
+
+	EXTI->PR = pending;
+
+	for (u8 line = 0; line < 16; line++)
+		if ((pending & BIT(line)) && gpio_interrupts[line].callback)
+			gpio_interrupts[line].callback(gpio_interrupts[line].data);
+}
+
+void _exti0_isr()
+{
+	gpio_dispatch_interrupts(BIT(0));
+}
+
+void _exti1_isr()
+{
+	gpio_dispatch_interrupts(BIT(1));
+}
+
+void _exti2_isr()
+{
+	gpio_dispatch_interrupts(BIT(2));
+}
+
+void _exti3_isr()
+{
+	gpio_dispatch_interrupts(BIT(3));
+}
+
+void _exti4_isr()
+{
+	gpio_dispatch_interrupts(BIT(4));
+}
+
+void _exti9_5_isr()
+{
+	gpio_dispatch_interrupts(0x03E0);
+}
+
+void _exti15_10_isr()
+{
+	gpio_dispatch_interrupts(0xFC00);
+}
@@ -29,6 +29,11 @@
 #define GPIO_PORT_C 2
 #define GPIO_PORT_D 3
 
+/* interrupt edges */
+#define GPIO_EDGE_RISING  (1 << 0)
+#define GPIO_EDGE_FALLING (1 << 1)
+#define GPIO_EDGE_BOTH	  (GPIO_EDGE_RISING | GPIO_EDGE_FALLING)
+
 struct gpio_pin_t {
 	u8 port;
 	u8 pin;
@@ -49,3 +54,4 @@ void gpio_setup_pin(struct gpio_config_t *config, struct gpio_pin_t pin, u8 mode
 void gpio_set(struct gpio_pin_t pin, u8 out);
 void gpio_toggle(struct gpio_pin_t pin);
 u8 gpio_get(struct gpio_pin_t pin);
+void gpio_attach_interrupt(struct gpio_pin_t pin, u8 edge, void (*callback)(void *data), void *data);
@@ -17,10 +17,25 @@ u8 spi_hal_transfer(struct spi_hal_t interface, u8 data)
 	return spi_transfer_byte(*drv_data, data);
 }
 
+void spi_hal_transfer_buf(struct spi_hal_t interface, const u8 *src, u8 *dst, size_t size)
+{
+	struct spi_device_t *drv_data = interface.drv_data;
+	return spi_transfer(*drv_data, src, size, dst);
+}
+
+void spi_hal_transfer_async(
+	struct spi_hal_t interface, const u8 *src, u8 *dst, size_t size, void (*callback)(void *data), void *data)
+{
+	struct spi_device_t *drv_data = interface.drv_data;
+	return spi_transfer_async(*drv_data, src, size, dst, callback, data);
+}
+
 struct spi_hal_t spi_hal_init(struct spi_device_t *drv_data)
 {
 	struct spi_hal_t hal = {
 		.transfer = spi_hal_transfer,
+		.transfer_buf = spi_hal_transfer_buf,
+		.transfer_async = spi_hal_transfer_async,
 		.select = spi_hal_select,
 		.drv_data = drv_data,
 	};
@@ -0,0 +1,27 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include "platform/stm32f1/hal/timer.h"
+
+void timer_hal_start_us(struct timer_hal_t interface, u32 ticks, void (*callback)(void *data), void *data)
+{
+	return timer_start_us((enum timer_channel_no) (uintptr_t) interface.drv_data, ticks, callback, data);
+}
+
+void timer_hal_stop(struct timer_hal_t interface)
+{
+	return timer_stop((enum timer_channel_no) (uintptr_t) interface.drv_data);
+}
+
+/* the channel is all we need, it is stored in drv_data itself */
+struct timer_hal_t timer_hal_init(enum timer_channel_no channel_no)
+{
+	struct timer_hal_t hal = {
+		.start_us = timer_hal_start_us,
+		.stop = timer_hal_stop,
+		.drv_data = (void *) (uintptr_t) channel_no,
+	};
+	return hal;
+}
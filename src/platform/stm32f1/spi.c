@@ -10,6 +10,33 @@
 #include "platform/stm32f1/spi.h"
 #include "util/types.h"
 
+/*
+ * DMA request mapping, see the DMA1/DMA2 request tables in the reference manual
+ * the RX channel completes last, so its transfer complete interrupt ends the transfer
+ */
+struct spi_dma_t {
+	DMA_TypeDef *dma;
+	DMA_Channel_TypeDef *rx;
+	DMA_Channel_TypeDef *tx;
+	u8 rx_channel_no;
+	u8 tx_channel_no;
+	IRQn_Type rx_irqn;
+	void (*callback)(void *data);
+	void *data;
+};
+
+static struct spi_dma_t spi_dma[] = {
+	[SPI_INTERFACE_1] = {DMA1, DMA1_Channel2, DMA1_Channel3, 2, 3, DMA1_Channel2_IRQn},
+#if defined(SPI2)
+	[SPI_INTERFACE_2] = {DMA1, DMA1_Channel4, DMA1_Channel5, 4, 5, DMA1_Channel4_IRQn},
+#endif
+#if defined(SPI3)
+	[SPI_INTERFACE_3] = {DMA2, DMA2_Channel1, DMA2_Channel2, 1, 2, DMA2_Channel1_IRQn},
+#endif
+};
+
+#define SPI_DMA_CLEAR_FLAGS(channel_no) (DMA_IFCR_CGIF1 << (((channel_no) - 1) * 4))
+
 void spi_init_interface(enum spi_interface_no interface_no, enum spi_mode mode, u32 frequency, u8 bit_order)
 {
 	struct rcc_clock_tree_t clock_tree = rcc_get_clock_tree();
@@ -81,6 +108,16 @@ void spi_init_interface(enum spi_interface_no interface_no, enum spi_mode mode,
 	interface->CR2 = 0x00000000;
 	interface->CR1 = mode | SPI_CR1_MSTR | (divider << SPI_CR1_BR_Pos) | SPI_CR1_SPE |
 			 (bit_order << SPI_CR1_LSBFIRST_Pos) | SPI_CR1_SSI | SPI_CR1_SSM;
+
+	/* configure DMA */
+	if (spi_dma[interface_no].dma == DMA1)
+		RCC->AHBENR |= RCC_AHBENR_DMA1EN;
+#if defined(DMA2)
+	else
+		RCC->AHBENR |= RCC_AHBENR_DMA2EN;
+#endif
+
+	NVIC_EnableIRQ(spi_dma[interface_no].rx_irqn);
 }
 
 struct spi_device_t spi_init_device(enum spi_interface_no interface_no, struct gpio_pin_t cs_gpio, u8 cs_inverted)
@@ -106,6 +143,7 @@ struct spi_device_t spi_init_device(enum spi_interface_no interface_no, struct g
 	}
 
 	struct spi_device_t device = {
+		.interface_no = interface_no,
 		.interface = interface,
 		.cs_gpio = cs_gpio,
 		.cs_inverted = !!cs_inverted,
@@ -143,3 +181,75 @@ void spi_transfer(struct spi_device_t device, const u8 *src, u32 size, u8 *dst)
 		while (size--) *(dst++) = spi_transfer_byte(device, 0x00);
 	}
 }
+
+/*
+ * transfers size bytes in the background with DMA, src and/or dst may be NULL
+ * callback is called from interrupt context once the transfer is complete
+ */
+void spi_transfer_async(
+	struct spi_device_t device, const u8 *src, u32 size, u8 *dst, void (*callback)(void *data), void *data)
+{
+	static const u8 tx_dummy = 0x00;
+	static u8 rx_dummy;
+	struct spi_dma_t *dma = &spi_dma[device.interface_no];
+	SPI_TypeDef *interface = device.interface;
+
+	if (!size) {
+		if (callback)
+			callback(data);
+		return;
+	}
+
+	dma->callback = callback;
+	dma->data = data;
+
+	dma->dma->IFCR = SPI_DMA_CLEAR_FLAGS(dma->rx_channel_no) | SPI_DMA_CLEAR_FLAGS(dma->tx_channel_no);
+
+	dma->rx->CPAR = (u32) &interface->DR;
+	dma->rx->CMAR = (u32) (dst ? dst : &rx_dummy);
+	dma->rx->CNDTR = size;
+	dma->rx->CCR = (dst ? DMA_CCR_MINC : 0) | DMA_CCR_TCIE | DMA_CCR_PL_1;
+
+	dma->tx->CPAR = (u32) &interface->DR;
+	dma->tx->CMAR = (u32) (src ? src : &tx_dummy);
+	dma->tx->CNDTR = size;
+	dma->tx->CCR = (src ? DMA_CCR_MINC : 0) | DMA_CCR_DIR;
+
+	dma->rx->CCR |= DMA_CCR_EN;
+	dma->tx->CCR |= DMA_CCR_EN;
+
+	interface->CR2 |= SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN;
+}
+
+static void spi_dma_complete(enum spi_interface_no interface_no, SPI_TypeDef *interface)
+{
+	struct spi_dma_t *dma = &spi_dma[interface_no];
+
+	dma->dma->IFCR = SPI_DMA_CLEAR_FLAGS(dma->rx_channel_no) | SPI_DMA_CLEAR_FLAGS(dma->tx_channel_no);
+
+	dma->rx->CCR = 0;
+	dma->tx->CCR = 0;
+	interface->CR2 &= ~(SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+
+	if (dma->callback)
+		dma->callback(dma->data);
+}
+
+void _dma1_channel2_isr()
+{
+	spi_dma_complete(SPI_INTERFACE_1, SPI1);
+}
+
+#if defined(SPI2)
+void _dma1_channel4_isr()
+{
+	spi_dma_complete(SPI_INTERFACE_2, SPI2);
+}
+#endif
+
+#if defined(SPI3)
+void _dma2_channel1_isr()
+{
+	spi_dma_complete(SPI_INTERFACE_3, SPI3);
+}
+#endif
@@ -31,6 +31,7 @@ enum spi_interface_no {
 struct spi_device_t {
 	struct gpio_pin_t cs_gpio;
 	u8 cs_inverted;
+	enum spi_interface_no interface_no;
 	void *interface;
 };
 
@@ -39,3 +40,5 @@ struct spi_device_t spi_init_device(enum spi_interface_no interface_no, struct g
 void spi_select(struct spi_device_t device, u8 state);
 u8 spi_transfer_byte(struct spi_device_t device, const u8 data);
 void spi_transfer(struct spi_device_t device, const u8 *src, u32 size, u8 *dst);
+void spi_transfer_async(
+	struct spi_device_t device, const u8 *src, u32 size, u8 *dst, void (*callback)(void *data), void *data);
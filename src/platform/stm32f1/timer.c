@@ -0,0 +1,97 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <stm32f1xx.h>
+
+#include "platform/stm32f1/atomic.h"
+#include "platform/stm32f1/rcc.h"
+#include "platform/stm32f1/timer.h"
+#include "util/data.h"
+
+/*
+ * TIM4 counts microsecs and never stops, a timeout is a compare value on one of
+ * its channels. The counter is 16 bits, so a timeout can be up to ~65ms away.
+ * Values that are too close could be passed by the counter before the compare
+ * register is written, and would only fire after a full wrap, so a timeout is
+ * at least TIMER_MIN_US.
+ */
+
+#define TIMER_MIN_US 2
+#define TIMER_MAX_US 0xFFFF
+
+#define TIMER_SR_CCIF(channel_no)   (TIM_SR_CC1IF << (channel_no))
+#define TIMER_DIER_CCIE(channel_no) (TIM_DIER_CC1IE << (channel_no))
+
+struct timer_channel_t {
+	void (*callback)(void *data);
+	void *data;
+};
+
+static struct timer_channel_t timer_channels[TIMER_CHANNEL_COUNT];
+
+void timer_init()
+{
+	struct rcc_clock_tree_t clock_tree = rcc_get_clock_tree();
+
+	RCC->APB1RSTR |= RCC_APB1RSTR_TIM4RST; /* Reset TIM4 peripheral */
+	RCC->APB1RSTR &= ~RCC_APB1RSTR_TIM4RST;
+
+	RCC->APB1ENR |= RCC_APB1ENR_TIM4EN; /* Enable TIM4 peripheral clock */
+
+	/* free running 1MHz counter */
+	TIM4->PSC = (clock_tree.apb1_tim_clock_freq / 1000000) - 1;
+	TIM4->ARR = 0xFFFF;
+	TIM4->DIER = 0;
+	TIM4->EGR = TIM_EGR_UG; /* load the prescaler */
+	TIM4->SR = 0;
+	TIM4->CR1 = TIM_CR1_CEN;
+
+	NVIC_EnableIRQ(TIM4_IRQn);
+}
+
+/* callback is called from interrupt context, starting a channel again replaces its pending timeout */
+void timer_start_us(enum timer_channel_no channel_no, u32 ticks, void (*callback)(void *data), void *data)
+{
+	struct timer_channel_t *channel = &timer_channels[channel_no];
+
+	ticks = min(max(ticks, TIMER_MIN_US), TIMER_MAX_US);
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		channel->callback = callback;
+		channel->data = data;
+
+		/* CCR1-4 are consecutive */
+		(&TIM4->CCR1)[channel_no] = (u16) (TIM4->CNT + ticks);
+		TIM4->SR = ~TIMER_SR_CCIF(channel_no); /* rc_w0, only clears our flag */
+		TIM4->DIER |= TIMER_DIER_CCIE(channel_no);
+	}
+}
+
+void timer_stop(enum timer_channel_no channel_no)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		TIM4->DIER &= ~TIMER_DIER_CCIE(channel_no);
+		TIM4->SR = ~TIMER_SR_CCIF(channel_no);
+	}
+}
+
+void _tim4_isr()
+{
+	u32 status = TIM4->SR & TIM4->DIER;
+
+	for (u8 i = 0; i < TIMER_CHANNEL_COUNT; i++) {
+		if (!(status & TIMER_SR_CCIF(i)))
+			continue;
+
+		/* one shot, the callback may start it again */
+		TIM4->DIER &= ~TIMER_DIER_CCIE(i);
+		TIM4->SR = ~TIMER_SR_CCIF(i);
+
+		if (timer_channels[i].callback)
+			timer_channels[i].callback(timer_channels[i].data);
+	}
+}
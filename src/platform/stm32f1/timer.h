@@ -0,0 +1,21 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "util/types.h"
+
+/* TIM4 compare channels, each one is an independent one shot timeout */
+enum timer_channel_no {
+	TIMER_CHANNEL_1,
+	TIMER_CHANNEL_2,
+	TIMER_CHANNEL_3,
+	TIMER_CHANNEL_4,
+	TIMER_CHANNEL_COUNT,
+};
+
+void timer_init();
+void timer_start_us(enum timer_channel_no channel_no, u32 ticks, void (*callback)(void *data), void *data);
+void timer_stop(enum timer_channel_no channel_no);
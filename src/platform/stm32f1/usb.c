@@ -5,6 +5,7 @@
 
 #include <stm32f1xx.h>
 
+#include "platform/stm32f1/atomic.h"
 #include "platform/stm32f1/gpio.h"
 #include "platform/stm32f1/usb.h"
 #include "util/types.h"
@@ -12,7 +13,16 @@
 #define CFG_TUSB_CONFIG_FILE "targets/stm32f1-generic/tusb_config.h"
 #include "tusb.h"
 
-static struct protocol_config_t protocol_config;
+static const struct protocol_config_t *protocol_config;
+
+/* DWT cycles spent in the last protocol_dispatch call, read it with a debugger */
+volatile u32 usb_protocol_dispatch_cycles;
+
+static void (*sof_callback)(void *data);
+static void *sof_data;
+
+static void (*irq_callback)(void *data);
+static void *irq_data;
 
 void usb_init()
 {
@@ -23,28 +33,65 @@ void usb_init()
 
 	/* Init USB stack */
 	tusb_init(); /* USB Stack handles the rest of the peripheral init */
+
+	/* make sure we get SOF interrupts, for usb_attach_sof_callback */
+	USB->CNTR |= USB_CNTR_SOFM;
 }
 
-void usb_attach_protocol_config(struct protocol_config_t config)
+void usb_attach_protocol_config(const struct protocol_config_t *config)
 {
 	protocol_config = config;
 }
 
+/* callback is called from interrupt context after the USB stack queued its events, tud_task needs to run */
+void usb_attach_irq_callback(void (*callback)(void *data), void *data)
+{
+	/* the USB ISR must never see the new callback with the old data */
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		irq_callback = callback;
+		irq_data = data;
+	}
+}
+
+/* callback is called from interrupt context on every start of frame */
+void usb_attach_sof_callback(void (*callback)(void *data), void *data)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		sof_callback = callback;
+		sof_data = data;
+	}
+}
+
 /* USB ISR mapping */
 
 void _usb_hp_can_tx_isr()
 {
 	tud_int_handler(0);
+
+	if (irq_callback)
+		irq_callback(irq_data);
 }
 
 void _usb_lp_can_rx0_isr()
 {
+	/* check before the stack clears the flag */
+	if ((USB->ISTR & USB_ISTR_SOF) && sof_callback)
+		sof_callback(sof_data);
+
 	tud_int_handler(0);
+
+	if (irq_callback)
+		irq_callback(irq_data);
 }
 
 void _usb_wakeup_isr()
 {
 	tud_int_handler(0);
+
+	if (irq_callback)
+		irq_callback(irq_data);
 }
 
 /* TinyUSB port* */
@@ -88,6 +135,9 @@ void tud_suspend_cb(bool remote_wakeup_en)
 /* Invoked when usb bus is resumed */
 void tud_resume_cb(void)
 {
+	/* responses queued while the bus was suspended */
+	if (protocol_config)
+		protocol_flush(protocol_config);
 }
 
 /*
@@ -116,6 +166,19 @@ void tud_hid_set_report_cb(u8 itf, u8 report_id, hid_report_type_t report_type,
 	(void) report_id;
 	(void) report_type;
 
-	if (itf == 0)
+	if (itf == 0) {
+		u32 start = DWT->CYCCNT;
 		protocol_dispatch(protocol_config, (u8 *) buffer, bufsize);
+		usb_protocol_dispatch_cycles = DWT->CYCCNT - start;
+	}
+}
+
+/* Invoked when an IN report was sent, the endpoint can take the next queued response */
+void tud_hid_report_complete_cb(u8 itf, u8 const *report, u16 len)
+{
+	(void) report;
+	(void) len;
+
+	if (itf == 0)
+		protocol_flush(protocol_config);
 }
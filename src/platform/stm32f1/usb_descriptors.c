@@ -76,7 +76,7 @@ const u8 desc_configuration[] = {
 	0x00,			/* COUNTRY CODE (None) */
 	0x01,			/* NO DESCRIPTORS (1) */
 	0x22,			/* DESCRIPTOR TYPE (Report) */
-	sizeof(desc_hid_mouse_report),
+	sizeof(desc_hid_mouse_report_16),
 	0x00,			/* DESCRIPTOR LENGTH () */
 	/* Endpoint in */
 	0x07,			/* LENGTH */
@@ -141,7 +141,7 @@ u8 const *tud_hid_descriptor_report_cb(u8 itf)
 			break;
 
 		case 1:
-			return desc_hid_mouse_report;
+			return desc_hid_mouse_report_16;
 			break;
 
 		case 2:
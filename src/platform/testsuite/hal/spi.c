@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <string.h>
+
+#include "platform/testsuite/hal/spi.h"
+#include "util/data.h"
+
+static u8 spi_mock_transfer_byte(struct spi_mock_t *mock, u8 data)
+{
+	if (mock->tx_count < sizeof(mock->tx))
+		mock->tx[mock->tx_count] = data;
+	mock->tx_count++;
+	mock->tx_hash = mock->tx_hash * 31 + data;
+
+	if (mock->rx_index < mock->rx_size)
+		return mock->rx[mock->rx_index++];
+	return mock->rx_idle;
+}
+
+void spi_mock_hal_select(struct spi_hal_t interface, u8 state)
+{
+	struct spi_mock_t *mock = interface.drv_data;
+	mock->selected = !!state;
+}
+
+u8 spi_mock_hal_transfer(struct spi_hal_t interface, u8 data)
+{
+	return spi_mock_transfer_byte(interface.drv_data, data);
+}
+
+void spi_mock_hal_transfer_buf(struct spi_hal_t interface, const u8 *src, u8 *dst, size_t size)
+{
+	struct spi_mock_t *mock = interface.drv_data;
+
+	for (size_t i = 0; i < size; i++) {
+		u8 data = spi_mock_transfer_byte(mock, src ? src[i] : 0x00);
+		if (dst)
+			dst[i] = data;
+	}
+}
+
+void spi_mock_hal_transfer_async(
+	struct spi_hal_t interface, const u8 *src, u8 *dst, size_t size, void (*callback)(void *data), void *data)
+{
+	struct spi_mock_t *mock = interface.drv_data;
+
+	mock->async.pending = 1;
+	mock->async.src = src;
+	mock->async.dst = dst;
+	mock->async.size = size;
+	mock->async.callback = callback;
+	mock->async.data = data;
+}
+
+struct spi_hal_t spi_hal_init_mock(struct spi_mock_t *mock)
+{
+	struct spi_hal_t hal = {
+		.transfer = spi_mock_hal_transfer,
+		.transfer_buf = spi_mock_hal_transfer_buf,
+		.transfer_async = spi_mock_hal_transfer_async,
+		.select = spi_mock_hal_select,
+		.drv_data = mock,
+	};
+	return hal;
+}
+
+void spi_mock_queue_rx(struct spi_mock_t *mock, const u8 *data, size_t size)
+{
+	/* drop the data already clocked in */
+	memmove(mock->rx, mock->rx + mock->rx_index, mock->rx_size - mock->rx_index);
+	mock->rx_size -= mock->rx_index;
+	mock->rx_index = 0;
+
+	size = min(size, sizeof(mock->rx) - mock->rx_size);
+	memcpy(mock->rx + mock->rx_size, data, size);
+	mock->rx_size += size;
+}
+
+/* clocks the pending background transfer and calls its callback, like the DMA interrupt would */
+void spi_mock_complete_async(struct spi_mock_t *mock)
+{
+	if (!mock->async.pending)
+		return;
+
+	mock->async.pending = 0;
+
+	spi_mock_hal_transfer_buf(spi_hal_init_mock(mock), mock->async.src, mock->async.dst, mock->async.size);
+
+	if (mock->async.callback)
+		mock->async.callback(mock->async.data);
+}
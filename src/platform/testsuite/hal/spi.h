@@ -0,0 +1,38 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/spi.h"
+#include "util/types.h"
+
+#define SPI_MOCK_BUFFER_SIZE 64
+
+/* software SPI device, the test drives it by queueing MISO data and completing background transfers */
+struct spi_mock_t {
+	u8 selected;
+	/* MISO data, rx_idle is clocked in once it runs out */
+	u8 rx[SPI_MOCK_BUFFER_SIZE];
+	u8 rx_idle;
+	size_t rx_size;
+	size_t rx_index;
+	/* MOSI data, only the first SPI_MOCK_BUFFER_SIZE bytes are kept */
+	u8 tx[SPI_MOCK_BUFFER_SIZE];
+	size_t tx_count;
+	u32 tx_hash; /* of all the MOSI data, cheap enough not to show in the SPI benchmarks */
+	/* background transfer waiting for spi_mock_complete_async */
+	struct {
+		u8 pending;
+		const u8 *src;
+		u8 *dst;
+		size_t size;
+		void (*callback)(void *data);
+		void *data;
+	} async;
+};
+
+struct spi_hal_t spi_hal_init_mock(struct spi_mock_t *mock);
+void spi_mock_queue_rx(struct spi_mock_t *mock, const u8 *data, size_t size);
+void spi_mock_complete_async(struct spi_mock_t *mock);
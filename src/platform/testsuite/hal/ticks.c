@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include "platform/testsuite/hal/ticks.h"
+#include "platform/testsuite/hal/timer.h"
+#include "util/data.h"
+
+static u64 ticks_mock_us;
+
+/* timer mocks that are due fire in order, like interrupts, with the clock at their deadline */
+void ticks_mock_advance_us(u32 ticks)
+{
+	u64 target = ticks_mock_us + ticks;
+	struct timer_mock_t *timer;
+
+	while ((timer = timer_mock_next_due(target))) {
+		ticks_mock_us = max(ticks_mock_us, timer->deadline);
+		timer_mock_fire(timer);
+	}
+
+	ticks_mock_us = target;
+}
+
+u64 ticks_mock_get_us()
+{
+	return ticks_mock_us;
+}
+
+/* milisecs, the systick of the testsuite */
+u64 ticks_mock_get_ticks()
+{
+	return ticks_mock_us / 1000;
+}
+
+void ticks_mock_hal_delay_ms(u32 ticks)
+{
+	ticks_mock_advance_us(ticks * 1000);
+}
+
+void ticks_mock_hal_delay_us(u32 ticks)
+{
+	ticks_mock_advance_us(ticks);
+}
+
+u64 ticks_mock_hal_now_us()
+{
+	return ticks_mock_us;
+}
+
+/* the virtual CPU runs at 1MHz */
+u64 ticks_mock_hal_now_cycles()
+{
+	return ticks_mock_us;
+}
+
+struct ticks_hal_t ticks_hal_init_mock()
+{
+	struct ticks_hal_t hal = {
+		.delay_ms = ticks_mock_hal_delay_ms,
+		.delay_us = ticks_mock_hal_delay_us,
+		.now_us = ticks_mock_hal_now_us,
+		.now_cycles = ticks_mock_hal_now_cycles,
+		.drv_data = NULL,
+	};
+	return hal;
+}
@@ -0,0 +1,15 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/ticks.h"
+#include "util/types.h"
+
+/* virtual clock, it only moves when the firmware waits or the test advances it */
+struct ticks_hal_t ticks_hal_init_mock();
+void ticks_mock_advance_us(u32 ticks);
+u64 ticks_mock_get_us();
+u64 ticks_mock_get_ticks();
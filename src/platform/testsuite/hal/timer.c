@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <string.h>
+
+#include "platform/testsuite/hal/ticks.h"
+#include "platform/testsuite/hal/timer.h"
+
+/* every mock that was initialized, so the clock can find the due ones */
+static struct timer_mock_t *timer_mocks;
+
+void timer_mock_hal_start_us(struct timer_hal_t interface, u32 ticks, void (*callback)(void *data), void *data)
+{
+	struct timer_mock_t *mock = interface.drv_data;
+
+	mock->callback = callback;
+	mock->data = data;
+	mock->deadline = ticks_mock_get_us() + ticks;
+	mock->armed = 1;
+}
+
+void timer_mock_hal_stop(struct timer_hal_t interface)
+{
+	struct timer_mock_t *mock = interface.drv_data;
+
+	mock->armed = 0;
+}
+
+struct timer_hal_t timer_hal_init_mock(struct timer_mock_t *mock)
+{
+	struct timer_hal_t hal = {
+		.start_us = timer_mock_hal_start_us,
+		.stop = timer_mock_hal_stop,
+		.drv_data = mock,
+	};
+
+	timer_mock_remove(mock);
+	memset(mock, 0, sizeof(*mock));
+
+	mock->next = timer_mocks;
+	timer_mocks = mock;
+
+	return hal;
+}
+
+/* must be called before the mock memory is released */
+void timer_mock_remove(struct timer_mock_t *mock)
+{
+	for (struct timer_mock_t **it = &timer_mocks; *it; it = &(*it)->next) {
+		if (*it == mock) {
+			*it = mock->next;
+			break;
+		}
+	}
+}
+
+/* the armed mock with the earliest deadline up to now_us, if any */
+struct timer_mock_t *timer_mock_next_due(u64 now_us)
+{
+	struct timer_mock_t *due = NULL;
+
+	for (struct timer_mock_t *it = timer_mocks; it; it = it->next) {
+		if (it->armed && it->deadline <= now_us && (!due || it->deadline < due->deadline))
+			due = it;
+	}
+
+	return due;
+}
+
+/* the callback may start the timer again */
+void timer_mock_fire(struct timer_mock_t *mock)
+{
+	mock->armed = 0;
+
+	if (mock->callback)
+		mock->callback(mock->data);
+}
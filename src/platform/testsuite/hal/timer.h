@@ -0,0 +1,23 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/timer.h"
+#include "util/types.h"
+
+/* one shot timeout on the virtual clock, it fires while ticks_mock_advance_us moves past its deadline */
+struct timer_mock_t {
+	u8 armed;
+	u64 deadline;
+	void (*callback)(void *data);
+	void *data;
+	struct timer_mock_t *next;
+};
+
+struct timer_hal_t timer_hal_init_mock(struct timer_mock_t *mock);
+void timer_mock_remove(struct timer_mock_t *mock);
+struct timer_mock_t *timer_mock_next_due(u64 now_us);
+void timer_mock_fire(struct timer_mock_t *mock);
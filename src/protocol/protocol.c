@@ -15,27 +15,128 @@
 
 #include <stdio.h>
 
-void protocol_get_functions_pages(struct protocol_config_t config, u8 *pages, u8 *pages_size)
+void protocol_get_functions_pages(const struct protocol_config_t *config, u8 *pages, u8 *pages_size)
 {
 	u8 index = 0;
 
 	for (u8 i = 0; i < PAGE_COUNT; i++)
-		if (config.functions[i] != NULL && config.functions_size[i] != 0)
+		if (config->functions[i] != NULL && config->functions_size[i] != 0)
 			pages[index++] = supported_pages[i];
 		else
 			--(*pages_size);
 }
 
-u8 *protocol_get_functions(struct protocol_config_t config, u8 function_page, size_t *functions_size)
+/*
+ * dispatch tables
+ *
+ * Function page IDs are sparse (0x00, 0xFD, 0xFE, ...), so they are mapped to the
+ * supported_pages index with a 256 entry table. Function IDs inside a page are
+ * dense, so each page has a handler table indexed directly by the function ID.
+ * The functions the device enables are a bitmap per page, so resolving a request
+ * is two array lookups and a bit test, no matter how many pages or functions we
+ * register.
+ */
+
+typedef void (*protocol_handler_t)(const struct protocol_config_t *config, struct oi_report_t *msg);
+
+struct protocol_page_t {
+	const protocol_handler_t *handlers;
+	u8 handlers_size;
+};
+
+/* page ID -> supported_pages index + 1 (0 means unsupported page) */
+static const u8 page_index_table[256] = {
+	[OI_PAGE_INFO] = INFO + 1,
+	[OI_PAGE_GENERAL_PROFILES] = GENERAL_PROFILES + 1,
+	[OI_PAGE_FW_UPDATE] = FW_UPDATE + 1,
+	[OI_PAGE_BATCH] = BATCH + 1,
+	[OI_PAGE_GIMMICKS] = GIMMICKS + 1,
+	[OI_PAGE_DEBUG] = DEBUG + 1,
+};
+
+static const protocol_handler_t info_handlers[] = {
+	[OI_FUNCTION_VERSION] = protocol_info_version,
+	[OI_FUNCTION_FW_INFO] = protocol_info_fw_info,
+	[OI_FUNCTION_SUPPORTED_FUNCTION_PAGES] = protocol_info_supported_function_pages,
+	[OI_FUNCTION_SUPPORTED_FUNCTIONS] = protocol_info_supported_functions,
+};
+
+static const protocol_handler_t profiles_handlers[] = {
+	[OI_FUNCTION_PROFILE_INFO] = protocol_profiles_info,
+	[OI_FUNCTION_GET_ACTIVE_PROFILE] = protocol_profiles_get_active,
+	[OI_FUNCTION_SET_ACTIVE_PROFILE] = protocol_profiles_set_active,
+	[OI_FUNCTION_GET_PROFILE] = protocol_profiles_get,
+	[OI_FUNCTION_SET_CPI] = protocol_profiles_set_cpi,
+	[OI_FUNCTION_SET_POLLING_RATE] = protocol_profiles_set_polling_rate,
+	[OI_FUNCTION_SET_BUTTON] = protocol_profiles_set_button,
+	[OI_FUNCTION_SET_LED] = protocol_profiles_set_led,
+	[OI_FUNCTION_SAVE_PROFILES] = protocol_profiles_save,
+};
+
+static const protocol_handler_t fw_update_handlers[] = {
+	[OI_FUNCTION_FW_UPDATE_INFO] = protocol_fw_update_info,
+	[OI_FUNCTION_FW_UPDATE_START] = protocol_fw_update_start,
+	[OI_FUNCTION_FW_UPDATE_WRITE] = protocol_fw_update_write,
+	[OI_FUNCTION_FW_UPDATE_FINISH] = protocol_fw_update_finish,
+};
+
+static const protocol_handler_t batch_handlers[] = {
+	[OI_FUNCTION_BATCH_EXECUTE] = protocol_batch_execute,
+};
+
+static const protocol_handler_t debug_handlers[] = {
+	[OI_FUNCTION_SOF_STATS] = protocol_debug_sof_stats,
+	[OI_FUNCTION_TX_QUEUE_STATS] = protocol_debug_tx_queue_stats,
+};
+
+/* functions_mask has one bit per function */
+_Static_assert(sizeof(info_handlers) / sizeof(*info_handlers) <= 32, "too many info functions");
+_Static_assert(sizeof(profiles_handlers) / sizeof(*profiles_handlers) <= 32, "too many profiles functions");
+_Static_assert(sizeof(fw_update_handlers) / sizeof(*fw_update_handlers) <= 32, "too many fw update functions");
+_Static_assert(sizeof(batch_handlers) / sizeof(*batch_handlers) <= 32, "too many batch functions");
+_Static_assert(sizeof(debug_handlers) / sizeof(*debug_handlers) <= 32, "too many debug functions");
+
+static const struct protocol_page_t page_table[PAGE_COUNT] = {
+	[INFO] = {info_handlers, sizeof(info_handlers) / sizeof(*info_handlers)},
+	[GENERAL_PROFILES] = {profiles_handlers, sizeof(profiles_handlers) / sizeof(*profiles_handlers)},
+	[FW_UPDATE] = {fw_update_handlers, sizeof(fw_update_handlers) / sizeof(*fw_update_handlers)},
+	[BATCH] = {batch_handlers, sizeof(batch_handlers) / sizeof(*batch_handlers)},
+	[DEBUG] = {debug_handlers, sizeof(debug_handlers) / sizeof(*debug_handlers)},
+};
+
+int protocol_page_index(u8 function_page)
 {
-	for (size_t i = 0; i < sizeof(supported_pages); i++) {
-		if (supported_pages[i] == function_page) {
-			*functions_size = config.functions_size[i];
-			return config.functions[i];
-		}
+	return (int) page_index_table[function_page] - 1;
+}
+
+void protocol_set_functions(struct protocol_config_t *config,
+			    enum supported_pages_index index,
+			    u8 *functions,
+			    u8 functions_size)
+{
+	const struct protocol_page_t *page = &page_table[index];
+
+	config->functions[index] = functions;
+	config->functions_size[index] = functions_size;
+	config->functions_mask[index] = 0;
+
+	/* functions we don't implement can't be enabled */
+	for (size_t i = 0; i < functions_size; i++)
+		if (functions[i] < page->handlers_size && page->handlers[functions[i]])
+			config->functions_mask[index] |= 1UL << functions[i];
+}
+
+u8 *protocol_get_functions(const struct protocol_config_t *config, u8 function_page, size_t *functions_size)
+{
+	int index = protocol_page_index(function_page);
+
+	if (index < 0) {
+		*functions_size = 0;
+		return NULL;
 	}
-	*functions_size = 0;
-	return NULL;
+
+	*functions_size = config->functions_size[index];
+	return config->functions[index];
 }
 
 u8 protocol_get_smallest_report_id(size_t args_size)
@@ -45,98 +146,202 @@ u8 protocol_get_smallest_report_id(size_t args_size)
 	return OI_REPORT_LONG;
 }
 
-int protocol_is_supported(struct protocol_config_t config, u8 function_page, u8 function)
+static protocol_handler_t protocol_get_handler(const struct protocol_config_t *config, u8 function_page, u8 function)
 {
-	size_t functions_size;
-	u8 *functions = protocol_get_functions(config, function_page, &functions_size);
+	int index = protocol_page_index(function_page);
 
-	for (size_t i = 0; i < functions_size; i++)
-		if (functions[i] == function)
-			return 1;
-	return 0;
+	if (index < 0)
+		return NULL;
+
+	/* the device may only enable a subset of the functions we implement, the mask only has those */
+	if (function >= 32 || !(config->functions_mask[index] & (1UL << function)))
+		return NULL;
+
+	return page_table[index].handlers[function];
 }
 
-void protocol_dispatch(struct protocol_config_t config, u8 *buffer, size_t buffer_size)
+int protocol_is_supported(const struct protocol_config_t *config, u8 function_page, u8 function)
 {
-	struct oi_report_t msg;
-	struct protocol_error_t unsupported_error = {
+	return protocol_get_handler(config, function_page, function) != NULL;
+}
+
+void protocol_dispatch(const struct protocol_config_t *config, u8 *buffer, size_t buffer_size)
+{
+	/*
+	 * This is the only copy of the request, handlers rewrite it in place into the
+	 * response and send it from here, so nothing else is copied along the way.
+	 */
+	struct oi_report_t msg = {};
+	static const struct protocol_error_t unsupported_error = {
 		.id = OI_ERROR_UNSUPPORTED_FUNCTION,
 	};
-	int ret;
+	static const struct protocol_error_t busy_error = {
+		.id = OI_ERROR_BUSY,
+	};
+	struct protocol_pipeline_t *pipeline = config->pipeline;
+	protocol_handler_t handler;
+	size_t size;
+	u8 pipelined = 0;
 
-	if (buffer_size < 1 || buffer_size > sizeof(msg))
-		/* we need at least a report ID, and a packet that fits the struct  */
+	if (buffer_size < 1)
+		/* we need at least a report ID */
 		return;
 
-	memcpy(&msg, buffer, buffer_size);
-
-	switch (msg.id) {
+	switch (buffer[0]) {
 		case OI_REPORT_SHORT:
-			if (buffer_size != OI_REPORT_SHORT_SIZE)
-				return;
+			size = OI_REPORT_SHORT_SIZE;
 			break;
 
 		case OI_REPORT_LONG:
-			if (buffer_size != OI_REPORT_LONG_SIZE)
-				return;
+			size = OI_REPORT_LONG_SIZE;
+			break;
+
+		case OI_REPORT_SHORT_PIPELINED:
+			size = OI_REPORT_SHORT_SIZE;
+			pipelined = 1;
+			break;
+
+		case OI_REPORT_LONG_PIPELINED:
+			size = OI_REPORT_LONG_SIZE;
+			pipelined = 1;
 			break;
 
 		default:
 			return;
 	}
 
-	if (!protocol_is_supported(config, msg.function_page, msg.function)) {
-		protocol_send_error(config, msg, unsupported_error);
+	if (buffer_size != size + pipelined)
 		return;
-	}
 
-	switch (msg.function_page) {
-		case OI_PAGE_INFO:
-			switch (msg.function) {
-				case OI_FUNCTION_VERSION:
-					protocol_info_version(config, msg);
-					break;
-				case OI_FUNCTION_FW_INFO:
-					protocol_info_fw_info(config, msg);
-					break;
-				case OI_FUNCTION_SUPPORTED_FUNCTION_PAGES:
-					protocol_info_supported_function_pages(config, msg);
-					break;
-				case OI_FUNCTION_SUPPORTED_FUNCTIONS:
-					protocol_info_supported_functions(config, msg);
-					break;
-				default:
-					break;
-			}
+	/* without a queue the responses could be lost, the host has to wait for each of them */
+	if (pipelined && !pipeline)
+		return;
 
-		default:
-			break;
+	/* handlers only ever see plain reports, the sequence number is added back when the response is queued */
+	memcpy(&msg, buffer, size);
+	msg.id = size == OI_REPORT_SHORT_SIZE ? OI_REPORT_SHORT : OI_REPORT_LONG;
+	if (pipeline) {
+		pipeline->pipelined = pipelined;
+		pipeline->sequence = pipelined ? buffer[size] : 0;
+	}
+
+	handler = protocol_get_handler(config, msg.function_page, msg.function);
+	if (pipeline && !pipeline->capture && tx_queue_space(&pipeline->queue) < 2) {
+		/* every request has at most one response, so this is the last one we can tell about it */
+		pipeline->busy++;
+		protocol_send_error(config, &msg, &busy_error);
+	} else if (handler) {
+		handler(config, &msg);
+	} else {
+		protocol_send_error(config, &msg, &unsupported_error);
 	}
+
+	if (pipeline)
+		pipeline->pipelined = 0;
+}
+
+int protocol_dispatch_sync(const struct protocol_config_t *config,
+			   u8 *buffer,
+			   size_t buffer_size,
+			   u8 *response,
+			   size_t response_size)
+{
+	struct protocol_pipeline_t *pipeline = config->pipeline;
+	struct protocol_capture_t capture = {
+		.buffer = response,
+		.size = response_size,
+	};
+
+	/* only plain reports, a pipelined request has nowhere to queue its response */
+	if (!(buffer_size == OI_REPORT_SHORT_SIZE && buffer[0] == OI_REPORT_SHORT) &&
+	    !(buffer_size == OI_REPORT_LONG_SIZE && buffer[0] == OI_REPORT_LONG))
+		return -EINVAL;
+
+	/* the response is captured through the pipeline */
+	if (!pipeline)
+		return -ENOTSUP;
+
+	pipeline->capture = &capture;
+	protocol_dispatch(config, buffer, buffer_size);
+	pipeline->capture = NULL;
+
+	/* some requests don't get a response on purpose (eg. windowed firmware update writes), that's 0 */
+	return capture.length;
 }
 
-void protocol_send_report(struct protocol_config_t config, struct oi_report_t msg)
+void protocol_send_report(const struct protocol_config_t *config, struct oi_report_t *msg)
 {
-	int ret = 0;
+	struct protocol_pipeline_t *pipeline = config->pipeline;
+	size_t size;
+	u8 *entry;
 
-	switch (msg.id) {
+	switch (msg->id) {
 		case OI_REPORT_SHORT:
-			ret = config.hid_hal.send(config.hid_hal, (u8 *) &msg, OI_REPORT_SHORT_SIZE);
+			size = OI_REPORT_SHORT_SIZE;
 			break;
 		case OI_REPORT_LONG:
-			ret = config.hid_hal.send(config.hid_hal, (u8 *) &msg, OI_REPORT_LONG_SIZE);
+			size = OI_REPORT_LONG_SIZE;
 			break;
 		default:
-			break;
+			return;
 	}
+
+	if (!pipeline) {
+		config->hid_hal.send(config->hid_hal, (u8 *) msg, size);
+		return;
+	}
+
+	if (pipeline->capture) {
+		pipeline->capture->length = min(size, pipeline->capture->size);
+		memcpy(pipeline->capture->buffer, msg, pipeline->capture->length);
+		return;
+	}
+
+	/* the consumer runs in our context on all targets, give it a chance to make room */
+	if (!tx_queue_space(&pipeline->queue))
+		protocol_flush(config);
+
+	/* the host ignored the busy errors, it will time out waiting for this one (counted as an overflow) */
+	entry = tx_queue_reserve(&pipeline->queue);
+	if (!entry)
+		return;
+
+	memcpy(entry, msg, size);
+	if (pipeline->pipelined) {
+		entry[0] = msg->id == OI_REPORT_SHORT ? OI_REPORT_SHORT_PIPELINED : OI_REPORT_LONG_PIPELINED;
+		entry[size++] = pipeline->sequence;
+	}
+	tx_queue_commit(&pipeline->queue, size);
+
+	/* nothing else will start the transfer if the endpoint is idle */
+	protocol_flush(config);
 }
 
-void protocol_send_error(struct protocol_config_t config, struct oi_report_t msg, struct protocol_error_t error)
+void protocol_flush(const struct protocol_config_t *config)
 {
-	msg.data[0] = msg.function_page;
-	msg.data[1] = msg.function;
-	memcpy(msg.data + 2, &error.args, sizeof(msg.data - 2));
-	msg.function_page = OI_PAGE_ERROR;
-	msg.function = error.id;
+	struct protocol_pipeline_t *pipeline = config->pipeline;
+	const u8 *entry;
+	size_t size;
+
+	if (!pipeline)
+		return;
+
+	while ((entry = tx_queue_peek(&pipeline->queue, &size))) {
+		/* any other error is not going to go away, drop the response like we would without a queue */
+		if (config->hid_hal.send(config->hid_hal, (u8 *) entry, size) == -EBUSY)
+			return;
+
+		tx_queue_pop(&pipeline->queue);
+	}
+}
+
+void protocol_send_error(const struct protocol_config_t *config, struct oi_report_t *msg, const struct protocol_error_t *error)
+{
+	msg->data[0] = msg->function_page;
+	msg->data[1] = msg->function;
+	memcpy(msg->data + 2, &error->args, sizeof(msg->data) - 2);
+	msg->function_page = OI_PAGE_ERROR;
+	msg->function = error->id;
 
 	protocol_send_report(config, msg);
 }
@@ -145,45 +350,45 @@ void protocol_send_error(struct protocol_config_t config, struct oi_report_t msg
  * 0x00 - info
  */
 
-void protocol_info_version(struct protocol_config_t config, struct oi_report_t msg)
+void protocol_info_version(const struct protocol_config_t *config, struct oi_report_t *msg)
 {
-	msg.id = OI_REPORT_SHORT;
-	msg.data[0] = OI_PROTOCOL_VERSION_MAJOR;
-	msg.data[1] = OI_PROTOCOL_VERSION_MINOR;
-	msg.data[2] = OI_PROTOCOL_VERSION_PATCH;
+	msg->id = OI_REPORT_SHORT;
+	msg->data[0] = OI_PROTOCOL_VERSION_MAJOR;
+	msg->data[1] = OI_PROTOCOL_VERSION_MINOR;
+	msg->data[2] = OI_PROTOCOL_VERSION_PATCH;
 
 	protocol_send_report(config, msg);
 }
 
-void protocol_info_fw_info(struct protocol_config_t config, struct oi_report_t msg)
+void protocol_info_fw_info(const struct protocol_config_t *config, struct oi_report_t *msg)
 {
 	struct protocol_error_t error = {.id = OI_ERROR_INVALID_VALUE};
 
-	msg.id = OI_REPORT_LONG;
-	switch (msg.data[0]) {
+	msg->id = OI_REPORT_LONG;
+	switch (msg->data[0]) {
 		case 0: /* fw vendor */
-			memset(msg.data, 0, sizeof(msg.data));
-			snprintf(msg.data, sizeof(msg.data), "%s", OI_VENDOR);
+			memset(msg->data, 0, sizeof(msg->data));
+			snprintf(msg->data, sizeof(msg->data), "%s", OI_VENDOR);
 			break;
 		case 1: /* fw version */
-			memset(msg.data, 0, sizeof(msg.data));
-			snprintf(msg.data, sizeof(msg.data), "%s", OI_VERSION);
+			memset(msg->data, 0, sizeof(msg->data));
+			snprintf(msg->data, sizeof(msg->data), "%s", OI_VERSION);
 			break;
 		case 2: /* device name */
-			memset(msg.data, 0, sizeof(msg.data));
-			snprintf(msg.data, sizeof(msg.data), "%s", config.device_name);
+			memset(msg->data, 0, sizeof(msg->data));
+			snprintf(msg->data, sizeof(msg->data), "%s", config->device_name);
 			break;
 		default:
-			memset(msg.data, 0, sizeof(msg.data));
+			memset(msg->data, 0, sizeof(msg->data));
 			error.args.invalid_value.position = 0;
-			protocol_send_error(config, msg, error);
+			protocol_send_error(config, msg, &error);
 			return;
 	}
 
 	protocol_send_report(config, msg);
 }
 
-void protocol_info_supported_function_pages(struct protocol_config_t config, struct oi_report_t msg)
+void protocol_info_supported_function_pages(const struct protocol_config_t *config, struct oi_report_t *msg)
 {
 	struct protocol_error_t error = {
 		.id = OI_ERROR_INVALID_VALUE,
@@ -191,46 +396,588 @@ void protocol_info_supported_function_pages(struct protocol_config_t config, str
 	u8 copy_size;
 	u8 pages[PAGE_COUNT];
 	u8 pages_size = sizeof(pages);
-	u8 start_index = msg.data[0];
+	u8 start_index = msg->data[0];
 
 	protocol_get_functions_pages(config, pages, &pages_size);
 
 	if (start_index >= pages_size) {
 		error.args.invalid_value.position = 0;
-		protocol_send_error(config, msg, error);
+		protocol_send_error(config, msg, &error);
 		return;
 	}
 
-	copy_size = min(sizeof(msg.data) - 1, pages_size - start_index);
-	msg.id = protocol_get_smallest_report_id(copy_size);
-	msg.data[0] = copy_size;
-	msg.data[1] = pages_size - start_index - copy_size;
-	memcpy(msg.data + 2, pages + start_index, copy_size);
+	copy_size = min(sizeof(msg->data) - 2, pages_size - start_index);
+	msg->id = protocol_get_smallest_report_id(copy_size);
+	msg->data[0] = copy_size;
+	msg->data[1] = pages_size - start_index - copy_size;
+	memcpy(msg->data + 2, pages + start_index, copy_size);
 
 	protocol_send_report(config, msg);
 }
 
-void protocol_info_supported_functions(struct protocol_config_t config, struct oi_report_t msg)
+void protocol_info_supported_functions(const struct protocol_config_t *config, struct oi_report_t *msg)
 {
 	struct protocol_error_t error = {
 		.id = OI_ERROR_INVALID_VALUE,
 	};
 	u8 copy_size;
 	size_t functions_size;
-	u8 *functions = protocol_get_functions(config, msg.data[0], &functions_size);
-	u8 start_index = msg.data[1];
+	u8 *functions = protocol_get_functions(config, msg->data[0], &functions_size);
+	u8 start_index = msg->data[1];
 
 	if (start_index >= functions_size) {
 		error.args.invalid_value.position = 1;
-		protocol_send_error(config, msg, error);
+		protocol_send_error(config, msg, &error);
+		return;
+	}
+
+	copy_size = min(sizeof(msg->data) - 2, functions_size - start_index);
+	msg->id = protocol_get_smallest_report_id(copy_size);
+	msg->data[0] = copy_size;
+	msg->data[1] = functions_size - start_index - copy_size;
+	memcpy(msg->data + 2, functions + start_index, copy_size);
+
+	protocol_send_report(config, msg);
+}
+
+/*
+ * 0x01 - general profiles
+ *
+ * Requests that target a profile take its index in the first byte, multi-byte
+ * values are little endian. Set functions acknowledge by echoing the request, the
+ * changes reach the report path at the next report and flash a bit later.
+ */
+
+static void protocol_send_invalid_value(const struct protocol_config_t *config, struct oi_report_t *msg, u8 position)
+{
+	struct protocol_error_t error = {
+		.id = OI_ERROR_INVALID_VALUE,
+		.args.invalid_value.position = position,
+	};
+
+	protocol_send_error(config, msg, &error);
+}
+
+/* the description doesn't fit short reports */
+static void protocol_send_custom_error(const struct protocol_config_t *config,
+				       struct oi_report_t *msg,
+				       const char *description)
+{
+	struct protocol_error_t error = {
+		.id = OI_ERROR_CUSTOM,
+	};
+
+	snprintf(error.args.description, sizeof(error.args.description), "%s", description);
+	msg->id = OI_REPORT_LONG;
+	protocol_send_error(config, msg, &error);
+}
+
+static u8 protocol_profiles_available(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	static const struct protocol_error_t error = {
+		.id = OI_ERROR_UNSUPPORTED_FUNCTION,
+	};
+
+	if (config->profiles)
+		return 1;
+
+	protocol_send_error(config, msg, &error);
+	return 0;
+}
+
+/* copies the profile selected by the request, or replies with an error */
+static u8 protocol_profiles_read(const struct protocol_config_t *config, struct oi_report_t *msg, struct profile_t *profile)
+{
+	if (!protocol_profiles_available(config, msg))
+		return 0;
+
+	if (msg->data[0] >= PROFILE_COUNT) {
+		protocol_send_invalid_value(config, msg, 0);
+		return 0;
+	}
+
+	*profile = config->profiles->profiles[msg->data[0]];
+	return 1;
+}
+
+static void protocol_profiles_write(const struct protocol_config_t *config,
+				    struct oi_report_t *msg,
+				    const struct profile_t *profile)
+{
+	if (profiles_update(config->profiles, msg->data[0], profile) < 0) {
+		protocol_send_custom_error(config, msg, "invalid profile");
+		return;
+	}
+
+	protocol_send_report(config, msg);
+}
+
+void protocol_profiles_info(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	if (!protocol_profiles_available(config, msg))
+		return;
+
+	msg->id = OI_REPORT_SHORT;
+	memset(msg->data, 0, sizeof(msg->data));
+	msg->data[0] = PROFILE_COUNT;
+	msg->data[1] = PROFILE_BUTTON_COUNT;
+	msg->data[2] = config->profiles->selected;
+
+	protocol_send_report(config, msg);
+}
+
+void protocol_profiles_get_active(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	if (!protocol_profiles_available(config, msg))
+		return;
+
+	msg->id = OI_REPORT_SHORT;
+	memset(msg->data, 0, sizeof(msg->data));
+	msg->data[0] = config->profiles->selected;
+
+	protocol_send_report(config, msg);
+}
+
+void protocol_profiles_set_active(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	if (!protocol_profiles_available(config, msg))
+		return;
+
+	if (profiles_select(config->profiles, msg->data[0]) < 0) {
+		protocol_send_invalid_value(config, msg, 0);
+		return;
+	}
+
+	protocol_send_report(config, msg);
+}
+
+void protocol_profiles_get(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	struct profile_t profile;
+
+	if (!protocol_profiles_read(config, msg, &profile))
+		return;
+
+	msg->id = OI_REPORT_LONG;
+	memset(msg->data + 1, 0, sizeof(msg->data) - 1);
+	memcpy(msg->data + 1, &profile, sizeof(profile));
+
+	protocol_send_report(config, msg);
+}
+
+void protocol_profiles_set_cpi(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	struct profile_t profile;
+	u16 cpi = msg->data[1] | msg->data[2] << 8;
+
+	if (!protocol_profiles_read(config, msg, &profile))
+		return;
+
+	if (cpi == 0) {
+		protocol_send_invalid_value(config, msg, 1);
+		return;
+	}
+
+	profile.cpi = cpi;
+	protocol_profiles_write(config, msg, &profile);
+}
+
+void protocol_profiles_set_polling_rate(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	struct profile_t profile;
+	u16 rate = msg->data[1] | msg->data[2] << 8;
+
+	if (!protocol_profiles_read(config, msg, &profile))
+		return;
+
+	if (rate == 0 || rate > PROFILE_POLLING_RATE_MAX) {
+		protocol_send_invalid_value(config, msg, 1);
+		return;
+	}
+
+	profile.polling_rate = rate;
+	protocol_profiles_write(config, msg, &profile);
+}
+
+void protocol_profiles_set_button(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	struct profile_t profile;
+	u8 button = msg->data[1];
+
+	if (!protocol_profiles_read(config, msg, &profile))
+		return;
+
+	if (button >= PROFILE_BUTTON_COUNT) {
+		protocol_send_invalid_value(config, msg, 1);
+		return;
+	}
+
+	profile.buttons[button] = msg->data[2];
+	protocol_profiles_write(config, msg, &profile);
+}
+
+void protocol_profiles_set_led(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	struct profile_t profile;
+
+	if (!protocol_profiles_read(config, msg, &profile))
+		return;
+
+	/* the settings only fit long reports, a short one would set blue to 0 */
+	if (msg->id != OI_REPORT_LONG) {
+		protocol_send_invalid_value(config, msg, sizeof(profile.led)); /* blue, the first byte past the report */
+		return;
+	}
+
+	if (msg->data[1] >= PROFILE_LED_MODE_COUNT) {
+		protocol_send_invalid_value(config, msg, 1);
+		return;
+	}
+
+	memcpy(&profile.led, msg->data + 1, sizeof(profile.led));
+	protocol_profiles_write(config, msg, &profile);
+}
+
+/* don't wait for the flush timer, eg. before the host unplugs the device */
+void protocol_profiles_save(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	if (!protocol_profiles_available(config, msg))
+		return;
+
+	if (profiles_flush(config->profiles) < 0) {
+		protocol_send_custom_error(config, msg, "flash write failed");
+		return;
+	}
+
+	protocol_send_report(config, msg);
+}
+
+/*
+ * 0x02 - firmware update
+ *
+ * The image is streamed into the slot we are not running from. START takes the
+ * image size and CRC-32, then the host sends WRITE chunks with a sequence number
+ * without waiting for replies, up to OI_FW_UPDATE_WINDOW of them. We only
+ * acknowledge every OI_FW_UPDATE_ACK_INTERVAL chunks and the last one, with the
+ * next sequence number we expect, so the transfer runs at the speed of the bus
+ * instead of one round trip per chunk. A chunk out of sequence gets a single NAK
+ * with the sequence number to resend from, everything after it is dropped until
+ * the resend arrives. FINISH checks the CRC of the flash contents and switches
+ * the boot slot. Multi-byte values are little endian.
+ */
+
+static u8 protocol_fw_update_available(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	static const struct protocol_error_t error = {
+		.id = OI_ERROR_UNSUPPORTED_FUNCTION,
+	};
+
+	if (config->fw_update)
+		return 1;
+
+	protocol_send_error(config, msg, &error);
+	return 0;
+}
+
+static u32 protocol_get_u32(const u8 *data)
+{
+	return data[0] | data[1] << 8 | data[2] << 16 | (u32) data[3] << 24;
+}
+
+static void protocol_put_u32(u8 *data, u32 value)
+{
+	data[0] = value;
+	data[1] = value >> 8;
+	data[2] = value >> 16;
+	data[3] = value >> 24;
+}
+
+static void protocol_fw_update_send_ack(const struct protocol_config_t *config, struct oi_report_t *msg, u8 status)
+{
+	msg->id = OI_REPORT_SHORT;
+	memset(msg->data, 0, sizeof(msg->data));
+	msg->data[0] = config->fw_update->sequence;
+	msg->data[1] = config->fw_update->sequence >> 8;
+	msg->data[2] = status;
+
+	protocol_send_report(config, msg);
+}
+
+void protocol_fw_update_info(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	struct fw_update_t *update = config->fw_update;
+
+	if (!protocol_fw_update_available(config, msg))
+		return;
+
+	msg->id = OI_REPORT_LONG;
+	memset(msg->data, 0, sizeof(msg->data));
+	msg->data[0] = update->running;
+	msg->data[1] = update->boot;
+	msg->data[2] = OI_FW_UPDATE_CHUNK_SIZE;
+	msg->data[3] = OI_FW_UPDATE_WINDOW;
+	protocol_put_u32(msg->data + 4, fw_update_capacity(update));
+	msg->data[8] = update->state;
+	protocol_put_u32(msg->data + 9, update->received);
+
+	protocol_send_report(config, msg);
+}
+
+void protocol_fw_update_start(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	int ret;
+
+	if (!protocol_fw_update_available(config, msg))
+		return;
+
+	ret = fw_update_start(config->fw_update, protocol_get_u32(msg->data), protocol_get_u32(msg->data + 4));
+	if (ret == -EINVAL || ret == -EFBIG) {
+		protocol_send_invalid_value(config, msg, 0);
+		return;
+	} else if (ret < 0) {
+		protocol_send_custom_error(config, msg, "flash write failed");
+		return;
+	}
+
+	protocol_send_report(config, msg);
+}
+
+void protocol_fw_update_write(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	struct fw_update_t *update = config->fw_update;
+	u16 sequence = msg->data[0] | msg->data[1] << 8;
+	u16 size;
+
+	if (!protocol_fw_update_available(config, msg))
+		return;
+
+	/* the chunk only fits long reports */
+	if (msg->id != OI_REPORT_LONG) {
+		protocol_send_invalid_value(config, msg, 2);
+		return;
+	}
+
+	if (update->state != FW_UPDATE_RECEIVING) {
+		protocol_send_custom_error(config, msg, "no update in progress");
+		return;
+	}
+
+	if (sequence != update->sequence) {
+		/* chunks behind us are resends we already have, a gap means we lost some */
+		if ((s16) (sequence - update->sequence) > 0 && !update->gap_reported) {
+			update->gap_reported = 1;
+			protocol_fw_update_send_ack(config, msg, OI_FW_UPDATE_NAK);
+		}
+		return;
+	}
+
+	/* the next chunk would be past the end of the image */
+	if (update->received == update->size) {
+		protocol_send_custom_error(config, msg, "image complete");
+		return;
+	}
+
+	update->gap_reported = 0;
+	size = min(OI_FW_UPDATE_CHUNK_SIZE, update->size - update->received);
+	if (fw_update_write(update, msg->data + 2, size) < 0) {
+		protocol_send_custom_error(config, msg, "flash write failed");
+		return;
+	}
+	update->sequence++;
+
+	if (update->sequence % OI_FW_UPDATE_ACK_INTERVAL == 0 || update->received == update->size)
+		protocol_fw_update_send_ack(config, msg, OI_FW_UPDATE_ACK);
+}
+
+void protocol_fw_update_finish(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	int ret;
+
+	if (!protocol_fw_update_available(config, msg))
+		return;
+
+	ret = fw_update_finish(config->fw_update);
+	if (ret == -EINVAL) {
+		protocol_send_custom_error(config, msg, "image incomplete");
+		return;
+	} else if (ret == -EBADMSG) {
+		protocol_send_custom_error(config, msg, "crc mismatch");
+		return;
+	} else if (ret == -ENODEV) {
+		protocol_send_custom_error(config, msg, "no boot record");
+		return;
+	} else if (ret < 0) {
+		protocol_send_custom_error(config, msg, "flash write failed");
+		return;
+	}
+
+	msg->id = OI_REPORT_SHORT;
+	memset(msg->data, 0, sizeof(msg->data));
+	msg->data[0] = config->fw_update->boot;
+
+	protocol_send_report(config, msg);
+}
+
+/*
+ * 0x03 - batch
+ *
+ * EXECUTE carries several calls in one long report, so configuring a device
+ * doesn't cost a round trip per setting. The first data byte is the number of
+ * calls, followed by a (page, function, size, args) tuple for each of them. The
+ * calls run in order, each one as if it had arrived in its own report, and the
+ * response has the number of calls followed by their status, OI_BATCH_OK or the
+ * ID of the error they replied with, or OI_BATCH_TRUNCATED if the response was
+ * too short to tell. The data of the individual responses is dropped, so
+ * batches are meant for set functions. A malformed batch is rejected
+ * as a whole, before anything runs.
+ */
+
+void protocol_batch_execute(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	static const struct protocol_error_t unsupported_error = {
+		.id = OI_ERROR_UNSUPPORTED_FUNCTION,
+	};
+	struct protocol_pipeline_t *pipeline = config->pipeline;
+	struct protocol_capture_t *parent_capture;
+	u8 statuses[OI_BATCH_MAX_CALLS];
+	u8 response[OI_REPORT_DATA_INDEX]; /* the status is all we keep */
+	struct protocol_capture_t capture = {
+		.buffer = response,
+		.size = sizeof(response),
+	};
+	u8 count = msg->data[0];
+	protocol_handler_t handler;
+	struct oi_report_t call;
+	size_t position = 1;
+	u8 size;
+
+	/* the responses of the calls are captured through the pipeline */
+	if (!pipeline) {
+		protocol_send_error(config, msg, &unsupported_error);
+		return;
+	}
+
+	if (count == 0 || count > OI_BATCH_MAX_CALLS) {
+		protocol_send_invalid_value(config, msg, 0);
+		return;
+	}
+
+	/* every tuple has to fit, the position of the first size that doesn't is the invalid value */
+	for (u8 i = 0; i < count; i++) {
+		if (position + OI_BATCH_CALL_HEADER_SIZE > sizeof(msg->data)) {
+			protocol_send_invalid_value(config, msg, 0);
+			return;
+		}
+		size = msg->data[position + 2];
+		if (position + OI_BATCH_CALL_HEADER_SIZE + size > sizeof(msg->data)) {
+			protocol_send_invalid_value(config, msg, position + 2);
+			return;
+		}
+		position += OI_BATCH_CALL_HEADER_SIZE + size;
+	}
+
+	/* responses to the calls are captured, the queue (or whoever captures us) is only for the batch response */
+	parent_capture = pipeline->capture;
+	pipeline->capture = &capture;
+
+	position = 1;
+	for (u8 i = 0; i < count; i++) {
+		size = msg->data[position + 2];
+
+		memset(&call, 0, sizeof(call));
+		call.id = size <= OI_REPORT_SHORT_DATA_MAX_SIZE ? OI_REPORT_SHORT : OI_REPORT_LONG;
+		call.function_page = msg->data[position];
+		call.function = msg->data[position + 1];
+		memcpy(call.data, msg->data + position + OI_BATCH_CALL_HEADER_SIZE, size);
+		position += OI_BATCH_CALL_HEADER_SIZE + size;
+
+		capture.length = 0;
+
+		/* no nested batches */
+		handler = call.function_page != OI_PAGE_BATCH ? protocol_get_handler(config, call.function_page, call.function)
+							      : NULL;
+		if (handler)
+			handler(config, &call);
+		else
+			protocol_send_error(config, &call, &unsupported_error);
+
+		/* the error ID is the last header byte, don't read past what was captured */
+		if (!capture.length)
+			statuses[i] = OI_BATCH_OK;
+		else if (capture.length < OI_REPORT_DATA_INDEX)
+			statuses[i] = OI_BATCH_TRUNCATED;
+		else
+			statuses[i] = response[1] == OI_PAGE_ERROR ? response[2] : OI_BATCH_OK;
+	}
+
+	pipeline->capture = parent_capture;
+
+	msg->id = OI_REPORT_LONG;
+	memset(msg->data, 0, sizeof(msg->data));
+	msg->data[0] = count;
+	memcpy(msg->data + 1, statuses, count);
+
+	protocol_send_report(config, msg);
+}
+
+/*
+ * 0xFE - debug
+ */
+
+void protocol_debug_sof_stats(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	struct protocol_error_t error = {
+		.id = OI_ERROR_INVALID_VALUE,
+	};
+	struct sof_stats_t stats;
+	u8 reset = msg->data[0] & 0x01; /* bit 0: reset the statistics after reading them */
+
+	if (!config->sof_scheduler) {
+		error.id = OI_ERROR_UNSUPPORTED_FUNCTION;
+		protocol_send_error(config, msg, &error);
+		return;
+	}
+
+	if (msg->data[0] & ~0x01) {
+		error.args.invalid_value.position = 0;
+		protocol_send_error(config, msg, &error);
+		return;
+	}
+
+	sof_scheduler_get_stats(config->sof_scheduler, &stats);
+	if (reset)
+		sof_scheduler_reset_stats(config->sof_scheduler);
+
+	msg->id = OI_REPORT_LONG;
+	memset(msg->data, 0, sizeof(msg->data));
+	memcpy(msg->data, &stats, sizeof(stats));
+
+	protocol_send_report(config, msg);
+}
+
+/* response queue counters, little endian: queued, sent, overflows, high water mark, busy errors, then the queue size */
+void protocol_debug_tx_queue_stats(const struct protocol_config_t *config, struct oi_report_t *msg)
+{
+	static const struct protocol_error_t error = {
+		.id = OI_ERROR_UNSUPPORTED_FUNCTION,
+	};
+	struct tx_queue_stats_t stats;
+
+	if (!config->pipeline) {
+		protocol_send_error(config, msg, &error);
 		return;
 	}
 
-	copy_size = min(sizeof(msg.data) - 1, functions_size - start_index);
-	msg.id = protocol_get_smallest_report_id(copy_size);
-	msg.data[0] = copy_size;
-	msg.data[1] = functions_size - start_index - copy_size;
-	memcpy(msg.data + 2, functions + start_index, copy_size);
+	tx_queue_get_stats(&config->pipeline->queue, &stats);
+
+	msg->id = OI_REPORT_LONG;
+	memset(msg->data, 0, sizeof(msg->data));
+	protocol_put_u32(msg->data, stats.queued);
+	protocol_put_u32(msg->data + 4, stats.sent);
+	protocol_put_u32(msg->data + 8, stats.overflows);
+	protocol_put_u32(msg->data + 12, stats.high_water);
+	protocol_put_u32(msg->data + 16, config->pipeline->busy);
+	msg->data[20] = TX_QUEUE_SIZE;
 
 	protocol_send_report(config, msg);
 }
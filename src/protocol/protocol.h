@@ -7,6 +7,10 @@
 
 #include "hal/hid.h"
 #include "protocol/reports.h"
+#include "util/fw_update/fw_update.h"
+#include "util/profiles/profiles.h"
+#include "util/sof_scheduler/sof_scheduler.h"
+#include "util/tx_queue/tx_queue.h"
 #include "util/types.h"
 
 /* version */
@@ -20,6 +24,15 @@
 #define OI_REPORT_SHORT_SIZE 8
 #define OI_REPORT_LONG_SIZE  32
 
+/* pipelined reports, same as above followed by a sequence number that the response echoes */
+#define OI_REPORT_SHORT_PIPELINED      0x22
+#define OI_REPORT_LONG_PIPELINED       0x23
+#define OI_REPORT_SHORT_PIPELINED_SIZE (OI_REPORT_SHORT_SIZE + 1)
+#define OI_REPORT_LONG_PIPELINED_SIZE  (OI_REPORT_LONG_SIZE + 1)
+
+/* requests the host may have in flight, the last queue entry is kept for the busy error */
+#define OI_PIPELINE_WINDOW (TX_QUEUE_SIZE - 1)
+
 #define OI_REPORT_DATA_INDEX	      3
 #define OI_REPORT_SHORT_DATA_MAX_SIZE OI_REPORT_SHORT_SIZE - OI_REPORT_DATA_INDEX
 #define OI_REPORT_LONG_DATA_MAX_SIZE  OI_REPORT_LONG_SIZE - OI_REPORT_DATA_INDEX
@@ -27,6 +40,8 @@
 /* protocol function pages */
 #define OI_PAGE_INFO		 0x00
 #define OI_PAGE_GENERAL_PROFILES 0x01
+#define OI_PAGE_FW_UPDATE	 0x02
+#define OI_PAGE_BATCH		 0x03
 #define OI_PAGE_GIMMICKS	 0xFD
 #define OI_PAGE_DEBUG		 0xFE
 #define OI_PAGE_ERROR		 0xFF
@@ -37,15 +52,56 @@
 #define OI_FUNCTION_SUPPORTED_FUNCTION_PAGES 0x02
 #define OI_FUNCTION_SUPPORTED_FUNCTIONS	     0x03
 
+/* general profiles page (0x01) functions */
+#define OI_FUNCTION_PROFILE_INFO       0x00
+#define OI_FUNCTION_GET_ACTIVE_PROFILE 0x01
+#define OI_FUNCTION_SET_ACTIVE_PROFILE 0x02
+#define OI_FUNCTION_GET_PROFILE	       0x03
+#define OI_FUNCTION_SET_CPI	       0x04
+#define OI_FUNCTION_SET_POLLING_RATE   0x05
+#define OI_FUNCTION_SET_BUTTON	       0x06
+#define OI_FUNCTION_SET_LED	       0x07
+#define OI_FUNCTION_SAVE_PROFILES      0x08
+
+/* firmware update page (0x02) functions */
+#define OI_FUNCTION_FW_UPDATE_INFO   0x00
+#define OI_FUNCTION_FW_UPDATE_START  0x01
+#define OI_FUNCTION_FW_UPDATE_WRITE  0x02
+#define OI_FUNCTION_FW_UPDATE_FINISH 0x03
+
+/* firmware update transfer */
+#define OI_FW_UPDATE_CHUNK_SIZE	  (OI_REPORT_LONG_DATA_MAX_SIZE - 2) /* after the sequence number */
+#define OI_FW_UPDATE_WINDOW	  16 /* chunks the host may send without an acknowledgement */
+#define OI_FW_UPDATE_ACK_INTERVAL 8 /* chunks per acknowledgement, less than the window to keep the host busy */
+#define OI_FW_UPDATE_ACK	  0x00
+#define OI_FW_UPDATE_NAK	  0x01
+
+/* batch page (0x03) functions */
+#define OI_FUNCTION_BATCH_EXECUTE 0x00
+
+/* batch calls, (page, function, size, args) after the number of calls */
+#define OI_BATCH_CALL_HEADER_SIZE 3
+#define OI_BATCH_MAX_CALLS	  ((OI_REPORT_LONG_DATA_MAX_SIZE - 1) / OI_BATCH_CALL_HEADER_SIZE)
+#define OI_BATCH_OK		  0x00 /* call status, otherwise the error ID */
+#define OI_BATCH_TRUNCATED	  0xFF /* call status, the response was too short to carry one */
+
+/* debug page (0xFE) functions */
+#define OI_FUNCTION_SOF_STATS	   0x00
+#define OI_FUNCTION_TX_QUEUE_STATS 0x01
+
 /* error page (0xFF) */
 #define OI_ERROR_INVALID_VALUE	      0x01
 #define OI_ERROR_UNSUPPORTED_FUNCTION 0x02
+#define OI_ERROR_BUSY		      0x03 /* not run, the response queue is full, send it again later */
 #define OI_ERROR_CUSTOM		      0xFE
 
 /* supported functions enum */
 enum supported_pages_index {
 	/* IMPORTANT: also update tests/wrapper/pages.py! */
 	INFO,
+	GENERAL_PROFILES,
+	FW_UPDATE,
+	BATCH,
 	GIMMICKS,
 	DEBUG,
 	PAGE_COUNT /* this will hold the number of supported function pages */
@@ -53,17 +109,59 @@ enum supported_pages_index {
 
 static const u8 supported_pages[] = {
 	OI_PAGE_INFO,
+	OI_PAGE_GENERAL_PROFILES,
+	OI_PAGE_FW_UPDATE,
+	OI_PAGE_BATCH,
 	OI_PAGE_GIMMICKS,
 	OI_PAGE_DEBUG,
 };
 
 _Static_assert(sizeof(supported_pages) == PAGE_COUNT, "invalid size");
 
+/*
+ * Responses waiting for the HID endpoint
+ *
+ * Pipelined requests arrive back to back, faster than the endpoint can send the
+ * responses (one report per poll interval), so responses are queued here and go
+ * out in order as the endpoint frees up. Plain requests use the queue too when
+ * there is one, otherwise they could overtake queued responses.
+ *
+ * The handlers are the producer of the queue and protocol_flush is the consumer.
+ * When only one entry is left, requests are turned away with OI_ERROR_BUSY, so the
+ * host finds out it has to slow down instead of losing responses.
+ */
+struct protocol_pipeline_t {
+	struct tx_queue_t queue;
+	u32 busy; /* requests turned away */
+	/* request being dispatched */
+	u8 pipelined;
+	u8 sequence;
+	/* responses go here instead of out while set, for calls that answer someone else (batches, feature reports) */
+	struct protocol_capture_t *capture;
+};
+
+/* keeps a response instead of sending it, the part that doesn't fit in size is dropped */
+struct protocol_capture_t {
+	u8 *buffer;
+	size_t size;
+	size_t length; /* of the response, 0 if there was none */
+};
+
 struct protocol_config_t {
 	char *device_name;
 	u8 *functions[PAGE_COUNT];
 	u8 functions_size[PAGE_COUNT];
+	/* the same functions as a bitmap indexed by function ID, set with protocol_set_functions */
+	u32 functions_mask[PAGE_COUNT];
 	struct hid_hal_t hid_hal;
+	/* response queue, pipelined requests are ignored, batches and feature reports unsupported without it, may be NULL */
+	struct protocol_pipeline_t *pipeline;
+	/* persistent settings, may be NULL */
+	struct profiles_t *profiles;
+	/* in-field firmware update, may be NULL */
+	struct fw_update_t *fw_update;
+	/* debug data sources, may be NULL */
+	struct sof_scheduler_t *sof_scheduler;
 };
 
 struct protocol_error_t {
@@ -80,15 +178,53 @@ struct protocol_error_t {
 	} args;
 };
 
-int protocol_is_supported(struct protocol_config_t config, u8 function_page, u8 function);
+int protocol_page_index(u8 function_page);
+/* enables the functions of a page, the list is kept for the supported functions query */
+void protocol_set_functions(struct protocol_config_t *config,
+			    enum supported_pages_index index,
+			    u8 *functions,
+			    u8 functions_size);
+int protocol_is_supported(const struct protocol_config_t *config, u8 function_page, u8 function);
 
-void protocol_dispatch(struct protocol_config_t config, u8 *buffer, size_t buffer_size);
-
-void protocol_send_report(struct protocol_config_t config, struct oi_report_t msg);
-void protocol_send_error(struct protocol_config_t config, struct oi_report_t msg, struct protocol_error_t error);
+void protocol_dispatch(const struct protocol_config_t *config, u8 *buffer, size_t buffer_size);
+/*
+ * For transports where the host asks for the response (feature reports), the
+ * response is returned in response instead of being sent. Pipelined requests are
+ * not supported, there's nothing to queue. Returns the response size, 0 if the
+ * request doesn't get one, -EINVAL if it wasn't a protocol report, or -ENOTSUP
+ * without a pipeline to capture the response.
+ */
+int protocol_dispatch_sync(const struct protocol_config_t *config,
+			   u8 *buffer,
+			   size_t buffer_size,
+			   u8 *response,
+			   size_t response_size);
+
+void protocol_send_report(const struct protocol_config_t *config, struct oi_report_t *msg);
+/* sends queued responses until the endpoint is busy, call it when the endpoint is done with a report (consumer) */
+void protocol_flush(const struct protocol_config_t *config);
+void protocol_send_error(const struct protocol_config_t *config,
+			 struct oi_report_t *msg,
+			 const struct protocol_error_t *error);
 
 /* protocol functions */
-void protocol_info_version(struct protocol_config_t config, struct oi_report_t msg);
-void protocol_info_fw_info(struct protocol_config_t config, struct oi_report_t msg);
-void protocol_info_supported_function_pages(struct protocol_config_t config, struct oi_report_t msg);
-void protocol_info_supported_functions(struct protocol_config_t config, struct oi_report_t msg);
+void protocol_info_version(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_info_fw_info(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_info_supported_function_pages(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_info_supported_functions(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_info(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_get_active(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_set_active(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_get(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_set_cpi(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_set_polling_rate(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_set_button(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_set_led(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_profiles_save(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_fw_update_info(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_fw_update_start(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_fw_update_write(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_fw_update_finish(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_batch_execute(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_debug_sof_stats(const struct protocol_config_t *config, struct oi_report_t *msg);
+void protocol_debug_tx_queue_stats(const struct protocol_config_t *config, struct oi_report_t *msg);
@@ -44,5 +44,33 @@ static const u8 oi_rdesc[] = {
 	0x09, 0x00,			/*  USAGE (Vendor Usage 0) */
 	0x91, 0x00,			/*  OUTPUT (Data,Arr,Abs) */
 	0xc0,			/* END_COLLECTION */
+	/* short pipelined report */
+	0x06, 0x00, 0xff,	/* USAGE_PAGE (Vendor Page) */
+	0x09, 0x00,		/* USAGE (Vendor Usage 0) */
+	0xa1, 0x01,		/* COLLECTION (Application) */
+	0x85, 0x22,			/*  REPORT_ID (0x22) */
+	0x75, 0x08,			/*  REPORT_SIZE (8) */
+	0x95, 0x09,			/*  REPORT_COUNT (9) */
+	0x15, 0x00,			/*  LOGICAL MINIMUM (0) */
+	0x26, 0xff, 0x00,		/*  LOGICAL MAXIMUM (255) */
+	0x09, 0x00,			/*  USAGE (Vendor Usage 0) */
+	0x81, 0x00,			/*  INPUT (Data,Arr,Abs) */
+	0x09, 0x00,			/*  USAGE (Vendor Usage 0) */
+	0x91, 0x00,			/*  OUTPUT (Data,Arr,Abs) */
+	0xc0,			/* END_COLLECTION */
+	/* long pipelined report */
+	0x06, 0x00, 0xff,	/* USAGE_PAGE (Vendor Page) */
+	0x09, 0x00,		/* USAGE (Vendor Usage 0) */
+	0xa1, 0x01,		/* COLLECTION (Application) */
+	0x85, 0x23,			/*  REPORT_ID (0x23) */
+	0x75, 0x08,			/*  REPORT_SIZE (8) */
+	0x95, 0x21,			/*  REPORT_COUNT (33) */
+	0x15, 0x00,			/*  LOGICAL MINIMUM (0) */
+	0x26, 0xff, 0x00,		/*  LOGICAL MAXIMUM (255) */
+	0x09, 0x00,			/*  USAGE (Vendor Usage 0) */
+	0x81, 0x00,			/*  INPUT (Data,Arr,Abs) */
+	0x09, 0x00,			/*  USAGE (Vendor Usage 0) */
+	0x91, 0x00,			/*  OUTPUT (Data,Arr,Abs) */
+	0xc0,			/* END_COLLECTION */
 	/* clang-format on */
 };
@@ -6,8 +6,10 @@
 #include <em_device.h>
 
 #include "util/data.h"
+#include "util/event_loop/event_loop.h"
 #include "util/types.h"
 
+#include "platform/efm32gg/atomic.h"
 #include "platform/efm32gg/cmu.h"
 #include "platform/efm32gg/emu.h"
 #include "platform/efm32gg/gpio.h"
@@ -18,6 +20,31 @@
 #define CFG_TUSB_CONFIG_FILE "targets/efm32gg12b-generic/tusb_config.h"
 #include "tusb.h"
 
+static struct event_loop_t event_loop;
+static struct event_work_t usb_work;
+static struct protocol_pipeline_t protocol_pipeline;
+
+static void idle(struct event_loop_t *loop)
+{
+	/* masked interrupts still wake us up, nothing can be posted between the check and WFI */
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (!event_loop_pending(loop))
+			__WFI();
+	}
+}
+
+static void usb_irq(void *data)
+{
+	event_loop_post(&usb_work);
+}
+
+/* USB events, protocol requests are dispatched from here too (SET_REPORT callback) */
+static void usb_task(void *data)
+{
+	tud_task();
+}
+
 void main()
 {
 #if defined(DCDC_PRESENT) && defined(DCDC_ENABLE)
@@ -63,14 +90,17 @@ void main()
 	memset(&protocol_config, 0, sizeof(protocol_config));
 	protocol_config.device_name = "openinput Device";
 	protocol_config.hid_hal = hid_hal_init();
-	protocol_config.functions[INFO] = info_functions;
-	protocol_config.functions_size[INFO] = sizeof(info_functions);
+	protocol_config.pipeline = &protocol_pipeline;
+	protocol_set_functions(&protocol_config, INFO, info_functions, sizeof(info_functions));
+
+	event_loop_init(&event_loop, systick_get_ticks, idle);
+	event_loop_add_work(&event_loop, &usb_work, usb_task, NULL);
 
-	usb_attach_protocol_config(protocol_config);
+	usb_attach_protocol_config(&protocol_config);
+	usb_attach_irq_callback(usb_irq, NULL);
 
 	usb_init();
 
-	for (;;) {
-		tud_task();
-	}
+	event_loop_post(&usb_work);
+	event_loop_run(&event_loop);
 }
@@ -25,13 +25,14 @@ int LLVMFuzzerTestOneInput(const char *data, size_t size)
 	struct hid_hal_t hid_hal = {
 		.send = dummy_hal_hid_send,
 	};
+	struct protocol_pipeline_t pipeline = {};
 	struct protocol_config_t config = {
 		.device_name = "openinput fuzz device",
 		.hid_hal = hid_hal,
-		.functions = info_functions,
-		.functions_size = sizeof(info_functions),
+		.pipeline = &pipeline,
 	};
 
-	protocol_dispatch(config, (u8 *) data, size);
+	protocol_set_functions(&config, INFO, info_functions, sizeof(info_functions));
+	protocol_dispatch(&config, (u8 *) data, size);
 	return 0;
 }
@@ -6,11 +6,15 @@
 #define _GNU_SOURCE
 
 #include <errno.h>
+#include <getopt.h>
 #include <pthread.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -19,101 +23,331 @@
 #include "readline/readline.h"
 
 #include "hal/hid.h"
+#include "platform/linux-uhid/hal/blockdev.h"
 #include "platform/linux-uhid/hal/hid.h"
+#include "platform/linux-uhid/hal/ticks.h"
+#include "platform/linux-uhid/replay.h"
 #include "platform/linux-uhid/uhid.h"
 #include "protocol/protocol.h"
 #include "protocol/reports.h"
+#include "util/data.h"
+#include "util/event_loop/event_loop.h"
 #include "util/hid_descriptors.h"
+#include "util/nvs/nvs.h"
+#include "util/profiles/profiles.h"
 #include "util/usb_descriptors.h"
 
+/* emulated flash for the storage file, 8 sectors of 4K like a small SPI NOR */
+#define STORAGE_BLOCK_SIZE  4096
+#define STORAGE_BLOCK_COUNT 8
+#define STORAGE_WRITE_SIZE  16
+
+#define MAX_DEVICES	   1024
+#define UHID_START_TIMEOUT 3000 /* ms */
+
+static const struct profile_t default_profile = {
+	.cpi = 800,
+	.polling_rate = 1000,
+	.buttons = {1, 2, 3, 4, 5, 6, 7, 8},
+	.led = {.mode = PROFILE_LED_OFF},
+};
+
+static u8 info_functions[] = {
+	OI_FUNCTION_VERSION,
+	OI_FUNCTION_FW_INFO,
+	OI_FUNCTION_SUPPORTED_FUNCTION_PAGES,
+	OI_FUNCTION_SUPPORTED_FUNCTIONS,
+};
+static u8 profiles_functions[] = {
+	OI_FUNCTION_PROFILE_INFO,
+	OI_FUNCTION_GET_ACTIVE_PROFILE,
+	OI_FUNCTION_SET_ACTIVE_PROFILE,
+	OI_FUNCTION_GET_PROFILE,
+	OI_FUNCTION_SET_CPI,
+	OI_FUNCTION_SET_POLLING_RATE,
+	OI_FUNCTION_SET_BUTTON,
+	OI_FUNCTION_SET_LED,
+	OI_FUNCTION_SAVE_PROFILES,
+};
+static u8 batch_functions[] = {
+	OI_FUNCTION_BATCH_EXECUTE,
+};
+
+static const char *options_usage = "usage: %s [options] [storage file]\n"
+				   "options:\n"
+				   "\t-r, --replay <trace>\treplays a motion trace (- for stdin) instead of the shell\n"
+				   "\t-R, --rate <hz>     \treplay rate, up to 8000 (default: 1000)\n"
+				   "\t-n, --repeat <count>\ttimes to play the trace, 0 loops until interrupted (default: 1)\n"
+				   "\t-d, --devices <n>   \tnumber of devices to create, up to 1024 (default: 1)\n"
+				   "\t-b, --benchmark <n> \tmeasures the uhid write throughput with n reports and exits\n"
+				   "\t-h, --help          \tshows this help message\n";
+
+static const struct option options[] = {
+	{"replay", required_argument, NULL, 'r'},
+	{"rate", required_argument, NULL, 'R'},
+	{"repeat", required_argument, NULL, 'n'},
+	{"devices", required_argument, NULL, 'd'},
+	{"benchmark", required_argument, NULL, 'b'},
+	{"help", no_argument, NULL, 'h'},
+	{},
+};
+
+static volatile sig_atomic_t replay_stop;
+
 static char *usage = "commands:\n"
 		     "\thelp               \t\tshows this help message\n"
 		     "\tmove <axis> <value>\t\tmoves an axis\n"
 		     "\texit               \t\texit the program\n";
 
-struct uhid_dispatch_args_t {
+/* a virtual device, every one has its own protocol state and settings */
+struct uhid_device_t {
 	struct uhid_data_t uhid;
 	struct protocol_config_t config;
-	int *exit;
+	struct protocol_pipeline_t pipeline;
+	struct profiles_t profiles;
+	char name[128];
+	/* response to the last feature report request, for the host to get */
+	u8 feature_response[OI_REPORT_LONG_SIZE];
+	size_t feature_response_size;
 };
 
-void *uhid_dispatch(void *thread_args)
+/*
+ * The dispatch thread only wakes up for uhid events, its timers, and the wakeup
+ * eventfd, which is in the same epoll set with NULL as its event data. Other
+ * threads set exit (atomically) and then signal the eventfd to stop it.
+ */
+struct uhid_dispatch_args_t {
+	struct uhid_device_t *devices;
+	size_t device_count;
+	int epoll_fd;
+	int wakeup_fd;
+	u8 exit;
+	/* storage of the first device, NULL if the settings are not persisted */
+	struct nvs_t *nvs;
+	/* event loop */
+	struct event_loop_t loop;
+	struct event_work_t uhid_work;
+	struct event_timer_t nvs_gc_timer;
+	struct epoll_event events[MAX_EPOLL_EVENTS];
+	size_t event_count;
+};
+
+/* block on the uhid fds until there are events or the next timer is due */
+static void uhid_idle(struct event_loop_t *loop)
 {
-	struct uhid_dispatch_args_t *args = (struct uhid_dispatch_args_t *) thread_args;
+	struct uhid_dispatch_args_t *args = loop->data;
+	u32 timeout;
+	int event_count;
+
+	/* garbage collect in the background, but only while there is something to collect */
+	if (args->nvs && nvs_gc_pending(args->nvs) && !event_timer_active(&args->nvs_gc_timer))
+		event_timer_start(loop, &args->nvs_gc_timer, 100, 0);
+
+	timeout = event_loop_next_timeout(loop);
+	event_count = uhid_wait_for_events(args->epoll_fd,
+					   args->events,
+					   timeout == UINT32_MAX ? -1 : (int) min(timeout, INT32_MAX));
+	if (event_count > 0) {
+		args->event_count = event_count;
+		event_loop_post(&args->uhid_work);
+	}
+}
+
+/*
+ * Feature reports, SET_REPORT carries a request and GET_REPORT reads its response
+ *
+ * The requests go through the same dispatch as output reports, but the response
+ * is kept for the host instead of being sent as an input report. The kernel
+ * blocks the requester until we reply, so both are answered right away.
+ */
+static void uhid_device_set_report(struct uhid_device_t *device, struct uhid_set_report_req *request)
+{
+	int ret;
+
+	ret = protocol_dispatch_sync(
+		&device->config, request->data, request->size, device->feature_response, sizeof(device->feature_response));
+	/* a request without a response was still processed, only GET_REPORT has nothing to read */
+	device->feature_response_size = ret < 0 ? 0 : ret;
+
+	uhid_set_report_reply(device->uhid, request->id, ret < 0 ? EIO : 0);
+}
+
+static void uhid_device_get_report(struct uhid_device_t *device, struct uhid_get_report_req *request)
+{
+	/* the response can be longer than the request, so either protocol report ID reads it */
+	if ((request->rnum != OI_REPORT_SHORT && request->rnum != OI_REPORT_LONG) || !device->feature_response_size) {
+		uhid_get_report_reply(device->uhid, request->id, EIO, NULL, 0);
+		return;
+	}
+
+	uhid_get_report_reply(device->uhid, request->id, 0, device->feature_response, device->feature_response_size);
+}
+
+static void uhid_dispatch_wakeup(struct uhid_dispatch_args_t *args)
+{
+	u64 count;
+
+	if (read(args->wakeup_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+		fprintf(stderr, "error: failed to read the wakeup eventfd (%m)\n");
+
+	if (__atomic_load_n(&args->exit, __ATOMIC_ACQUIRE))
+		event_loop_stop(&args->loop);
+}
+
+/* stops the dispatch thread, from any other thread */
+static void uhid_dispatch_stop(struct uhid_dispatch_args_t *args)
+{
+	u64 one = 1;
+
+	__atomic_store_n(&args->exit, 1, __ATOMIC_RELEASE);
+	if (write(args->wakeup_fd, &one, sizeof(one)) < 0)
+		fprintf(stderr, "error: failed to wake up the dispatch thread (%m)\n");
+}
+
+/* handle incoming packets, one event per ready device, epoll reports the ones with more again */
+static void uhid_task(void *data)
+{
+	struct uhid_dispatch_args_t *args = data;
+	struct uhid_device_t *device;
 	struct uhid_event event;
-	size_t event_count;
 
-	while (!*args->exit) {
-		/* handle incoming packets */
-		event_count = uhid_wait_for_events(args->uhid, 100);
-
-		for (size_t i = 0; i < event_count; i++) {
-			uhid_read_event(args->uhid, &event);
-			switch (event.type) {
-				case UHID_OUTPUT:
-					protocol_dispatch(args->config, event.u.output.data, event.u.output.size);
-					break;
-				case UHID_GET_REPORT:
-					/* TODO */
-					break;
-				case UHID_SET_REPORT:
-					/* TODO */
-					break;
-				case UHID_OPEN:
-				case UHID_CLOSE:
-					/* ignore */
-					break;
-				default:
-					break;
-			}
+	for (size_t i = 0; i < args->event_count; i++) {
+		device = args->events[i].data.ptr;
+		if (!device) {
+			uhid_dispatch_wakeup(args);
+			continue;
+		}
+		if (uhid_read_event(device->uhid, &event))
+			continue;
+		switch (event.type) {
+			case UHID_OUTPUT:
+				protocol_dispatch(&device->config, event.u.output.data, event.u.output.size);
+				break;
+			case UHID_GET_REPORT:
+				uhid_device_get_report(device, &event.u.get_report);
+				break;
+			case UHID_SET_REPORT:
+				uhid_device_set_report(device, &event.u.set_report);
+				break;
+			case UHID_OPEN:
+			case UHID_CLOSE:
+				/* ignore */
+				break;
+			default:
+				break;
 		}
 	}
 }
 
-int main(void)
+static void nvs_gc_task(void *data)
 {
-	struct uhid_data_t uhid;
-	struct mouse_report report;
-	struct uhid_create2_req create;
+	struct nvs_t *nvs = data;
 
-	pthread_t uhid_dispatch_thread = 0;
-	struct uhid_dispatch_args_t args;
-	int uhid_dispatch_exit = 0;
-	unsigned int rdesc_size = 0;
+	if (nvs_gc_pending(nvs))
+		nvs_gc_step(nvs);
+}
 
-	struct hid_hal_t hid_hal;
-	struct protocol_config_t config;
-	u8 info_functions[] = {
-		OI_FUNCTION_VERSION,
-		OI_FUNCTION_FW_INFO,
-		OI_FUNCTION_SUPPORTED_FUNCTION_PAGES,
-		OI_FUNCTION_SUPPORTED_FUNCTIONS,
-	};
+static void replay_interrupt(int signal)
+{
+	(void) signal;
+	replay_stop = 1;
+}
 
-	char *line = NULL;
-	char *arg = NULL;
-	int ret = 0;
+static int parse_option_value(const char *name, const char *arg, long min, long max, u32 *value)
+{
+	char *endptr;
+	long parsed;
+
+	errno = 0;
+	parsed = strtol(arg, &endptr, 0);
+	if (errno || *endptr || endptr == arg || parsed < min || parsed > max) {
+		fprintf(stderr, "error: invalid %s '%s' (must be between %ld and %ld)\n", name, arg, min, max);
+		return -EINVAL;
+	}
 
-	char *endptr = NULL;
+	*value = parsed;
+	return 0;
+}
 
-	char axis;
-	int value;
+static int run_replay(struct uhid_data_t uhid, const char *path, u32 rate, u32 repeat)
+{
+	struct replay_trace_t trace;
+	struct replay_stats_t stats;
+	struct sigaction action = {.sa_handler = replay_interrupt};
+	FILE *file = stdin;
+	int ret;
+
+	if (strcmp(path, "-") != 0) {
+		file = fopen(path, "r");
+		if (!file) {
+			fprintf(stderr, "error: failed to open '%s' (%s)\n", path, strerror(errno));
+			return -errno;
+		}
+	}
+
+	ret = replay_trace_load(&trace, file, path);
+	if (file != stdin)
+		fclose(file);
+	if (ret)
+		return ret;
+
+	if (!trace.count) {
+		fprintf(stderr, "error: no reports in '%s'\n", path);
+		replay_trace_free(&trace);
+		return -EINVAL;
+	}
+
+	printf("replaying %zu reports (%zu skipped) at %u Hz\n", trace.count, trace.skipped, rate);
+
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	ret = replay_run(uhid, &trace, rate, repeat, &replay_stop, &stats);
+	if (!ret)
+		replay_print_stats(stdout, &stats, rate);
+	else
+		fprintf(stderr, "error: replay failed (%s)\n", strerror(-ret));
+
+	replay_stats_free(&stats);
+	replay_trace_free(&trace);
+	return ret;
+}
+
+static void uhid_device_init(struct uhid_device_t *device, size_t index, size_t count)
+{
+	memset(device, 0, sizeof(*device));
+	device->uhid.uhid_fd = -1;
+
+	if (count > 1)
+		snprintf(device->name, sizeof(device->name), "openinput Linux UHID Device %zu", index);
+	else
+		snprintf(device->name, sizeof(device->name), "openinput Linux UHID Device");
 
 	/* create protocol config */
-	memset(&config, 0, sizeof(config));
-	config.device_name = "openinput Linux UHID Device";
-	config.hid_hal = uhid_hid_hal_init(&uhid);
-	config.functions[INFO] = info_functions;
-	config.functions_size[INFO] = sizeof(info_functions);
+	device->config.device_name = device->name;
+	device->config.hid_hal = uhid_hid_hal_init(&device->uhid);
+	device->config.pipeline = &device->pipeline;
+	protocol_set_functions(&device->config, INFO, info_functions, sizeof(info_functions));
+	protocol_set_functions(&device->config, GENERAL_PROFILES, profiles_functions, sizeof(profiles_functions));
+	protocol_set_functions(&device->config, BATCH, batch_functions, sizeof(batch_functions));
+	device->config.profiles = &device->profiles;
+}
+
+static int uhid_device_create(struct uhid_device_t *device, size_t index, int epoll_fd)
+{
+	struct uhid_create2_req create;
+	unsigned int rdesc_size = 0;
+	int ret;
 
 	/* open uhid fd */
-	ret = uhid_open(&uhid);
+	ret = uhid_open(&device->uhid, epoll_fd, device);
 	if (ret)
-		goto exit;
+		return ret;
 
 	/* create uhid device */
 	memset(&create, 0, sizeof(create));
-	strcpy(create.name, config.device_name);
+	strcpy((char *) create.name, device->name);
+	snprintf((char *) create.uniq, sizeof(create.uniq), "uhid-%zu", index);
 	memcpy(create.rd_data, oi_rdesc, sizeof(oi_rdesc)); /* protocol report descriptor */
 	rdesc_size += sizeof(oi_rdesc);
 	memcpy(create.rd_data + rdesc_size,
@@ -123,24 +357,187 @@ int main(void)
 	create.rd_size = rdesc_size;
 	create.bus = BUS_USB;
 	create.vendor = VENDOR_ID;
-	create.product = PRODUCT_ID;
+	create.product = PRODUCT_ID + index; /* so the host can tell the devices apart */
 	create.version = RELEASE;
-	ret = uhid_create(uhid, create);
+	ret = uhid_create(device->uhid, create);
 	if (ret)
-		goto exit;
+		return ret;
 
 	/* wait for the kernel to respond to the uhid creation request */
-	uhid_wait_for_kernel_start(uhid);
+	return uhid_wait_for_kernel_start(device->uhid, UHID_START_TIMEOUT);
+}
+
+/* every device holds a uhid fd, hundreds of them go past the usual soft limit */
+static void raise_fd_limit(size_t device_count)
+{
+	struct rlimit limit;
+
+	if (getrlimit(RLIMIT_NOFILE, &limit) || limit.rlim_cur >= device_count + 64)
+		return;
+
+	limit.rlim_cur = min(limit.rlim_max, device_count + 64);
+	if (setrlimit(RLIMIT_NOFILE, &limit))
+		fprintf(stderr, "warning: failed to raise the open file limit (%m)\n");
+}
+
+void *uhid_dispatch(void *thread_args)
+{
+	struct uhid_dispatch_args_t *args = (struct uhid_dispatch_args_t *) thread_args;
+
+	event_loop_init(&args->loop, ticks_get_ms, uhid_idle);
+	args->loop.data = args;
+
+	event_loop_add_work(&args->loop, &args->uhid_work, uhid_task, args);
+
+	/* the profiles and the NVS are only touched from this thread until it exits */
+	for (size_t i = 0; i < args->device_count; i++)
+		profiles_init(&args->devices[i].profiles, &default_profile, i ? NULL : args->nvs, &args->loop);
+	event_timer_init(&args->nvs_gc_timer, nvs_gc_task, args->nvs);
+
+	event_loop_run(&args->loop);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct uhid_device_t *devices = NULL;
+	struct uhid_data_t uhid;
+	struct blockdev_file_t storage = {.fd = -1};
+	struct nvs_t nvs;
+	struct mouse_report report;
+	int epoll_fd = -1;
+	struct epoll_event wakeup_event;
+
+	pthread_t uhid_dispatch_thread = 0;
+	struct uhid_dispatch_args_t args;
+
+	char *line = NULL;
+	char *arg = NULL;
+	int ret = 0;
 
-	/* start uhid dispatch thread */
-	args.uhid = uhid;
-	args.config = config;
-	args.exit = &uhid_dispatch_exit;
-	if (pthread_create(&uhid_dispatch_thread, NULL, uhid_dispatch, &args)) {
+	const char *replay = NULL;
+	u32 replay_rate = 1000;
+	u32 replay_repeat = 1;
+	u32 benchmark = 0;
+	u32 device_count = 1;
+	int option;
+
+	char *endptr = NULL;
+
+	char axis;
+	int value;
+
+	while ((option = getopt_long(argc, argv, "r:R:n:d:b:h", options, NULL)) != -1) {
+		switch (option) {
+			case 'r':
+				replay = optarg;
+				break;
+			case 'R':
+				if (parse_option_value("rate", optarg, 1, REPLAY_MAX_RATE, &replay_rate))
+					return EXIT_FAILURE;
+				break;
+			case 'n':
+				if (parse_option_value("repeat count", optarg, 0, UINT32_MAX, &replay_repeat))
+					return EXIT_FAILURE;
+				break;
+			case 'd':
+				if (parse_option_value("device count", optarg, 1, MAX_DEVICES, &device_count))
+					return EXIT_FAILURE;
+				break;
+			case 'b':
+				if (parse_option_value("report count", optarg, 1, UINT32_MAX, &benchmark))
+					return EXIT_FAILURE;
+				break;
+			case 'h':
+				printf(options_usage, argv[0]);
+				return EXIT_SUCCESS;
+			default:
+				fprintf(stderr, options_usage, argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+
+	devices = calloc(device_count, sizeof(*devices));
+	if (!devices) {
+		fprintf(stderr, "error: failed to allocate the devices\n");
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < device_count; i++) uhid_device_init(&devices[i], i, device_count);
+
+	args.wakeup_fd = -1;
+
+	/* optional storage file for the first device, the settings only live in RAM without one */
+	args.nvs = NULL;
+	if (optind < argc) {
+		ret = blockdev_file_open(&storage, argv[optind], STORAGE_BLOCK_SIZE, STORAGE_BLOCK_COUNT, STORAGE_WRITE_SIZE);
+		if (ret)
+			goto exit;
+
+		ret = nvs_mount(&nvs, blockdev_hal_init_file(&storage));
+		if (ret) {
+			fprintf(stderr, "error: failed to mount the storage (%s)\n", strerror(-ret));
+			goto exit;
+		}
+		args.nvs = &nvs;
+	}
+
+	/* one epoll for all the devices */
+	epoll_fd = uhid_epoll_create();
+	if (epoll_fd < 0) {
+		ret = epoll_fd;
+		goto exit;
+	}
+
+	/* and the wakeup eventfd of the dispatch thread */
+	args.wakeup_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (args.wakeup_fd < 0) {
+		fprintf(stderr, "error: failed to open the wakeup eventfd (%m)\n");
+		ret = -errno;
+		goto exit;
+	}
+	wakeup_event.events = EPOLLIN;
+	wakeup_event.data.ptr = NULL;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, args.wakeup_fd, &wakeup_event)) {
+		fprintf(stderr, "error: failed to register the wakeup eventfd in epoll (%m)\n");
+		ret = -errno;
+		goto exit;
+	}
+
+	raise_fd_limit(device_count);
+	for (size_t i = 0; i < device_count; i++) {
+		ret = uhid_device_create(&devices[i], i, epoll_fd);
+		if (ret) {
+			fprintf(stderr, "error: failed to create device %zu\n", i);
+			goto exit;
+		}
+	}
+
+	/* start uhid dispatch thread, it serves every device */
+	args.devices = devices;
+	args.device_count = device_count;
+	args.epoll_fd = epoll_fd;
+	args.exit = 0;
+	ret = pthread_create(&uhid_dispatch_thread, NULL, uhid_dispatch, &args);
+	if (ret) {
+		fprintf(stderr, "error: failed to start the uhid dispatch thread (%s)\n", strerror(ret));
+		ret = -ret; /* pthread returns the error number instead of setting errno */
 		uhid_dispatch_thread = 0;
 		goto exit;
 	}
 
+	/* the shell and the headless modes drive the first device */
+	uhid = devices[0].uhid;
+
+	/* headless modes, the dispatch thread keeps serving the protocol meanwhile */
+	if (benchmark) {
+		ret = replay_benchmark(uhid, benchmark, stdout);
+		goto exit;
+	} else if (replay) {
+		ret = run_replay(uhid, replay, replay_rate, replay_repeat);
+		goto exit;
+	}
+
 	/* main loop */
 	for (;;) {
 		/* process shell - user action */
@@ -152,7 +549,7 @@ int main(void)
 		arg = strtok(line, " ");
 
 		if (!arg)
-			continue;
+			goto next;
 
 		/* TODO: implement history support using GNU history */
 		if (strcmp(arg, "help") == 0 || strcmp(arg, "?") == 0) {
@@ -162,8 +559,7 @@ int main(void)
 			arg = strtok(NULL, " ");
 			if (!arg) {
 				fprintf(stderr, "error: missing axis argument! (usage: move <axis> <value>)\n");
-				ret = -EINVAL;
-				goto exit;
+				goto next;
 			}
 
 			/* validate axis */
@@ -173,32 +569,28 @@ int main(void)
 				axis = 'Y';
 			else {
 				fprintf(stderr, "error: unknown axis (%s)\n", arg);
-				ret = -EINVAL;
-				goto exit;
+				goto next;
 			}
 
 			/* get value argument */
 			arg = strtok(NULL, " ");
 			if (!arg) {
 				fprintf(stderr, "error: missing value argument! (usage: move <axis> <value>)\n");
-				ret = -EINVAL;
-				goto exit;
+				goto next;
 			}
 
 			/* parse value */
+			errno = 0;
 			value = strtol(arg, &endptr, 0);
 			if (errno || *endptr) {
-				fprintf(stderr, "error: invalid value");
-				ret = -EINVAL;
-				goto exit;
+				fprintf(stderr, "error: invalid value\n");
+				goto next;
 			} else if (value > 127) {
 				fprintf(stderr, "error: value too big (max is 127)\n");
-				ret = -EINVAL;
-				goto exit;
+				goto next;
 			} else if (value < -127) {
 				fprintf(stderr, "error: value too small (min is -127)\n");
-				ret = -EINVAL;
-				goto exit;
+				goto next;
 			}
 
 			printf("moving %d in %c axis\n", value, axis);
@@ -217,20 +609,31 @@ int main(void)
 			ret = 0;
 			goto exit;
 		} else {
-			fprintf(stderr, "error: unkown command\n");
-			ret = -EINVAL;
-			goto exit;
+			fprintf(stderr, "error: unknown command (see help)\n");
+			goto next;
 		}
+next:
 		free(line);
+		line = NULL;
 	}
 
 exit:
-	uhid_dispatch_exit = 1;
-	if (uhid_dispatch_thread)
+	if (uhid_dispatch_thread) {
+		uhid_dispatch_stop(&args);
 		pthread_join(uhid_dispatch_thread, NULL);
+		/* don't lose the changes that are still waiting for the flush timer */
+		for (size_t i = 0; i < device_count; i++) profiles_flush(&devices[i].profiles);
+	}
+
+	blockdev_file_close(&storage);
 
 	free(line);
-	uhid_close(uhid);
+	for (size_t i = 0; i < device_count; i++) uhid_close(devices[i].uhid);
+	free(devices);
+	if (args.wakeup_fd >= 0)
+		close(args.wakeup_fd);
+	if (epoll_fd >= 0)
+		close(epoll_fd);
 
 	return ret;
 }
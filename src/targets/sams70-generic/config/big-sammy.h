@@ -13,6 +13,16 @@
 
 #define EXTERNAL_CLOCK_VALUE 12000000UL
 
+/* Firmware Update Config */
+
+/* define if a bootloader boots the image the fw_update boot record points to, enables the update page */
+//#define FW_UPDATE_BOOTLOADER
+
+/* USB Config */
+
+/* mouse polling rate (Hz), 8000 needs a high speed link */
+#define USB_POLLING_RATE            8000
+
 /* Sensor Config */
 #define SENSOR_ENABLED
 #define SENSOR_DRIVER               PIXART_PMW
@@ -6,30 +6,178 @@
 #include "util/data.h"
 #include "util/types.h"
 
+#include "platform/samx7x/atomic.h"
 #include "platform/samx7x/eefc.h"
 #include "platform/samx7x/hal/blockdev.h"
 #include "platform/samx7x/hal/hid.h"
 #include "platform/samx7x/hal/spi.h"
 #include "platform/samx7x/hal/ticks.h"
+#include "platform/samx7x/hal/timer.h"
 #include "platform/samx7x/pio.h"
 #include "platform/samx7x/pmc.h"
 #include "platform/samx7x/qspi.h"
 #include "platform/samx7x/systick.h"
+#include "platform/samx7x/timer.h"
 #include "platform/samx7x/usb.h"
 #include "platform/samx7x/wdt.h"
 
 #include "driver/pixart/pixart_pmw.h"
 
+#include "util/blob/blob.h"
+#include "util/block_cache/block_cache.h"
+#include "util/event_loop/event_loop.h"
+#include "util/fw_update/fw_update.h"
 #include "util/hid_descriptors.h"
+#include "util/motion.h"
+#include "util/nvs/nvs.h"
 #include "util/partition/partition.h"
+#include "util/profiles/profiles.h"
+#include "util/sof_scheduler/sof_scheduler.h"
+#include "util/usb_descriptors.h"
 
 #include "protocol/protocol.h"
 
 #define CFG_TUSB_CONFIG_FILE "targets/sams70-generic/tusb_config.h"
 #include "tusb.h"
 
+/* how long before the next SOF we sample the sensor, more than a high speed microframe means right at its SOF */
+#ifndef SENSOR_SAMPLE_LEAD_US
+#define SENSOR_SAMPLE_LEAD_US 200
+#endif
+
+#define SENSOR_TIMER	    TIMER_CHANNEL_0 /* sensor register and burst timings */
+#define SENSOR_SAMPLE_TIMER TIMER_CHANNEL_1 /* sampling point of the (micro)frame */
+
 extern u32 _stable;
 
+static struct event_loop_t event_loop;
+static struct event_work_t usb_work;
+static struct protocol_pipeline_t protocol_pipeline;
+static struct sof_scheduler_t scheduler;
+static struct motion_t motion;
+static struct event_timer_t nvs_gc_timer;
+static struct block_cache_t nvs_cache;
+static struct nvs_t nvs;
+static u8 nvs_mounted;
+static struct profiles_t profiles;
+static struct fw_update_t fw_update;
+static u8 fw_update_ready;
+
+static const struct profile_t default_profile = {
+	.cpi = 800,
+	.polling_rate = USB_POLLING_RATE,
+	.buttons = {1, 2, 3, 4, 5, 6, 7, 8},
+	.led = {.mode = PROFILE_LED_OFF},
+};
+
+#if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
+static struct event_work_t sensor_work;
+static struct pixart_pmw_driver_t sensor;
+static struct pio_pin_t sensor_motion_io = SENSOR_MOTION_IO;
+#endif
+
+static void idle(struct event_loop_t *loop)
+{
+	/* programs and erases stall instruction fetch, so they are done when there is nothing else to do */
+	if (block_cache_dirty(&nvs_cache) && block_cache_flush_step(&nvs_cache) == 0)
+		return;
+
+	/* masked interrupts still wake us up, nothing can be posted between the check and WFI */
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (!event_loop_pending(loop))
+			__WFI();
+	}
+}
+
+static void usb_irq(void *data)
+{
+	event_loop_post(&usb_work);
+}
+
+#if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
+static void sensor_sample_isr(void *data)
+{
+	event_loop_post(&sensor_work);
+}
+#endif
+
+static void usb_sof_isr(void *data)
+{
+	u32 now = systick_get_us();
+	u32 frame_us = usb_get_frame_us();
+
+	if (scheduler.period_us != frame_us)
+		sof_scheduler_set_period(&scheduler, frame_us, SENSOR_SAMPLE_LEAD_US);
+	sof_scheduler_sof(&scheduler, now);
+
+#if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
+	/* new (micro)frame, wake up the sensor task at its sampling point */
+	timer_start_us(SENSOR_SAMPLE_TIMER, sof_scheduler_sample_delay(&scheduler, now), sensor_sample_isr, NULL);
+#endif
+}
+
+static void send_report()
+{
+	struct mouse_report_16 report;
+
+	/* motion that doesn't fit is sent in the next report */
+	if (!tud_hid_n_ready(1) || !motion_report_16(&motion, &report))
+		return;
+
+	tud_hid_n_report(1, 0, &report, sizeof(report));
+}
+
+/* USB events, protocol requests are dispatched from here too (SET_REPORT callback) */
+static void usb_task(void *data)
+{
+	tud_task();
+
+	send_report();
+}
+
+/* collect one NVS sector at a time so a flash erase never stalls the USB task for long */
+static void nvs_gc_task(void *data)
+{
+	if (nvs_gc_pending(&nvs))
+		nvs_gc_step(&nvs);
+}
+
+#if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
+static void profile_apply(const struct profile_t *profile, void *data)
+{
+	pixart_pmw_set_cpi(&sensor, profile->cpi);
+}
+
+static void sensor_task(void *data)
+{
+	u32 now = systick_get_us();
+
+	/* only between bursts, a report never mixes the settings of two profiles */
+	if (!pixart_pmw_busy(&sensor))
+		profiles_apply(&profiles);
+
+	/*
+	 * sample once per (micro)frame, so the burst (~100us) completes and the report is queued before the
+	 * host polls us, on high speed that's right at the SOF
+	 */
+	if (sof_scheduler_poll(&scheduler, now)) {
+		if (!pio_get(sensor_motion_io))
+			pixart_pmw_motion_event(&sensor);
+	} else if (sof_scheduler_waiting(&scheduler)) {
+		/* woken up a bit before SysTick agrees it's time, come back at the sampling point */
+		timer_start_us(SENSOR_SAMPLE_TIMER, sof_scheduler_sample_delay(&scheduler, now), sensor_sample_isr, NULL);
+	}
+
+	/* the sensor waits are timeouts that post this work again, nothing to poll */
+	if (pixart_pmw_task(&sensor)) {
+		struct deltas_t deltas = pixart_pmw_get_deltas(&sensor);
+		motion_add(&motion, deltas.dx, deltas.dy);
+		send_report();
+	}
+}
+#endif
+
 void main()
 {
 	eefc_init();
@@ -41,32 +189,82 @@ void main()
 
 	systick_init();
 
+	timer_init();
+
 	wdt_disable();
 
 	pio_init();
 
-	const struct partition_table_t *partition_table = partition_table_read((void *) &_stable);
+	/* lookups on a table that failed validation find nothing */
+	static struct partition_index_t partitions;
+	partition_table_read(&partitions, &_stable, PARTITION_TABLE_MAX_SIZE);
 
-	const struct partition_table_entry_t *sensor_blob = partition_from_type(partition_table, PARTITION_TYPE_BLOB);
+	const struct partition_table_entry_t *sensor_blob = partition_from_type(&partitions, PARTITION_TYPE_BLOB);
 
-	const struct partition_table_entry_t *nvs_data = partition_from_type(partition_table, PARTITION_TYPE_NVS);
+	const struct partition_table_entry_t *nvs_data = partition_from_type(&partitions, PARTITION_TYPE_NVS);
 
-	// static struct blockdev_drv_t nvs_block_drv;
-	// nvs_block_drv.start_addr = nvs_data->start_addr;
-	// nvs_block_drv.size = (nvs_data->end_addr - nvs_data->start_addr);
-	// struct blockdev_hal_t data_blockdev_hal = blockdev_hal_init_eefc(&nvs_block_drv);
+	static struct blockdev_drv_t nvs_block_drv;
+	if (nvs_data) {
+		nvs_block_drv.start_addr = nvs_data->start_addr;
+		nvs_block_drv.size = nvs_data->end_addr - nvs_data->start_addr;
 
-	// data_blockdev_hal.erase(data_blockdev_hal, 0);
-	// u8 buffer[512];
-	// memset(buffer, 0x5A, 512);
-	// data_blockdev_hal.write(data_blockdev_hal, 0, 16, buffer, 496);
+		/* small settings writes are merged into page programs and flushed from idle */
+		struct blockdev_hal_t nvs_blockdev = blockdev_hal_init_eefc(&nvs_block_drv);
+		if (!block_cache_init(&nvs_cache, nvs_blockdev, eefc_get_info()->page_size))
+			nvs_blockdev = blockdev_hal_init_cache(&nvs_cache);
+
+		nvs_mounted = nvs_mount(&nvs, nvs_blockdev) == 0;
+	}
+
+#if defined(FW_UPDATE_BOOTLOADER)
+	/*
+	 * A/B update slots, the first two firmware partitions in internal flash, the bootloader numbers them the
+	 * same way. The image runs where it was linked no matter what the boot record says, so the running slot
+	 * is the one holding our code, and if it's neither we can't tell what an update would overwrite.
+	 */
+	static struct blockdev_drv_t fw_slot_drv[FW_UPDATE_SLOTS];
+	const struct partition_table_entry_t *entry;
+	u32 execution_addr = (u32) main;
+	u8 fw_running = FW_UPDATE_SLOTS;
+	u8 fw_slots = 0;
+	for (u8 i = 0; fw_slots < FW_UPDATE_SLOTS && (entry = partition_from_index(&partitions, i)); i++) {
+		if (entry->type != PARTITION_TYPE_FW || entry->location != PARTITION_LOC_INTERNAL)
+			continue;
+		if (execution_addr >= entry->start_addr && execution_addr < entry->end_addr)
+			fw_running = fw_slots;
+		fw_slot_drv[fw_slots].start_addr = entry->start_addr;
+		fw_slot_drv[fw_slots].size = entry->end_addr - entry->start_addr;
+		fw_slots++;
+	}
+	/* without NVS there is nowhere to point the bootloader to the new image */
+	if (fw_slots == FW_UPDATE_SLOTS && fw_running < FW_UPDATE_SLOTS && nvs_mounted)
+		fw_update_ready = fw_update_init(&fw_update,
+						 blockdev_hal_init_eefc(&fw_slot_drv[0]),
+						 blockdev_hal_init_eefc(&fw_slot_drv[1]),
+						 fw_running,
+						 &nvs) == 0;
+#endif
+
+	/* the sensor firmware is streamed from its partition, only the internal flash has a driver for now */
+	static struct blockdev_drv_t sensor_blob_drv;
+	struct blob_t sensor_firmware;
+	int sensor_firmware_ret = -1;
+	if (sensor_blob && sensor_blob->location == PARTITION_LOC_INTERNAL) {
+		sensor_blob_drv.start_addr = sensor_blob->start_addr;
+		sensor_blob_drv.size = sensor_blob->end_addr - sensor_blob->start_addr;
+
+		struct blockdev_hal_t sensor_blob_blockdev = blockdev_hal_init_eefc(&sensor_blob_drv);
+		sensor_firmware_ret = blob_init(&sensor_firmware,
+						sensor_blob_blockdev,
+						0,
+						(u32) sensor_blob_blockdev.block_size * sensor_blob_blockdev.block_count);
+	}
 
 	/* could not find sensor blob, halt */
-	if (!sensor_blob)
+	if (sensor_firmware_ret < 0)
 		while (1) continue;
 
 #if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
-	struct pio_pin_t sensor_motion_io = SENSOR_MOTION_IO;
 	struct pio_pin_t sensor_cs_io = SENSOR_INTERFACE_CS_IO;
 	struct pio_pin_t sensor_sck_io = SENSOR_INTERFACE_SCK_IO;
 	struct pio_pin_t sensor_miso_io = SENSOR_INTERFACE_MISO_IO;
@@ -87,7 +285,7 @@ void main()
 
 	struct ticks_hal_t ticks_hal = ticks_hal_init();
 
-	struct pixart_pmw_driver_t sensor = pixart_pmw_init((const u8 *) sensor_blob->start_addr, sensor_spi_hal, ticks_hal);
+	pixart_pmw_init(&sensor, &sensor_firmware, sensor_spi_hal, ticks_hal, timer_hal_init(SENSOR_TIMER), &sensor_work);
 #endif
 
 	struct hid_hal_t hid_hal;
@@ -97,48 +295,65 @@ void main()
 		OI_FUNCTION_SUPPORTED_FUNCTION_PAGES,
 		OI_FUNCTION_SUPPORTED_FUNCTIONS,
 	};
+	u8 profiles_functions[] = {
+		OI_FUNCTION_PROFILE_INFO,
+		OI_FUNCTION_GET_ACTIVE_PROFILE,
+		OI_FUNCTION_SET_ACTIVE_PROFILE,
+		OI_FUNCTION_GET_PROFILE,
+		OI_FUNCTION_SET_CPI,
+		OI_FUNCTION_SET_POLLING_RATE,
+		OI_FUNCTION_SET_BUTTON,
+		OI_FUNCTION_SET_LED,
+		OI_FUNCTION_SAVE_PROFILES,
+	};
+	u8 batch_functions[] = {
+		OI_FUNCTION_BATCH_EXECUTE,
+	};
+	u8 fw_update_functions[] = {
+		OI_FUNCTION_FW_UPDATE_INFO,
+		OI_FUNCTION_FW_UPDATE_START,
+		OI_FUNCTION_FW_UPDATE_WRITE,
+		OI_FUNCTION_FW_UPDATE_FINISH,
+	};
 
 	/* create protocol config */
 	struct protocol_config_t protocol_config;
 	memset(&protocol_config, 0, sizeof(protocol_config));
 	protocol_config.device_name = "openinput Device";
 	protocol_config.hid_hal = hid_hal_init();
-	protocol_config.functions[INFO] = info_functions;
-	protocol_config.functions_size[INFO] = sizeof(info_functions);
-
-	usb_attach_protocol_config(protocol_config);
-
-	usb_init();
-
-	struct mouse_report report;
-	u8 new_data = 0;
+	protocol_config.pipeline = &protocol_pipeline;
+	protocol_set_functions(&protocol_config, INFO, info_functions, sizeof(info_functions));
+	protocol_set_functions(&protocol_config, GENERAL_PROFILES, profiles_functions, sizeof(profiles_functions));
+	protocol_config.profiles = &profiles;
+	protocol_set_functions(&protocol_config, BATCH, batch_functions, sizeof(batch_functions));
+	if (fw_update_ready) {
+		protocol_set_functions(&protocol_config, FW_UPDATE, fw_update_functions, sizeof(fw_update_functions));
+		protocol_config.fw_update = &fw_update;
+	}
 
-	for (;;) {
-		tud_task();
+	/* full speed until the host reset the bus, the SOF callback follows the link speed */
+	sof_scheduler_init(&scheduler, usb_get_frame_us(), SENSOR_SAMPLE_LEAD_US);
 
+	event_loop_init(&event_loop, systick_get_ticks, idle);
+	event_loop_add_work(&event_loop, &usb_work, usb_task, NULL);
+	if (nvs_mounted) {
+		event_timer_init(&nvs_gc_timer, nvs_gc_task, NULL);
+		event_timer_start(&event_loop, &nvs_gc_timer, 100, 100);
+	}
+	profiles_init(&profiles, &default_profile, nvs_mounted ? &nvs : NULL, &event_loop);
 #if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
-		if (!pio_get(sensor_motion_io)) {
-			pixart_pmw_motion_event(&sensor);
-		}
-
-		if (sensor.motion_flag) {
-			pixart_pmw_read_motion(&sensor);
-			new_data = 1;
-		}
-
-		if (tud_hid_n_ready(0) && new_data) {
-			struct deltas_t deltas = pixart_pmw_get_deltas(&sensor);
+	event_loop_add_work(&event_loop, &sensor_work, sensor_task, NULL);
+	event_loop_post(&sensor_work); /* boot the sensor */
+	profiles_attach_apply_callback(&profiles, profile_apply, NULL);
+#endif
 
-			/* fill report */
-			memset(&report, 0, sizeof(report));
-			report.id = MOUSE_REPORT_ID;
-			report.x = deltas.dx;
-			report.y = deltas.dy;
+	usb_attach_protocol_config(&protocol_config);
+	usb_attach_irq_callback(usb_irq, NULL);
+	usb_attach_sof_callback(usb_sof_isr, NULL);
 
-			tud_hid_n_report(1, 0, &report, sizeof(report));
+	usb_init();
 
-			new_data = 0;
-		}
-#endif
-	}
+	event_loop_post(&usb_work);
+	event_loop_run(&event_loop);
 }
+
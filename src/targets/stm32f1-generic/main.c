@@ -5,20 +5,29 @@
 
 #include <stm32f1xx.h>
 
+#include "platform/stm32f1/atomic.h"
 #include "platform/stm32f1/flash.h"
 #include "platform/stm32f1/gpio.h"
 #include "platform/stm32f1/hal/hid.h"
 #include "platform/stm32f1/hal/spi.h"
 #include "platform/stm32f1/hal/ticks.h"
+#include "platform/stm32f1/hal/timer.h"
 #include "platform/stm32f1/rcc.h"
 #include "platform/stm32f1/spi.h"
 #include "platform/stm32f1/systick.h"
+#include "platform/stm32f1/timer.h"
 #include "platform/stm32f1/usb.h"
 
 #include "driver/pixart/pixart_pmw.h"
 #include "pixart_blobs.h"
 
+#include "util/blob/blob.h"
 #include "util/data.h"
+#include "util/event_loop/event_loop.h"
+#include "util/hid_descriptors.h"
+#include "util/motion.h"
+#include "util/ram_blockdev/ram_blockdev.h"
+#include "util/sof_scheduler/sof_scheduler.h"
 #include "util/types.h"
 
 #include "protocol/protocol.h"
@@ -26,17 +35,104 @@
 #define CFG_TUSB_CONFIG_FILE "targets/stm32f1-generic/tusb_config.h"
 #include "tusb.h"
 
-#define OI_MOUSE_REPORT_ID 0x01
+/* how long before the next SOF we sample the sensor, must cover the burst read */
+#ifndef SENSOR_SAMPLE_LEAD_US
+#define SENSOR_SAMPLE_LEAD_US 200
+#endif
+
+#define SENSOR_TIMER	    TIMER_CHANNEL_1 /* sensor register and burst timings */
+#define SENSOR_SAMPLE_TIMER TIMER_CHANNEL_2 /* sampling point of the frame */
+
+static struct event_loop_t event_loop;
+static struct event_work_t usb_work;
+static struct protocol_pipeline_t protocol_pipeline;
+static struct sof_scheduler_t scheduler;
+static struct motion_t motion;
+
+#if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
+static struct event_work_t sensor_work;
+static struct pixart_pmw_driver_t sensor;
+static struct gpio_pin_t sensor_motion_io = SENSOR_MOTION_IO;
+#endif
+
+static void idle(struct event_loop_t *loop)
+{
+	/* masked interrupts still wake us up, nothing can be posted between the check and WFI */
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		if (!event_loop_pending(loop))
+			__WFI();
+	}
+}
+
+static void usb_irq(void *data)
+{
+	event_loop_post(&usb_work);
+}
 
-struct output_report {
-	u8 id;
-	s8 x;
-	s8 y;
-	s8 wheel;
-	u8 button1 : 1;
-	u8 button2 : 1;
-	u8 button3 : 1;
-} __attribute__((__packed__));
+#if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
+static void sensor_sample_isr(void *data)
+{
+	event_loop_post(&sensor_work);
+}
+#endif
+
+static void usb_sof_isr(void *data)
+{
+	u32 now = systick_get_us();
+
+	sof_scheduler_sof(&scheduler, now);
+
+#if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
+	/* new frame, wake up the sensor task at its sampling point */
+	timer_start_us(SENSOR_SAMPLE_TIMER, sof_scheduler_sample_delay(&scheduler, now), sensor_sample_isr, NULL);
+#endif
+}
+
+static void send_report()
+{
+	struct mouse_report_16 report;
+
+	/* motion that doesn't fit is sent in the next report */
+	if (!tud_hid_n_ready(1) || !motion_report_16(&motion, &report))
+		return;
+
+	tud_hid_n_report(1, 0, &report, sizeof(report));
+}
+
+/* USB events, protocol requests are dispatched from here too (SET_REPORT callback) */
+static void usb_task(void *data)
+{
+	tud_task();
+
+	send_report();
+}
+
+#if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
+static void sensor_task(void *data)
+{
+	u32 now = systick_get_us();
+
+	/*
+	 * sample once per frame, right before the host polls us, so the report carries
+	 * the freshest motion instead of whatever was read whenever the pin toggled
+	 */
+	if (sof_scheduler_poll(&scheduler, now)) {
+		if (!gpio_get(sensor_motion_io))
+			pixart_pmw_motion_event(&sensor);
+	} else if (sof_scheduler_waiting(&scheduler)) {
+		/* woken up by the sensor, or a bit before SysTick agrees it's time, come back at the sampling point */
+		timer_start_us(SENSOR_SAMPLE_TIMER, sof_scheduler_sample_delay(&scheduler, now), sensor_sample_isr, NULL);
+	}
+
+	/* the sensor waits are timeouts that post this work again, nothing to poll */
+	if (pixart_pmw_task(&sensor)) {
+		struct deltas_t deltas = pixart_pmw_get_deltas(&sensor);
+		motion_add(&motion, deltas.dx, deltas.dy);
+		send_report();
+	}
+}
+#endif
 
 void main()
 {
@@ -46,6 +142,8 @@ void main()
 
 	systick_init();
 
+	timer_init();
+
 	struct gpio_config_t gpio_config;
 	struct gpio_pin_t usb_dm_io = {.port = GPIO_PORT_A, .pin = 11};
 	struct gpio_pin_t usb_dp_io = {.port = GPIO_PORT_A, .pin = 12};
@@ -59,7 +157,6 @@ void main()
 		&gpio_config, usb_dp_pu_io, GPIO_MODE_OUTPUT_50MHZ | GPIO_CNF_OUTPUT_GENERAL_PUSH_PULL, 0); /* USB DP PU */
 
 #if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
-	struct gpio_pin_t sensor_motion_io = SENSOR_MOTION_IO;
 	struct gpio_pin_t sensor_cs_io = SENSOR_INTERFACE_CS_IO;
 	struct gpio_pin_t sensor_sck_io = SENSOR_INTERFACE_SCK_IO;
 	struct gpio_pin_t sensor_miso_io = SENSOR_INTERFACE_MISO_IO;
@@ -83,9 +180,22 @@ void main()
 
 	struct ticks_hal_t ticks_hal = ticks_hal_init();
 
-	struct pixart_pmw_driver_t sensor = pixart_pmw_init((u8 *) SENSOR_FIRMWARE_BLOB, sensor_spi_hal, ticks_hal);
+	/* the blob is in the MCU flash, read it through a memory block device */
+	static struct ram_blockdev_t sensor_blob_mem = {
+		.data = (u8 *) SENSOR_FIRMWARE_BLOB,
+		.block_size = PIXART_PMW_SROM_SIZE,
+		.block_count = 1,
+		.write_size = 1,
+	};
+	struct blob_t sensor_blob;
+	blob_init(&sensor_blob, blockdev_hal_init_ram(&sensor_blob_mem), 0, PIXART_PMW_SROM_SIZE);
+
+	pixart_pmw_init(&sensor, &sensor_blob, sensor_spi_hal, ticks_hal, timer_hal_init(SENSOR_TIMER), &sensor_work);
 #endif
 
+	/* full speed, 1ms frames */
+	sof_scheduler_init(&scheduler, 1000, SENSOR_SAMPLE_LEAD_US);
+
 	struct hid_hal_t hid_hal;
 	u8 info_functions[] = {
 		OI_FUNCTION_VERSION,
@@ -93,49 +203,35 @@ void main()
 		OI_FUNCTION_SUPPORTED_FUNCTION_PAGES,
 		OI_FUNCTION_SUPPORTED_FUNCTIONS,
 	};
+	u8 debug_functions[] = {
+		OI_FUNCTION_SOF_STATS,
+		OI_FUNCTION_TX_QUEUE_STATS,
+	};
 
 	/* create protocol config */
 	struct protocol_config_t protocol_config;
 	memset(&protocol_config, 0, sizeof(protocol_config));
 	protocol_config.device_name = "openinput Device";
 	protocol_config.hid_hal = hid_hal_init();
-	protocol_config.functions[INFO] = info_functions;
-	protocol_config.functions_size[INFO] = sizeof(info_functions);
-
-	usb_attach_protocol_config(protocol_config);
-
-	usb_init();
-
-	struct output_report report;
-	u8 new_data = 0;
-
-	for (;;) {
-		tud_task();
+	protocol_config.pipeline = &protocol_pipeline;
+	protocol_set_functions(&protocol_config, INFO, info_functions, sizeof(info_functions));
+	protocol_set_functions(&protocol_config, DEBUG, debug_functions, sizeof(debug_functions));
+	protocol_config.sof_scheduler = &scheduler;
 
+	event_loop_init(&event_loop, systick_get_ticks, idle);
+	event_loop_add_work(&event_loop, &usb_work, usb_task, NULL);
 #if defined(SENSOR_ENABLED) && SENSOR_DRIVER == PIXART_PMW
-		if (!gpio_get(sensor_motion_io)) {
-			pixart_pmw_motion_event(&sensor);
-		}
-
-		if (sensor.motion_flag) {
-			pixart_pmw_read_motion(&sensor);
-
-			new_data = 1;
-		}
-
-		if (tud_hid_n_ready(0) && new_data) {
-			struct deltas_t deltas = pixart_pmw_get_deltas(&sensor);
+	event_loop_add_work(&event_loop, &sensor_work, sensor_task, NULL);
+	event_loop_post(&sensor_work); /* boot the sensor */
+#endif
 
-			/* fill report */
-			memset(&report, 0, sizeof(report));
-			report.id = OI_MOUSE_REPORT_ID;
-			report.x = deltas.dx;
-			report.y = deltas.dy;
+	usb_attach_protocol_config(&protocol_config);
+	usb_attach_irq_callback(usb_irq, NULL);
+	usb_attach_sof_callback(usb_sof_isr, NULL);
 
-			tud_hid_n_report(1, 0, &report, sizeof(report));
+	usb_init();
 
-			new_data = 0;
-		}
-#endif
-	}
+	event_loop_post(&usb_work);
+	event_loop_run(&event_loop);
 }
+
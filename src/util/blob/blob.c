@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "util/blob/blob.h"
+#include "util/data.h"
+
+int blob_init(struct blob_t *blob, struct blockdev_hal_t device, u32 offset, u32 size)
+{
+	u32 device_size = (u32) device.block_size * device.block_count;
+
+	if (!device.read_size || offset % device.read_size || size % device.read_size || offset > device_size ||
+	    size > device_size - offset)
+		return -EINVAL;
+
+	blob->device = device;
+	blob->offset = offset;
+	blob->size = size;
+
+	return 0;
+}
+
+int blob_read(const struct blob_t *blob, u32 pos, void *buffer, u32 size)
+{
+	u8 *data = buffer;
+	u32 addr;
+	u16 count;
+	int ret;
+
+	if (pos > blob->size || size > blob->size - pos)
+		return -EINVAL;
+
+	addr = blob->offset + pos;
+
+	/* block devices don't read across blocks */
+	while (size) {
+		count = min(size, blob->device.block_size - addr % blob->device.block_size);
+
+		ret = blob->device.read(
+			blob->device, addr / blob->device.block_size, addr % blob->device.block_size, data, count);
+		if (ret < 0)
+			return ret;
+
+		addr += count;
+		data += count;
+		size -= count;
+	}
+
+	return 0;
+}
+
+static int blob_stream_fetch(struct blob_stream_t *stream, u8 buffer)
+{
+	u16 count = min(stream->blob.size - stream->fetch_pos, BLOB_STREAM_CHUNK_SIZE);
+	int ret;
+
+	ret = blob_read(&stream->blob, stream->fetch_pos, stream->buffer[buffer], count);
+	if (ret < 0)
+		return ret;
+
+	stream->fetch_pos += count;
+	stream->fill[buffer] = count;
+
+	return 0;
+}
+
+int blob_stream_open(struct blob_stream_t *stream, const struct blob_t *blob)
+{
+	if (BLOB_STREAM_CHUNK_SIZE % blob->device.read_size)
+		return -EINVAL;
+
+	memset(stream, 0, sizeof(*stream));
+	stream->blob = *blob;
+
+	return blob_stream_fetch(stream, stream->front);
+}
+
+int blob_stream_prefetch(struct blob_stream_t *stream)
+{
+	u8 back = !stream->front;
+
+	if (stream->fill[back] || stream->fetch_pos == stream->blob.size)
+		return 0;
+
+	return blob_stream_fetch(stream, back);
+}
+
+int blob_stream_getc(struct blob_stream_t *stream)
+{
+	int ret;
+
+	if (stream->index == stream->fill[stream->front]) {
+		/* the consumer didn't prefetch, read the next chunk now */
+		ret = blob_stream_prefetch(stream);
+		if (ret < 0)
+			return ret;
+
+		if (!stream->fill[!stream->front])
+			return -ENODATA;
+
+		stream->fill[stream->front] = 0;
+		stream->front = !stream->front;
+		stream->index = 0;
+	}
+
+	return stream->buffer[stream->front][stream->index++];
+}
@@ -0,0 +1,48 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/blockdev.h"
+#include "util/types.h"
+
+/*
+ * Read-only byte range of a block device, eg. a partition holding a sensor
+ * firmware or LED animations, so assets don't need to be memory mapped and
+ * can live in external flash.
+ */
+struct blob_t {
+	struct blockdev_hal_t device;
+	u32 offset; /* in bytes, from the start of the device */
+	u32 size;
+};
+
+/* offset and size must be multiples of the device read size */
+int blob_init(struct blob_t *blob, struct blockdev_hal_t device, u32 offset, u32 size);
+int blob_read(const struct blob_t *blob, u32 pos, void *buffer, u32 size);
+
+/*
+ * Sequential reader with two chunk buffers, one being consumed and one being
+ * filled. Consumers that have to wait between bytes anyway (eg. the PixArt
+ * SROM upload) call blob_stream_prefetch while waiting, so the device reads
+ * overlap the wait and blob_stream_getc never has to block on the device.
+ */
+#define BLOB_STREAM_CHUNK_SIZE 64
+
+struct blob_stream_t {
+	struct blob_t blob;
+	u32 fetch_pos; /* next byte to read from the device */
+	u8 buffer[2][BLOB_STREAM_CHUNK_SIZE];
+	u8 fill[2]; /* bytes available in each buffer */
+	u8 front; /* buffer being consumed */
+	u8 index; /* next byte of the front buffer */
+};
+
+/* reads the first chunk, the chunk size must be a multiple of the device read size */
+int blob_stream_open(struct blob_stream_t *stream, const struct blob_t *blob);
+/* next byte of the blob, -ENODATA at the end */
+int blob_stream_getc(struct blob_stream_t *stream);
+/* fills the back buffer if it is empty and there is data left */
+int blob_stream_prefetch(struct blob_stream_t *stream);
@@ -0,0 +1,324 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "util/block_cache/block_cache.h"
+#include "util/data.h"
+
+#define BLOCK_CACHE_NO_BLOCK 0xFFFF
+
+/* stamps wrap around, 0 means no stamp */
+static u32 block_cache_stamp(struct block_cache_t *cache)
+{
+	if (!++cache->clock)
+		++cache->clock;
+	return cache->clock;
+}
+
+static u8 block_cache_before(u32 a, u32 b)
+{
+	return (s32) (a - b) < 0;
+}
+
+static struct block_cache_line_t *block_cache_lookup(struct block_cache_t *cache, u16 block, u16 page)
+{
+	for (size_t i = 0; i < BLOCK_CACHE_LINES; i++)
+		if (cache->lines[i].valid && cache->lines[i].block == block && cache->lines[i].page == page)
+			return &cache->lines[i];
+	return NULL;
+}
+
+/* the oldest dirty line, or the block of the oldest pending erase */
+static struct block_cache_line_t *block_cache_oldest(struct block_cache_t *cache, u16 *erase_block)
+{
+	struct block_cache_line_t *oldest_line = NULL;
+	u32 oldest = 0;
+
+	*erase_block = BLOCK_CACHE_NO_BLOCK;
+
+	for (size_t i = 0; i < BLOCK_CACHE_LINES; i++) {
+		struct block_cache_line_t *line = &cache->lines[i];
+
+		if (line->valid && line->dirty && (!oldest || block_cache_before(line->dirtied, oldest))) {
+			oldest_line = line;
+			oldest = line->dirtied;
+		}
+	}
+
+	for (u16 block = 0; block < cache->device.block_count; block++) {
+		if (cache->erase_pending[block] && (!oldest || block_cache_before(cache->erase_pending[block], oldest))) {
+			oldest_line = NULL;
+			oldest = cache->erase_pending[block];
+			*erase_block = block;
+		}
+	}
+
+	return oldest_line;
+}
+
+/* one program per run of dirty write units, the units that are already in the device are not programmed again */
+static int block_cache_writeback(struct block_cache_t *cache, struct block_cache_line_t *line)
+{
+	u16 unit = cache->device.write_size;
+	u16 units = cache->page_size / unit;
+	u16 first, last;
+	int ret;
+
+	for (first = 0; first < units; first = last + 1) {
+		if (!(line->dirty & (1ul << first))) {
+			last = first;
+			continue;
+		}
+
+		for (last = first; last + 1 < units && line->dirty & (1ul << (last + 1)); last++) continue;
+
+		ret = cache->device.write(cache->device,
+					  line->block,
+					  line->page * cache->page_size + first * unit,
+					  line->data + first * unit,
+					  (last - first + 1) * unit);
+		if (ret < 0)
+			return ret;
+
+		for (u16 i = first; i <= last; i++) line->dirty &= ~(1ul << i);
+	}
+
+	return 0;
+}
+
+int block_cache_flush_step(struct block_cache_t *cache)
+{
+	struct block_cache_line_t *line;
+	u16 block;
+	int ret;
+
+	line = block_cache_oldest(cache, &block);
+	if (line)
+		return block_cache_writeback(cache, line);
+
+	if (block == BLOCK_CACHE_NO_BLOCK)
+		return 0;
+
+	ret = cache->device.erase(cache->device, block);
+	if (ret < 0)
+		return ret;
+	cache->erase_pending[block] = 0;
+
+	return 0;
+}
+
+int block_cache_flush(struct block_cache_t *cache)
+{
+	int ret;
+
+	while (block_cache_dirty(cache))
+		if ((ret = block_cache_flush_step(cache)) < 0)
+			return ret;
+
+	return 0;
+}
+
+u8 block_cache_dirty(const struct block_cache_t *cache)
+{
+	for (size_t i = 0; i < BLOCK_CACHE_LINES; i++)
+		if (cache->lines[i].valid && cache->lines[i].dirty)
+			return 1;
+
+	for (u16 block = 0; block < cache->device.block_count; block++)
+		if (cache->erase_pending[block])
+			return 1;
+
+	return 0;
+}
+
+/* finds or loads the line of a page, evicting the least recently used clean line */
+static int block_cache_line(struct block_cache_t *cache, u16 block, u16 page, struct block_cache_line_t **line)
+{
+	struct block_cache_line_t *victim = NULL;
+	int ret;
+
+	*line = block_cache_lookup(cache, block, page);
+	if (*line) {
+		(*line)->used = block_cache_stamp(cache);
+		return 0;
+	}
+
+	for (size_t i = 0; i < BLOCK_CACHE_LINES; i++) {
+		struct block_cache_line_t *candidate = &cache->lines[i];
+
+		if (!candidate->valid) {
+			victim = candidate;
+			break;
+		}
+		if (!candidate->dirty && (!victim || block_cache_before(candidate->used, victim->used)))
+			victim = candidate;
+	}
+
+	/* everything is dirty, write it all out in order rather than reordering a single line */
+	if (!victim) {
+		ret = block_cache_flush(cache);
+		if (ret < 0)
+			return ret;
+
+		victim = &cache->lines[0];
+		for (size_t i = 1; i < BLOCK_CACHE_LINES; i++)
+			if (block_cache_before(cache->lines[i].used, victim->used))
+				victim = &cache->lines[i];
+	}
+
+	victim->valid = 0;
+	if (cache->erase_pending[block]) {
+		memset(victim->data, 0xFF, cache->page_size);
+	} else {
+		ret = cache->device.read(cache->device, block, page * cache->page_size, victim->data, cache->page_size);
+		if (ret < 0)
+			return ret;
+	}
+
+	victim->valid = 1;
+	victim->block = block;
+	victim->page = page;
+	victim->dirty = 0;
+	victim->used = block_cache_stamp(cache);
+
+	*line = victim;
+	return 0;
+}
+
+s8 block_cache_read(struct blockdev_hal_t mem_block, u16 block, u16 offset, void *buffer, u16 size)
+{
+	struct block_cache_t *cache = mem_block.drv_data;
+	struct block_cache_line_t *line;
+	u8 *data = buffer;
+	u16 start, count;
+	int ret;
+
+	if (block >= cache->device.block_count || (u32) offset + size > cache->device.block_size)
+		return -EINVAL;
+
+	while (size) {
+		start = offset % cache->page_size;
+		count = min(size, cache->page_size - start);
+
+		line = block_cache_lookup(cache, block, offset / cache->page_size);
+		if (line) {
+			memcpy(data, line->data + start, count);
+		} else if (cache->erase_pending[block]) {
+			memset(data, 0xFF, count);
+		} else {
+			ret = cache->device.read(cache->device, block, offset, data, count);
+			if (ret < 0)
+				return ret;
+		}
+
+		offset += count;
+		data += count;
+		size -= count;
+	}
+
+	return 0;
+}
+
+s8 block_cache_write(struct blockdev_hal_t mem_block, u16 block, u16 offset, void *buffer, u16 size)
+{
+	struct block_cache_t *cache = mem_block.drv_data;
+	struct block_cache_line_t *line;
+	u16 unit = cache->device.write_size;
+	const u8 *data = buffer;
+	u16 start, count;
+	int ret;
+
+	if (block >= cache->device.block_count || (u32) offset + size > cache->device.block_size || offset % unit ||
+	    size % unit)
+		return -EINVAL;
+
+	while (size) {
+		start = offset % cache->page_size;
+		count = min(size, cache->page_size - start);
+
+		ret = block_cache_line(cache, block, offset / cache->page_size, &line);
+		if (ret < 0)
+			return ret;
+
+		/* programming can only clear bits */
+		for (u16 i = 0; i < count; i++) line->data[start + i] &= data[i];
+
+		if (!line->dirty)
+			line->dirtied = block_cache_stamp(cache);
+		for (u16 i = start / unit; i < (start + count) / unit; i++) line->dirty |= 1ul << i;
+
+		offset += count;
+		data += count;
+		size -= count;
+	}
+
+	return 0;
+}
+
+s8 block_cache_erase(struct blockdev_hal_t mem_block, u16 block)
+{
+	struct block_cache_t *cache = mem_block.drv_data;
+
+	if (block >= cache->device.block_count)
+		return -EINVAL;
+
+	/* whatever was written to the block since the last flush is gone anyway */
+	for (size_t i = 0; i < BLOCK_CACHE_LINES; i++) {
+		struct block_cache_line_t *line = &cache->lines[i];
+
+		if (line->valid && line->block == block) {
+			memset(line->data, 0xFF, cache->page_size);
+			line->dirty = 0;
+		}
+	}
+
+	cache->erase_pending[block] = block_cache_stamp(cache);
+
+	return 0;
+}
+
+s8 block_cache_sync(struct blockdev_hal_t mem_block)
+{
+	struct block_cache_t *cache = mem_block.drv_data;
+	int ret = block_cache_flush(cache);
+
+	if (ret < 0)
+		return ret;
+
+	return cache->device.sync(cache->device);
+}
+
+int block_cache_init(struct block_cache_t *cache, struct blockdev_hal_t device, u16 page_size)
+{
+	if (!page_size || page_size > BLOCK_CACHE_MAX_PAGE_SIZE || device.block_size % page_size ||
+	    page_size % device.write_size || page_size / device.write_size > 32 || device.block_count > BLOCK_CACHE_MAX_BLOCKS)
+		return -EINVAL;
+
+	memset(cache, 0, sizeof(*cache));
+	cache->device = device;
+	cache->page_size = page_size;
+
+	return 0;
+}
+
+struct blockdev_hal_t blockdev_hal_init_cache(struct block_cache_t *cache)
+{
+	struct blockdev_hal_t hal = {
+		.read_size = cache->device.read_size,
+		.write_size = cache->device.write_size,
+		.block_size = cache->device.block_size,
+		.block_count = cache->device.block_count,
+
+		.read = block_cache_read,
+		.write = block_cache_write,
+		.erase = block_cache_erase,
+		.sync = block_cache_sync,
+
+		.drv_data = cache,
+	};
+	return hal;
+}
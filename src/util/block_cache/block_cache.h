@@ -0,0 +1,57 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/blockdev.h"
+#include "util/types.h"
+
+/*
+ * Write-back page cache, as a blockdev decorator
+ *
+ * Writes land in page sized cache lines and only reach the device when the cache
+ * is flushed (sync, idle, or when a line has to be evicted), so a burst of small
+ * writes to the same page becomes a single program per run of written units.
+ * Erases are deferred too, erasing a block again before the flush costs nothing,
+ * and anything written to a block before its erase never reaches the device.
+ *
+ * The device semantics are kept, writes clear bits (NOR), and operations reach the
+ * device in the order they were requested: every dirty line and pending erase has
+ * a stamp, and flushing always picks the oldest one. Storage code that is careful
+ * about power loss (eg. writing a copy before erasing the original) stays correct,
+ * it only loses the writes that were not flushed yet.
+ */
+
+#define BLOCK_CACHE_LINES	  4
+#define BLOCK_CACHE_MAX_PAGE_SIZE 512
+#define BLOCK_CACHE_MAX_BLOCKS	  64
+
+struct block_cache_line_t {
+	u16 block;
+	u16 page; /* inside the block */
+	u8 valid;
+	u32 dirty; /* write units not in the device yet, one bit each */
+	u32 dirtied; /* stamp of the first unflushed write */
+	u32 used; /* LRU */
+	u8 data[BLOCK_CACHE_MAX_PAGE_SIZE] __attribute__((aligned(4))); /* some drivers copy words */
+};
+
+struct block_cache_t {
+	struct blockdev_hal_t device;
+	u16 page_size;
+	u32 clock;
+	struct block_cache_line_t lines[BLOCK_CACHE_LINES];
+	u32 erase_pending[BLOCK_CACHE_MAX_BLOCKS]; /* stamp of the pending erase, 0 if none */
+};
+
+/* page_size must be a multiple of the device write size, with up to 32 write units per page */
+int block_cache_init(struct block_cache_t *cache, struct blockdev_hal_t device, u16 page_size);
+struct blockdev_hal_t blockdev_hal_init_cache(struct block_cache_t *cache);
+
+u8 block_cache_dirty(const struct block_cache_t *cache);
+
+/* push the oldest pending operation to the device, for idle time flushing */
+int block_cache_flush_step(struct block_cache_t *cache);
+int block_cache_flush(struct block_cache_t *cache);
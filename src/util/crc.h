@@ -0,0 +1,37 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "util/types.h"
+
+/* CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), pass the previous value to continue a calculation */
+static inline u16 crc16_ccitt(u16 crc, const void *data, size_t size)
+{
+	const u8 *bytes = data;
+
+	for (size_t i = 0; i < size; i++) {
+		crc ^= (u16) bytes[i] << 8;
+		for (u8 bit = 0; bit < 8; bit++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+
+	return crc;
+}
+
+#define CRC16_CCITT_INIT 0xFFFF
+
+/* CRC-32/ISO-HDLC (zlib, reflected poly 0xEDB88320), start at 0 and pass the previous value to continue a calculation */
+static inline u32 crc32_ieee(u32 crc, const void *data, size_t size)
+{
+	const u8 *bytes = data;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++) {
+		crc ^= bytes[i];
+		for (u8 bit = 0; bit < 8; bit++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+	}
+
+	return ~crc;
+}
@@ -0,0 +1,222 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "util/data.h"
+#include "util/event_loop/event_loop.h"
+
+#define EVENT_LOOP_WHEEL_MASK (EVENT_LOOP_WHEEL_SIZE - 1)
+
+void event_loop_init(struct event_loop_t *loop, u64 (*get_ticks)(void), void (*idle)(struct event_loop_t *loop))
+{
+	memset(loop, 0, sizeof(*loop));
+
+	loop->get_ticks = get_ticks;
+	loop->idle = idle;
+	loop->tick = get_ticks();
+}
+
+/* work items */
+
+void event_loop_add_work(struct event_loop_t *loop, struct event_work_t *work, void (*callback)(void *data), void *data)
+{
+	struct event_work_t **tail = &loop->works;
+
+	while (*tail) tail = &(*tail)->next;
+
+	work->callback = callback;
+	work->data = data;
+	work->pending = 0;
+	work->loop = loop;
+	work->next = NULL;
+
+	*tail = work;
+}
+
+/* safe to call from interrupt context */
+void event_loop_post(struct event_work_t *work)
+{
+	/* work first, the loop clears its flag before scanning the work items */
+	work->pending = 1;
+	work->loop->pending = 1;
+}
+
+u8 event_loop_pending(struct event_loop_t *loop)
+{
+	return loop->pending;
+}
+
+static u8 event_loop_run_works(struct event_loop_t *loop)
+{
+	u8 ran = 0;
+
+	if (!loop->pending)
+		return 0;
+
+	loop->pending = 0;
+
+	for (struct event_work_t *work = loop->works; work; work = work->next) {
+		if (!work->pending)
+			continue;
+
+		work->pending = 0;
+		work->callback(work->data);
+		ran = 1;
+	}
+
+	return ran;
+}
+
+/* timers */
+
+static void event_timer_link(struct event_timer_t **head, struct event_timer_t *timer)
+{
+	timer->next = *head;
+	if (timer->next)
+		timer->next->pprev = &timer->next;
+	timer->pprev = head;
+	*head = timer;
+}
+
+static void event_timer_unlink(struct event_timer_t *timer)
+{
+	if (!timer->pprev)
+		return;
+
+	*timer->pprev = timer->next;
+	if (timer->next)
+		timer->next->pprev = timer->pprev;
+
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+static void event_timer_arm(struct event_loop_t *loop, struct event_timer_t *timer, u64 expires)
+{
+	timer->expires = expires;
+	event_timer_link(&loop->wheel[expires & EVENT_LOOP_WHEEL_MASK], timer);
+}
+
+void event_timer_init(struct event_timer_t *timer, void (*callback)(void *data), void *data)
+{
+	memset(timer, 0, sizeof(*timer));
+
+	timer->callback = callback;
+	timer->data = data;
+}
+
+void event_timer_start(struct event_loop_t *loop, struct event_timer_t *timer, u32 delay_ms, u32 period_ms)
+{
+	event_timer_unlink(timer);
+
+	/* the slot of the current tick has already been visited */
+	timer->period = period_ms;
+	event_timer_arm(loop, timer, max(loop->get_ticks(), loop->tick) + max(delay_ms, 1));
+}
+
+void event_timer_stop(struct event_timer_t *timer)
+{
+	event_timer_unlink(timer);
+}
+
+u8 event_timer_active(const struct event_timer_t *timer)
+{
+	return timer->pprev != NULL;
+}
+
+u32 event_loop_next_timeout(struct event_loop_t *loop)
+{
+	u64 now = loop->get_ticks();
+	u64 next = UINT64_MAX;
+
+	if (loop->pending)
+		return 0;
+
+	for (size_t i = 0; i < EVENT_LOOP_WHEEL_SIZE; i++)
+		for (struct event_timer_t *timer = loop->wheel[i]; timer; timer = timer->next) next = min(next, timer->expires);
+
+	if (next == UINT64_MAX)
+		return UINT32_MAX;
+	if (next <= now)
+		return 0;
+	return min(next - now, UINT32_MAX);
+}
+
+static u8 event_loop_run_timers(struct event_loop_t *loop)
+{
+	u64 now = loop->get_ticks();
+	u64 steps;
+	struct event_timer_t *expired = NULL;
+	struct event_timer_t *timer, *next;
+	u8 ran = 0;
+
+	if (now <= loop->tick)
+		return 0;
+
+	/* after a full turn every slot has been visited, no need to go around again */
+	steps = min(now - loop->tick, EVENT_LOOP_WHEEL_SIZE);
+
+	for (u64 i = 1; i <= steps; i++) {
+		for (timer = loop->wheel[(loop->tick + i) & EVENT_LOOP_WHEEL_MASK]; timer; timer = next) {
+			next = timer->next;
+
+			/* the slot also holds timers for later turns of the wheel */
+			if (timer->expires > now)
+				continue;
+
+			event_timer_unlink(timer);
+			event_timer_link(&expired, timer);
+		}
+	}
+
+	loop->tick = now;
+
+	/* callbacks may start and stop any timer, including the ones in the expired list */
+	while ((timer = expired)) {
+		event_timer_unlink(timer);
+
+		if (timer->period) {
+			/* keep the period, unless we fell behind by more than a whole period */
+			u64 expires = timer->expires + timer->period;
+
+			if (expires <= now)
+				expires = now + timer->period;
+			event_timer_arm(loop, timer, expires);
+		}
+
+		timer->callback(timer->data);
+		ran = 1;
+	}
+
+	return ran;
+}
+
+/* loop */
+
+u8 event_loop_run_once(struct event_loop_t *loop)
+{
+	u8 ran = event_loop_run_timers(loop);
+
+	ran |= event_loop_run_works(loop);
+
+	if (!ran && !loop->pending && loop->idle)
+		loop->idle(loop);
+
+	return ran;
+}
+
+void event_loop_run(struct event_loop_t *loop)
+{
+	loop->running = 1;
+
+	while (loop->running) event_loop_run_once(loop);
+}
+
+void event_loop_stop(struct event_loop_t *loop)
+{
+	loop->running = 0;
+}
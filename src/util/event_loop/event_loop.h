@@ -0,0 +1,79 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "util/types.h"
+
+/*
+ * Cooperative run-to-completion event loop
+ *
+ * Work items are registered once, they are the event sources (USB, motion pin,
+ * protocol, ...), and get posted whenever they have something to do. Posting only
+ * sets flags, so it is safe from interrupt context. Callbacks always run from
+ * event_loop_run_once, one after the other, and must not block.
+ *
+ * Timers live in a hashed wheel, slot = expiry tick % EVENT_LOOP_WHEEL_SIZE, so
+ * advancing the loop only visits the slots for the ticks that passed instead of
+ * every armed timer. A tick is one millisecond (one SysTick period).
+ *
+ * When there is nothing to do, the idle callback is called, it can sleep until
+ * the next interrupt (WFI) or block on a file descriptor.
+ */
+
+#define EVENT_LOOP_WHEEL_SIZE 32 /* must be a power of 2 */
+
+struct event_loop_t;
+
+struct event_work_t {
+	void (*callback)(void *data);
+	void *data;
+	volatile u8 pending;
+	struct event_loop_t *loop;
+	struct event_work_t *next;
+};
+
+struct event_timer_t {
+	void (*callback)(void *data);
+	void *data;
+	u64 expires;
+	u32 period; /* 0 for one shot timers */
+	struct event_timer_t *next;
+	struct event_timer_t **pprev; /* NULL when the timer is not armed */
+};
+
+struct event_loop_t {
+	/* milisecs since boot */
+	u64 (*get_ticks)(void);
+	/* nothing to do, may wait for the next event */
+	void (*idle)(struct event_loop_t *loop);
+	/* arbitrary user data */
+	void *data;
+	u8 running;
+	volatile u8 pending;
+	struct event_work_t *works;
+	u64 tick;
+	struct event_timer_t *wheel[EVENT_LOOP_WHEEL_SIZE];
+};
+
+void event_loop_init(struct event_loop_t *loop, u64 (*get_ticks)(void), void (*idle)(struct event_loop_t *loop));
+
+/* work items run in the order they were added */
+void event_loop_add_work(struct event_loop_t *loop, struct event_work_t *work, void (*callback)(void *data), void *data);
+void event_loop_post(struct event_work_t *work);
+u8 event_loop_pending(struct event_loop_t *loop);
+
+void event_timer_init(struct event_timer_t *timer, void (*callback)(void *data), void *data);
+void event_timer_start(struct event_loop_t *loop, struct event_timer_t *timer, u32 delay_ms, u32 period_ms);
+void event_timer_stop(struct event_timer_t *timer);
+u8 event_timer_active(const struct event_timer_t *timer);
+
+/* milisecs until the next timer expires, 0 if there is pending work, UINT32_MAX if there is nothing scheduled */
+u32 event_loop_next_timeout(struct event_loop_t *loop);
+
+/* returns true if any callback ran */
+u8 event_loop_run_once(struct event_loop_t *loop);
+void event_loop_run(struct event_loop_t *loop);
+void event_loop_stop(struct event_loop_t *loop);
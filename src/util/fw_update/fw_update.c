@@ -0,0 +1,208 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "util/crc.h"
+#include "util/data.h"
+#include "util/fw_update/fw_update.h"
+
+static int fw_update_check_slot(struct blockdev_hal_t slot)
+{
+	/* staged programs must be aligned and never cross a block */
+	if (!slot.write_size || !slot.read_size || FW_UPDATE_STAGING_SIZE % slot.write_size ||
+	    FW_UPDATE_STAGING_SIZE % slot.read_size || slot.block_size % FW_UPDATE_STAGING_SIZE)
+		return -EINVAL;
+	return 0;
+}
+
+int fw_update_read_record(struct nvs_t *nvs, struct fw_update_record_t *record)
+{
+	if (nvs_read(nvs, FW_UPDATE_NVS_KEY, record, sizeof(*record)) != sizeof(*record) || record->slot >= FW_UPDATE_SLOTS)
+		return -ENOENT;
+	return 0;
+}
+
+int fw_update_init(struct fw_update_t *update,
+		   struct blockdev_hal_t slot_a,
+		   struct blockdev_hal_t slot_b,
+		   u8 running,
+		   struct nvs_t *nvs)
+{
+	if (running >= FW_UPDATE_SLOTS || fw_update_check_slot(slot_a) < 0 || fw_update_check_slot(slot_b) < 0)
+		return -EINVAL;
+
+	memset(update, 0, sizeof(*update));
+	update->slots[0] = slot_a;
+	update->slots[1] = slot_b;
+	update->nvs = nvs;
+	update->running = running;
+	update->boot = running;
+
+	/* a record pointing elsewhere is an update that didn't boot (yet), the next one replaces it */
+	if (nvs && fw_update_read_record(nvs, &update->record) == 0) {
+		update->boot = update->record.slot;
+		update->has_record = update->record.slot == running;
+	}
+
+	return 0;
+}
+
+u8 fw_update_target(const struct fw_update_t *update)
+{
+	return (update->running + 1) % FW_UPDATE_SLOTS;
+}
+
+u32 fw_update_capacity(const struct fw_update_t *update)
+{
+	struct blockdev_hal_t slot = update->slots[fw_update_target(update)];
+
+	return (u32) slot.block_size * slot.block_count;
+}
+
+static int fw_update_write_record(struct fw_update_t *update, const struct fw_update_record_t *record)
+{
+	int ret;
+
+	if (!update->nvs)
+		return -ENODEV;
+
+	ret = nvs_write(update->nvs, FW_UPDATE_NVS_KEY, record, sizeof(*record));
+	if (ret < 0)
+		return ret;
+
+	/* we may be reset right after this */
+	return update->nvs->blockdev.sync(update->nvs->blockdev);
+}
+
+int fw_update_start(struct fw_update_t *update, u32 size, u32 crc)
+{
+	u8 target = fw_update_target(update);
+	int ret;
+
+	update->state = FW_UPDATE_IDLE;
+
+	if (!size)
+		return -EINVAL;
+	if (size > fw_update_capacity(update))
+		return -EFBIG;
+
+	/* an earlier update that we didn't boot yet is about to be erased, boot what we are running again */
+	if (update->boot == target) {
+		if (update->has_record)
+			ret = fw_update_write_record(update, &update->record);
+		else
+			ret = update->nvs ? nvs_delete(update->nvs, FW_UPDATE_NVS_KEY) : 0;
+		if (ret < 0 && ret != -ENOENT)
+			return ret;
+		update->boot = update->running;
+	}
+
+	update->state = FW_UPDATE_RECEIVING;
+	update->size = size;
+	update->expected_crc = crc;
+	update->received = 0;
+	update->written = 0;
+	update->crc = 0;
+	update->erased = 0;
+	update->staged = 0;
+	update->sequence = 0;
+	update->gap_reported = 0;
+
+	return 0;
+}
+
+/* programs the staging buffer, erasing the block first if the stream just got to it */
+static int fw_update_program(struct fw_update_t *update)
+{
+	struct blockdev_hal_t slot = update->slots[fw_update_target(update)];
+	u16 block = update->written / slot.block_size;
+	u16 offset = update->written % slot.block_size;
+	u16 size = update->staged;
+	int ret;
+
+	/* the last program is padded to the write size, erased flash reads as 0xFF anyway */
+	while (size % slot.write_size) update->staging[size++] = 0xFF;
+
+	for (; update->erased <= block; update->erased++)
+		if ((ret = slot.erase(slot, update->erased)) < 0)
+			return ret;
+
+	ret = slot.write(slot, block, offset, update->staging, size);
+	if (ret < 0)
+		return ret;
+
+	/* check what the flash holds, not what we meant to write */
+	ret = slot.read(slot, block, offset, update->staging, size);
+	if (ret < 0)
+		return ret;
+
+	update->crc = crc32_ieee(update->crc, update->staging, update->staged);
+	update->written += update->staged;
+	update->staged = 0;
+
+	return 0;
+}
+
+int fw_update_write(struct fw_update_t *update, const void *data, u16 size)
+{
+	const u8 *bytes = data;
+	u16 count;
+	int ret;
+
+	if (update->state != FW_UPDATE_RECEIVING || size > update->size - update->received)
+		return -EINVAL;
+
+	while (size) {
+		count = min(size, FW_UPDATE_STAGING_SIZE - update->staged);
+		memcpy(update->staging + update->staged, bytes, count);
+		update->staged += count;
+		update->received += count;
+		bytes += count;
+		size -= count;
+
+		if (update->staged == FW_UPDATE_STAGING_SIZE && (ret = fw_update_program(update)) < 0) {
+			update->state = FW_UPDATE_IDLE;
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+int fw_update_finish(struct fw_update_t *update)
+{
+	struct blockdev_hal_t slot = update->slots[fw_update_target(update)];
+	struct fw_update_record_t record = {
+		.slot = fw_update_target(update),
+		.size = update->size,
+	};
+	int ret;
+
+	if (update->state != FW_UPDATE_RECEIVING || update->received != update->size)
+		return -EINVAL;
+
+	update->state = FW_UPDATE_IDLE;
+
+	if (update->staged && (ret = fw_update_program(update)) < 0)
+		return ret;
+
+	if (update->crc != update->expected_crc)
+		return -EBADMSG;
+
+	ret = slot.sync(slot);
+	if (ret < 0)
+		return ret;
+
+	record.crc = update->crc;
+	ret = fw_update_write_record(update, &record);
+	if (ret < 0)
+		return ret;
+
+	update->boot = record.slot;
+
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/blockdev.h"
+#include "util/nvs/nvs.h"
+#include "util/types.h"
+
+/*
+ * A/B firmware update
+ *
+ * The device has two firmware slots, the image is streamed into the one we are
+ * not running from while we keep running. Blocks are erased right before the
+ * stream reaches them and the data is staged into write_size aligned programs,
+ * so the time spent on flash is spread over the transfer instead of stalling it.
+ * Every staged program is read back and added to a CRC-32, when the transfer
+ * finishes the CRC of what is actually in flash is compared against the one the
+ * host announced, and only then the boot record is pointed at the new slot.
+ *
+ * The boot record (slot, image size and CRC) lives in NVS, it is what the
+ * bootloader uses to pick and check the image to run. Without one that reads it
+ * an update would never take effect, so only enable this if the target has it.
+ * The slot we run from is never trusted to the record, the caller works it out
+ * from the execution address, and it is never the update target.
+ */
+
+#define FW_UPDATE_SLOTS	       2
+#define FW_UPDATE_STAGING_SIZE 256
+#define FW_UPDATE_NVS_KEY      0x0200
+
+struct fw_update_record_t {
+	u8 slot;
+	u8 reserved[3];
+	u32 size;
+	u32 crc;
+} __attribute__((__packed__));
+
+enum fw_update_state {
+	FW_UPDATE_IDLE = 0,
+	FW_UPDATE_RECEIVING,
+};
+
+struct fw_update_t {
+	struct blockdev_hal_t slots[FW_UPDATE_SLOTS];
+	struct nvs_t *nvs;
+	u8 running; /* slot we are executing from */
+	u8 boot; /* slot the boot record points to */
+	u8 has_record; /* the record points to the running slot */
+	struct fw_update_record_t record; /* the one we booted with */
+	/* transfer */
+	u8 state;
+	u32 size;
+	u32 expected_crc;
+	u32 received;
+	u32 written;
+	u32 crc; /* of the data read back from flash */
+	u16 erased; /* blocks of the target slot erased so far */
+	u16 staged;
+	u8 staging[FW_UPDATE_STAGING_SIZE] __attribute__((aligned(4)));
+	/* windowing, owned by the protocol */
+	u16 sequence; /* next chunk we expect */
+	u8 gap_reported;
+};
+
+/* running is the slot holding the code that calls this, nvs may be NULL but then no update can finish */
+int fw_update_init(struct fw_update_t *update,
+		   struct blockdev_hal_t slot_a,
+		   struct blockdev_hal_t slot_b,
+		   u8 running,
+		   struct nvs_t *nvs);
+/* what the bootloader reads, -ENOENT if there is no valid record */
+int fw_update_read_record(struct nvs_t *nvs, struct fw_update_record_t *record);
+
+u8 fw_update_target(const struct fw_update_t *update);
+u32 fw_update_capacity(const struct fw_update_t *update);
+
+/* aborts any transfer in progress, -EFBIG if the image doesn't fit the target slot */
+int fw_update_start(struct fw_update_t *update, u32 size, u32 crc);
+/* in order image data, a failed write aborts the transfer */
+int fw_update_write(struct fw_update_t *update, const void *data, u16 size);
+/*
+ * -EINVAL if the image is incomplete, -EBADMSG if the CRC doesn't match, -ENODEV if there is no NVS to hold the
+ * boot record, the boot record is only updated on success
+ */
+int fw_update_finish(struct fw_update_t *update);
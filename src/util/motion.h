@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include <string.h>
+
+#include "util/hid_descriptors.h"
+#include "util/types.h"
+
+/*
+ * Relative motion waiting to be reported
+ *
+ * Sensor deltas are accumulated here as they come in, and each report takes as
+ * much as its fields can hold. Whatever doesn't fit is carried over to the next
+ * report instead of being truncated, so no displacement is lost. If the host
+ * stops polling while the sensor keeps moving, the totals saturate instead of
+ * wrapping around to the opposite direction.
+ */
+struct motion_t {
+	s32 dx;
+	s32 dy;
+};
+
+static inline s32 motion_saturate(s64 value)
+{
+	if (value > INT32_MAX)
+		return INT32_MAX;
+	if (value < -INT32_MAX)
+		return -INT32_MAX;
+	return value;
+}
+
+static inline void motion_add(struct motion_t *motion, s32 dx, s32 dy)
+{
+	motion->dx = motion_saturate((s64) motion->dx + dx);
+	motion->dy = motion_saturate((s64) motion->dy + dy);
+}
+
+static inline s32 motion_take(s32 *axis, s32 limit)
+{
+	s32 value = *axis;
+
+	if (value > limit)
+		value = limit;
+	else if (value < -limit)
+		value = -limit;
+
+	*axis -= value;
+	return value;
+}
+
+static inline s8 motion_take_s8(s32 *axis)
+{
+	return motion_take(axis, 127);
+}
+
+static inline s16 motion_take_s16(s32 *axis)
+{
+	return motion_take(axis, 32767);
+}
+
+static inline u8 motion_pending(const struct motion_t *motion)
+{
+	return motion->dx || motion->dy;
+}
+
+/* fills a 16 bit mouse report with as much motion as it can hold, returns 0 if there is none */
+static inline u8 motion_report_16(struct motion_t *motion, struct mouse_report_16 *report)
+{
+	if (!motion_pending(motion))
+		return 0;
+
+	memset(report, 0, sizeof(*report));
+	report->id = MOUSE_REPORT_ID;
+	report->x = motion_take_s16(&motion->dx);
+	report->y = motion_take_s16(&motion->dy);
+
+	return 1;
+}
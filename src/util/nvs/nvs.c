@@ -0,0 +1,547 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "util/crc.h"
+#include "util/data.h"
+#include "util/nvs/nvs.h"
+
+#define NVS_SECTOR_MAGIC 0x3053564E /* "NVS0" */
+
+#define NVS_RECORD_VALUE  0x5A
+#define NVS_RECORD_DELETE 0xA5
+
+#define NVS_KEY_ERASED 0xFFFF
+
+struct nvs_sector_header_t {
+	u32 magic;
+	u32 sequence;
+} __attribute__((__packed__));
+
+struct nvs_record_header_t {
+	u16 key;
+	u16 size;
+	u8 type;
+	u8 reserved;
+	u16 crc; /* header (without the crc) and value */
+} __attribute__((__packed__));
+
+static u16 nvs_align(const struct nvs_t *nvs, u32 size)
+{
+	u16 write_size = nvs->blockdev.write_size;
+
+	return (size + write_size - 1) / write_size * write_size;
+}
+
+static u16 nvs_record_size(const struct nvs_t *nvs, u16 size)
+{
+	return nvs_align(nvs, sizeof(struct nvs_record_header_t) + size);
+}
+
+static u16 nvs_record_crc(const struct nvs_record_header_t *header, const void *value)
+{
+	u16 crc = crc16_ccitt(CRC16_CCITT_INIT, header, offsetof(struct nvs_record_header_t, crc));
+
+	/* deletes have no value, and may pass NULL for it */
+	if (!header->size)
+		return crc;
+
+	return crc16_ccitt(crc, value, header->size);
+}
+
+/* index */
+
+static struct nvs_entry_t *nvs_index_lookup(struct nvs_t *nvs, u16 key, size_t *position)
+{
+	size_t low = 0, high = nvs->index_count;
+
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+
+		if (nvs->index[middle].key < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	*position = low;
+	if (low < nvs->index_count && nvs->index[low].key == key)
+		return &nvs->index[low];
+	return NULL;
+}
+
+static int nvs_index_set(struct nvs_t *nvs, u16 key, u16 sector, u16 offset, u16 size)
+{
+	size_t position;
+	struct nvs_entry_t *entry = nvs_index_lookup(nvs, key, &position);
+
+	if (entry) {
+		/* the previous record is garbage now */
+		nvs->sectors[entry->sector].dead += nvs_record_size(nvs, entry->size);
+	} else {
+		if (nvs->index_count >= NVS_MAX_KEYS)
+			return -ENOMEM;
+
+		entry = &nvs->index[position];
+		memmove(entry + 1, entry, (nvs->index_count - position) * sizeof(*entry));
+		nvs->index_count++;
+	}
+
+	entry->key = key;
+	entry->sector = sector;
+	entry->offset = offset;
+	entry->size = size;
+
+	return 0;
+}
+
+static void nvs_index_remove(struct nvs_t *nvs, u16 key)
+{
+	size_t position;
+	struct nvs_entry_t *entry = nvs_index_lookup(nvs, key, &position);
+
+	if (!entry)
+		return;
+
+	nvs->sectors[entry->sector].dead += nvs_record_size(nvs, entry->size);
+
+	nvs->index_count--;
+	memmove(entry, entry + 1, (nvs->index_count - position) * sizeof(*entry));
+}
+
+/* sectors */
+
+static u8 nvs_sector_erased(struct nvs_t *nvs, u16 sector)
+{
+	u8 buffer[NVS_MAX_WRITE_SIZE];
+
+	for (u32 offset = 0; offset < nvs->blockdev.block_size; offset += sizeof(buffer)) {
+		u16 size = min(sizeof(buffer), nvs->blockdev.block_size - offset);
+
+		if (nvs->blockdev.read(nvs->blockdev, sector, offset, buffer, size))
+			return 0;
+
+		for (size_t i = 0; i < size; i++)
+			if (buffer[i] != 0xFF)
+				return 0;
+	}
+
+	return 1;
+}
+
+static int nvs_sector_erase(struct nvs_t *nvs, u16 sector)
+{
+	int ret = nvs->blockdev.erase(nvs->blockdev, sector);
+
+	if (ret)
+		return ret;
+
+	memset(&nvs->sectors[sector], 0, sizeof(nvs->sectors[sector]));
+	nvs->free_count++;
+
+	return 0;
+}
+
+static int nvs_sector_open(struct nvs_t *nvs)
+{
+	u8 buffer[NVS_MAX_WRITE_SIZE + sizeof(struct nvs_sector_header_t)];
+	struct nvs_sector_header_t *header = (struct nvs_sector_header_t *) buffer;
+	u16 block_count = nvs->blockdev.block_count;
+	u16 start = nvs->active == NVS_NO_SECTOR ? 0 : nvs->active + 1;
+	u16 sector = NVS_NO_SECTOR;
+	int ret;
+
+	/* round robin, spreads the erases */
+	for (u16 i = 0; i < block_count; i++) {
+		u16 candidate = (start + i) % block_count;
+
+		if (!nvs->sectors[candidate].sequence) {
+			sector = candidate;
+			break;
+		}
+	}
+
+	if (sector == NVS_NO_SECTOR)
+		return -ENOSPC;
+
+	memset(buffer, 0xFF, nvs->header_size);
+	header->magic = NVS_SECTOR_MAGIC;
+	header->sequence = ++nvs->sequence;
+
+	nvs->free_count--;
+	nvs->sectors[sector].sequence = header->sequence;
+	nvs->sectors[sector].used = nvs->blockdev.block_size;
+	nvs->sectors[sector].dead = nvs->blockdev.block_size;
+	nvs->active = sector;
+
+	ret = nvs->blockdev.write(nvs->blockdev, sector, 0, buffer, nvs->header_size);
+	if (ret)
+		return ret; /* the sector stays closed, the next collection erases it again */
+
+	nvs->sectors[sector].used = nvs->header_size;
+	nvs->sectors[sector].dead = 0;
+
+	return 0;
+}
+
+static u16 nvs_oldest_sector(struct nvs_t *nvs)
+{
+	u16 oldest = NVS_NO_SECTOR;
+
+	for (u16 i = 0; i < nvs->blockdev.block_count; i++) {
+		if (!nvs->sectors[i].sequence || i == nvs->active)
+			continue;
+		if (oldest == NVS_NO_SECTOR || nvs->sectors[i].sequence < nvs->sectors[oldest].sequence)
+			oldest = i;
+	}
+
+	return oldest;
+}
+
+static u8 nvs_active_fits(struct nvs_t *nvs, u16 record_size)
+{
+	return nvs->active != NVS_NO_SECTOR && nvs->sectors[nvs->active].used + record_size <= nvs->blockdev.block_size;
+}
+
+/* appends a record to the active sector, the caller makes sure it fits */
+static int nvs_program(struct nvs_t *nvs, u16 key, u8 type, const void *value, u16 size, u16 *offset)
+{
+	u8 buffer[sizeof(struct nvs_record_header_t) + NVS_MAX_VALUE_SIZE + NVS_MAX_WRITE_SIZE];
+	struct nvs_record_header_t *header = (struct nvs_record_header_t *) buffer;
+	struct nvs_sector_t *sector = &nvs->sectors[nvs->active];
+	u16 record_size = nvs_record_size(nvs, size);
+	int ret;
+
+	memset(buffer, 0xFF, record_size);
+	header->key = key;
+	header->size = size;
+	header->type = type;
+	header->reserved = 0xFF;
+	header->crc = nvs_record_crc(header, value);
+	if (size)
+		memcpy(buffer + sizeof(*header), value, size);
+
+	ret = nvs->blockdev.write(nvs->blockdev, nvs->active, sector->used, buffer, record_size);
+	if (ret) {
+		/* we don't know what made it to the flash, don't write after it */
+		sector->dead += nvs->blockdev.block_size - sector->used;
+		sector->used = nvs->blockdev.block_size;
+		return ret;
+	}
+
+	*offset = sector->used;
+	sector->used += record_size;
+
+	return 0;
+}
+
+/* garbage collection */
+
+/* copies one live record out of the sector being collected, returns 1 if it did */
+static int nvs_gc_move(struct nvs_t *nvs)
+{
+	u8 value[NVS_MAX_VALUE_SIZE];
+	struct nvs_entry_t *entry = NULL;
+	u16 offset;
+	int ret;
+
+	for (size_t i = 0; i < nvs->index_count; i++) {
+		if (nvs->index[i].sector == nvs->gc_sector) {
+			entry = &nvs->index[i];
+			break;
+		}
+	}
+
+	if (!entry)
+		return 0;
+
+	ret = nvs->blockdev.read(
+		nvs->blockdev, entry->sector, entry->offset + sizeof(struct nvs_record_header_t), value, entry->size);
+	if (ret)
+		return ret;
+
+	/* the sector we collect always fits in a fresh one, so a single spare sector is enough */
+	if (!nvs_active_fits(nvs, nvs_record_size(nvs, entry->size))) {
+		ret = nvs_sector_open(nvs);
+		if (ret)
+			return ret;
+	}
+
+	ret = nvs_program(nvs, entry->key, NVS_RECORD_VALUE, value, entry->size, &offset);
+	if (ret)
+		return ret;
+
+	/* no dead accounting, the old copy goes away with its sector */
+	entry->sector = nvs->active;
+	entry->offset = offset;
+
+	return 1;
+}
+
+u8 nvs_gc_pending(struct nvs_t *nvs)
+{
+	u16 oldest;
+
+	if (nvs->gc_sector != NVS_NO_SECTOR)
+		return 1;
+
+	if (nvs->free_count >= NVS_GC_FREE_SECTORS)
+		return 0;
+
+	/* don't shuffle sectors around if we can't reclaim anything */
+	oldest = nvs_oldest_sector(nvs);
+	return oldest != NVS_NO_SECTOR && nvs->sectors[oldest].dead;
+}
+
+/* moves a single record, or erases the collected sector */
+int nvs_gc_step(struct nvs_t *nvs)
+{
+	int ret;
+
+	if (nvs->gc_sector == NVS_NO_SECTOR) {
+		nvs->gc_sector = nvs_oldest_sector(nvs);
+		if (nvs->gc_sector == NVS_NO_SECTOR)
+			return 0;
+	}
+
+	ret = nvs_gc_move(nvs);
+	if (ret)
+		return ret < 0 ? ret : 0;
+
+	ret = nvs_sector_erase(nvs, nvs->gc_sector);
+	if (ret)
+		return ret;
+
+	nvs->gc_sector = NVS_NO_SECTOR;
+
+	return 0;
+}
+
+/* collects a whole sector */
+static int nvs_gc(struct nvs_t *nvs)
+{
+	int ret;
+
+	do {
+		ret = nvs_gc_step(nvs);
+		if (ret)
+			return ret;
+	} while (nvs->gc_sector != NVS_NO_SECTOR);
+
+	return 0;
+}
+
+static int nvs_reserve(struct nvs_t *nvs, u16 record_size)
+{
+	u16 collected = 0;
+	int ret;
+
+	while (!nvs_active_fits(nvs, record_size)) {
+		/* keep a spare sector for the collection to copy into */
+		if (nvs->free_count >= 2)
+			return nvs_sector_open(nvs);
+
+		/* went around the whole device without reclaiming enough */
+		if (collected++ > nvs->blockdev.block_count)
+			return -ENOSPC;
+
+		ret = nvs_gc(nvs);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* mount */
+
+static int nvs_replay(struct nvs_t *nvs, u16 sector)
+{
+	u8 value[NVS_MAX_VALUE_SIZE];
+	struct nvs_record_header_t header;
+	struct nvs_sector_t *state = &nvs->sectors[sector];
+	u16 block_size = nvs->blockdev.block_size;
+	u32 offset = nvs->header_size;
+	u16 record_size;
+	int ret;
+
+	while (offset + sizeof(header) <= block_size) {
+		ret = nvs->blockdev.read(nvs->blockdev, sector, offset, &header, sizeof(header));
+		if (ret)
+			return ret;
+
+		/* end of the log */
+		if (header.key == NVS_KEY_ERASED && header.size == 0xFFFF && header.type == 0xFF && header.crc == 0xFFFF)
+			break;
+
+		record_size = nvs_record_size(nvs, header.size);
+		if (header.size > NVS_MAX_VALUE_SIZE || offset + record_size > block_size)
+			goto torn;
+
+		ret = nvs->blockdev.read(nvs->blockdev, sector, offset + sizeof(header), value, header.size);
+		if (ret)
+			return ret;
+
+		if (header.key == NVS_KEY_ERASED || header.crc != nvs_record_crc(&header, value))
+			goto torn;
+
+		switch (header.type) {
+			case NVS_RECORD_VALUE:
+				ret = nvs_index_set(nvs, header.key, sector, offset, header.size);
+				if (ret)
+					return ret;
+				break;
+			case NVS_RECORD_DELETE:
+				nvs_index_remove(nvs, header.key);
+				state->dead += record_size;
+				break;
+			default:
+				goto torn;
+		}
+
+		offset += record_size;
+	}
+
+	state->used = offset;
+	return 0;
+
+torn:
+	/* nothing after a torn write can be trusted, close the sector */
+	state->used = block_size;
+	state->dead += block_size - offset;
+	return 0;
+}
+
+int nvs_mount(struct nvs_t *nvs, struct blockdev_hal_t blockdev)
+{
+	struct nvs_sector_header_t header;
+	u16 order[NVS_MAX_SECTORS];
+	u16 used_count = 0;
+	int ret;
+
+	memset(nvs, 0, sizeof(*nvs));
+	nvs->blockdev = blockdev;
+	nvs->active = NVS_NO_SECTOR;
+	nvs->gc_sector = NVS_NO_SECTOR;
+
+	/* we need a spare sector to collect into, and one to collect */
+	if (blockdev.block_count < 3 || blockdev.block_count > NVS_MAX_SECTORS)
+		return -EINVAL;
+	if (!blockdev.write_size || blockdev.write_size > NVS_MAX_WRITE_SIZE)
+		return -EINVAL;
+
+	nvs->header_size = nvs_align(nvs, sizeof(header));
+	if (blockdev.block_size < nvs->header_size + nvs_record_size(nvs, NVS_MAX_VALUE_SIZE))
+		return -EINVAL;
+
+	for (u16 sector = 0; sector < blockdev.block_count; sector++) {
+		ret = blockdev.read(blockdev, sector, 0, &header, sizeof(header));
+		if (ret)
+			return ret;
+
+		if (header.magic == NVS_SECTOR_MAGIC && header.sequence && header.sequence != 0xFFFFFFFF) {
+			/* keep them sorted by sequence, the log has to be replayed in order */
+			size_t i = used_count++;
+			for (; i > 0 && nvs->sectors[order[i - 1]].sequence > header.sequence; i--) order[i] = order[i - 1];
+			order[i] = sector;
+
+			nvs->sectors[sector].sequence = header.sequence;
+			nvs->sequence = max(nvs->sequence, header.sequence);
+		} else if (nvs_sector_erased(nvs, sector)) {
+			nvs->free_count++;
+		} else {
+			/* interrupted erase or sector open */
+			ret = nvs_sector_erase(nvs, sector);
+			if (ret)
+				return ret;
+		}
+	}
+
+	for (size_t i = 0; i < used_count; i++) {
+		ret = nvs_replay(nvs, order[i]);
+		if (ret)
+			return ret;
+	}
+
+	if (used_count)
+		nvs->active = order[used_count - 1];
+
+	return 0;
+}
+
+/* access */
+
+int nvs_read(struct nvs_t *nvs, u16 key, void *buffer, u16 size)
+{
+	size_t position;
+	struct nvs_entry_t *entry = nvs_index_lookup(nvs, key, &position);
+	int ret;
+
+	if (!entry)
+		return -ENOENT;
+
+	ret = nvs->blockdev.read(
+		nvs->blockdev, entry->sector, entry->offset + sizeof(struct nvs_record_header_t), buffer, min(size, entry->size));
+	if (ret)
+		return ret;
+
+	return entry->size;
+}
+
+int nvs_write(struct nvs_t *nvs, u16 key, const void *value, u16 size)
+{
+	u8 current[NVS_MAX_VALUE_SIZE];
+	size_t position;
+	struct nvs_entry_t *entry;
+	u16 offset;
+	int ret;
+
+	if (key == NVS_KEY_ERASED || size > NVS_MAX_VALUE_SIZE)
+		return -EINVAL;
+
+	entry = nvs_index_lookup(nvs, key, &position);
+	if (entry) {
+		/* nothing changed, save the flash */
+		if (entry->size == size && nvs_read(nvs, key, current, size) == size && !memcmp(current, value, size))
+			return 0;
+	} else if (nvs->index_count >= NVS_MAX_KEYS) {
+		return -ENOMEM;
+	}
+
+	ret = nvs_reserve(nvs, nvs_record_size(nvs, size));
+	if (ret)
+		return ret;
+
+	ret = nvs_program(nvs, key, NVS_RECORD_VALUE, value, size, &offset);
+	if (ret)
+		return ret;
+
+	return nvs_index_set(nvs, key, nvs->active, offset, size);
+}
+
+int nvs_delete(struct nvs_t *nvs, u16 key)
+{
+	size_t position;
+	u16 offset;
+	int ret;
+
+	if (!nvs_index_lookup(nvs, key, &position))
+		return -ENOENT;
+
+	ret = nvs_reserve(nvs, nvs_record_size(nvs, 0));
+	if (ret)
+		return ret;
+
+	ret = nvs_program(nvs, key, NVS_RECORD_DELETE, NULL, 0, &offset);
+	if (ret)
+		return ret;
+
+	nvs_index_remove(nvs, key);
+	nvs->sectors[nvs->active].dead += nvs_record_size(nvs, 0);
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/blockdev.h"
+#include "util/types.h"
+
+/*
+ * Log-structured key/value store
+ *
+ * Every blockdev block (an erase unit, 16 pages on the EEFC) is a sector. Values
+ * are never rewritten in place, each write appends a record to the active sector
+ * and the in-RAM index, rebuilt from the log at mount, points to the newest one.
+ * Deletes append a tombstone.
+ *
+ * Sectors are opened round-robin and the oldest one is always the one collected:
+ * its live records are copied to the head of the log and it gets erased. This
+ * spreads the erases over the whole device, static data included, and makes sure
+ * tombstones outlive every older record of their key. Collection runs one record
+ * at a time from nvs_gc_step, so it can be done in the background, writes only
+ * collect synchronously if we are running out of erased sectors.
+ *
+ * Records are CRC protected, a torn write closes its sector at the next mount.
+ */
+
+#define NVS_MAX_SECTORS	   16
+#define NVS_MAX_KEYS	   64
+#define NVS_MAX_VALUE_SIZE 256
+#define NVS_MAX_WRITE_SIZE 32
+
+/* nvs_gc_step has work to do if we have fewer erased sectors than this */
+#define NVS_GC_FREE_SECTORS 2
+
+#define NVS_NO_SECTOR 0xFFFF
+
+struct nvs_sector_t {
+	u32 sequence; /* 0 for erased sectors */
+	u16 used; /* end of the log */
+	u16 dead; /* overwritten and deleted records */
+};
+
+struct nvs_entry_t {
+	u16 key;
+	u16 sector;
+	u16 offset; /* record header */
+	u16 size; /* value size */
+};
+
+struct nvs_t {
+	struct blockdev_hal_t blockdev;
+	u16 header_size;
+	u16 active;
+	u16 gc_sector;
+	u16 free_count;
+	u32 sequence;
+	struct nvs_sector_t sectors[NVS_MAX_SECTORS];
+	/* sorted by key */
+	struct nvs_entry_t index[NVS_MAX_KEYS];
+	u16 index_count;
+};
+
+int nvs_mount(struct nvs_t *nvs, struct blockdev_hal_t blockdev);
+
+/* returns the value size (which may be bigger than the buffer), or -ENOENT */
+int nvs_read(struct nvs_t *nvs, u16 key, void *buffer, u16 size);
+int nvs_write(struct nvs_t *nvs, u16 key, const void *value, u16 size);
+int nvs_delete(struct nvs_t *nvs, u16 key);
+
+u8 nvs_gc_pending(struct nvs_t *nvs);
+int nvs_gc_step(struct nvs_t *nvs);
@@ -3,81 +3,170 @@
  * SPDX-FileCopyrightText: 2021 Filipe Laíns <lains@riseup.net>
  */
 
+#include <errno.h>
 #include <string.h>
 
+#include "util/crc.h"
 #include "util/data.h"
 #include "util/partition/partition.h"
 
-const struct partition_table_t *partition_table_read(void *addr)
+/* FNV-1a */
+static u32 partition_name_hash(const u8 *name, size_t len)
 {
-	const struct partition_table_t *table = (const struct partition_table_t *) addr;
+	u32 hash = 0x811C9DC5;
 
-	if (table->magic_word != PARTITION_TABLE_MW | PARTITION_TABLE_VERSION)
-		return NULL;
+	for (size_t i = 0; i < len; i++) {
+		hash ^= name[i];
+		hash *= 0x01000193;
+	}
 
-	if (table->num_entries == 0)
-		return NULL;
+	return hash;
+}
+
+static size_t partition_name_len(const struct partition_table_entry_t *entry)
+{
+	return strnlen((const char *) entry->name, PARTITION_NAME_SIZE);
+}
+
+static int partition_entry_check(const struct partition_table_t *table, size_t i)
+{
+	const struct partition_table_entry_t *entry = &table->entries[i];
+
+	if (entry->magic_word != PARTITION_TABLE_ENTRY_MW || entry->start_addr >= entry->end_addr)
+		return -EINVAL;
+
+	/* the name padding must be zeroes, otherwise hashing and comparing names would disagree */
+	for (size_t c = partition_name_len(entry); c < PARTITION_NAME_SIZE; c++)
+		if (entry->name[c])
+			return -EINVAL;
 
-	for (size_t i = 0; i < table->num_entries; i++) {
-		if (table->entries[i].magic_word != PARTITION_TABLE_ENTRY_MW)
-			return NULL;
+	for (size_t j = 0; j < i; j++) {
+		const struct partition_table_entry_t *other = &table->entries[j];
+
+		if (other->location == entry->location && entry->start_addr < other->end_addr &&
+		    other->start_addr < entry->end_addr)
+			return -EINVAL;
 	}
 
-	return table;
+	return 0;
 }
 
-const struct partition_table_entry_t *partition_from_index(const struct partition_table_t *table, uint8_t index)
+static int partition_index_name(struct partition_index_t *index, u8 entry)
 {
-	if (!table)
-		return NULL;
+	const struct partition_table_entry_t *e = &index->table->entries[entry];
+	size_t len = partition_name_len(e);
+	u32 slot;
 
-	if (index >= table->num_entries)
-		return NULL;
+	/* nameless partitions can only be looked up in other ways */
+	if (!len)
+		return 0;
 
-	if (table->entries[index].magic_word != PARTITION_TABLE_ENTRY_MW)
-		return NULL;
+	index->name_hash[entry] = partition_name_hash(e->name, len);
+
+	for (slot = index->name_hash[entry];; slot++) {
+		u8 *ref = &index->by_name[slot % PARTITION_INDEX_NAME_SLOTS];
+
+		if (!*ref) {
+			*ref = entry + 1;
+			return 0;
+		}
 
-	return &table->entries[index];
+		if (index->name_hash[*ref - 1] == index->name_hash[entry] &&
+		    !memcmp(index->table->entries[*ref - 1].name, e->name, PARTITION_NAME_SIZE))
+			return -EINVAL;
+	}
 }
 
-const struct partition_table_entry_t *partition_from_type(const struct partition_table_t *table, uint8_t type)
+int partition_table_read(struct partition_index_t *index, const void *addr, size_t size)
 {
-	if (!table)
-		return NULL;
+	const struct partition_table_t *table = addr;
+	int ret;
+
+	memset(index, 0, sizeof(*index));
+
+	if (size < sizeof(*table) || (table->magic_word & ~0xFFu) != PARTITION_TABLE_MW)
+		return -EBADMSG;
+
+	if (table->magic_word != (PARTITION_TABLE_MW | PARTITION_TABLE_VERSION))
+		return -EPROTONOSUPPORT;
 
-	for (size_t i = 0; i < table->num_entries; i++) {
-		if (table->entries[i].type == type)
-			return &table->entries[i];
+	if (table->num_entries == 0 || table->num_entries > PARTITION_TABLE_MAX_ENTRIES ||
+	    sizeof(*table) + table->num_entries * sizeof(table->entries[0]) > size)
+		return -EINVAL;
+
+	if (crc16_ccitt(CRC16_CCITT_INIT, &table->num_entries, 1 + table->num_entries * sizeof(table->entries[0])) !=
+	    table->crc)
+		return -EBADMSG;
+
+	for (size_t i = 0; i < table->num_entries; i++)
+		if ((ret = partition_entry_check(table, i)) < 0)
+			return ret;
+
+	index->table = table;
+
+	for (u8 i = 0; i < table->num_entries; i++) {
+		const struct partition_table_entry_t *entry = &table->entries[i];
+
+		if (index->by_id[entry->id] || (ret = partition_index_name(index, i)) < 0) {
+			memset(index, 0, sizeof(*index));
+			return -EINVAL;
+		}
+
+		index->by_id[entry->id] = i + 1;
+		if (!index->by_type[entry->type])
+			index->by_type[entry->type] = i + 1;
 	}
 
-	return NULL;
+	return 0;
 }
 
-const struct partition_table_entry_t *partition_from_id(const struct partition_table_t *table, uint8_t id)
+static const struct partition_table_entry_t *partition_ref(const struct partition_index_t *index, u8 ref)
 {
-	if (!table)
+	return ref ? &index->table->entries[ref - 1] : NULL;
+}
+
+const struct partition_table_entry_t *partition_from_index(const struct partition_index_t *index, u8 entry)
+{
+	if (!index->table || entry >= index->table->num_entries)
 		return NULL;
 
-	for (size_t i = 0; i < table->num_entries; i++) {
-		if (table->entries[i].id == id)
-			return &table->entries[i];
-	}
+	return &index->table->entries[entry];
+}
 
-	return NULL;
+const struct partition_table_entry_t *partition_from_type(const struct partition_index_t *index, u8 type)
+{
+	if (!index->table)
+		return NULL;
+
+	return partition_ref(index, index->by_type[type]);
 }
 
-const struct partition_table_entry_t *partition_from_name(const struct partition_table_t *table, char *name, uint8_t name_len)
+const struct partition_table_entry_t *partition_from_id(const struct partition_index_t *index, u8 id)
 {
-	if (!table)
+	if (!index->table)
+		return NULL;
+
+	return partition_ref(index, index->by_id[id]);
+}
+
+const struct partition_table_entry_t *partition_from_name(const struct partition_index_t *index,
+							  const char *name,
+							  u8 name_len)
+{
+	size_t len = strnlen(name, name_len);
+	u32 hash;
+	u8 ref;
+
+	if (!index->table || !len || len > PARTITION_NAME_SIZE)
 		return NULL;
 
-	char name_buf[16] = {};
+	hash = partition_name_hash((const u8 *) name, len);
 
-	memcpy(name_buf, name, min(name_len, 16));
+	for (u32 slot = hash; (ref = index->by_name[slot % PARTITION_INDEX_NAME_SLOTS]); slot++) {
+		const struct partition_table_entry_t *entry = &index->table->entries[ref - 1];
 
-	for (size_t i = 0; i < table->num_entries; i++) {
-		if (strncmp(table->entries[i].name, name_buf, 16) == 0)
-			return &table->entries[i];
+		if (index->name_hash[ref - 1] == hash && partition_name_len(entry) == len && !memcmp(entry->name, name, len))
+			return entry;
 	}
 
 	return NULL;
@@ -8,7 +8,7 @@
 #include "util/types.h"
 
 /* version */
-#define PARTITION_TABLE_VERSION 0x00
+#define PARTITION_TABLE_VERSION 0x01
 
 /* magic words */
 #define PARTITION_TABLE_MW	 0x7AB1E00
@@ -24,27 +24,54 @@
 #define PARTITION_TYPE_BLOB 1
 #define PARTITION_TYPE_NVS  2
 
+#define PARTITION_NAME_SIZE	    16
+#define PARTITION_TABLE_MAX_ENTRIES 16
+#define PARTITION_INDEX_NAME_SLOTS  32 /* power of two, twice the entries keeps the probe sequences short */
+
 struct partition_table_entry_t {
 	u8 magic_word;
 	u8 location;
 	u8 type;
 	u8 id;
 	u32 start_addr;
-	u32 end_addr;
-	u8 name[16];
+	u32 end_addr; /* exclusive */
+	u8 name[PARTITION_NAME_SIZE]; /* zero padded, not terminated if it uses all 16 bytes */
 } __attribute__((__packed__));
 
 struct partition_table_t {
-	u32 magic_word;
-	u8 reserved0;
-	u8 reserved1;
-	u8 reserved2;
+	u32 magic_word; /* PARTITION_TABLE_MW | PARTITION_TABLE_VERSION */
+	u16 crc; /* CRC-16/CCITT-FALSE of num_entries and the entries */
+	u8 reserved;
 	u8 num_entries;
 	struct partition_table_entry_t entries[];
 } __attribute__((__packed__));
 
-const struct partition_table_t *partition_table_read(void *addr);
-const struct partition_table_entry_t *partition_from_index(const struct partition_table_t *table, uint8_t index);
-const struct partition_table_entry_t *partition_from_type(const struct partition_table_t *table, uint8_t type);
-const struct partition_table_entry_t *partition_from_id(const struct partition_table_t *table, uint8_t id);
-const struct partition_table_entry_t *partition_from_name(const struct partition_table_t *table, char *name, uint8_t name_len);
+#define PARTITION_TABLE_MAX_SIZE \
+	(sizeof(struct partition_table_t) + PARTITION_TABLE_MAX_ENTRIES * sizeof(struct partition_table_entry_t))
+
+/*
+ * The table is validated once, at boot, and indexed so the lookups don't have to
+ * scan it. Entry references are stored as index + 1, 0 means there is no entry.
+ */
+struct partition_index_t {
+	const struct partition_table_t *table;
+	u8 by_id[256];
+	u8 by_type[256]; /* first entry of each type */
+	u8 by_name[PARTITION_INDEX_NAME_SLOTS]; /* open addressing on the name hash */
+	u32 name_hash[PARTITION_TABLE_MAX_ENTRIES];
+};
+
+/*
+ * Reads at most size bytes, returns -EBADMSG if there is no valid table (bad magic or CRC),
+ * -EPROTONOSUPPORT for other table versions and -EINVAL for inconsistent tables (too many
+ * entries, bad entries, duplicated ids or names, overlapping partitions)
+ *
+ * The lookups on an index that failed to load return NULL.
+ */
+int partition_table_read(struct partition_index_t *index, const void *addr, size_t size);
+const struct partition_table_entry_t *partition_from_index(const struct partition_index_t *index, u8 entry);
+const struct partition_table_entry_t *partition_from_type(const struct partition_index_t *index, u8 type);
+const struct partition_table_entry_t *partition_from_id(const struct partition_index_t *index, u8 id);
+const struct partition_table_entry_t *partition_from_name(const struct partition_index_t *index,
+							  const char *name,
+							  u8 name_len);
@@ -0,0 +1,154 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "util/profiles/profiles.h"
+
+#define PROFILES_DIRTY_SELECTED (1 << PROFILE_COUNT)
+
+static void profiles_flush_timer(void *data)
+{
+	struct profiles_t *profiles = data;
+
+	/* try again later, the NVS may need to collect a sector first */
+	if (profiles_flush(profiles) < 0)
+		event_timer_start(profiles->loop, &profiles->flush_timer, PROFILES_FLUSH_DELAY_MS, 0);
+}
+
+static void profiles_schedule_flush(struct profiles_t *profiles)
+{
+	/* don't push the deadline back, a host that keeps changing things still gets them saved */
+	if (profiles->nvs && profiles->loop && !event_timer_active(&profiles->flush_timer))
+		event_timer_start(profiles->loop, &profiles->flush_timer, PROFILES_FLUSH_DELAY_MS, 0);
+}
+
+static void profiles_load(struct profiles_t *profiles)
+{
+	struct profile_t profile;
+	u8 selected;
+
+	for (u8 i = 0; i < PROFILE_COUNT; i++)
+		if (nvs_read(profiles->nvs, PROFILES_NVS_KEY + i, &profile, sizeof(profile)) == sizeof(profile) &&
+		    profile_is_valid(&profile))
+			profiles->profiles[i] = profile;
+
+	if (nvs_read(profiles->nvs, PROFILES_NVS_KEY_ACTIVE, &selected, sizeof(selected)) == sizeof(selected) &&
+	    selected < PROFILE_COUNT)
+		profiles->selected = selected;
+}
+
+void profiles_init(struct profiles_t *profiles, const struct profile_t *defaults, struct nvs_t *nvs, struct event_loop_t *loop)
+{
+	memset(profiles, 0, sizeof(*profiles));
+
+	for (u8 i = 0; i < PROFILE_COUNT; i++) profiles->profiles[i] = *defaults;
+
+	profiles->nvs = nvs;
+	profiles->loop = loop;
+	event_timer_init(&profiles->flush_timer, profiles_flush_timer, profiles);
+
+	if (nvs)
+		profiles_load(profiles);
+
+	/* the first profiles_apply pushes the settings to the hardware */
+	profiles->changed = 1;
+}
+
+void profiles_attach_apply_callback(
+	struct profiles_t *profiles, void (*callback)(const struct profile_t *profile, void *data), void *data)
+{
+	profiles->apply_callback = callback;
+	profiles->apply_data = data;
+}
+
+u8 profile_is_valid(const struct profile_t *profile)
+{
+	return profile->cpi != 0 && profile->polling_rate != 0 && profile->polling_rate <= PROFILE_POLLING_RATE_MAX &&
+	       profile->led.mode < PROFILE_LED_MODE_COUNT;
+}
+
+int profiles_select(struct profiles_t *profiles, u8 index)
+{
+	if (index >= PROFILE_COUNT)
+		return -EINVAL;
+
+	if (index == profiles->selected)
+		return 0;
+
+	profiles->selected = index;
+	profiles->changed = 1;
+	profiles->dirty |= PROFILES_DIRTY_SELECTED;
+	profiles_schedule_flush(profiles);
+
+	return 0;
+}
+
+int profiles_update(struct profiles_t *profiles, u8 index, const struct profile_t *profile)
+{
+	if (index >= PROFILE_COUNT || !profile_is_valid(profile))
+		return -EINVAL;
+
+	if (!memcmp(&profiles->profiles[index], profile, sizeof(*profile)))
+		return 0;
+
+	profiles->profiles[index] = *profile;
+	if (index == profiles->selected)
+		profiles->changed = 1;
+	profiles->dirty |= 1 << index;
+	profiles_schedule_flush(profiles);
+
+	return 0;
+}
+
+u8 profiles_apply(struct profiles_t *profiles)
+{
+	if (!profiles->changed)
+		return 0;
+
+	profiles->changed = 0;
+	profiles->active_index = profiles->selected;
+	profiles->active = profiles->profiles[profiles->selected];
+
+	if (profiles->apply_callback)
+		profiles->apply_callback(&profiles->active, profiles->apply_data);
+
+	return 1;
+}
+
+const struct profile_t *profiles_active(const struct profiles_t *profiles)
+{
+	return &profiles->active;
+}
+
+int profiles_flush(struct profiles_t *profiles)
+{
+	int ret;
+
+	if (!profiles->nvs)
+		return 0;
+
+	event_timer_stop(&profiles->flush_timer);
+
+	for (u8 i = 0; i < PROFILE_COUNT; i++) {
+		if (!(profiles->dirty & (1 << i)))
+			continue;
+
+		ret = nvs_write(profiles->nvs, PROFILES_NVS_KEY + i, &profiles->profiles[i], sizeof(profiles->profiles[i]));
+		if (ret < 0)
+			return ret;
+		profiles->dirty &= ~(1 << i);
+	}
+
+	if (profiles->dirty & PROFILES_DIRTY_SELECTED) {
+		ret = nvs_write(profiles->nvs, PROFILES_NVS_KEY_ACTIVE, &profiles->selected, sizeof(profiles->selected));
+		if (ret < 0)
+			return ret;
+		profiles->dirty &= ~PROFILES_DIRTY_SELECTED;
+	}
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "util/event_loop/event_loop.h"
+#include "util/nvs/nvs.h"
+#include "util/types.h"
+
+/*
+ * Device profiles
+ *
+ * There are two copies of the settings. The host edits the profile table through
+ * the protocol, and the report path only ever reads the active copy in RAM, which
+ * is refreshed by profiles_apply. Calling that between reports means a report is
+ * never built with half of a profile switch, and flash is never touched from the
+ * hot path.
+ *
+ * Changes are not written right away, they mark the profile dirty and arm a one
+ * shot timer, everything that changed in the meantime goes out in a single flush.
+ * Hosts usually set a bunch of settings in a row, this saves us a NVS write (and
+ * eventually an erase) per command.
+ */
+
+#define PROFILE_COUNT	     4
+#define PROFILE_BUTTON_COUNT 8
+
+#define PROFILE_POLLING_RATE_MAX 8000
+
+/* time between the first change and the flash write */
+#define PROFILES_FLUSH_DELAY_MS 1000
+
+/* NVS keys, a record per profile plus the selected profile index */
+#define PROFILES_NVS_KEY	0x0100
+#define PROFILES_NVS_KEY_ACTIVE (PROFILES_NVS_KEY + PROFILE_COUNT)
+
+enum profile_led_mode {
+	PROFILE_LED_OFF,
+	PROFILE_LED_STATIC,
+	PROFILE_LED_BREATHING,
+	PROFILE_LED_CYCLE,
+	PROFILE_LED_MODE_COUNT
+};
+
+struct profile_led_t {
+	u8 mode;
+	u8 brightness;
+	u8 red;
+	u8 green;
+	u8 blue;
+} __attribute__((__packed__));
+
+/* this is also the wire and the flash format */
+struct profile_t {
+	u16 cpi;
+	u16 polling_rate; /* Hz */
+	u8 buttons[PROFILE_BUTTON_COUNT]; /* reported button for each physical button, 0 disables it */
+	struct profile_led_t led;
+} __attribute__((__packed__));
+
+struct profiles_t {
+	/* host view */
+	struct profile_t profiles[PROFILE_COUNT];
+	u8 selected;
+	/* report path view, only updated by profiles_apply */
+	struct profile_t active;
+	u8 active_index;
+	u8 changed;
+	/* not in flash yet, bit PROFILE_COUNT is the selected index */
+	u8 dirty;
+	struct nvs_t *nvs;
+	struct event_loop_t *loop;
+	struct event_timer_t flush_timer;
+	void (*apply_callback)(const struct profile_t *profile, void *data);
+	void *apply_data;
+};
+
+_Static_assert(PROFILE_COUNT < 8, "the dirty mask does not fit");
+
+/* nvs and loop may be NULL, for RAM only profiles and explicit flushes respectively */
+void profiles_init(struct profiles_t *profiles, const struct profile_t *defaults, struct nvs_t *nvs, struct event_loop_t *loop);
+void profiles_attach_apply_callback(
+	struct profiles_t *profiles, void (*callback)(const struct profile_t *profile, void *data), void *data);
+
+u8 profile_is_valid(const struct profile_t *profile);
+
+int profiles_select(struct profiles_t *profiles, u8 index);
+int profiles_update(struct profiles_t *profiles, u8 index, const struct profile_t *profile);
+
+/* report path, returns true if the active profile changed */
+u8 profiles_apply(struct profiles_t *profiles);
+const struct profile_t *profiles_active(const struct profiles_t *profiles);
+
+/* write the dirty profiles now */
+int profiles_flush(struct profiles_t *profiles);
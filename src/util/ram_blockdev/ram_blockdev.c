@@ -0,0 +1,116 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "util/data.h"
+#include "util/ram_blockdev/ram_blockdev.h"
+
+static u8 *ram_blockdev_address(struct ram_blockdev_t *ram, u16 block, u16 offset, u16 size)
+{
+	if (block >= ram->block_count || (u32) offset + size > ram->block_size)
+		return NULL;
+
+	return ram->data + (u32) block * ram->block_size + offset;
+}
+
+static void ram_blockdev_busy(struct ram_blockdev_t *ram, u32 us)
+{
+	if (!us)
+		return;
+
+	ram->busy_us += us;
+	if (ram->ticks.delay_us)
+		ram->ticks.delay_us(us);
+}
+
+s8 ram_blockdev_read(struct blockdev_hal_t mem_block, u16 block, u16 offset, void *buffer, u16 size)
+{
+	struct ram_blockdev_t *ram = mem_block.drv_data;
+	u8 *address = ram_blockdev_address(ram, block, offset, size);
+
+	if (!address)
+		return -EINVAL;
+
+	memcpy(buffer, address, size);
+	ram->read_bytes += size;
+
+	return 0;
+}
+
+s8 ram_blockdev_write(struct blockdev_hal_t mem_block, u16 block, u16 offset, void *buffer, u16 size)
+{
+	struct ram_blockdev_t *ram = mem_block.drv_data;
+	u8 *address = ram_blockdev_address(ram, block, offset, size);
+	const u8 *data = buffer;
+	u16 count = size;
+	u8 overwrite = 0;
+
+	if (!address || offset % ram->write_size || size % ram->write_size)
+		return -EINVAL;
+
+	if (ram->power_loss) {
+		count = min(count, ram->power_loss_bytes);
+		ram->power_loss_bytes -= count;
+	}
+
+	for (u16 i = 0; i < count; i++) {
+		overwrite |= data[i] & ~address[i];
+		address[i] &= data[i];
+	}
+
+	ram->program_count++;
+	ram->program_bytes += count;
+	if (overwrite)
+		ram->overwrite_count++;
+	ram_blockdev_busy(ram, ram->program_latency_us * ((count + ram->write_size - 1) / ram->write_size));
+
+	return count == size ? 0 : -EIO;
+}
+
+s8 ram_blockdev_erase(struct blockdev_hal_t mem_block, u16 block)
+{
+	struct ram_blockdev_t *ram = mem_block.drv_data;
+	u8 *address = ram_blockdev_address(ram, block, 0, ram->block_size);
+
+	if (!address)
+		return -EINVAL;
+
+	if (ram->power_loss && !ram->power_loss_bytes)
+		return -EIO;
+
+	memset(address, 0xFF, ram->block_size);
+	if (ram->erase_count)
+		ram->erase_count[block]++;
+	ram_blockdev_busy(ram, ram->erase_latency_us);
+
+	return 0;
+}
+
+s8 ram_blockdev_sync(struct blockdev_hal_t mem_block)
+{
+	(void) mem_block;
+
+	return 0;
+}
+
+struct blockdev_hal_t blockdev_hal_init_ram(struct ram_blockdev_t *ram)
+{
+	struct blockdev_hal_t hal = {
+		.read_size = 1,
+		.write_size = ram->write_size,
+		.block_size = ram->block_size,
+		.block_count = ram->block_count,
+
+		.read = ram_blockdev_read,
+		.write = ram_blockdev_write,
+		.erase = ram_blockdev_erase,
+		.sync = ram_blockdev_sync,
+
+		.drv_data = ram,
+	};
+	return hal;
+}
@@ -0,0 +1,45 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "hal/blockdev.h"
+#include "hal/ticks.h"
+#include "util/types.h"
+
+/*
+ * NOR flash emulated in memory
+ *
+ * Erase sets a whole block to 0xFF, programming can only clear bits (the new data
+ * is ANDed in) and must be aligned to write_size, like on the real thing. The
+ * memory is provided by the caller, it can be a plain buffer or a mmaped file.
+ *
+ * Erase and program latencies are simulated with the delay_us callback of the
+ * ticks HAL, if any, and always accounted in busy_us, so storage code can be
+ * benchmarked against the timings of the flash it will run on.
+ */
+
+struct ram_blockdev_t {
+	u8 *data;
+	u16 block_size;
+	u16 block_count;
+	u16 write_size;
+	/* simulated timings */
+	struct ticks_hal_t ticks;
+	u32 erase_latency_us; /* per block */
+	u32 program_latency_us; /* per write_size unit */
+	/* statistics */
+	u32 *erase_count; /* per block, may be NULL */
+	u32 program_count;
+	u32 program_bytes;
+	u32 overwrite_count; /* programs that tried to set bits, always a bug on NOR */
+	u64 read_bytes;
+	u64 busy_us;
+	/* simulated power loss, programs stop after this many more bytes and the device goes away */
+	u8 power_loss;
+	u32 power_loss_bytes;
+};
+
+struct blockdev_hal_t blockdev_hal_init_ram(struct ram_blockdev_t *ram);
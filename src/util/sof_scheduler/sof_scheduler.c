@@ -0,0 +1,109 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <string.h>
+
+#include "util/data.h"
+#include "util/sof_scheduler/sof_scheduler.h"
+
+/* the frame length follows the link speed, which is only known after the bus reset */
+void sof_scheduler_set_period(struct sof_scheduler_t *scheduler, u32 period_us, u32 lead_us)
+{
+	scheduler->period_us = period_us;
+	scheduler->lead_us = min(lead_us, period_us);
+}
+
+void sof_scheduler_init(struct sof_scheduler_t *scheduler, u32 period_us, u32 lead_us)
+{
+	memset(scheduler, 0, sizeof(*scheduler));
+
+	sof_scheduler_set_period(scheduler, period_us, lead_us);
+
+	sof_scheduler_reset_stats(scheduler);
+}
+
+void sof_scheduler_sof(struct sof_scheduler_t *scheduler, u32 now_us)
+{
+	/* the frame that just ended was sampled, that sample is what the host gets now */
+	if (scheduler->sof_count && scheduler->sample_frame == scheduler->sof_count) {
+		u32 latency = now_us - scheduler->sample_time;
+
+		scheduler->samples++;
+		scheduler->latency_sum += latency;
+		scheduler->latency_min = min(scheduler->latency_min, latency);
+		scheduler->latency_max = max(scheduler->latency_max, latency);
+	}
+
+	scheduler->sof_time = now_us;
+	scheduler->sof_count++;
+}
+
+u8 sof_scheduler_poll(struct sof_scheduler_t *scheduler, u32 now_us)
+{
+	u32 sof_count, sof_time, offset;
+
+	/* the SOF interrupt may update the frame while we read it */
+	do {
+		sof_count = scheduler->sof_count;
+		sof_time = scheduler->sof_time;
+	} while (sof_count != scheduler->sof_count);
+
+	if (!sof_count || scheduler->sample_frame == sof_count)
+		return 0;
+
+	offset = now_us - sof_time;
+	if (offset < scheduler->period_us - scheduler->lead_us)
+		return 0;
+
+	scheduler->sample_time = now_us;
+	scheduler->sample_frame = sof_count;
+
+	scheduler->offset_min = min(scheduler->offset_min, offset);
+	scheduler->offset_max = max(scheduler->offset_max, offset);
+
+	return 1;
+}
+
+/* microsecs until the sampling point of the current frame, 0 if it has been reached */
+u32 sof_scheduler_sample_delay(const struct sof_scheduler_t *scheduler, u32 now_us)
+{
+	u32 offset = now_us - scheduler->sof_time;
+	u32 sample_offset = scheduler->period_us - scheduler->lead_us;
+
+	if (offset >= sample_offset)
+		return 0;
+
+	return sample_offset - offset;
+}
+
+/* the current frame has not been sampled yet */
+u8 sof_scheduler_waiting(const struct sof_scheduler_t *scheduler)
+{
+	return scheduler->sof_count && scheduler->sample_frame != scheduler->sof_count;
+}
+
+void sof_scheduler_get_stats(const struct sof_scheduler_t *scheduler, struct sof_stats_t *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+
+	if (!scheduler->samples)
+		return;
+
+	stats->samples = scheduler->samples;
+	stats->latency_min_us = scheduler->latency_min;
+	stats->latency_avg_us = scheduler->latency_sum / scheduler->samples;
+	stats->latency_max_us = scheduler->latency_max;
+	stats->jitter_us = scheduler->offset_max - scheduler->offset_min;
+}
+
+void sof_scheduler_reset_stats(struct sof_scheduler_t *scheduler)
+{
+	scheduler->samples = 0;
+	scheduler->latency_sum = 0;
+	scheduler->latency_min = UINT32_MAX;
+	scheduler->latency_max = 0;
+	scheduler->offset_min = UINT32_MAX;
+	scheduler->offset_max = 0;
+}
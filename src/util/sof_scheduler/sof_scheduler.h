@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "util/types.h"
+
+/*
+ * Start of frame synchronised sampling
+ *
+ * sof_scheduler_sof is called on every USB SOF (usually from the USB interrupt),
+ * and sof_scheduler_poll from the main loop. poll returns true once per frame,
+ * lead_us before the next SOF, which is our estimate of when the host sends the
+ * next IN token. Sampling there means the report always carries fresh data.
+ * sof_scheduler_sample_delay tells how far away that point is, so a one shot
+ * timer can wake the main loop right on time instead of polling for it.
+ */
+
+struct sof_stats_t {
+	u32 samples;
+	/* age of the sample when the next frame starts */
+	u32 latency_min_us;
+	u32 latency_avg_us;
+	u32 latency_max_us;
+	/* spread of the sampling point relative to the SOF */
+	u32 jitter_us;
+} __attribute__((packed));
+
+struct sof_scheduler_t {
+	u32 period_us;
+	u32 lead_us;
+	/* updated from interrupt context */
+	volatile u32 sof_time;
+	volatile u32 sof_count;
+	/* updated from the main loop */
+	volatile u32 sample_time;
+	volatile u32 sample_frame;
+	/* statistics */
+	u32 samples;
+	u32 latency_min;
+	u32 latency_max;
+	u64 latency_sum;
+	u32 offset_min;
+	u32 offset_max;
+};
+
+void sof_scheduler_init(struct sof_scheduler_t *scheduler, u32 period_us, u32 lead_us);
+void sof_scheduler_set_period(struct sof_scheduler_t *scheduler, u32 period_us, u32 lead_us);
+void sof_scheduler_sof(struct sof_scheduler_t *scheduler, u32 now_us);
+u8 sof_scheduler_poll(struct sof_scheduler_t *scheduler, u32 now_us);
+u8 sof_scheduler_waiting(const struct sof_scheduler_t *scheduler);
+u32 sof_scheduler_sample_delay(const struct sof_scheduler_t *scheduler, u32 now_us);
+void sof_scheduler_get_stats(const struct sof_scheduler_t *scheduler, struct sof_stats_t *stats);
+void sof_scheduler_reset_stats(struct sof_scheduler_t *scheduler);
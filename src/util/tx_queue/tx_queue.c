@@ -0,0 +1,91 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "util/tx_queue/tx_queue.h"
+
+_Static_assert((TX_QUEUE_SIZE & (TX_QUEUE_SIZE - 1)) == 0, "TX_QUEUE_SIZE must be a power of 2");
+_Static_assert(TX_QUEUE_ENTRY_SIZE <= UINT8_MAX, "entry sizes are stored in a byte");
+
+void tx_queue_init(struct tx_queue_t *queue)
+{
+	memset(queue, 0, sizeof(*queue));
+}
+
+u8 tx_queue_space(const struct tx_queue_t *queue)
+{
+	u32 head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+	return TX_QUEUE_SIZE - (queue->tail - head);
+}
+
+u8 *tx_queue_reserve(struct tx_queue_t *queue)
+{
+	if (!tx_queue_space(queue)) {
+		queue->overflows++;
+		return NULL;
+	}
+
+	return queue->entries[queue->tail % TX_QUEUE_SIZE];
+}
+
+void tx_queue_commit(struct tx_queue_t *queue, size_t size)
+{
+	u8 used;
+
+	queue->sizes[queue->tail % TX_QUEUE_SIZE] = size;
+	/* the entry has to be visible before the consumer sees the new tail */
+	__atomic_store_n(&queue->tail, queue->tail + 1, __ATOMIC_RELEASE);
+
+	queue->queued++;
+	used = TX_QUEUE_SIZE - tx_queue_space(queue);
+	if (used > queue->high_water)
+		queue->high_water = used;
+}
+
+int tx_queue_push(struct tx_queue_t *queue, const u8 *data, size_t size)
+{
+	u8 *entry;
+
+	if (size > TX_QUEUE_ENTRY_SIZE)
+		return -EMSGSIZE;
+
+	entry = tx_queue_reserve(queue);
+	if (!entry)
+		return -ENOBUFS;
+
+	memcpy(entry, data, size);
+	tx_queue_commit(queue, size);
+
+	return 0;
+}
+
+const u8 *tx_queue_peek(const struct tx_queue_t *queue, size_t *size)
+{
+	u32 tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+	if (queue->head == tail)
+		return NULL;
+
+	*size = queue->sizes[queue->head % TX_QUEUE_SIZE];
+	return queue->entries[queue->head % TX_QUEUE_SIZE];
+}
+
+void tx_queue_pop(struct tx_queue_t *queue)
+{
+	queue->sent++;
+	/* we are done with the entry, the producer may reuse it once it sees the new head */
+	__atomic_store_n(&queue->head, queue->head + 1, __ATOMIC_RELEASE);
+}
+
+void tx_queue_get_stats(const struct tx_queue_t *queue, struct tx_queue_stats_t *stats)
+{
+	stats->queued = __atomic_load_n(&queue->queued, __ATOMIC_RELAXED);
+	stats->sent = __atomic_load_n(&queue->sent, __ATOMIC_RELAXED);
+	stats->overflows = __atomic_load_n(&queue->overflows, __ATOMIC_RELAXED);
+	stats->high_water = __atomic_load_n(&queue->high_water, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,59 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * SPDX-FileCopyrightText: 2026 openinput contributors
+ */
+
+#pragma once
+
+#include "util/types.h"
+
+/*
+ * Single producer, single consumer report queue
+ *
+ * Sits between the code that generates reports (the producer, eg. the protocol
+ * handlers) and the endpoint that sends them (the consumer, eg. the IN complete
+ * callback). They may run in different contexts and interrupt each other, so
+ * there are no locks: the producer only writes tail and the consumer only writes
+ * head. Both are free running counters, published with release stores after the
+ * entry they cover was written (or read), and read with acquire loads.
+ *
+ * Producers reserve an entry, fill it in place and commit it. When the queue is
+ * full the reservation fails and is counted as an overflow, tx_queue_space lets
+ * the producer see that coming and push back on whoever sends it work.
+ */
+
+#define TX_QUEUE_SIZE	    16 /* must be a power of 2 */
+#define TX_QUEUE_ENTRY_SIZE 64 /* a full speed interrupt packet */
+
+struct tx_queue_stats_t {
+	u32 queued;
+	u32 sent;
+	u32 overflows; /* reports that didn't fit */
+	u32 high_water; /* most entries in use at once */
+};
+
+struct tx_queue_t {
+	u8 entries[TX_QUEUE_SIZE][TX_QUEUE_ENTRY_SIZE];
+	u8 sizes[TX_QUEUE_SIZE];
+	u32 head; /* consumer */
+	u32 tail; /* producer */
+	/* each counter has a single writer too */
+	u32 queued;
+	u32 overflows;
+	u32 high_water;
+	u32 sent;
+};
+
+void tx_queue_init(struct tx_queue_t *queue);
+
+/* producer */
+u8 *tx_queue_reserve(struct tx_queue_t *queue); /* NULL if the queue is full */
+void tx_queue_commit(struct tx_queue_t *queue, size_t size);
+int tx_queue_push(struct tx_queue_t *queue, const u8 *data, size_t size);
+u8 tx_queue_space(const struct tx_queue_t *queue);
+
+/* consumer */
+const u8 *tx_queue_peek(const struct tx_queue_t *queue, size_t *size); /* NULL if the queue is empty */
+void tx_queue_pop(struct tx_queue_t *queue);
+
+void tx_queue_get_stats(const struct tx_queue_t *queue, struct tx_queue_stats_t *stats);
@@ -45,3 +45,115 @@ static const u8 desc_device_qualifier[] = {
 	0x00,				/* RESERVED */
 	/* clang-format on */
 };
+
+/* mouse endpoint polling rate (Hz), up to 8000 on high speed and 1000 on full speed */
+#ifndef USB_POLLING_RATE
+#define USB_POLLING_RATE 1000
+#endif
+
+/*
+ * bInterval of an interrupt endpoint polled at rate (Hz), rounded to the closest interval that is at least as fast
+ * full speed counts 1ms frames (1000Hz max), high speed counts 2^(bInterval-1) 125us microframes (8000Hz max)
+ */
+#define USB_FS_INTERVAL(rate) ((rate) >= 1000 ? 1 : (rate) <= 3 ? 255 : 1000 / (rate))
+#define USB_HS_INTERVAL(rate) \
+	((rate) > 4000 ? 1 :  \
+	 (rate) > 2000 ? 2 :  \
+	 (rate) > 1000 ? 3 :  \
+	 (rate) > 500 ? 4 :   \
+	 (rate) > 250 ? 5 :   \
+	 (rate) > 125 ? 6 :   \
+	 (rate) > 62 ? 7 :    \
+	 (rate) > 31 ? 8 :    \
+	 (rate) > 15 ? 9 :    \
+	 (rate) > 7 ? 10 :    \
+	 (rate) > 3 ? 11 :    \
+	 (rate) > 1 ? 12 :    \
+	 13)
+
+/* the interval is never slower than the rate asked for */
+#define USB_FS_INTERVAL_RATE(rate) (1000 / USB_FS_INTERVAL(rate))
+#define USB_HS_INTERVAL_RATE(rate) (8000 >> (USB_HS_INTERVAL(rate) - 1))
+
+_Static_assert(USB_POLLING_RATE >= 1 && USB_POLLING_RATE <= 8000, "invalid USB polling rate");
+_Static_assert(USB_FS_INTERVAL_RATE(USB_POLLING_RATE) >= (USB_POLLING_RATE > 1000 ? 1000 : USB_POLLING_RATE),
+	       "full speed polling interval is slower than USB_POLLING_RATE");
+_Static_assert(USB_HS_INTERVAL_RATE(USB_POLLING_RATE) >= USB_POLLING_RATE,
+	       "high speed polling interval is slower than USB_POLLING_RATE");
+_Static_assert(USB_HS_INTERVAL_RATE(100) == 125 && USB_HS_INTERVAL_RATE(63) == 125 && USB_HS_INTERVAL_RATE(62) == 62,
+	       "high speed polling interval rounding");
+
+/* Configuration descriptor with the openinput protocol and mouse interfaces */
+#define USB_DESC_CONFIGURATION_OI_MOUSE(oi_rdesc_size, mouse_rdesc_size, oi_interval, mouse_interval) \
+	{                                                                                             \
+		/* configuration */                                                                   \
+		0x09,		/* LENGTH */                                                          \
+		0x02,		/* DESCRIPTOR TYPE (Configuration) */                                 \
+		0x42, 0x00,	/* TOTAL LENGTH (66) */                                               \
+		0x02,		/* NUM INTERFACES (2) */                                              \
+		0x01,		/* CONFIG NUMBER (1) */                                               \
+		0x00,		/* STRING INDEX (null) */                                             \
+		0xA0,		/* ATTRIBUTES (Bus powered, Remote wakeup) */                         \
+		0xFA,		/* MAX POWER (500mA) */                                               \
+                                                                                                      \
+		/* Interface 0 - openinput protocol */                                                \
+		0x09,		/* LENGTH */                                                          \
+		0x04,		/* DESCRIPTOR TYPE (Interface) */                                     \
+		0x00,		/* INTERFACE NO (0) */                                                \
+		0x00,		/* ALTERNATE SETTING (none) */                                        \
+		0x02,		/* NUM ENDPOINTS (2) */                                               \
+		0x03,		/* INTERFACE CLASS (HID) */                                           \
+		0x00,		/* INTERFACE SUBCLASS (None) */                                       \
+		0x00,		/* INTERFACE PROTOCOL (None) */                                       \
+		0x00,		/* INTERFACE STRING (Null) */                                         \
+		/* HID */                                                                             \
+		0x09,		/* LENGTH */                                                          \
+		0x21,		/* DESCRIPTOR TYPE (hid) */                                           \
+		0x11, 0x01,	/* HID VERSION (0x0111) */                                            \
+		0x00,		/* COUNTRY CODE (None) */                                             \
+		0x01,		/* NO DESCRIPTORS (1) */                                              \
+		0x22,		/* DESCRIPTOR TYPE (Report) */                                        \
+		(oi_rdesc_size) & 0xFF,                                                               \
+		(oi_rdesc_size) >> 8, /* DESCRIPTOR LENGTH */                                         \
+		/* Endpoint in */                                                                     \
+		0x07,		/* LENGTH */                                                          \
+		0x05,		/* DESCRIPTOR TYPE (Endpoint) */                                      \
+		0x81,		/* ENDPOINT ADDRESS (Endpoint 1, IN) */                               \
+		0x03,		/* ATTRIBUTES (Interrupt) */                                          \
+		0x40, 0x00,	/* MAX PACKET SIZE (64) */                                            \
+		(oi_interval),	/* POLLING INTERVAL */                                                \
+		/* Endpoint out */                                                                    \
+		0x07,		/* LENGTH */                                                          \
+		0x05,		/* DESCRIPTOR TYPE (Endpoint) */                                      \
+		0x01,		/* ENDPOINT ADDRESS (Endpoint 1, OUT) */                              \
+		0x03,		/* ATTRIBUTES (Interrupt) */                                          \
+		0x40, 0x00,	/* MAX PACKET SIZE (64) */                                            \
+		(oi_interval),	/* POLLING INTERVAL */                                                \
+                                                                                                      \
+		/* Interface 1 - HID Mouse */                                                         \
+		0x09,		/* LENGTH */                                                          \
+		0x04,		/* DESCRIPTOR TYPE (Interface) */                                     \
+		0x01,		/* INTERFACE NO (1) */                                                \
+		0x00,		/* ALTERNATE SETTING (none) */                                        \
+		0x01,		/* NUM ENDPOINTS (1) */                                               \
+		0x03,		/* INTERFACE CLASS (HID) */                                           \
+		0x00,		/* INTERFACE SUBCLASS (None) */                                       \
+		0x00,		/* INTERFACE PROTOCOL (None) */                                       \
+		0x00,		/* INTERFACE STRING (Null) */                                         \
+		/* HID */                                                                             \
+		0x09,		/* LENGTH */                                                          \
+		0x21,		/* DESCRIPTOR TYPE (hid) */                                           \
+		0x11, 0x01,	/* HID VERSION (0x0111) */                                            \
+		0x00,		/* COUNTRY CODE (None) */                                             \
+		0x01,		/* NO DESCRIPTORS (1) */                                              \
+		0x22,		/* DESCRIPTOR TYPE (Report) */                                        \
+		(mouse_rdesc_size) & 0xFF,                                                            \
+		(mouse_rdesc_size) >> 8, /* DESCRIPTOR LENGTH */                                      \
+		/* Endpoint in */                                                                     \
+		0x07,		/* LENGTH */                                                          \
+		0x05,		/* DESCRIPTOR TYPE (Endpoint) */                                      \
+		0x82,		/* ENDPOINT ADDRESS (Endpoint 2, IN) */                               \
+		0x03,		/* ATTRIBUTES (Interrupt) */                                          \
+		0x40, 0x00,	/* MAX PACKET SIZE (64) */                                            \
+		(mouse_interval), /* POLLING INTERVAL */                                              \
+	}
@@ -0,0 +1,136 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import struct
+import unittest.mock
+
+import pages
+import pytest
+import testsuite
+
+
+PROFILE_FORMAT = '<HH8s5B'  # cpi, polling rate, buttons, led (mode, brightness, rgb)
+
+
+@pytest.fixture()
+def batch_device():
+    device = testsuite.Device(
+        name='batch test device',
+        functions={
+            pages.GeneralProfiles.GET_PROFILE,
+            pages.GeneralProfiles.SET_ACTIVE_PROFILE,
+            pages.GeneralProfiles.SET_CPI,
+            pages.GeneralProfiles.SET_POLLING_RATE,
+            pages.GeneralProfiles.SET_BUTTON,
+            pages.Batch.EXECUTE,
+        },
+    )
+    device.hid_send = unittest.mock.MagicMock()
+    return device
+
+
+def call(function, *args):
+    return [function.page_id, function.function_id, len(args)] + list(args)
+
+
+def batch(device, *calls):
+    data = [len(calls)] + sum(calls, [])
+    device.protocol_dispatch([0x21, 0x03, 0x00] + data + [0x00] * (29 - len(data)))
+    return device.hid_send.call_args[0][0]
+
+
+def get_profile(device, index):
+    device.protocol_dispatch([0x20, 0x01, 0x03, index, 0x00, 0x00, 0x00, 0x00])
+    return struct.unpack_from(PROFILE_FORMAT, bytes(device.hid_send.call_args[0][0][4:]))
+
+
+def test_execute(batch_device):
+    response = batch(
+        batch_device,
+        call(pages.GeneralProfiles.SET_CPI, 1, *(1600).to_bytes(2, 'little')),
+        call(pages.GeneralProfiles.SET_POLLING_RATE, 1, *(500).to_bytes(2, 'little')),
+        call(pages.GeneralProfiles.SET_BUTTON, 1, 0, 9),
+        call(pages.GeneralProfiles.SET_ACTIVE_PROFILE, 1),
+    )
+
+    # a single response for the whole batch
+    batch_device.hid_send.assert_called_once()
+    assert response == [0x21, 0x03, 0x00, 4] + [0x00] * 4 + [0x00] * 24
+
+    cpi, rate, buttons, *_ = get_profile(batch_device, 1)
+    assert (cpi, rate, buttons[0]) == (1600, 500, 9)
+
+
+def test_failed_call(batch_device):
+    response = batch(
+        batch_device,
+        call(pages.GeneralProfiles.SET_CPI, 0, *(400).to_bytes(2, 'little')),
+        call(pages.GeneralProfiles.SET_CPI, 9, *(400).to_bytes(2, 'little')),  # no such profile
+        call(pages.GeneralProfiles.SET_LED),  # not enabled
+        call(pages.Info.FW_INFO),  # page not enabled
+        call(pages.Batch.EXECUTE),  # no nesting
+        call(pages.GeneralProfiles.SET_CPI, 2, *(400).to_bytes(2, 'little')),
+    )
+
+    assert response[3:10] == [6, 0x00, 0x01, 0x02, 0x02, 0x02, 0x00]
+
+    # the calls around the failures still ran
+    assert get_profile(batch_device, 0)[0] == 400
+    assert get_profile(batch_device, 2)[0] == 400
+
+
+@pytest.mark.parametrize(
+    ('data', 'position'),
+    [
+        ([0], 0),  # no calls
+        ([10] + [0x01, 0x02, 0x00] * 9, 0),  # more calls than fit
+        ([9, 0x01, 0x02, 20], 0),  # more calls announced than fit after the first one
+        ([1, 0x01, 0x04, 27], 3),  # args past the end of the report
+        ([2] + call(pages.GeneralProfiles.SET_ACTIVE_PROFILE, 1) + [0x01, 0x02, 24], 7),
+    ]
+)
+def test_malformed(batch_device, data, position):
+    batch_device.protocol_dispatch([0x21, 0x03, 0x00] + data + [0x00] * (29 - len(data)))
+
+    # rejected before anything runs, so this is the only response
+    batch_device.hid_send.assert_called_once()
+    assert batch_device.hid_send.call_args[0][0][1:6] == [0xFF, 0x01, 0x03, 0x00, position]
+
+
+def test_feature_report(batch_device):
+    data = [2] + call(pages.GeneralProfiles.SET_CPI, 0, *(400).to_bytes(2, 'little')) + call(pages.Info.FW_INFO)
+    response = batch_device.protocol_dispatch_sync([0x21, 0x03, 0x00] + data + [0x00] * (29 - len(data)))
+
+    # the calls are captured by the batch, only its own response reaches the host
+    assert response[:6] == [0x21, 0x03, 0x00, 2, 0x00, 0x02]
+    batch_device.hid_send.assert_not_called()
+    assert get_profile(batch_device, 0)[0] == 400
+
+
+def test_pipelined(batch_device):
+    data = [1] + call(pages.GeneralProfiles.SET_ACTIVE_PROFILE, 2)
+    batch_device.protocol_dispatch([0x23, 0x03, 0x00] + data + [0x00] * (29 - len(data)) + [0x42])
+
+    batch_device.hid_send.assert_called_once_with([0x23, 0x03, 0x00, 1, 0x00] + [0x00] * 27 + [0x42])
+
+
+def test_fewer_transfers(batch_device):
+    # a whole profile: CPI, polling rate and the 8 buttons
+    calls = [
+        call(pages.GeneralProfiles.SET_CPI, 3, *(3200).to_bytes(2, 'little')),
+        call(pages.GeneralProfiles.SET_POLLING_RATE, 3, *(1000).to_bytes(2, 'little')),
+    ] + [call(pages.GeneralProfiles.SET_BUTTON, 3, button, 8 - button) for button in range(8)]
+
+    reports = []
+    while calls:
+        chunk = []
+        while calls and 1 + len(sum(chunk + [calls[0]], [])) <= 29:
+            chunk.append(calls.pop(0))
+        reports.append(chunk)
+
+    for chunk in reports:
+        response = batch(batch_device, *chunk)
+        assert response[4:4 + len(chunk)] == [0x00] * len(chunk)
+
+    assert len(reports) == 3  # instead of 10
+    assert get_profile(batch_device, 3)[:3] == (3200, 1000, bytes(range(8, 0, -1)))
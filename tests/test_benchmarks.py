@@ -0,0 +1,112 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import os.path
+import re
+
+import _testsuite
+import pages
+import testsuite
+
+
+def _cost(device, data, iterations=20000, rounds=5):
+    # the minimum is the least noisy estimate of the real cost
+    return min(device.dispatch_cost(data, iterations) for _ in range(rounds))
+
+
+def _protocol_functions():
+    # registered pages and functions, straight from protocol.h
+    pages_ = {}
+    functions = {}
+    page_id = None
+    with open(os.path.join(os.path.dirname(__file__), '..', 'src', 'protocol', 'protocol.h')) as header:
+        for line in header:
+            if match := re.match(r'#define OI_PAGE_(\w+)\s+(0x[0-9A-Fa-f]+)', line):
+                pages_[match[1]] = int(match[2], 16)
+            elif match := re.match(r'/\* .* page \((0x[0-9A-Fa-f]+)\) functions \*/', line):
+                page_id = int(match[1], 16)
+            elif match := re.match(r'#define OI_FUNCTION_\w+\s+(0x[0-9A-Fa-f]+)', line):
+                functions.setdefault(page_id, []).append(int(match[1], 16))
+            elif not line.strip():
+                page_id = None
+    del pages_['ERROR']  # not a function page, it only carries responses
+    return pages_, functions
+
+
+def test_page_index_table():
+    page_ids, _ = _protocol_functions()
+
+    for name, page_id in page_ids.items():
+        assert 0 <= _testsuite.page_index(page_id) < len(pages.PAGE_INDEXES), name
+        assert pages.PAGE_INDEXES[_testsuite.page_index(page_id)]._PAGE_ID == page_id, name
+
+    for page_id in set(range(256)) - set(page_ids.values()):
+        assert _testsuite.page_index(page_id) == -1
+
+
+def test_dispatch_cost_flat():
+    # every function implemented, registered in header order so the last one is also the last in its page
+    _, functions = _protocol_functions()
+    device = testsuite.Device(
+        name='benchmark device',
+        functions=[pages.Function(page_id, function_id) for page_id, ids in functions.items() for function_id in ids],
+    )
+
+    lookups = [(page_id, function_id) for page_id, ids in functions.items() for function_id in (ids[0], ids[-1])]
+    costs = dict(zip(lookups, device.lookup_cost(lookups, 1000, 2000)))
+
+    print()
+    for (page_id, function_id), cost in costs.items():
+        print(f'0x{page_id:02x} 0x{function_id:02x}: {cost:.1f} cycles/lookup')
+
+    # no matter which page, or where in the page, resolving the handler costs the same
+    assert max(costs.values()) < 1.3 * min(costs.values())
+
+
+def test_feature_report_round_trip(basic_device):
+    request = [0x20, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00]  # FW_INFO vendor
+    sync = min(basic_device.dispatch_sync_cost(request, 20000) for _ in range(5))
+    plain = _cost(basic_device, request)
+
+    print()
+    print(f'feature report round trip: {sync:.1f} cycles')
+    print(f'output report dispatch:    {plain:.1f} cycles')
+
+    # getting the response back costs about the same as sending it
+    assert sync < 2 * plain
+
+
+def test_spi_throughput():
+    # mock SPI backend, so this measures the per-byte overhead of the HAL, not the bus
+    size, iterations = 4096, 200
+    byte = max(_testsuite.spi_throughput(size, iterations, False) for _ in range(5))
+    bulk = max(_testsuite.spi_throughput(size, iterations, True) for _ in range(5))
+
+    print()
+    print(f'transfer:     {byte / 1e6:.1f} MB/s')
+    print(f'transfer_buf: {bulk / 1e6:.1f} MB/s')
+
+    assert bulk > byte
+
+
+def test_nvs_throughput():
+    # SPI NOR-ish timings: 40us per 16 byte program, 30ms sector erase
+    nvs = _testsuite.Nvs(block_count=8, block_size=4096, erase_latency_us=30000, program_latency_us=40)
+    nvs.mount()
+    written = 0
+    for i in range(5000):
+        value = i.to_bytes(4, 'little') * (1 + i % 16)
+        nvs.write(i % 32, value)
+        written += len(value)
+        while nvs.gc_pending:
+            nvs.gc_step()
+
+    erases = nvs.erase_counts
+    print()
+    print(f'nvs writes: {written / nvs.busy_us:.2f} MB/s of values (simulated flash time)')
+    print(f'write amplification: {nvs.program_bytes / written:.2f}')
+    print(f'sector erases: {erases}')
+
+    # NVS only ever programs erased flash, and wears all sectors the same
+    assert nvs.overwrites == 0
+    assert max(erases) - min(erases) <= 1
@@ -0,0 +1,111 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import _testsuite
+import pytest
+
+
+@pytest.fixture()
+def flash():
+    return _testsuite.RamBlockdev(block_count=4, block_size=1024, write_size=16, cache_page_size=256)
+
+
+def test_partial_writes_merge(flash):
+    for offset in range(0, 64, 16):
+        flash.write(0, offset, bytes([offset]) * 16)
+
+    assert flash.dirty
+    assert flash.program_count == 0
+    assert flash.read(0, 16, 16) == bytes([16]) * 16
+
+    flash.sync()
+    assert not flash.dirty
+    assert flash.program_count == 1
+    assert flash.program_bytes == 64
+    assert flash.image[:64] == b''.join(bytes([offset]) * 16 for offset in range(0, 64, 16))
+
+
+def test_program_only_clears_bits(flash):
+    flash.write(1, 32, bytes([0x0F] * 16))
+    flash.write(1, 32, bytes([0xF5] * 16))
+    assert flash.read(1, 32, 16) == bytes([0x05] * 16)
+
+    flash.sync()
+    assert flash.program_count == 1
+    assert flash.overwrites == 0
+    assert flash.read(1, 32, 16) == bytes([0x05] * 16)
+
+
+def test_erase_coalescing(flash):
+    flash.write(2, 0, bytes(16))
+    flash.sync()
+
+    flash.erase(2)
+    flash.write(2, 512, bytes(16))  # lost by the next erase
+    flash.erase(2)
+    assert flash.read(2, 0, 16) == b'\xff' * 16
+    assert flash.read(2, 512, 16) == b'\xff' * 16
+
+    flash.sync()
+    assert flash.erase_counts == [0, 0, 1, 0]
+    assert flash.program_count == 1
+    assert flash.image[2048:3072] == b'\xff' * 1024
+
+
+def test_write_after_erase(flash):
+    flash.write(3, 0, bytes(16))
+    flash.sync()
+
+    flash.erase(3)
+    flash.write(3, 16, bytes(16))
+    assert flash.read(3, 0, 32) == b'\xff' * 16 + bytes(16)
+
+    flash.sync()
+    assert flash.erase_counts == [0, 0, 0, 1]
+    assert flash.read(3, 0, 32) == b'\xff' * 16 + bytes(16)
+
+
+def test_flush_order(flash):
+    # copy a record to block 1 before erasing its original in block 0
+    flash.write(0, 0, bytes(16))
+    flash.sync()
+    flash.write(1, 0, bytes(16))
+    flash.erase(0)
+
+    flash.flush_step()
+    assert flash.image[1024:1040] == bytes(16)
+    assert flash.erase_counts == [0, 0, 0, 0]
+
+    flash.flush_step()
+    assert flash.erase_counts == [1, 0, 0, 0]
+    assert not flash.dirty
+
+
+def test_eviction(flash):
+    # more dirty pages than cache lines, all of them must make it in order
+    for page in range(8):
+        flash.write(page // 4, (page % 4) * 256, bytes([page]) * 16)
+    flash.sync()
+
+    for page in range(8):
+        assert flash.read(page // 4, (page % 4) * 256, 16) == bytes([page]) * 16
+    assert flash.program_count == 8
+
+
+@pytest.mark.parametrize('page_size', [8, 24, 2048])
+def test_invalid_page_size(page_size):
+    with pytest.raises(ValueError):
+        _testsuite.RamBlockdev(block_count=4, block_size=1024, write_size=16, cache_page_size=page_size)
+
+
+def test_nvs_remount():
+    nvs = _testsuite.Nvs(block_count=4, block_size=4096, write_size=16, cache_page_size=512)
+    nvs.mount()
+    for i in range(32):
+        nvs.write(i % 4, bytes([i]) * 8)
+    nvs.sync()
+
+    new = _testsuite.Nvs(image=nvs.image)
+    new.mount()
+    for key in range(4):
+        assert new.read(key) == bytes([28 + key]) * 8
@@ -0,0 +1,75 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import _testsuite
+import pytest
+
+
+@pytest.fixture()
+def flash():
+    return _testsuite.RamBlockdev(block_count=4, block_size=1024, write_size=16)
+
+
+def test_fresh_device_is_erased(flash):
+    assert flash.image == b'\xff' * 4096
+    assert flash.read(3, 1008, 16) == b'\xff' * 16
+
+
+def test_program_only_clears_bits(flash):
+    flash.write(1, 32, bytes([0x0F] * 16))
+    flash.write(1, 32, bytes([0xF5] * 16))
+
+    assert flash.read(1, 32, 16) == bytes([0x05] * 16)
+    assert flash.overwrites == 1
+    assert flash.program_count == 2
+    assert flash.program_bytes == 32
+
+
+def test_erase_granularity(flash):
+    for block in range(4):
+        flash.write(block, 0, bytes(16))
+    flash.erase(2)
+
+    assert flash.read(1, 0, 16) == bytes(16)
+    assert flash.read(2, 0, 16) == b'\xff' * 16
+    assert flash.read(3, 0, 16) == bytes(16)
+    assert flash.erase_counts == [0, 0, 1, 0]
+
+
+@pytest.mark.parametrize(
+    ('block', 'offset', 'size'),
+    [
+        (0, 8, 16),  # unaligned offset
+        (0, 0, 8),  # partial write unit
+        (0, 1024, 16),  # past the end of the block
+        (4, 0, 16),  # past the end of the device
+    ]
+)
+def test_invalid_write(flash, block, offset, size):
+    with pytest.raises(OSError):
+        flash.write(block, offset, bytes(size))
+
+    assert flash.program_count == 0
+
+
+def test_invalid_erase(flash):
+    with pytest.raises(OSError):
+        flash.erase(4)
+
+
+def test_latency():
+    flash = _testsuite.RamBlockdev(
+        block_count=2, block_size=1024, write_size=16, erase_latency_us=5000, program_latency_us=40
+    )
+    loop = _testsuite.EventLoop()
+    timeout = 10
+
+    timer = loop.add_timer(lambda: None)
+    loop.start_timer(timer, timeout)
+
+    flash.write(0, 0, bytes(64))  # 4 write units
+    flash.erase(1)
+
+    assert flash.busy_us == 4 * 40 + 5000
+    # latencies are simulated on the virtual clock, 5.16ms went by
+    assert timeout - 6 <= loop.next_timeout <= timeout - 5
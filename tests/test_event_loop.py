@@ -0,0 +1,157 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import _testsuite
+import pytest
+
+
+WHEEL_SIZE = 32
+
+
+@pytest.fixture()
+def loop():
+    return _testsuite.EventLoop()
+
+
+def test_work_runs_once_in_order(loop):
+    calls = []
+    first = loop.add_work(lambda: calls.append('first'))
+    second = loop.add_work(lambda: calls.append('second'))
+
+    loop.post(second)
+    loop.post(first)
+    loop.post(first)
+
+    assert loop.run_once()
+    assert calls == ['first', 'second']
+
+    assert not loop.run_once()
+    assert calls == ['first', 'second']
+
+
+def test_work_posted_from_callback(loop):
+    calls = []
+
+    def callback():
+        calls.append(None)
+        if len(calls) < 3:
+            loop.post(work)
+
+    work = loop.add_work(callback)
+    loop.post(work)
+
+    while loop.run_once():
+        pass
+
+    assert len(calls) == 3
+
+
+def test_idle(loop):
+    work = loop.add_work(lambda: None)
+
+    loop.post(work)
+    loop.run_once()
+    assert loop.idle_count == 0
+
+    loop.run_once()
+    assert loop.idle_count == 1
+
+
+def test_timer_one_shot(loop):
+    calls = []
+    timer = loop.add_timer(lambda: calls.append(None))
+
+    loop.start_timer(timer, 5)
+    assert loop.timer_active(timer)
+    assert loop.next_timeout == 5
+
+    loop.advance(4)
+    loop.run_once()
+    assert calls == []
+
+    loop.advance(1)
+    loop.run_once()
+    assert calls == [None]
+    assert not loop.timer_active(timer)
+    assert loop.next_timeout is None
+
+
+def test_timer_periodic(loop):
+    calls = []
+    timer = loop.add_timer(lambda: calls.append(None))
+
+    loop.start_timer(timer, 10, 10)
+    for _ in range(100):
+        loop.advance(1)
+        loop.run_once()
+
+    assert len(calls) == 10
+    assert loop.timer_active(timer)
+
+
+def test_timer_periodic_falls_behind(loop):
+    calls = []
+    timer = loop.add_timer(lambda: calls.append(None))
+
+    loop.start_timer(timer, 1, 1)
+    loop.advance(1000)
+    loop.run_once()
+
+    # missed periods are dropped, not replayed
+    assert len(calls) == 1
+    assert loop.next_timeout == 1
+
+
+@pytest.mark.parametrize('delay', [WHEEL_SIZE - 1, WHEEL_SIZE, WHEEL_SIZE + 1, 3 * WHEEL_SIZE + 7])
+def test_timer_longer_than_wheel(loop, delay):
+    calls = []
+    timer = loop.add_timer(lambda: calls.append(None))
+
+    loop.start_timer(timer, delay)
+    for _ in range(delay - 1):
+        loop.advance(1)
+        loop.run_once()
+    assert calls == []
+
+    loop.advance(1)
+    loop.run_once()
+    assert calls == [None]
+
+
+def test_timer_stopped_by_expired_timer(loop):
+    calls = []
+    first = loop.add_timer(lambda: (calls.append('first'), loop.stop_timer(second)))
+    second = loop.add_timer(lambda: calls.append('second'))
+
+    loop.start_timer(first, 3)
+    loop.start_timer(second, 3)
+    loop.advance(3)
+    loop.run_once()
+
+    # expire together, whichever runs first decides
+    assert calls in (['first'], ['second', 'first'])
+    assert not loop.timer_active(second)
+
+
+def test_timer_restart(loop):
+    calls = []
+    timer = loop.add_timer(lambda: calls.append(None))
+
+    loop.start_timer(timer, 5)
+    loop.advance(4)
+    loop.run_once()
+    loop.start_timer(timer, 5)
+    loop.advance(4)
+    loop.run_once()
+    assert calls == []
+
+    loop.advance(1)
+    loop.run_once()
+    assert calls == [None]
+
+
+def test_next_timeout_pending_work(loop):
+    work = loop.add_work(lambda: None)
+
+    loop.post(work)
+    assert loop.next_timeout == 0
@@ -0,0 +1,69 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import errno
+import struct
+import zlib
+
+import pages
+import pytest
+import testsuite
+
+
+FW_INFO_VENDOR = [0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00]
+FW_INFO_VENDOR_REPLY = [0x00, 0x01] + list(b'openinput-git') + [0x00] * 16
+
+
+def test_response_returned(basic_device):
+    response = basic_device.protocol_dispatch_sync([0x20] + FW_INFO_VENDOR)
+
+    assert response == [0x21] + FW_INFO_VENDOR_REPLY
+    # nothing goes out on the interrupt endpoint
+    basic_device.hid_send.assert_not_called()
+
+
+def test_error_returned(basic_device):
+    response = basic_device.protocol_dispatch_sync([0x20, 0x00, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00])
+
+    assert response == [0x20, 0xFF, 0x02, 0x00, 0xF0, 0x00, 0x00, 0x00]
+
+
+@pytest.mark.parametrize(
+    'report',
+    [
+        [0x01, 0x00, 0x00],  # not a protocol report
+        [0x20, 0x00, 0x01],  # too short
+        [0x22] + FW_INFO_VENDOR + [0x01],  # pipelined, nothing to queue
+    ]
+)
+def test_invalid_request(basic_device, report):
+    with pytest.raises(OSError) as e:
+        basic_device.protocol_dispatch_sync(report)
+
+    assert e.value.errno == errno.EINVAL
+
+
+def test_no_response():
+    device = testsuite.Device(
+        name='update test device',
+        functions={
+            pages.FwUpdate.START,
+            pages.FwUpdate.WRITE,
+        },
+    )
+    data = bytes(range(54))
+    start = [0x21, 0x02, 0x01] + list(struct.pack('<II', len(data), zlib.crc32(data)))
+    assert device.protocol_dispatch_sync(start + [0x00] * (32 - len(start)))[1] != 0xFF
+
+    # the first chunk of the window isn't acknowledged, that's not an error
+    write = [0x21, 0x02, 0x02, 0x00, 0x00] + list(data[:27])
+    assert device.protocol_dispatch_sync(write) == []
+
+
+def test_queued_responses_untouched(basic_device):
+    basic_device.hid_send = lambda data: -errno.EBUSY
+    basic_device.protocol_dispatch([0x22] + FW_INFO_VENDOR + [0x01])
+
+    basic_device.protocol_dispatch_sync([0x20] + FW_INFO_VENDOR)
+
+    assert basic_device.queued_responses == 1
@@ -0,0 +1,227 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import random
+import struct
+import unittest.mock
+import zlib
+
+import pages
+import pytest
+import testsuite
+
+
+CHUNK_SIZE = 27
+WINDOW = 16
+ACK_INTERVAL = 8
+SLOT_SIZE = 8 * 4096
+
+
+@pytest.fixture()
+def update_device():
+    device = testsuite.Device(
+        name='update test device',
+        functions={
+            pages.FwUpdate.INFO,
+            pages.FwUpdate.START,
+            pages.FwUpdate.WRITE,
+            pages.FwUpdate.FINISH,
+        },
+    )
+    device.hid_send = unittest.mock.MagicMock()
+    return device
+
+
+def image(size, seed=0):
+    return random.Random(seed).randbytes(size)
+
+
+def request(device, function, *args):
+    report = [0x20, 0x02, function] + list(args)
+    if len(report) > 8:
+        report[0] = 0x21
+        report += [0x00] * (32 - len(report))
+    else:
+        report += [0x00] * (8 - len(report))
+    device.protocol_dispatch(report)
+    return device.hid_send.call_args[0][0]
+
+
+def info(device):
+    response = request(device, 0x00)
+    assert response[:3] == [0x21, 0x02, 0x00]
+    running, boot, chunk_size, window, capacity, state, received = struct.unpack_from('<BBBBIBI', bytes(response[3:]))
+    return running, boot, chunk_size, window, capacity, state, received
+
+
+def start(device, data, crc=None):
+    return request(device, 0x01, *struct.pack('<II', len(data), zlib.crc32(data) if crc is None else crc))
+
+
+def send_chunk(device, sequence, data):
+    report = [0x21, 0x02, 0x02] + list(struct.pack('<H', sequence & 0xFFFF)) + list(data)
+    device.protocol_dispatch(report + [0x00] * (32 - len(report)))
+
+
+def stream(device, data, lose=()):
+    '''windowed host, returns the replies it got during the transfer'''
+    chunks = [data[i:i + CHUNK_SIZE] for i in range(0, len(data), CHUNK_SIZE)]
+    lose = set(lose)
+    acked = sent = 0
+    replies = []
+
+    while acked < len(chunks):
+        device.hid_send.reset_mock()
+        while sent < len(chunks) and sent - acked < WINDOW:
+            if sent in lose:
+                lose.discard(sent)  # only lost once
+            else:
+                send_chunk(device, sent, chunks[sent])
+            sent += 1
+
+        round_replies = [call[0][0] for call in device.hid_send.call_args_list]
+        if not round_replies:
+            sent = acked  # timeout, go back to the last acknowledgement
+        for reply in round_replies:
+            assert reply[:3] == [0x20, 0x02, 0x02]
+            sequence, status = struct.unpack_from('<HB', bytes(reply[3:]))
+            acked = max(acked, sequence)
+            if status == 0x01:  # NAK, resend from there
+                sent = sequence
+        replies += round_replies
+
+    return replies
+
+
+def update(device, data):
+    assert start(device, data)[:3] == [0x21, 0x02, 0x01]
+    replies = stream(device, data)
+    response = request(device, 0x03)
+    return replies, response
+
+
+def test_info(update_device):
+    assert info(update_device) == (0, 0, CHUNK_SIZE, WINDOW, SLOT_SIZE, 0, 0)
+
+
+def test_update(update_device):
+    data = image(10000)
+    replies, response = update(update_device, data)
+
+    assert response == [0x20, 0x02, 0x03, 1, 0, 0, 0, 0]
+    assert update_device.fw_slots[1][:len(data)] == data
+    assert update_device.fw_slots[0] == b'\xff' * SLOT_SIZE
+    # only the blocks the image needs are erased, once
+    assert update_device.fw_slot_erases[1] == [1, 1, 1, 0, 0, 0, 0, 0]
+    # one reply every ACK_INTERVAL chunks, plus the last one
+    chunks = -(-len(data) // CHUNK_SIZE)
+    assert len(replies) == -(-chunks // ACK_INTERVAL)
+
+    assert info(update_device)[:2] == (0, 1)
+    update_device.reboot()
+    assert info(update_device)[:2] == (1, 1)
+
+    # and back to the first slot
+    data = image(SLOT_SIZE, seed=1)
+    assert update(update_device, data)[1][3] == 0
+    assert update_device.fw_slots[0] == data
+    update_device.reboot()
+    assert info(update_device)[:2] == (0, 0)
+
+
+def test_lost_chunks(update_device):
+    data = image(5000)
+    replies = None
+
+    assert start(update_device, data)[:3] == [0x21, 0x02, 0x01]
+    replies = stream(update_device, data, lose=(3, 4, 40, 185))
+
+    assert any(reply[5] == 0x01 for reply in replies)
+    assert request(update_device, 0x03)[:4] == [0x20, 0x02, 0x03, 1]
+    assert update_device.fw_slots[1][:len(data)] == data
+
+
+def test_crc_mismatch(update_device):
+    data = image(1000)
+
+    assert start(update_device, data, crc=zlib.crc32(data) ^ 1)[:3] == [0x21, 0x02, 0x01]
+    stream(update_device, data)
+    response = request(update_device, 0x03)
+
+    assert response[:5] == [0x21, 0xFF, 0xFE, 0x02, 0x03]
+    assert bytes(response[5:]).rstrip(b'\0') == b'crc mismatch'
+    assert info(update_device)[:2] == (0, 0)
+
+
+def test_incomplete(update_device):
+    data = image(1000)
+
+    start(update_device, data)
+    send_chunk(update_device, 0, data[:CHUNK_SIZE])
+    response = request(update_device, 0x03)
+
+    assert response[1:3] == [0xFF, 0xFE]
+    assert info(update_device)[:2] == (0, 0)
+
+
+def test_too_big(update_device):
+    assert start(update_device, bytes(SLOT_SIZE + 1))[:5] == [0x21, 0xFF, 0x01, 0x02, 0x01]
+    assert start(update_device, b'')[:5] == [0x21, 0xFF, 0x01, 0x02, 0x01]
+
+
+def test_write_without_start(update_device):
+    send_chunk(update_device, 0, bytes(CHUNK_SIZE))
+    response = update_device.hid_send.call_args[0][0]
+
+    assert response[:5] == [0x21, 0xFF, 0xFE, 0x02, 0x02]
+    assert bytes(response[5:]).rstrip(b'\0') == b'no update in progress'
+
+
+def test_write_short_report(update_device):
+    start(update_device, image(1000))
+    response = request(update_device, 0x02, 0x00, 0x00, 0xAA)
+
+    assert response[:6] == [0x20, 0xFF, 0x01, 0x02, 0x02, 0x02]
+    assert info(update_device)[6] == 0
+
+
+def test_write_past_the_end(update_device):
+    data = image(CHUNK_SIZE * 2)
+
+    start(update_device, data)
+    stream(update_device, data)
+    update_device.hid_send.reset_mock()
+    send_chunk(update_device, 2, bytes(CHUNK_SIZE))
+    response = update_device.hid_send.call_args[0][0]
+
+    # no ACK, and the sequence doesn't move
+    assert response[:5] == [0x21, 0xFF, 0xFE, 0x02, 0x02]
+    assert bytes(response[5:]).rstrip(b'\0') == b'image complete'
+    assert info(update_device)[6] == len(data)
+    assert request(update_device, 0x03)[:4] == [0x20, 0x02, 0x03, 1]
+
+
+def test_restart_before_reboot(update_device):
+    update(update_device, image(2000))
+    assert info(update_device)[:2] == (0, 1)
+
+    # the pending image is about to be overwritten, boot the running one until this update finishes
+    start(update_device, image(2000, seed=1))
+    assert info(update_device)[:2] == (0, 0)
+    update_device.reboot()
+    assert info(update_device)[:2] == (0, 0)
+
+
+def test_running_slot_not_from_record(update_device):
+    update(update_device, image(2000))
+    assert info(update_device)[:2] == (0, 1)
+
+    # the bootloader didn't take the new image, the record doesn't say where we run from
+    update_device.reboot(slot=0)
+    assert info(update_device)[:2] == (0, 1)
+
+    # so the running image is never the target
+    data = image(2000, seed=1)
+    assert update(update_device, data)[1][3] == 1
+    assert update_device.fw_slots[1][:len(data)] == data
+    assert not any(update_device.fw_slot_erases[0])
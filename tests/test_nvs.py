@@ -0,0 +1,207 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import random
+
+import _testsuite
+import pytest
+
+
+def remount(nvs, **geometry):
+    new = _testsuite.Nvs(image=nvs.image, **geometry)
+    new.mount()
+    return new
+
+
+@pytest.fixture()
+def nvs():
+    nvs = _testsuite.Nvs()
+    nvs.mount()
+    return nvs
+
+
+def test_read_write(nvs):
+    assert nvs.read(1) is None
+
+    nvs.write(1, b'hello')
+    nvs.write(2, b'')
+    assert nvs.read(1) == b'hello'
+    assert nvs.read(2) == b''
+
+    nvs.write(1, b'world!')
+    assert nvs.read(1) == b'world!'
+    assert nvs.keys == [1, 2]
+
+
+def test_delete(nvs):
+    nvs.write(7, b'value')
+    nvs.delete(7)
+    assert nvs.read(7) is None
+
+    with pytest.raises(FileNotFoundError):
+        nvs.delete(7)
+
+
+def test_invalid(nvs):
+    with pytest.raises(OSError):
+        nvs.write(0xFFFF, b'reserved key')
+    with pytest.raises(OSError):
+        nvs.write(1, bytes(257))
+
+
+def test_bad_geometry():
+    with pytest.raises(OSError):
+        _testsuite.Nvs(block_count=2).mount()
+    with pytest.raises(OSError):
+        _testsuite.Nvs(block_size=256).mount()
+
+
+def test_persistence(nvs):
+    nvs.write(1, b'one')
+    nvs.write(2, b'two')
+    nvs.write(1, b'uno')
+    nvs.delete(2)
+
+    nvs = remount(nvs)
+    assert nvs.read(1) == b'uno'
+    assert nvs.read(2) is None
+
+
+def test_unchanged_write_is_skipped(nvs):
+    nvs.write(1, b'dpi')
+    programmed = nvs.program_bytes
+
+    nvs.write(1, b'dpi')
+    assert nvs.program_bytes == programmed
+
+
+def test_garbage_collection(nvs):
+    # a lot more data than the device holds, only the latest values are live
+    for i in range(2000):
+        nvs.write(i % 8, i.to_bytes(4, 'little') * 16)
+
+    for key in range(8):
+        value = (1992 + key).to_bytes(4, 'little') * 16
+        assert nvs.read(key) == value
+        assert remount(nvs).read(key) == value
+
+    # round robin, every sector wears the same
+    counts = nvs.erase_counts
+    assert min(counts) > 0
+    assert max(counts) - min(counts) <= 1
+
+
+def test_background_gc(nvs):
+    for i in range(200):
+        nvs.write(1, bytes([i]) * 200)
+    assert nvs.gc_pending
+
+    steps = 0
+    while nvs.gc_pending:
+        nvs.gc_step()
+        steps += 1
+        assert steps < 100
+
+    assert nvs.free_sectors >= 2
+    assert nvs.read(1) == bytes([199]) * 200
+
+
+def test_deleted_key_stays_deleted(nvs):
+    nvs.write(1, b'old')
+    nvs.delete(1)
+    # churn through the device so both records get collected
+    for i in range(300):
+        nvs.write(2, bytes([i % 256]) * 128)
+
+    assert nvs.read(1) is None
+    assert remount(nvs).read(1) is None
+
+
+def test_full(nvs):
+    with pytest.raises(OSError):
+        for key in range(64):
+            nvs.write(key, bytes(256))
+
+    # what did make it is still readable
+    nvs = remount(nvs)
+    for key in nvs.keys:
+        assert nvs.read(key) == bytes(256)
+
+
+@pytest.mark.parametrize('cut', [0, 1, 8, 16, 40])
+def test_torn_write(nvs, cut):
+    nvs.write(1, b'before' * 10)
+
+    nvs.power_loss_after(cut)
+    with pytest.raises(OSError):
+        nvs.write(1, b'after' * 10)
+
+    nvs = remount(nvs)
+    assert nvs.read(1) == b'before' * 10
+
+    nvs.write(1, b'again')
+    nvs.write(2, b'more')
+    nvs = remount(nvs)
+    assert nvs.read(1) == b'again'
+    assert nvs.read(2) == b'more'
+
+
+@pytest.mark.parametrize('cut', range(0, 4096, 397))
+def test_power_loss_during_gc(cut):
+    nvs = _testsuite.Nvs()
+    nvs.mount()
+    model = {key: bytes([key]) * 200 for key in range(8)}
+    for key, value in model.items():
+        nvs.write(key, value)
+    for i in range(60):
+        nvs.write(100, bytes([i]) * 200)
+    model[100] = bytes([59]) * 200
+
+    # run the collection until the power goes away
+    nvs.power_loss_after(cut)
+    in_flight = None
+    with pytest.raises(OSError):
+        for i in range(1000):
+            in_flight = i.to_bytes(2, 'little') * 100
+            nvs.write(100, in_flight)
+            model[100] = in_flight
+            while nvs.gc_pending:
+                nvs.gc_step()
+
+    nvs = remount(nvs)
+    for key, value in model.items():
+        assert nvs.read(key) in (value, in_flight if key == 100 else value)
+
+    nvs.write(1, b'still works')
+    assert remount(nvs).read(1) == b'still works'
+
+
+def test_stress():
+    rng = random.Random(0x5EED)
+    geometry = {'block_count': 6, 'block_size': 2048}
+    nvs = _testsuite.Nvs(**geometry)
+    nvs.mount()
+    model = {}
+
+    for i in range(5000):
+        key = rng.randrange(24)
+        op = rng.random()
+        if op < 0.7:
+            value = rng.randbytes(rng.randrange(0, 96))
+            nvs.write(key, value)
+            model[key] = value
+        elif op < 0.85 and key in model:
+            nvs.delete(key)
+            del model[key]
+        elif op < 0.95:
+            nvs.gc_step()
+        else:
+            nvs = remount(nvs, **geometry)
+
+        if i % 500 == 0:
+            assert {key: nvs.read(key) for key in model} == model
+            assert sorted(nvs.keys) == sorted(model)
+
+    nvs = remount(nvs, **geometry)
+    assert {key: nvs.read(key) for key in model} == model
+    assert sorted(nvs.keys) == sorted(model)
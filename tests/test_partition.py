@@ -0,0 +1,127 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import errno
+import importlib.util
+import os.path
+import struct
+
+import _testsuite
+import pytest
+
+
+_spec = importlib.util.spec_from_file_location(
+    'partition_table', os.path.join(os.path.dirname(__file__), '..', 'tools', 'partition_table.py')
+)
+pt = importlib.util.module_from_spec(_spec)
+_spec.loader.exec_module(pt)
+
+
+def entries():
+    return [
+        pt.add_entry(name='nv_data', ptype=pt.PARTITION_TYPE_NVS, id=0, start_addr=0x00460000, end_addr=0x0047C000),
+        pt.add_entry(name='sensor_blob', ptype=pt.PARTITION_TYPE_BLOB, id=1, start_addr=0x0047C000, end_addr=0x0047E000),
+        pt.add_entry(name='fw', ptype=pt.PARTITION_TYPE_FW, id=7, start_addr=0x00400000, end_addr=0x00440000),
+        pt.add_entry(name='nv_backup', ptype=pt.PARTITION_TYPE_NVS, id=9, start_addr=0x00440000, end_addr=0x00460000),
+    ]
+
+
+def fix_crc(data):
+    entry_data = data[8:]
+    return pt.table_header(entry_data, numEntries=data[7])[:8] + entry_data
+
+
+@pytest.fixture()
+def table():
+    return _testsuite.PartitionTable(pt.partition_table(*entries()))
+
+
+def test_lookups(table):
+    assert table.from_index(1)['name'] == b'sensor_blob'
+    assert table.from_index(4) is None
+
+    # the first partition of each type
+    assert table.from_type(pt.PARTITION_TYPE_NVS)['id'] == 0
+    assert table.from_type(pt.PARTITION_TYPE_FW)['start'] == 0x00400000
+    assert table.from_type(3) is None
+
+    assert table.from_id(9)['name'] == b'nv_backup'
+    assert table.from_id(2) is None
+
+    assert table.from_name('sensor_blob') == {
+        'location': pt.PARTITION_LOC_INTERNAL,
+        'type': pt.PARTITION_TYPE_BLOB,
+        'id': 1,
+        'start': 0x0047C000,
+        'end': 0x0047E000,
+        'name': b'sensor_blob',
+    }
+    assert table.from_name('nv_data\0trailing')['id'] == 0
+    assert table.from_name('nv_dat') is None
+    assert table.from_name('nv_data_') is None
+    assert table.from_name('') is None
+
+
+def test_full_table():
+    names = [f'partition_{i:06}' for i in range(pt.PARTITION_TABLE_MAX_ENTRIES)]
+    table = _testsuite.PartitionTable(pt.partition_table(*(
+        pt.add_entry(name=name, id=i, start_addr=i * 0x1000, end_addr=(i + 1) * 0x1000)
+        for i, name in enumerate(names)
+    )))
+
+    for i, name in enumerate(names):
+        assert table.from_name(name)['id'] == i
+        assert table.from_id(i)['name'] == name.encode()
+
+
+def test_generator_rejects_long_names():
+    with pytest.raises(ValueError):
+        pt.add_entry(name='a' * 17)
+
+
+@pytest.mark.parametrize(
+    ('mangle', 'error'),
+    [
+        (lambda data: b'', errno.EBADMSG),  # truncated header
+        (lambda data: b'\xff' * len(data), errno.EBADMSG),  # erased flash
+        (lambda data: data[:-1], errno.EINVAL),  # truncated entries
+        (lambda data: data[:-2] + bytes([data[-2] ^ 1]) + data[-1:], errno.EBADMSG),  # corrupted entry
+        (lambda data: data[:1] + b'\x00' + data[2:], errno.EBADMSG),  # corrupted CRC
+        (lambda data: struct.pack('<I', pt.PARTITION_TABLE_MW) + data[4:], errno.EPROTONOSUPPORT),  # version 0
+        (lambda data: fix_crc(data[:7] + b'\x00'), errno.EINVAL),  # no entries
+        (lambda data: fix_crc(data[:7] + b'\x11' + data[8:] * 5), errno.EINVAL),  # too many entries
+        (lambda data: fix_crc(data[:8] + b'\xaa' + data[9:]), errno.EINVAL),  # bad entry magic
+    ]
+)
+def test_malformed(mangle, error):
+    with pytest.raises(OSError) as e:
+        _testsuite.PartitionTable(mangle(pt.partition_table(*entries())))
+
+    assert e.value.errno == error
+
+
+@pytest.mark.parametrize(
+    'entry',
+    [
+        pt.add_entry(name='dup_id', id=1, start_addr=0x00480000, end_addr=0x00481000),
+        pt.add_entry(name='nv_data', id=2, start_addr=0x00480000, end_addr=0x00481000),
+        pt.add_entry(name='overlap', id=2, start_addr=0x0047DFF0, end_addr=0x00481000),
+        pt.add_entry(name='empty', id=2, start_addr=0x00480000, end_addr=0x00480000),
+        pt.add_entry(name='reversed', id=2, start_addr=0x00481000, end_addr=0x00480000),
+        pt.add_entry(name='nv\0junk', id=2, start_addr=0x00480000, end_addr=0x00481000),
+    ]
+)
+def test_inconsistent(entry):
+    with pytest.raises(OSError) as e:
+        _testsuite.PartitionTable(pt.partition_table(*entries(), entry))
+
+    assert e.value.errno == errno.EINVAL
+
+
+def test_other_location_may_overlap():
+    table = _testsuite.PartitionTable(pt.partition_table(
+        *entries(),
+        pt.add_entry(location=1, name='external', id=2, start_addr=0x00460000, end_addr=0x00470000),
+    ))
+
+    assert table.from_name('external')['location'] == 1
@@ -0,0 +1,162 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import errno
+import struct
+import unittest.mock
+
+import pages
+import pytest
+import testsuite
+
+
+FW_INFO_VENDOR = [0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00]
+FW_INFO_VENDOR_REPLY = [0x00, 0x01] + list(b'openinput-git') + [0x00] * 16
+
+
+def fw_info(sequence):
+    return [0x22] + FW_INFO_VENDOR + [sequence]
+
+
+def test_sequence_echoed(basic_device):
+    basic_device.protocol_dispatch(fw_info(0x5A))
+
+    basic_device.hid_send.assert_called_once_with([0x23] + FW_INFO_VENDOR_REPLY + [0x5A])
+
+
+def test_long_request(basic_device):
+    basic_device.protocol_dispatch([0x23] + FW_INFO_VENDOR + [0x00] * 24 + [0x80])
+
+    basic_device.hid_send.assert_called_once_with([0x23] + FW_INFO_VENDOR_REPLY + [0x80])
+
+
+def test_error_keeps_sequence(basic_device):
+    basic_device.protocol_dispatch([0x22, 0x00, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33])
+
+    basic_device.hid_send.assert_called_once_with([0x22, 0xFF, 0x02, 0x00, 0xF0, 0x00, 0x00, 0x00, 0x33])
+
+
+@pytest.mark.parametrize(
+    'report',
+    [
+        [0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00],  # no sequence number
+        [0x23, 0x00, 0x00] + [0x00] * 29,
+        [0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01],  # plain report with a sequence number
+    ]
+)
+def test_invalid_length(basic_device, report):
+    basic_device.protocol_dispatch(report)
+
+    basic_device.hid_send.assert_not_called()
+
+
+def test_plain_request_after_pipelined(basic_device):
+    basic_device.protocol_dispatch(fw_info(0x01))
+    basic_device.protocol_dispatch([0x20] + FW_INFO_VENDOR)
+
+    basic_device.hid_send.assert_called_with([0x21] + FW_INFO_VENDOR_REPLY)
+
+
+def test_busy_endpoint(basic_device):
+    sent = []
+    busy = True
+
+    def hid_send(data):
+        if busy:
+            return -errno.EBUSY
+        sent.append(data)
+
+    basic_device.hid_send = hid_send
+
+    # the whole window arrives before the endpoint frees up
+    for sequence in range(15):
+        basic_device.protocol_dispatch(fw_info(sequence))
+    assert basic_device.queued_responses == 15
+
+    busy = False
+    basic_device.protocol_flush()
+
+    assert basic_device.queued_responses == 0
+    assert [report[32] for report in sent] == list(range(15))
+
+
+def test_responses_stay_in_order(basic_device):
+    sent = []
+    busy = True
+
+    def hid_send(data):
+        if busy:
+            return -errno.EBUSY
+        sent.append(data)
+
+    basic_device.hid_send = hid_send
+
+    basic_device.protocol_dispatch(fw_info(0x10))
+    busy = False
+    # the plain response must not overtake the queued one
+    basic_device.protocol_dispatch([0x20] + FW_INFO_VENDOR)
+
+    assert [report[0] for report in sent] == [0x23, 0x21]
+
+
+@pytest.fixture()
+def stats_device():
+    device = testsuite.Device(
+        name='queue test device',
+        functions={
+            pages.Info.FW_INFO,
+            pages.Debug.TX_QUEUE_STATS,
+        },
+    )
+    device.hid_send = unittest.mock.MagicMock()
+    return device
+
+
+def read_stats(device):
+    device.protocol_dispatch([0x20, 0xFE, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00])
+    response = device.hid_send.call_args[0][0]
+    assert response[:3] == [0x21, 0xFE, 0x01]
+    return struct.unpack_from('<5IB', bytes(response[3:]))
+
+
+def test_backpressure(stats_device):
+    sent = []
+    busy = True
+
+    def hid_send(data):
+        if busy:
+            return -errno.EBUSY
+        sent.append(data)
+
+    stats_device.hid_send = hid_send
+
+    # one past the window, the last request is turned away
+    for sequence in range(16):
+        stats_device.protocol_dispatch(fw_info(sequence))
+    # and with no room left for the busy error, the next one is lost
+    stats_device.protocol_dispatch(fw_info(16))
+
+    busy = False
+    stats_device.protocol_flush()
+
+    assert [report[-1] for report in sent] == list(range(16))
+    assert sent[-1] == [0x22, 0xFF, 0x03, 0x00, 0x01, 0x00, 0x00, 0x00, 15]
+
+    stats_device.hid_send = unittest.mock.MagicMock()
+    queued, sent_count, overflows, high_water, busy_errors, size = read_stats(stats_device)
+    assert (queued, sent_count, overflows, high_water, busy_errors, size) == (16, 16, 1, 16, 2, 16)
+
+
+def test_stats_initial(stats_device):
+    # read before the response carrying them is queued
+    assert read_stats(stats_device) == (0, 0, 0, 0, 0, 16)
+
+
+def test_queue_overflow(basic_device):
+    basic_device.hid_send = lambda data: -errno.EBUSY
+
+    for sequence in range(20):
+        basic_device.protocol_dispatch(fw_info(sequence))
+
+    # the host went past the window, the extra requests are dropped
+    assert basic_device.queued_responses == 16
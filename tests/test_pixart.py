@@ -0,0 +1,272 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import struct
+
+import _testsuite
+import pytest
+
+
+BURST_ADDRESS = 0x50
+CPI_ADDRESS = 0x0F
+WRITE = 0x80
+
+
+def burst(dx, dy):
+    return struct.pack('<BBhh', 0x80, 0x00, dx, dy)
+
+
+@pytest.fixture()
+def sensor():
+    return _testsuite.PixartSensor()
+
+
+def test_motion_event_does_not_block(sensor):
+    start = sensor.now_us
+
+    sensor.motion_event()
+    assert sensor.selected
+    assert sensor.tx == bytes([BURST_ADDRESS])
+
+    # Tsrad_motbr has not elapsed, the burst data must not be clocked yet
+    assert not sensor.task()
+    assert sensor.transfer_pending is None
+
+    assert sensor.now_us == start
+
+
+def test_burst_read(sensor):
+    sensor.motion_event()
+    sensor.advance(34)
+    assert sensor.transfer_pending is None
+
+    # the Tsrad_motbr timeout starts the transfer, the task doesn't need to run
+    sensor.advance(1)
+    assert sensor.transfer_pending == 6
+    assert sensor.selected
+    assert sensor.wakeups == 0
+
+    # the driver is only woken up once the sample is ready
+    sensor.complete_transfer(burst(-3, 120))
+    assert not sensor.selected
+    sensor.advance(0)
+    assert sensor.wakeups == 1
+
+    assert sensor.task()
+    assert sensor.get_deltas() == (-3, 120)
+    assert not sensor.task()
+
+
+def test_burst_read_across_32bit_us(sensor):
+    # the clock is shared by the whole testsuite, move it right before 2**32 us
+    sensor.advance((2**32 - 10 - sensor.now_us) % 2**32)
+
+    sensor.motion_event()
+    sensor.advance(20)
+    assert sensor.now_us >= 2**32
+
+    # 20us passed, Tsrad_motbr (35us) must still be respected
+    assert sensor.transfer_pending is None
+
+    sensor.advance(15)
+    assert sensor.transfer_pending == 6
+
+
+def test_motion_event_while_busy(sensor):
+    sensor.motion_event()
+    sensor.motion_event()
+    sensor.advance(35)
+    sensor.motion_event()
+
+    assert sensor.tx == bytes([BURST_ADDRESS])
+
+    sensor.complete_transfer(burst(1, 2))
+    sensor.motion_event()
+    assert sensor.task()
+
+    # a new burst can only start once the previous one was consumed
+    sensor.motion_event()
+    sensor.advance(35)
+    sensor.complete_transfer(burst(1, 2))
+    assert sensor.task()
+
+    assert sensor.get_deltas() == (2, 4)
+
+
+def test_init_does_not_block():
+    firmware = bytes(range(256)) * 16
+    sensor = _testsuite.PixartSensor(firmware=firmware[:4094])
+    # reads back as a PMW3360 PID, with the SROM running bit set and a non-zero SROM ID
+    sensor.miso_idle = 0x42
+
+    start = sensor.now_us
+    steps = 0
+    while sensor.initializing:
+        step_start = sensor.now_us
+        assert not sensor.task()
+        # a step only starts a register access or a wait, it never waits itself
+        assert sensor.now_us == step_start
+        # nothing happens until the wait is over
+        tx_count = sensor.tx_count
+        sensor.task()
+        assert sensor.tx_count == tx_count
+        steps += 1
+        if sensor.initializing:
+            sensor.wait()
+
+    assert sensor.pid == 0x42
+    # the SROM is clocked one byte per wakeup, with the 15us gap enforced, the other steps are a handful
+    assert 4094 < steps < 4094 + 64
+    assert sensor.wakeups == steps - 1
+    assert sensor.now_us - start >= 50000 + 15000 + 4094 * 15 + 2000
+
+
+def run_init(sensor, miso=0x42):
+    sensor.miso_idle = miso
+    while True:
+        sensor.task()
+        if not sensor.initializing:
+            return sensor
+        sensor.wait()
+
+
+@pytest.mark.parametrize(
+    ('offset', 'block_size'),
+    [
+        (0, 4096),
+        (1000, 256),  # chunks straddle block boundaries
+        (4000, 8192),  # blob at the end of a partition
+    ]
+)
+def test_init_streams_srom(offset, block_size):
+    firmware = bytes(range(256)) * 16
+    reference = run_init(_testsuite.PixartSensor(firmware=firmware[:4094]))
+    sensor = run_init(_testsuite.PixartSensor(firmware=firmware, firmware_offset=offset, block_size=block_size))
+
+    assert sensor.pid == 0x42
+    # same SPI traffic as from a blob at the start of the flash, only the SROM is read, once
+    assert sensor.tx_hash == reference.tx_hash
+    assert sensor.tx_count == reference.tx_count
+    assert sensor.firmware_read_bytes == 4094
+
+    other = run_init(_testsuite.PixartSensor(firmware=bytes(4094)))
+    assert other.tx_hash != reference.tx_hash
+
+
+def test_init_short_blob():
+    sensor = _testsuite.PixartSensor(firmware=bytes(4093))
+
+    assert not sensor.initializing
+    assert sensor.pid == 0
+    assert sensor.tx_count == 0
+
+
+def test_init_bad_pid():
+    sensor = run_init(_testsuite.PixartSensor(firmware=bytes(4094)), miso=0x00)
+
+    assert sensor.pid == 0
+    sensor.motion_event()
+    assert not sensor.selected
+
+
+def test_high_speed_motion_is_not_lost(sensor):
+    # fast flick at high CPI, the host is busy for a few bursts
+    for _ in range(10):
+        sensor.motion_event()
+        sensor.advance(35)
+        sensor.complete_transfer(burst(30000, -30000))
+        assert sensor.poll_report(ready=False) is None
+
+    total_x = total_y = 0
+    while (report := sensor.poll_report()) is not None:
+        report_id, x, y, wheel, buttons = struct.unpack('<BhhbB', report)
+        assert report_id == 0x01
+        assert -32767 <= x <= 32767 and -32767 <= y <= 32767
+        total_x += x
+        total_y += y
+
+    assert (total_x, total_y) == (300000, -300000)
+
+
+def test_stalled_host_saturates(sensor):
+    # the host stops polling, enough motion to overflow a 32 bit accumulator
+    for _ in range(2 ** 31 // 30000 + 2):
+        sensor.motion_event()
+        sensor.advance(35)
+        sensor.complete_transfer(burst(30000, -30000))
+        sensor.poll_report(ready=False)
+
+    # still going the same way, not wrapped around
+    report_id, x, y, wheel, buttons = struct.unpack('<BhhbB', sensor.poll_report())
+    assert (x, y) == (32767, -32767)
+
+
+def write_register(sensor):
+    # address, Tsrad, value, and the gap before the next access
+    assert sensor.selected
+    sensor.wait()
+    assert not sensor.task()
+    assert not sensor.selected
+    sensor.wait()
+    assert not sensor.task()
+
+
+def test_set_cpi_does_not_block(sensor):
+    start = sensor.now_us
+
+    sensor.set_cpi(800)
+    assert sensor.busy
+    sensor.advance(0)
+    assert sensor.wakeups == 1
+
+    assert not sensor.task()
+    assert sensor.now_us == start
+    assert sensor.tx == bytes([CPI_ADDRESS | WRITE])
+
+    write_register(sensor)
+    assert sensor.tx == bytes([CPI_ADDRESS | WRITE, 800 // 100 - 1])
+    assert not sensor.busy
+
+
+def test_set_cpi_waits_for_burst(sensor):
+    sensor.motion_event()
+    sensor.set_cpi(1600)
+    sensor.advance(35)
+    assert sensor.transfer_pending == 6
+
+    # the burst is not interrupted, the CPI is written right after it was consumed
+    sensor.complete_transfer(burst(1, 2))
+    assert sensor.task()
+    assert sensor.busy
+    assert not sensor.task()
+    assert sensor.tx == bytes([BURST_ADDRESS]) + bytes(6) + bytes([CPI_ADDRESS | WRITE])
+
+    write_register(sensor)
+    assert sensor.tx.endswith(bytes([CPI_ADDRESS | WRITE, 1600 // 100 - 1]))
+    assert not sensor.busy
+
+
+def test_motion_event_during_cpi_write(sensor):
+    sensor.set_cpi(800)
+    sensor.task()
+
+    # the burst is held back until the register access is done
+    sensor.motion_event()
+    assert sensor.tx == bytes([CPI_ADDRESS | WRITE])
+
+    write_register(sensor)
+    assert sensor.selected
+    assert sensor.tx == bytes([CPI_ADDRESS | WRITE, 800 // 100 - 1, BURST_ADDRESS])
+
+    sensor.advance(35)
+    sensor.complete_transfer(burst(5, 6))
+    assert sensor.task()
+    assert sensor.get_deltas() == (5, 6)
+
+
+def test_invalid_cpi(sensor):
+    sensor.set_cpi(50)
+    sensor.task()
+
+    assert sensor.tx_count == 0
+    assert not sensor.busy
@@ -0,0 +1,164 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import struct
+import unittest.mock
+
+import pages
+import pytest
+import testsuite
+
+
+PROFILE_FORMAT = '<HH8s5B'  # cpi, polling rate, buttons, led (mode, brightness, rgb)
+DEFAULT_PROFILE = (800, 1000, bytes(range(1, 9)), 1, 255, 255, 255, 255)
+
+
+@pytest.fixture()
+def profiles_device():
+    device = testsuite.Device(
+        name='profiles test device',
+        functions={
+            pages.GeneralProfiles.PROFILE_INFO,
+            pages.GeneralProfiles.GET_ACTIVE_PROFILE,
+            pages.GeneralProfiles.SET_ACTIVE_PROFILE,
+            pages.GeneralProfiles.GET_PROFILE,
+            pages.GeneralProfiles.SET_CPI,
+            pages.GeneralProfiles.SET_POLLING_RATE,
+            pages.GeneralProfiles.SET_BUTTON,
+            pages.GeneralProfiles.SET_LED,
+            pages.GeneralProfiles.SAVE_PROFILES,
+        },
+    )
+    device.hid_send = unittest.mock.MagicMock()
+    return device
+
+
+def request(device, function, *args):
+    report = [0x20, 0x01, function] + list(args)
+    if len(report) > 8:
+        report[0] = 0x21
+        report += [0x00] * (32 - len(report))
+    else:
+        report += [0x00] * (8 - len(report))
+    device.protocol_dispatch(report)
+    return device.hid_send.call_args[0][0]
+
+
+def get_profile(device, index):
+    response = request(device, 0x03, index)
+    assert response[:4] == [0x21, 0x01, 0x03, index]
+    return struct.unpack_from(PROFILE_FORMAT, bytes(response[4:]))
+
+
+def active_profile(device):
+    return struct.unpack(PROFILE_FORMAT, device.active_profile)
+
+
+def test_info(profiles_device):
+    assert request(profiles_device, 0x00) == [0x20, 0x01, 0x00, 4, 8, 0, 0, 0]
+
+
+def test_defaults(profiles_device):
+    for index in range(4):
+        assert get_profile(profiles_device, index) == DEFAULT_PROFILE
+
+    assert profiles_device.apply_profile()
+    assert active_profile(profiles_device) == DEFAULT_PROFILE
+
+
+def test_set_settings(profiles_device):
+    assert request(profiles_device, 0x04, 2, 0x40, 0x06) == [0x20, 0x01, 0x04, 2, 0x40, 0x06, 0, 0]
+    request(profiles_device, 0x05, 2, 0x40, 0x1F)  # 8000
+    request(profiles_device, 0x06, 2, 0, 3)
+    request(profiles_device, 0x07, 2, 2, 128, 0x10, 0x20, 0x30)
+
+    assert get_profile(profiles_device, 2) == (1600, 8000, bytes([3, 2, 3, 4, 5, 6, 7, 8]), 2, 128, 0x10, 0x20, 0x30)
+    # other profiles are untouched
+    assert get_profile(profiles_device, 1) == DEFAULT_PROFILE
+
+
+@pytest.mark.parametrize(
+    ('function', 'args', 'position'),
+    [
+        (0x02, [4], 0),  # profile index
+        (0x03, [4], 0),
+        (0x04, [4, 0x20, 0x03], 0),
+        (0x04, [0, 0x00, 0x00], 1),  # cpi 0
+        (0x05, [0, 0x00, 0x00], 1),  # polling rate 0
+        (0x05, [0, 0x41, 0x1F], 1),  # polling rate 8001
+        (0x06, [0, 8, 1], 1),  # button
+        (0x07, [0, 4, 0, 0, 0, 0], 1),  # led mode
+        (0x07, [0, 2, 128, 0x10, 0x20], 5),  # short report, no room for blue
+    ]
+)
+def test_invalid_value(profiles_device, function, args, position):
+    response = request(profiles_device, function, *args)
+
+    assert response[:6] == [0x21 if len(args) > 5 else 0x20, 0xFF, 0x01, 0x01, function, position]
+
+
+def test_switch_is_applied_between_reports(profiles_device):
+    profiles_device.apply_profile()
+    request(profiles_device, 0x04, 1, 0x90, 0x01)  # 400 cpi on profile 1, not the active one
+    assert not profiles_device.apply_profile()
+
+    assert request(profiles_device, 0x02, 1) == [0x20, 0x01, 0x02, 1, 0, 0, 0, 0]
+    assert request(profiles_device, 0x01) == [0x20, 0x01, 0x01, 1, 0, 0, 0, 0]
+
+    # the report path keeps the old profile until it picks the new one up
+    assert active_profile(profiles_device) == DEFAULT_PROFILE
+    assert profiles_device.apply_profile()
+    assert active_profile(profiles_device)[0] == 400
+    assert profiles_device.apply_count == 2
+
+
+def test_changes_are_coalesced(profiles_device):
+    for cpi in range(100, 3300, 100):
+        request(profiles_device, 0x04, 0, cpi & 0xFF, cpi >> 8)
+        request(profiles_device, 0x02, cpi // 100 % 4)
+        profiles_device.advance(10)
+    # still within the flush delay of the first change
+    assert profiles_device.flash_writes == 0
+
+    profiles_device.advance(1000)
+    writes = profiles_device.flash_writes
+    assert 0 < writes <= 2 * 3  # profile + selected index, a few program operations each
+
+    profiles_device.reboot()
+    assert get_profile(profiles_device, 0)[0] == 3200
+    assert request(profiles_device, 0x01)[3] == 0
+
+
+def test_unflushed_changes_are_lost(profiles_device):
+    request(profiles_device, 0x04, 0, 0x20, 0x03)
+    profiles_device.reboot()
+
+    assert get_profile(profiles_device, 0) == DEFAULT_PROFILE
+
+
+def test_save(profiles_device):
+    request(profiles_device, 0x04, 3, 0x84, 0x03)
+    request(profiles_device, 0x02, 3)
+    assert request(profiles_device, 0x08) == [0x20, 0x01, 0x08, 0, 0, 0, 0, 0]
+
+    profiles_device.reboot()
+    assert get_profile(profiles_device, 3)[0] == 900
+    assert profiles_device.apply_profile()
+    assert active_profile(profiles_device)[0] == 900
+    assert request(profiles_device, 0x01)[3] == 3
+
+
+def test_unchanged_settings_are_not_written(profiles_device):
+    request(profiles_device, 0x04, 0, 0x20, 0x03)  # the default
+    request(profiles_device, 0x02, 0)
+    profiles_device.advance(2000)
+
+    assert profiles_device.flash_writes == 0
+
+
+def test_unsupported_without_profiles_page(basic_device):
+    basic_device.protocol_dispatch([0x20, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00])
+
+    basic_device.hid_send.assert_called_with(
+        [0x20, 0xFF, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00]
+    )
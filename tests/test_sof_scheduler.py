@@ -0,0 +1,115 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import struct
+import unittest.mock
+
+import pages
+import pytest
+import testsuite
+
+
+@pytest.fixture()
+def debug_device():
+    device = testsuite.Device(
+        name='debug test device',
+        functions={
+            pages.Debug.SOF_STATS,
+        },
+    )
+    device.hid_send = unittest.mock.MagicMock()
+    return device
+
+
+def read_stats(device, reset=False):
+    device.protocol_dispatch([0x20, 0xFE, 0x00, int(reset), 0x00, 0x00, 0x00, 0x00])
+    response = device.hid_send.call_args[0][0]
+    assert response[:3] == [0x21, 0xFE, 0x00]
+    return struct.unpack('<5I', bytes(response[3:23]))
+
+
+def run_frames(device, frames, offsets):
+    '''Runs 1ms frames, polling the scheduler at each offset (us) of every frame.'''
+    sampled = []
+    for frame in range(frames):
+        sof = 1000 + frame * 1000
+        device.sof(sof)
+        for offset in offsets:
+            if device.sof_poll(sof + offset):
+                sampled.append(offset)
+    device.sof(1000 + frames * 1000)
+    return sampled
+
+
+def test_sample_once_per_frame_before_sof(debug_device):
+    sampled = run_frames(debug_device, 10, range(0, 1000, 50))
+
+    # 200us lead, first eligible poll is at 800us, and only one per frame
+    assert sampled == [800] * 10
+
+
+def test_high_speed_period(debug_device):
+    # 125us microframes, the lead covers the whole frame so the sample is taken at the SOF
+    debug_device.sof_set_period(125, 200)
+    debug_device.sof(1000)
+
+    assert debug_device.sof_sample_delay(1000) == 0
+    assert debug_device.sof_poll(1000)
+    assert not debug_device.sof_poll(1100)
+    debug_device.sof(1125)
+    assert debug_device.sof_poll(1125)
+
+    # back to full speed, the lead is taken again instead of staying clamped
+    debug_device.sof_set_period(1000, 200)
+    debug_device.sof(1250)
+    assert debug_device.sof_sample_delay(1250) == 800
+
+
+def test_sample_delay(debug_device):
+    debug_device.sof(1000)
+
+    # a timer armed from the SOF fires right at the sampling point
+    assert debug_device.sof_sample_delay(1000) == 800
+    assert debug_device.sof_sample_delay(1750) == 50
+    assert not debug_device.sof_poll(1750)
+    assert debug_device.sof_sample_delay(1800) == 0
+    assert debug_device.sof_poll(1800)
+
+    # late, the sample is due right away
+    debug_device.sof(2000)
+    assert debug_device.sof_sample_delay(2950) == 0
+
+
+def test_no_sample_before_first_sof(debug_device):
+    assert not debug_device.sof_poll(900)
+
+
+def test_stats(debug_device):
+    debug_device.sof(1000)
+    assert debug_device.sof_poll(1810)
+    debug_device.sof(2000)
+    assert debug_device.sof_poll(2850)
+    debug_device.sof(3000)
+
+    samples, latency_min, latency_avg, latency_max, jitter = read_stats(debug_device)
+
+    assert samples == 2
+    assert latency_min == 150
+    assert latency_avg == 170
+    assert latency_max == 190
+    assert jitter == 40
+
+
+def test_stats_reset(debug_device):
+    run_frames(debug_device, 5, range(0, 1000, 100))
+
+    assert read_stats(debug_device, reset=True)[0] == 5
+    assert read_stats(debug_device) == (0, 0, 0, 0, 0)
+
+
+def test_stats_invalid_flags(debug_device):
+    debug_device.protocol_dispatch([0x20, 0xFE, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00])
+
+    debug_device.hid_send.assert_called_with(
+        [0x20, 0xFF, 0x01, 0xFE, 0x00, 0x00, 0x00, 0x00]
+    )
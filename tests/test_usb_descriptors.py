@@ -0,0 +1,63 @@
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import _testsuite
+import pytest
+
+
+def parse(desc):
+    descriptors = []
+    while desc:
+        length = desc[0]
+        assert 2 <= length <= len(desc)
+        descriptors.append(desc[:length])
+        desc = desc[length:]
+    return descriptors
+
+
+def polling_rate(interval, high_speed):
+    if high_speed:
+        assert 1 <= interval <= 16
+        return 8000 / 2 ** (interval - 1)
+    assert 1 <= interval <= 255
+    return 1000 / interval
+
+
+@pytest.mark.parametrize('high_speed', [False, True])
+@pytest.mark.parametrize('rate', [125, 250, 500, 1000, 2000, 4000, 8000])
+def test_configuration_descriptor(rate, high_speed):
+    desc = _testsuite.usb_configuration_descriptor(rate, high_speed)
+    config, *descriptors = parse(desc)
+
+    assert config[1] == 0x02
+    assert int.from_bytes(config[2:4], 'little') == len(desc)
+    assert config[4] == sum(d[1] == 0x04 for d in descriptors)
+
+    endpoints = {d[2]: d for d in descriptors if d[1] == 0x05}
+    assert set(endpoints) == {0x81, 0x01, 0x82}
+    for endpoint in endpoints.values():
+        assert endpoint[3] == 0x03  # interrupt
+        assert int.from_bytes(endpoint[4:6], 'little') <= 64
+
+    # the protocol endpoints stay at 100Hz (or the closest faster rate the bus can do)
+    assert 100 <= polling_rate(endpoints[0x81][6], high_speed) <= 100 * 1.3
+    assert 100 <= polling_rate(endpoints[0x01][6], high_speed) <= 100 * 1.3
+
+    # full speed caps at 1000Hz
+    assert polling_rate(endpoints[0x82][6], high_speed) == min(rate, 8000 if high_speed else 1000)
+
+
+@pytest.mark.parametrize('high_speed', [False, True])
+@pytest.mark.parametrize('rate', [1, 3, 5, 63, 100, 300, 700, 1500, 5000])
+def test_polling_rate_rounding(rate, high_speed):
+    parsed = parse(_testsuite.usb_configuration_descriptor(rate, high_speed))
+    endpoint = next(d for d in parsed if d[1] == 0x05 and d[2] == 0x82)
+
+    # never slower than asked for
+    interval = endpoint[6]
+    requested = min(rate, 8000 if high_speed else 1000)
+    assert polling_rate(interval, high_speed) >= requested
+
+    # but as close as possible, the next slower interval (if there is one) would be too slow
+    if interval < (16 if high_speed else 255):
+        assert polling_rate(interval + 1, high_speed) < requested
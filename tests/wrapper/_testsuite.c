@@ -4,25 +4,128 @@
  */
 
 #include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 #include <Python.h>
 
+#include "driver/pixart/pixart_pmw.h"
+#include "platform/testsuite/hal/spi.h"
+#include "platform/testsuite/hal/ticks.h"
+#include "platform/testsuite/hal/timer.h"
 #include "protocol/protocol.h"
+#include "protocol/reports.h"
+#include "util/blob/blob.h"
+#include "util/block_cache/block_cache.h"
+#include "util/data.h"
+#include "util/event_loop/event_loop.h"
+#include "util/fw_update/fw_update.h"
+#include "util/hid_descriptors.h"
+#include "util/motion.h"
+#include "util/nvs/nvs.h"
+#include "util/partition/partition.h"
+#include "util/profiles/profiles.h"
+#include "util/ram_blockdev/ram_blockdev.h"
+#include "util/sof_scheduler/sof_scheduler.h"
+#include "util/usb_descriptors.h"
 
 typedef struct {
 	/* clang-format off */
 	PyObject_HEAD
 	struct protocol_config_t config;
+	struct protocol_pipeline_t pipeline;
+	struct sof_scheduler_t scheduler;
+	struct ram_blockdev_t flash;
+	struct nvs_t nvs;
+	struct event_loop_t loop;
+	struct profiles_t profiles;
+	unsigned long apply_count;
+	struct ram_blockdev_t fw_slots[FW_UPDATE_SLOTS];
+	struct fw_update_t fw_update;
 	/* clang-format on */
 } DeviceObject;
 
+#define DEVICE_FLASH_BLOCKS	4
+#define DEVICE_FLASH_BLOCK_SIZE 4096
+#define DEVICE_FW_SLOT_BLOCKS	8
+
+static const struct profile_t device_default_profile = {
+	.cpi = 800,
+	.polling_rate = 1000,
+	.buttons = {1, 2, 3, 4, 5, 6, 7, 8},
+	.led = {.mode = PROFILE_LED_STATIC, .brightness = 255, .red = 255, .green = 255, .blue = 255},
+};
+
+typedef struct {
+	/* clang-format off */
+	PyObject_HEAD
+	struct spi_mock_t spi;
+	struct timer_mock_t timer;
+	struct event_loop_t loop;
+	struct event_work_t work;
+	unsigned long wakeups;
+	struct pixart_pmw_driver_t driver;
+	struct motion_t motion;
+	/* the firmware blob lives in an emulated flash */
+	struct ram_blockdev_t flash;
+	struct blob_t firmware;
+	/* clang-format on */
+} PixartSensorObject;
+
+#define EVENT_LOOP_MAX_WORKS  8
+#define EVENT_LOOP_MAX_TIMERS 8
+
+typedef struct {
+	/* clang-format off */
+	PyObject_HEAD
+	struct event_loop_t loop;
+	struct event_work_t works[EVENT_LOOP_MAX_WORKS];
+	PyObject *work_callbacks[EVENT_LOOP_MAX_WORKS];
+	size_t work_count;
+	struct event_timer_t timers[EVENT_LOOP_MAX_TIMERS];
+	PyObject *timer_callbacks[EVENT_LOOP_MAX_TIMERS];
+	size_t timer_count;
+	unsigned long idle_count;
+	/* clang-format on */
+} EventLoopObject;
+
+typedef struct {
+	/* clang-format off */
+	PyObject_HEAD
+	struct ram_blockdev_t flash;
+	struct block_cache_t cache;
+	struct blockdev_hal_t hal;
+	struct nvs_t nvs;
+	/* clang-format on */
+} NvsObject;
+
+typedef struct {
+	/* clang-format off */
+	PyObject_HEAD
+	struct ram_blockdev_t flash;
+	struct block_cache_t cache;
+	struct blockdev_hal_t hal;
+	/* clang-format on */
+} RamBlockdevObject;
+
+typedef struct {
+	/* clang-format off */
+	PyObject_HEAD
+	PyObject *data;
+	struct partition_index_t index;
+	/* clang-format on */
+} PartitionTableObject;
+
 /* firmware callbacks */
 
 int hal_hid_send(struct hid_hal_t interface, u8 *buffer, size_t buffer_size)
 {
 	int rc = 0;
 	DeviceObject *self = interface.drv_data;
-	PyObject *callback, *bytes, *list;
+	PyObject *callback, *bytes, *list, *result;
 	PyGILState_STATE state;
 
 	callback = PyObject_GetAttrString((PyObject *) self, "hid_send");
@@ -46,9 +149,15 @@ int hal_hid_send(struct hid_hal_t interface, u8 *buffer, size_t buffer_size)
 		goto error_bytes;
 
 	state = PyGILState_Ensure();
-	PyObject_CallOneArg(callback, list);
+	result = PyObject_CallOneArg(callback, list);
+	/* the callback may return an error code, eg. -EBUSY to simulate a busy endpoint */
+	if (result && PyLong_Check(result))
+		rc = PyLong_AsLong(result);
+	Py_XDECREF(result);
 	PyGILState_Release(state);
 
+	Py_DECREF(list);
+
 error_bytes:
 	Py_DECREF(bytes);
 error:
@@ -56,6 +165,201 @@ error:
 	return rc;
 }
 
+static int hal_hid_send_discard(struct hid_hal_t interface, u8 *buffer, size_t buffer_size)
+{
+	return 0;
+}
+
+/* benchmark helpers */
+
+static u64 bench_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	/* no portable cycle counter, fall back to nanoseconds */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static double bench_seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* flash helpers */
+
+static PyObject *oserror(int ret)
+{
+	PyObject *error = Py_BuildValue("(is)", -ret, strerror(-ret));
+
+	if (error) {
+		PyErr_SetObject(PyExc_OSError, error);
+		Py_DECREF(error);
+	}
+	return NULL;
+}
+
+static void flash_free(struct ram_blockdev_t *flash)
+{
+	PyMem_Free(flash->data);
+	PyMem_Free(flash->erase_count);
+	memset(flash, 0, sizeof(*flash));
+}
+
+/* fresh devices come erased, unless we start from a saved image */
+static int flash_alloc(struct ram_blockdev_t *flash, u16 block_count, u16 block_size, u16 write_size, const Py_buffer *image)
+{
+	size_t size = (size_t) block_count * block_size;
+
+	if (!block_count || !block_size || !write_size || (image && image->buf && (size_t) image->len != size)) {
+		PyErr_SetString(PyExc_ValueError, "invalid flash geometry");
+		return -1;
+	}
+
+	flash_free(flash);
+	flash->data = PyMem_Malloc(size);
+	flash->erase_count = PyMem_Calloc(block_count, sizeof(u32));
+	if (!flash->data || !flash->erase_count) {
+		flash_free(flash);
+		PyErr_NoMemory();
+		return -1;
+	}
+
+	if (image && image->buf)
+		memcpy(flash->data, image->buf, size);
+	else
+		memset(flash->data, 0xFF, size);
+
+	flash->block_count = block_count;
+	flash->block_size = block_size;
+	flash->write_size = write_size;
+	/* simulated latencies advance the virtual clock */
+	flash->ticks = ticks_hal_init_mock();
+
+	return 0;
+}
+
+/* the flash HAL, behind a write-back cache if cache_page_size is not 0 */
+static int flash_hal(struct ram_blockdev_t *flash,
+		     struct block_cache_t *cache,
+		     u16 cache_page_size,
+		     struct blockdev_hal_t *hal)
+{
+	*hal = blockdev_hal_init_ram(flash);
+	memset(cache, 0, sizeof(*cache));
+
+	if (!cache_page_size)
+		return 0;
+
+	if (block_cache_init(cache, *hal, cache_page_size) < 0) {
+		PyErr_SetString(PyExc_ValueError, "invalid cache page size");
+		return -1;
+	}
+
+	*hal = blockdev_hal_init_cache(cache);
+	return 0;
+}
+
+static PyObject *flash_image(struct ram_blockdev_t *flash)
+{
+	return PyBytes_FromStringAndSize((char *) flash->data, (Py_ssize_t) flash->block_size * flash->block_count);
+}
+
+static PyObject *flash_erase_counts(struct ram_blockdev_t *flash)
+{
+	PyObject *list = PyList_New(flash->block_count);
+
+	if (!list)
+		return NULL;
+
+	for (size_t i = 0; i < flash->block_count; i++)
+		PyList_SET_ITEM(list, i, PyLong_FromUnsignedLong(flash->erase_count[i]));
+
+	return list;
+}
+
+/* module methods */
+
+static PyObject *testsuite_spi_throughput(PyObject *self, PyObject *args)
+{
+	struct spi_mock_t mock = {};
+	struct spi_hal_t hal = spi_hal_init_mock(&mock);
+	unsigned long size, iterations;
+	int bulk;
+	u8 *buffer;
+	double start, end;
+
+	if (!PyArg_ParseTuple(args, "kkp", &size, &iterations, &bulk))
+		return NULL;
+
+	if (size == 0 || iterations == 0) {
+		PyErr_SetString(PyExc_ValueError, "size and iterations must be greater than 0");
+		return NULL;
+	}
+
+	buffer = PyMem_Calloc(size, sizeof(u8));
+	if (!buffer)
+		return PyErr_NoMemory();
+
+	start = bench_seconds();
+	for (unsigned long i = 0; i < iterations; i++) {
+		mock.tx_count = 0;
+		if (bulk) {
+			hal.transfer_buf(hal, buffer, buffer, size);
+		} else {
+			for (size_t j = 0; j < size; j++) buffer[j] = hal.transfer(hal, buffer[j]);
+		}
+	}
+	end = bench_seconds();
+
+	PyMem_Free(buffer);
+
+	return PyFloat_FromDouble((double) size * iterations / (end - start));
+}
+
+static PyObject *testsuite_usb_configuration_descriptor(PyObject *self, PyObject *args)
+{
+	unsigned int rate;
+	int high_speed;
+
+	if (!PyArg_ParseTuple(args, "Ip", &rate, &high_speed))
+		return NULL;
+
+	if (rate == 0) {
+		PyErr_SetString(PyExc_ValueError, "rate must be greater than 0");
+		return NULL;
+	}
+
+	/* same as the samx7x descriptors, with runtime rates */
+	const u8 oi_interval = high_speed ? USB_HS_INTERVAL(100) : USB_FS_INTERVAL(100);
+	const u8 mouse_interval = high_speed ? USB_HS_INTERVAL(rate) : USB_FS_INTERVAL(rate);
+	const u8 desc[] = USB_DESC_CONFIGURATION_OI_MOUSE(
+		sizeof(oi_rdesc), sizeof(desc_hid_mouse_report_16), oi_interval, mouse_interval);
+
+	return PyBytes_FromStringAndSize((const char *) desc, sizeof(desc));
+}
+
+static PyObject *testsuite_page_index(PyObject *self, PyObject *args)
+{
+	unsigned char function_page;
+
+	if (!PyArg_ParseTuple(args, "b", &function_page))
+		return NULL;
+
+	return PyLong_FromLong(protocol_page_index(function_page));
+}
+
+static PyMethodDef testsuite_methods[] = {
+	{"spi_throughput", (PyCFunction) testsuite_spi_throughput, METH_VARARGS, NULL},
+	{"usb_configuration_descriptor", (PyCFunction) testsuite_usb_configuration_descriptor, METH_VARARGS, NULL},
+	{"page_index", (PyCFunction) testsuite_page_index, METH_VARARGS, NULL},
+	{NULL, NULL, 0, NULL}};
+
 /* Device class methods */
 
 static PyObject *Device_protocol_dispatch(DeviceObject *self, PyObject *args)
@@ -69,7 +373,7 @@ static PyObject *Device_protocol_dispatch(DeviceObject *self, PyObject *args)
 	if (!bytes)
 		goto error;
 
-	protocol_dispatch(self->config, (u8 *) PyBytes_AsString(bytes), PyBytes_Size(bytes));
+	protocol_dispatch(&self->config, (u8 *) PyBytes_AsString(bytes), PyBytes_Size(bytes));
 
 	Py_DECREF(bytes);
 
@@ -80,118 +384,1616 @@ error:
 	return NULL;
 }
 
-/* Device constructor and destructor */
+/* feature report path, returns the response instead of sending it */
+static PyObject *Device_protocol_dispatch_sync(DeviceObject *self, PyObject *args)
+{
+	PyObject *data = NULL, *bytes = NULL, *response_bytes;
+	u8 response[OI_REPORT_LONG_SIZE];
+	int ret;
 
-static int Device_init(DeviceObject *self, PyObject *args, PyObject *kw)
+	if (!PyArg_ParseTuple(args, "O", &data))
+		return NULL;
+
+	bytes = PyBytes_FromObject(data);
+	if (!bytes)
+		return NULL;
+
+	ret = protocol_dispatch_sync(
+		&self->config, (u8 *) PyBytes_AsString(bytes), PyBytes_Size(bytes), response, sizeof(response));
+	Py_DECREF(bytes);
+	if (ret < 0)
+		return oserror(ret);
+
+	response_bytes = PyBytes_FromStringAndSize((char *) response, ret);
+	if (!response_bytes)
+		return NULL;
+
+	data = PySequence_List(response_bytes);
+	Py_DECREF(response_bytes);
+	return data;
+}
+
+/* the endpoint is done with the last report */
+static PyObject *Device_protocol_flush(DeviceObject *self, PyObject *Py_UNUSED(ignored))
 {
-	int rc = -1;
-	static char *keywords[] = {"name", "functions", NULL};
-	PyObject *functions = NULL, *page = NULL, *page_bytes = NULL;
-	Py_ssize_t page_count, page_index, function_count;
+	protocol_flush(&self->config);
 
-	if (!PyArg_ParseTupleAndKeywords(args, kw, "sO", keywords, &self->config.device_name, &functions))
-		goto error;
+	Py_RETURN_NONE;
+}
 
-	/* construct functions array from python list */
+static PyObject *Device_dispatch_cost(DeviceObject *self, PyObject *args)
+{
+	PyObject *data = NULL, *bytes = NULL;
+	struct hid_hal_t hid_hal = self->config.hid_hal;
+	unsigned long iterations;
+	u64 start, end;
 
-	if (!PyList_Check(functions)) {
-		PyErr_Format(PyExc_TypeError, "Invalid functions value (expecting list, got %s)", Py_TYPE(functions)->tp_name);
+	if (!PyArg_ParseTuple(args, "Ok", &data, &iterations))
 		goto error;
-	}
 
-	page_count = PyList_Size(functions);
-	if (page_count != PAGE_COUNT) {
-		PyErr_Format(PyExc_ValueError, "Invalid function list size (expecting %d, got %d)", PAGE_COUNT, page_count);
+	if (iterations == 0) {
+		PyErr_SetString(PyExc_ValueError, "iterations must be greater than 0");
 		goto error;
 	}
 
-	for (page_index = 0; page_index < page_count; page_index++) {
-		/* get page, convert it to bytes, and fill the functions array */
+	bytes = PyBytes_FromObject(data);
+	if (!bytes)
+		goto error;
 
-		page = PyList_GetItem(functions, page_index);
-		if (!page)
-			goto error;
+	/* don't measure the python callback */
+	self->config.hid_hal.send = hal_hid_send_discard;
 
-		page_bytes = PyBytes_FromObject(page);
-		if (!page_bytes)
-			goto error;
+	start = bench_cycles();
+	for (unsigned long i = 0; i < iterations; i++)
+		protocol_dispatch(&self->config, (u8 *) PyBytes_AsString(bytes), PyBytes_Size(bytes));
+	end = bench_cycles();
 
-		/* alocate function page array */
-		function_count = PyBytes_Size(page_bytes);
-		self->config.functions[page_index] = PyMem_Calloc(sizeof(u8), function_count);
-		self->config.functions_size[page_index] = function_count;
+	self->config.hid_hal = hid_hal;
 
-		memcpy(self->config.functions[page_index], PyBytes_AsString(page_bytes), sizeof(u8) * function_count);
+	Py_DECREF(bytes);
 
-		Py_DECREF(page_bytes);
-		Py_DECREF(page);
+	return PyFloat_FromDouble((double) (end - start) / iterations);
+
+error:
+	return NULL;
+}
+
+/*
+ * handler lookup only, the part of the dispatch that depends on where the function is registered
+ *
+ * The lookups are a handful of cycles, so they are timed in short interleaved rounds, and the
+ * fastest round of each is kept, that way they all see the same clock and cache state.
+ */
+static PyObject *Device_lookup_cost(DeviceObject *self, PyObject *args)
+{
+	PyObject *lookups = NULL, *costs = NULL;
+	unsigned long iterations, rounds;
+	Py_ssize_t count;
+	u8(*functions)[2] = NULL;
+	u64 *best = NULL;
+	u64 start, end;
+	int supported;
+
+	if (!PyArg_ParseTuple(args, "Okk", &lookups, &iterations, &rounds))
+		return NULL;
+
+	if (iterations == 0 || rounds == 0) {
+		PyErr_SetString(PyExc_ValueError, "iterations and rounds must be greater than 0");
+		return NULL;
 	}
 
-	self->config.hid_hal = (struct hid_hal_t){
-		.send = hal_hid_send,
-		.drv_data = self,
-	};
+	lookups = PySequence_Fast(lookups, "lookups must be a sequence of (page, function)");
+	if (!lookups)
+		return NULL;
 
-	rc = 0;
+	count = PySequence_Fast_GET_SIZE(lookups);
+	functions = PyMem_Calloc(count, sizeof(*functions));
+	best = PyMem_Calloc(count, sizeof(*best));
+	if (!functions || !best) {
+		PyErr_NoMemory();
+		goto error;
+	}
+
+	for (Py_ssize_t i = 0; i < count; i++) {
+		if (!PyArg_ParseTuple(PySequence_Fast_GET_ITEM(lookups, i), "bb", &functions[i][0], &functions[i][1]))
+			goto error;
+		if (!protocol_is_supported(&self->config, functions[i][0], functions[i][1])) {
+			PyErr_Format(
+				PyExc_ValueError, "function 0x%02x 0x%02x is not supported", functions[i][0], functions[i][1]);
+			goto error;
+		}
+		best[i] = UINT64_MAX;
+	}
+
+	for (unsigned long round = 0; round < rounds; round++) {
+		for (Py_ssize_t i = 0; i < count; i++) {
+			supported = 0;
+			start = bench_cycles();
+			for (unsigned long j = 0; j < iterations; j++)
+				supported += protocol_is_supported(&self->config, functions[i][0], functions[i][1]);
+			end = bench_cycles();
+			/* keeps the lookups from being optimized out */
+			if (supported == (int) iterations)
+				best[i] = min(best[i], end - start);
+		}
+	}
+
+	costs = PyList_New(count);
+	if (!costs)
+		goto error;
+	for (Py_ssize_t i = 0; i < count; i++)
+		PyList_SET_ITEM(costs, i, PyFloat_FromDouble((double) best[i] / iterations));
 
 error:
-	return rc;
+	PyMem_Free(functions);
+	PyMem_Free(best);
+	Py_DECREF(lookups);
+	return costs;
 }
 
-static void Device_dealloc(DeviceObject *self)
+/* feature report round trip, the request in and the response back out */
+static PyObject *Device_dispatch_sync_cost(DeviceObject *self, PyObject *args)
 {
-	for (size_t i = 0; i < PAGE_COUNT; i++) PyMem_Free(self->config.functions[i]);
-	Py_TYPE(self)->tp_free((PyObject *) self);
-}
+	PyObject *data = NULL, *bytes = NULL;
+	u8 response[OI_REPORT_LONG_SIZE];
+	unsigned long iterations;
+	u64 start, end;
 
-/* Device class definition */
+	if (!PyArg_ParseTuple(args, "Ok", &data, &iterations))
+		return NULL;
 
-static PyMethodDef Device_methods[] = {
-	{"protocol_dispatch", (PyCFunction) Device_protocol_dispatch, METH_VARARGS | METH_KEYWORDS, NULL},
-	{NULL, NULL, 0, NULL}};
+	if (iterations == 0) {
+		PyErr_SetString(PyExc_ValueError, "iterations must be greater than 0");
+		return NULL;
+	}
 
-static PyTypeObject DeviceType = {
-	/* clang-format off */
-	PyVarObject_HEAD_INIT(NULL, 0)
-	.tp_name = "_testsuite.Device",
-	.tp_doc = "Test device",
-	.tp_basicsize = sizeof(DeviceObject),
-	.tp_itemsize = 0,
-	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
-	.tp_new = PyType_GenericNew,
-	.tp_init = (initproc) Device_init,
-	.tp_dealloc = (destructor) Device_dealloc,
-	.tp_methods = Device_methods,
-	/* clang-format on */
-};
+	bytes = PyBytes_FromObject(data);
+	if (!bytes)
+		return NULL;
 
-/* module definition */
+	start = bench_cycles();
+	for (unsigned long i = 0; i < iterations; i++)
+		protocol_dispatch_sync(
+			&self->config, (u8 *) PyBytes_AsString(bytes), PyBytes_Size(bytes), response, sizeof(response));
+	end = bench_cycles();
 
-static struct PyModuleDef testsuite_module = {
-	/* clang-format off */
-	PyModuleDef_HEAD_INIT,
-	"_testsuite",
-	"Wrapper module for the openinput testsuite target.",
-	-1,
-	NULL, //testsuite_methods,
-	/* clang-format on */
-};
+	Py_DECREF(bytes);
 
-PyMODINIT_FUNC PyInit__testsuite(void)
+	return PyFloat_FromDouble((double) (end - start) / iterations);
+}
+
+static PyObject *Device_sof(DeviceObject *self, PyObject *args)
 {
-	Py_Initialize();
+	unsigned int now_us;
 
-	PyObject *m = NULL;
+	if (!PyArg_ParseTuple(args, "I", &now_us))
+		return NULL;
 
-	if (PyType_Ready(&DeviceType) < 0)
+	sof_scheduler_sof(&self->scheduler, now_us);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *Device_sof_poll(DeviceObject *self, PyObject *args)
+{
+	unsigned int now_us;
+
+	if (!PyArg_ParseTuple(args, "I", &now_us))
 		return NULL;
 
-	if ((m = PyModule_Create(&testsuite_module)) == NULL)
+	return PyBool_FromLong(sof_scheduler_poll(&self->scheduler, now_us));
+}
+
+static PyObject *Device_sof_sample_delay(DeviceObject *self, PyObject *args)
+{
+	unsigned int now_us;
+
+	if (!PyArg_ParseTuple(args, "I", &now_us))
 		return NULL;
 
-	Py_XINCREF(&DeviceType);
+	return PyLong_FromUnsignedLong(sof_scheduler_sample_delay(&self->scheduler, now_us));
+}
 
-	PyModule_AddObject(m, "Device", (PyObject *) &DeviceType);
+static PyObject *Device_sof_set_period(DeviceObject *self, PyObject *args)
+{
+	unsigned int period_us, lead_us;
+
+	if (!PyArg_ParseTuple(args, "II", &period_us, &lead_us))
+		return NULL;
+
+	sof_scheduler_set_period(&self->scheduler, period_us, lead_us);
+
+	Py_RETURN_NONE;
+}
+
+static void device_profile_applied(const struct profile_t *profile, void *data)
+{
+	DeviceObject *self = data;
+
+	self->apply_count++;
+}
+
+/* mount the flash and load the profiles, like the firmware does at boot, slot < 0 boots what the record points to */
+static int device_boot(DeviceObject *self, int slot)
+{
+	struct fw_update_record_t record;
+	int ret = nvs_mount(&self->nvs, blockdev_hal_init_ram(&self->flash));
+
+	if (ret < 0) {
+		oserror(ret);
+		return -1;
+	}
+
+	event_loop_init(&self->loop, ticks_mock_get_ticks, NULL);
+	profiles_init(&self->profiles, &device_default_profile, &self->nvs, &self->loop);
+	profiles_attach_apply_callback(&self->profiles, device_profile_applied, self);
+	self->config.profiles = &self->profiles;
+
+	/* the bootloader */
+	if (slot < 0)
+		slot = fw_update_read_record(&self->nvs, &record) == 0 ? record.slot : 0;
+
+	ret = fw_update_init(&self->fw_update,
+			     blockdev_hal_init_ram(&self->fw_slots[0]),
+			     blockdev_hal_init_ram(&self->fw_slots[1]),
+			     slot,
+			     &self->nvs);
+	if (ret < 0) {
+		oserror(ret);
+		return -1;
+	}
+	self->config.fw_update = &self->fw_update;
+
+	return 0;
+}
+
+static PyObject *Device_advance(DeviceObject *self, PyObject *args)
+{
+	unsigned int ms;
+
+	if (!PyArg_ParseTuple(args, "I", &ms))
+		return NULL;
+
+	ticks_mock_advance_us(ms * 1000);
+	event_loop_run_once(&self->loop);
+
+	Py_RETURN_NONE;
+}
+
+/* what the report path does before building a report */
+static PyObject *Device_apply_profile(DeviceObject *self, PyObject *Py_UNUSED(ignored))
+{
+	return PyBool_FromLong(profiles_apply(&self->profiles));
+}
+
+/* power cycle, anything that wasn't flushed is lost, slot overrides the one the bootloader picks */
+static PyObject *Device_reboot(DeviceObject *self, PyObject *args, PyObject *kw)
+{
+	static char *keywords[] = {"slot", NULL};
+	int slot = -1;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "|i", keywords, &slot))
+		return NULL;
+
+	if (device_boot(self, slot) < 0)
+		return NULL;
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *Device_get_active_profile(DeviceObject *self, void *closure)
+{
+	return PyBytes_FromStringAndSize((const char *) profiles_active(&self->profiles), sizeof(struct profile_t));
+}
+
+static PyObject *Device_get_apply_count(DeviceObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->apply_count);
+}
+
+static PyObject *Device_get_flash_writes(DeviceObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->flash.program_count);
+}
+
+static PyObject *Device_get_queued_responses(DeviceObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(TX_QUEUE_SIZE - tx_queue_space(&self->pipeline.queue));
+}
+
+static PyObject *Device_get_fw_slots(DeviceObject *self, void *closure)
+{
+	return Py_BuildValue("(NN)", flash_image(&self->fw_slots[0]), flash_image(&self->fw_slots[1]));
+}
+
+static PyObject *Device_get_fw_slot_erases(DeviceObject *self, void *closure)
+{
+	return Py_BuildValue("(NN)", flash_erase_counts(&self->fw_slots[0]), flash_erase_counts(&self->fw_slots[1]));
+}
+
+/* Device constructor and destructor */
+
+static int Device_init(DeviceObject *self, PyObject *args, PyObject *kw)
+{
+	int rc = -1;
+	static char *keywords[] = {"name", "functions", NULL};
+	PyObject *functions = NULL, *page = NULL, *page_bytes = NULL;
+	Py_ssize_t page_count, page_index, function_count;
+	u8 *functions_array;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "sO", keywords, &self->config.device_name, &functions))
+		goto error;
+
+	/* construct functions array from python list */
+
+	if (!PyList_Check(functions)) {
+		PyErr_Format(PyExc_TypeError, "Invalid functions value (expecting list, got %s)", Py_TYPE(functions)->tp_name);
+		goto error;
+	}
+
+	page_count = PyList_Size(functions);
+	if (page_count != PAGE_COUNT) {
+		PyErr_Format(PyExc_ValueError, "Invalid function list size (expecting %d, got %d)", PAGE_COUNT, page_count);
+		goto error;
+	}
+
+	for (page_index = 0; page_index < page_count; page_index++) {
+		/* get page, convert it to bytes, and fill the functions array */
+
+		page = PyList_GetItem(functions, page_index);
+		if (!page)
+			goto error;
+
+		page_bytes = PyBytes_FromObject(page);
+		if (!page_bytes)
+			goto error;
+
+		/* alocate function page array */
+		function_count = PyBytes_Size(page_bytes);
+		functions_array = PyMem_Calloc(sizeof(u8), function_count);
+
+		memcpy(functions_array, PyBytes_AsString(page_bytes), sizeof(u8) * function_count);
+		protocol_set_functions(&self->config, page_index, functions_array, function_count);
+
+		Py_DECREF(page_bytes);
+		Py_DECREF(page);
+	}
+
+	self->config.hid_hal = (struct hid_hal_t){
+		.send = hal_hid_send,
+		.drv_data = self,
+	};
+	memset(&self->pipeline, 0, sizeof(self->pipeline));
+	self->config.pipeline = &self->pipeline;
+
+	/* full speed frames, same as the stm32f1 target */
+	sof_scheduler_init(&self->scheduler, 1000, 200);
+	self->config.sof_scheduler = &self->scheduler;
+
+	if (flash_alloc(&self->flash, DEVICE_FLASH_BLOCKS, DEVICE_FLASH_BLOCK_SIZE, 16, NULL) < 0)
+		goto error;
+	for (size_t i = 0; i < FW_UPDATE_SLOTS; i++)
+		if (flash_alloc(&self->fw_slots[i], DEVICE_FW_SLOT_BLOCKS, DEVICE_FLASH_BLOCK_SIZE, 16, NULL) < 0)
+			goto error;
+
+	self->apply_count = 0;
+	if (device_boot(self, -1) < 0)
+		goto error;
+
+	rc = 0;
+
+error:
+	return rc;
+}
+
+static void Device_dealloc(DeviceObject *self)
+{
+	for (size_t i = 0; i < PAGE_COUNT; i++) PyMem_Free(self->config.functions[i]);
+	flash_free(&self->flash);
+	for (size_t i = 0; i < FW_UPDATE_SLOTS; i++) flash_free(&self->fw_slots[i]);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* Device class definition */
+
+static PyMethodDef Device_methods[] = {
+	{"protocol_dispatch", (PyCFunction) Device_protocol_dispatch, METH_VARARGS | METH_KEYWORDS, NULL},
+	{"protocol_dispatch_sync", (PyCFunction) Device_protocol_dispatch_sync, METH_VARARGS, NULL},
+	{"protocol_flush", (PyCFunction) Device_protocol_flush, METH_NOARGS, NULL},
+	{"dispatch_cost", (PyCFunction) Device_dispatch_cost, METH_VARARGS, NULL},
+	{"dispatch_sync_cost", (PyCFunction) Device_dispatch_sync_cost, METH_VARARGS, NULL},
+	{"lookup_cost", (PyCFunction) Device_lookup_cost, METH_VARARGS, NULL},
+	{"sof", (PyCFunction) Device_sof, METH_VARARGS, NULL},
+	{"sof_poll", (PyCFunction) Device_sof_poll, METH_VARARGS, NULL},
+	{"sof_sample_delay", (PyCFunction) Device_sof_sample_delay, METH_VARARGS, NULL},
+	{"sof_set_period", (PyCFunction) Device_sof_set_period, METH_VARARGS, NULL},
+	{"advance", (PyCFunction) Device_advance, METH_VARARGS, NULL},
+	{"apply_profile", (PyCFunction) Device_apply_profile, METH_NOARGS, NULL},
+	{"reboot", (PyCFunction) Device_reboot, METH_VARARGS | METH_KEYWORDS, NULL},
+	{NULL, NULL, 0, NULL}};
+
+static PyGetSetDef Device_getset[] = {
+	{"active_profile", (getter) Device_get_active_profile, NULL, NULL, NULL},
+	{"apply_count", (getter) Device_get_apply_count, NULL, NULL, NULL},
+	{"flash_writes", (getter) Device_get_flash_writes, NULL, NULL, NULL},
+	{"queued_responses", (getter) Device_get_queued_responses, NULL, NULL, NULL},
+	{"fw_slots", (getter) Device_get_fw_slots, NULL, NULL, NULL},
+	{"fw_slot_erases", (getter) Device_get_fw_slot_erases, NULL, NULL, NULL},
+	{NULL, NULL, NULL, NULL, NULL}};
+
+static PyTypeObject DeviceType = {
+	/* clang-format off */
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_testsuite.Device",
+	.tp_doc = "Test device",
+	.tp_basicsize = sizeof(DeviceObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc) Device_init,
+	.tp_dealloc = (destructor) Device_dealloc,
+	.tp_methods = Device_methods,
+	.tp_getset = Device_getset,
+	/* clang-format on */
+};
+
+/* PixartSensor class methods */
+
+static PyObject *PixartSensor_motion_event(PixartSensorObject *self, PyObject *Py_UNUSED(ignored))
+{
+	pixart_pmw_motion_event(&self->driver);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *PixartSensor_task(PixartSensorObject *self, PyObject *Py_UNUSED(ignored))
+{
+	return PyBool_FromLong(pixart_pmw_task(&self->driver));
+}
+
+static PyObject *PixartSensor_complete_transfer(PixartSensorObject *self, PyObject *args)
+{
+	Py_buffer data;
+
+	if (!PyArg_ParseTuple(args, "y*", &data))
+		return NULL;
+
+	spi_mock_queue_rx(&self->spi, data.buf, data.len);
+	PyBuffer_Release(&data);
+
+	spi_mock_complete_async(&self->spi);
+
+	Py_RETURN_NONE;
+}
+
+/* timeouts that pass fire, and the driver work item is counted if they posted it */
+static PyObject *PixartSensor_advance(PixartSensorObject *self, PyObject *args)
+{
+	unsigned int us;
+
+	if (!PyArg_ParseTuple(args, "I", &us))
+		return NULL;
+
+	ticks_mock_advance_us(us);
+	event_loop_run_once(&self->loop);
+
+	Py_RETURN_NONE;
+}
+
+#define PIXART_SENSOR_WAIT_MAX_US 1000000
+
+/* sleep until the driver posts its work item again, returns how long it took */
+static PyObject *PixartSensor_wait(PixartSensorObject *self, PyObject *Py_UNUSED(ignored))
+{
+	unsigned long wakeups;
+	u32 us = 0;
+
+	/* a wakeup that was already posted doesn't count */
+	event_loop_run_once(&self->loop);
+	wakeups = self->wakeups;
+
+	while (self->wakeups == wakeups) {
+		if (us++ >= PIXART_SENSOR_WAIT_MAX_US) {
+			PyErr_SetString(PyExc_TimeoutError, "the driver never woke up");
+			return NULL;
+		}
+		ticks_mock_advance_us(1);
+		event_loop_run_once(&self->loop);
+	}
+
+	return PyLong_FromUnsignedLong(us);
+}
+
+static PyObject *PixartSensor_set_cpi(PixartSensorObject *self, PyObject *args)
+{
+	unsigned short cpi;
+
+	if (!PyArg_ParseTuple(args, "H", &cpi))
+		return NULL;
+
+	pixart_pmw_set_cpi(&self->driver, cpi);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *PixartSensor_get_deltas(PixartSensorObject *self, PyObject *Py_UNUSED(ignored))
+{
+	struct deltas_t deltas = pixart_pmw_get_deltas(&self->driver);
+
+	return Py_BuildValue("(hh)", deltas.dx, deltas.dy);
+}
+
+/* same as the targets main loop, returns the mouse report or None if the endpoint is busy or there is no motion */
+static PyObject *PixartSensor_poll_report(PixartSensorObject *self, PyObject *args, PyObject *kw)
+{
+	static char *keywords[] = {"ready", NULL};
+	struct mouse_report_16 report;
+	int ready = 1;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "|p", keywords, &ready))
+		return NULL;
+
+	if (pixart_pmw_task(&self->driver)) {
+		struct deltas_t deltas = pixart_pmw_get_deltas(&self->driver);
+		motion_add(&self->motion, deltas.dx, deltas.dy);
+	}
+
+	if (!ready || !motion_report_16(&self->motion, &report))
+		Py_RETURN_NONE;
+
+	return PyBytes_FromStringAndSize((char *) &report, sizeof(report));
+}
+
+static PyObject *PixartSensor_get_busy(PixartSensorObject *self, void *closure)
+{
+	return PyBool_FromLong(pixart_pmw_busy(&self->driver));
+}
+
+static PyObject *PixartSensor_get_wakeups(PixartSensorObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->wakeups);
+}
+
+static PyObject *PixartSensor_get_now_us(PixartSensorObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLongLong(self->driver.ticks_hal.now_us());
+}
+
+static PyObject *PixartSensor_get_selected(PixartSensorObject *self, void *closure)
+{
+	return PyBool_FromLong(self->spi.selected);
+}
+
+static PyObject *PixartSensor_get_transfer_pending(PixartSensorObject *self, void *closure)
+{
+	if (!self->spi.async.pending)
+		Py_RETURN_NONE;
+
+	return PyLong_FromSize_t(self->spi.async.size);
+}
+
+static PyObject *PixartSensor_get_pid(PixartSensorObject *self, void *closure)
+{
+	return PyLong_FromLong(self->driver.pid);
+}
+
+static PyObject *PixartSensor_get_initializing(PixartSensorObject *self, void *closure)
+{
+	return PyBool_FromLong(self->driver.init_state != PIXART_PMW_INIT_DONE);
+}
+
+static PyObject *PixartSensor_get_miso_idle(PixartSensorObject *self, void *closure)
+{
+	return PyLong_FromLong(self->spi.rx_idle);
+}
+
+static int PixartSensor_set_miso_idle(PixartSensorObject *self, PyObject *value, void *closure)
+{
+	long idle = PyLong_AsLong(value);
+
+	if (idle == -1 && PyErr_Occurred())
+		return -1;
+
+	self->spi.rx_idle = idle;
+	return 0;
+}
+
+static PyObject *PixartSensor_get_tx_count(PixartSensorObject *self, void *closure)
+{
+	return PyLong_FromSize_t(self->spi.tx_count);
+}
+
+static PyObject *PixartSensor_get_tx_hash(PixartSensorObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->spi.tx_hash);
+}
+
+static PyObject *PixartSensor_get_firmware_read_bytes(PixartSensorObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLongLong(self->flash.read_bytes);
+}
+
+static PyObject *PixartSensor_get_tx(PixartSensorObject *self, void *closure)
+{
+	return PyBytes_FromStringAndSize((char *) self->spi.tx, min(self->spi.tx_count, sizeof(self->spi.tx)));
+}
+
+/* PixartSensor constructor and destructor */
+
+/* the targets run pixart_pmw_task from here, the tests call it themselves */
+static void PixartSensor_work(void *data)
+{
+	PixartSensorObject *self = data;
+
+	self->wakeups++;
+}
+
+static int PixartSensor_init(PixartSensorObject *self, PyObject *args, PyObject *kw)
+{
+	static char *keywords[] = {"firmware", "firmware_offset", "block_size", NULL};
+	unsigned short block_size = 1024;
+	unsigned int offset = 0;
+	Py_buffer firmware = {};
+	size_t blocks;
+	int ret = -1;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "|y*IH", keywords, &firmware, &offset, &block_size))
+		return -1;
+
+	memset(&self->spi, 0, sizeof(self->spi));
+	memset(&self->motion, 0, sizeof(self->motion));
+
+	self->wakeups = 0;
+	event_loop_init(&self->loop, ticks_mock_get_ticks, NULL);
+	event_loop_add_work(&self->loop, &self->work, PixartSensor_work, self);
+
+	if (firmware.buf) {
+		/* run the real init sequence, streaming the SROM from the flash */
+		blocks = block_size ? max(((size_t) offset + firmware.len + block_size - 1) / block_size, 1) : 0;
+		if (flash_alloc(&self->flash, blocks, block_size, 1, NULL) < 0)
+			goto error;
+		memcpy(self->flash.data + offset, firmware.buf, firmware.len);
+
+		if (blob_init(&self->firmware, blockdev_hal_init_ram(&self->flash), offset, firmware.len) < 0) {
+			PyErr_SetString(PyExc_ValueError, "invalid firmware blob");
+			goto error;
+		}
+
+		pixart_pmw_init(&self->driver,
+				&self->firmware,
+				spi_hal_init_mock(&self->spi),
+				ticks_hal_init_mock(),
+				timer_hal_init_mock(&self->timer),
+				&self->work);
+	} else {
+		/* skip the init sequence, we just need a sensor that has already booted */
+		pixart_pmw_init(&self->driver,
+				NULL,
+				spi_hal_init_mock(&self->spi),
+				ticks_hal_init_mock(),
+				timer_hal_init_mock(&self->timer),
+				&self->work);
+		self->driver.pid = 0x42;
+	}
+
+	ret = 0;
+
+error:
+	PyBuffer_Release(&firmware);
+	return ret;
+}
+
+static void PixartSensor_dealloc(PixartSensorObject *self)
+{
+	timer_mock_remove(&self->timer);
+	flash_free(&self->flash);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* PixartSensor class definition */
+
+static PyMethodDef PixartSensor_methods[] = {
+	{"motion_event", (PyCFunction) PixartSensor_motion_event, METH_NOARGS, NULL},
+	{"task", (PyCFunction) PixartSensor_task, METH_NOARGS, NULL},
+	{"complete_transfer", (PyCFunction) PixartSensor_complete_transfer, METH_VARARGS, NULL},
+	{"advance", (PyCFunction) PixartSensor_advance, METH_VARARGS, NULL},
+	{"wait", (PyCFunction) PixartSensor_wait, METH_NOARGS, NULL},
+	{"set_cpi", (PyCFunction) PixartSensor_set_cpi, METH_VARARGS, NULL},
+	{"get_deltas", (PyCFunction) PixartSensor_get_deltas, METH_NOARGS, NULL},
+	{"poll_report", (PyCFunction) PixartSensor_poll_report, METH_VARARGS | METH_KEYWORDS, NULL},
+	{NULL, NULL, 0, NULL}};
+
+static PyGetSetDef PixartSensor_getset[] = {
+	{"busy", (getter) PixartSensor_get_busy, NULL, NULL, NULL},
+	{"wakeups", (getter) PixartSensor_get_wakeups, NULL, NULL, NULL},
+	{"now_us", (getter) PixartSensor_get_now_us, NULL, NULL, NULL},
+	{"selected", (getter) PixartSensor_get_selected, NULL, NULL, NULL},
+	{"transfer_pending", (getter) PixartSensor_get_transfer_pending, NULL, NULL, NULL},
+	{"pid", (getter) PixartSensor_get_pid, NULL, NULL, NULL},
+	{"initializing", (getter) PixartSensor_get_initializing, NULL, NULL, NULL},
+	{"miso_idle", (getter) PixartSensor_get_miso_idle, (setter) PixartSensor_set_miso_idle, NULL, NULL},
+	{"tx_count", (getter) PixartSensor_get_tx_count, NULL, NULL, NULL},
+	{"tx", (getter) PixartSensor_get_tx, NULL, NULL, NULL},
+	{"tx_hash", (getter) PixartSensor_get_tx_hash, NULL, NULL, NULL},
+	{"firmware_read_bytes", (getter) PixartSensor_get_firmware_read_bytes, NULL, NULL, NULL},
+	{NULL, NULL, NULL, NULL, NULL}};
+
+static PyTypeObject PixartSensorType = {
+	/* clang-format off */
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_testsuite.PixartSensor",
+	.tp_doc = "PixArt PMW sensor driver on top of a mock SPI bus",
+	.tp_basicsize = sizeof(PixartSensorObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc) PixartSensor_init,
+	.tp_dealloc = (destructor) PixartSensor_dealloc,
+	.tp_methods = PixartSensor_methods,
+	.tp_getset = PixartSensor_getset,
+	/* clang-format on */
+};
+
+/* EventLoop class methods */
+
+static void event_loop_callback(void *data)
+{
+	PyObject *ret;
+
+	/* keep the first error, run_once reports it */
+	if (PyErr_Occurred())
+		return;
+
+	ret = PyObject_CallNoArgs(data);
+	Py_XDECREF(ret);
+}
+
+static void event_loop_idle(struct event_loop_t *loop)
+{
+	EventLoopObject *self = loop->data;
+
+	self->idle_count++;
+}
+
+static PyObject *EventLoop_add_work(EventLoopObject *self, PyObject *args)
+{
+	PyObject *callback;
+
+	if (!PyArg_ParseTuple(args, "O", &callback))
+		return NULL;
+
+	if (!PyCallable_Check(callback)) {
+		PyErr_SetString(PyExc_TypeError, "callback should be callable");
+		return NULL;
+	}
+
+	if (self->work_count >= EVENT_LOOP_MAX_WORKS) {
+		PyErr_SetString(PyExc_OverflowError, "too many work items");
+		return NULL;
+	}
+
+	Py_INCREF(callback);
+	self->work_callbacks[self->work_count] = callback;
+	event_loop_add_work(&self->loop, &self->works[self->work_count], event_loop_callback, callback);
+
+	return PyLong_FromSize_t(self->work_count++);
+}
+
+static PyObject *EventLoop_post(EventLoopObject *self, PyObject *args)
+{
+	unsigned int index;
+
+	if (!PyArg_ParseTuple(args, "I", &index))
+		return NULL;
+
+	if (index >= self->work_count) {
+		PyErr_SetString(PyExc_IndexError, "invalid work item");
+		return NULL;
+	}
+
+	event_loop_post(&self->works[index]);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *EventLoop_add_timer(EventLoopObject *self, PyObject *args)
+{
+	PyObject *callback;
+
+	if (!PyArg_ParseTuple(args, "O", &callback))
+		return NULL;
+
+	if (!PyCallable_Check(callback)) {
+		PyErr_SetString(PyExc_TypeError, "callback should be callable");
+		return NULL;
+	}
+
+	if (self->timer_count >= EVENT_LOOP_MAX_TIMERS) {
+		PyErr_SetString(PyExc_OverflowError, "too many timers");
+		return NULL;
+	}
+
+	Py_INCREF(callback);
+	self->timer_callbacks[self->timer_count] = callback;
+	event_timer_init(&self->timers[self->timer_count], event_loop_callback, callback);
+
+	return PyLong_FromSize_t(self->timer_count++);
+}
+
+static PyObject *EventLoop_start_timer(EventLoopObject *self, PyObject *args)
+{
+	unsigned int index, delay_ms, period_ms = 0;
+
+	if (!PyArg_ParseTuple(args, "II|I", &index, &delay_ms, &period_ms))
+		return NULL;
+
+	if (index >= self->timer_count) {
+		PyErr_SetString(PyExc_IndexError, "invalid timer");
+		return NULL;
+	}
+
+	event_timer_start(&self->loop, &self->timers[index], delay_ms, period_ms);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *EventLoop_stop_timer(EventLoopObject *self, PyObject *args)
+{
+	unsigned int index;
+
+	if (!PyArg_ParseTuple(args, "I", &index))
+		return NULL;
+
+	if (index >= self->timer_count) {
+		PyErr_SetString(PyExc_IndexError, "invalid timer");
+		return NULL;
+	}
+
+	event_timer_stop(&self->timers[index]);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *EventLoop_timer_active(EventLoopObject *self, PyObject *args)
+{
+	unsigned int index;
+
+	if (!PyArg_ParseTuple(args, "I", &index))
+		return NULL;
+
+	if (index >= self->timer_count) {
+		PyErr_SetString(PyExc_IndexError, "invalid timer");
+		return NULL;
+	}
+
+	return PyBool_FromLong(event_timer_active(&self->timers[index]));
+}
+
+static PyObject *EventLoop_run_once(EventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+	u8 ran = event_loop_run_once(&self->loop);
+
+	if (PyErr_Occurred())
+		return NULL;
+
+	return PyBool_FromLong(ran);
+}
+
+static PyObject *EventLoop_advance(EventLoopObject *self, PyObject *args)
+{
+	unsigned int ms;
+
+	if (!PyArg_ParseTuple(args, "I", &ms))
+		return NULL;
+
+	ticks_mock_advance_us(ms * 1000);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *EventLoop_get_next_timeout(EventLoopObject *self, void *closure)
+{
+	u32 timeout = event_loop_next_timeout(&self->loop);
+
+	if (timeout == UINT32_MAX)
+		Py_RETURN_NONE;
+
+	return PyLong_FromUnsignedLong(timeout);
+}
+
+static PyObject *EventLoop_get_idle_count(EventLoopObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->idle_count);
+}
+
+/* EventLoop constructor and destructor */
+
+static int EventLoop_init(EventLoopObject *self, PyObject *args, PyObject *kw)
+{
+	static char *keywords[] = {NULL};
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "", keywords))
+		return -1;
+
+	for (size_t i = 0; i < self->work_count; i++) Py_CLEAR(self->work_callbacks[i]);
+	for (size_t i = 0; i < self->timer_count; i++) Py_CLEAR(self->timer_callbacks[i]);
+	self->work_count = 0;
+	self->timer_count = 0;
+	self->idle_count = 0;
+
+	/* driven by the virtual clock of the testsuite platform */
+	event_loop_init(&self->loop, ticks_mock_get_ticks, event_loop_idle);
+	self->loop.data = self;
+
+	return 0;
+}
+
+static void EventLoop_dealloc(EventLoopObject *self)
+{
+	for (size_t i = 0; i < self->work_count; i++) Py_XDECREF(self->work_callbacks[i]);
+	for (size_t i = 0; i < self->timer_count; i++) Py_XDECREF(self->timer_callbacks[i]);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* EventLoop class definition */
+
+static PyMethodDef EventLoop_methods[] = {
+	{"add_work", (PyCFunction) EventLoop_add_work, METH_VARARGS, NULL},
+	{"post", (PyCFunction) EventLoop_post, METH_VARARGS, NULL},
+	{"add_timer", (PyCFunction) EventLoop_add_timer, METH_VARARGS, NULL},
+	{"start_timer", (PyCFunction) EventLoop_start_timer, METH_VARARGS, NULL},
+	{"stop_timer", (PyCFunction) EventLoop_stop_timer, METH_VARARGS, NULL},
+	{"timer_active", (PyCFunction) EventLoop_timer_active, METH_VARARGS, NULL},
+	{"run_once", (PyCFunction) EventLoop_run_once, METH_NOARGS, NULL},
+	{"advance", (PyCFunction) EventLoop_advance, METH_VARARGS, NULL},
+	{NULL, NULL, 0, NULL}};
+
+static PyGetSetDef EventLoop_getset[] = {
+	{"next_timeout", (getter) EventLoop_get_next_timeout, NULL, NULL, NULL},
+	{"idle_count", (getter) EventLoop_get_idle_count, NULL, NULL, NULL},
+	{NULL, NULL, NULL, NULL, NULL}};
+
+static PyTypeObject EventLoopType = {
+	/* clang-format off */
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_testsuite.EventLoop",
+	.tp_doc = "Event loop on top of the testsuite virtual clock",
+	.tp_basicsize = sizeof(EventLoopObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc) EventLoop_init,
+	.tp_dealloc = (destructor) EventLoop_dealloc,
+	.tp_methods = EventLoop_methods,
+	.tp_getset = EventLoop_getset,
+	/* clang-format on */
+};
+
+/* Nvs class methods */
+
+static PyObject *Nvs_mount(NvsObject *self, PyObject *Py_UNUSED(ignored))
+{
+	int ret = nvs_mount(&self->nvs, self->hal);
+
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *Nvs_sync(NvsObject *self, PyObject *Py_UNUSED(ignored))
+{
+	int ret = self->hal.sync(self->hal);
+
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *Nvs_read(NvsObject *self, PyObject *args)
+{
+	u8 value[NVS_MAX_VALUE_SIZE];
+	unsigned short key;
+	int ret;
+
+	if (!PyArg_ParseTuple(args, "H", &key))
+		return NULL;
+
+	ret = nvs_read(&self->nvs, key, value, sizeof(value));
+	if (ret == -ENOENT)
+		Py_RETURN_NONE;
+	if (ret < 0)
+		return oserror(ret);
+
+	return PyBytes_FromStringAndSize((char *) value, ret);
+}
+
+static PyObject *Nvs_write(NvsObject *self, PyObject *args)
+{
+	unsigned short key;
+	Py_buffer value;
+	int ret;
+
+	if (!PyArg_ParseTuple(args, "Hy*", &key, &value))
+		return NULL;
+
+	if (value.len > UINT16_MAX) {
+		PyBuffer_Release(&value);
+		return oserror(-EINVAL);
+	}
+
+	ret = nvs_write(&self->nvs, key, value.buf, value.len);
+	PyBuffer_Release(&value);
+
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *Nvs_delete(NvsObject *self, PyObject *args)
+{
+	unsigned short key;
+	int ret;
+
+	if (!PyArg_ParseTuple(args, "H", &key))
+		return NULL;
+
+	ret = nvs_delete(&self->nvs, key);
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *Nvs_gc_step(NvsObject *self, PyObject *Py_UNUSED(ignored))
+{
+	int ret = nvs_gc_step(&self->nvs);
+
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+/* simulate a power loss after programming this many more bytes, None to disable */
+static PyObject *Nvs_power_loss_after(NvsObject *self, PyObject *args)
+{
+	PyObject *bytes;
+
+	if (!PyArg_ParseTuple(args, "O", &bytes))
+		return NULL;
+
+	if (bytes == Py_None) {
+		self->flash.power_loss = 0;
+		Py_RETURN_NONE;
+	}
+
+	self->flash.power_loss_bytes = PyLong_AsUnsignedLong(bytes);
+	if (PyErr_Occurred())
+		return NULL;
+	self->flash.power_loss = 1;
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *Nvs_get_gc_pending(NvsObject *self, void *closure)
+{
+	return PyBool_FromLong(nvs_gc_pending(&self->nvs));
+}
+
+static PyObject *Nvs_get_free_sectors(NvsObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->nvs.free_count);
+}
+
+static PyObject *Nvs_get_keys(NvsObject *self, void *closure)
+{
+	PyObject *list = PyList_New(self->nvs.index_count);
+
+	if (!list)
+		return NULL;
+
+	for (size_t i = 0; i < self->nvs.index_count; i++)
+		PyList_SET_ITEM(list, i, PyLong_FromUnsignedLong(self->nvs.index[i].key));
+
+	return list;
+}
+
+static PyObject *Nvs_get_image(NvsObject *self, void *closure)
+{
+	return flash_image(&self->flash);
+}
+
+static PyObject *Nvs_get_erase_counts(NvsObject *self, void *closure)
+{
+	return flash_erase_counts(&self->flash);
+}
+
+static PyObject *Nvs_get_program_bytes(NvsObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->flash.program_bytes);
+}
+
+static PyObject *Nvs_get_busy_us(NvsObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLongLong(self->flash.busy_us);
+}
+
+static PyObject *Nvs_get_overwrites(NvsObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->flash.overwrite_count);
+}
+
+static PyObject *Nvs_get_program_count(NvsObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->flash.program_count);
+}
+
+/* Nvs constructor and destructor */
+
+static int Nvs_init(NvsObject *self, PyObject *args, PyObject *kw)
+{
+	static char *keywords[] = {"block_count",
+				   "block_size",
+				   "write_size",
+				   "image",
+				   "erase_latency_us",
+				   "program_latency_us",
+				   "cache_page_size",
+				   NULL};
+	unsigned short block_count = 4, block_size = 4096, write_size = 16, cache_page_size = 0;
+	unsigned int erase_latency_us = 0, program_latency_us = 0;
+	Py_buffer image = {};
+	int ret;
+
+	if (!PyArg_ParseTupleAndKeywords(args,
+					 kw,
+					 "|HHHy*IIH",
+					 keywords,
+					 &block_count,
+					 &block_size,
+					 &write_size,
+					 &image,
+					 &erase_latency_us,
+					 &program_latency_us,
+					 &cache_page_size))
+		return -1;
+
+	ret = flash_alloc(&self->flash, block_count, block_size, write_size, &image);
+	PyBuffer_Release(&image);
+	if (ret < 0)
+		return -1;
+
+	self->flash.erase_latency_us = erase_latency_us;
+	self->flash.program_latency_us = program_latency_us;
+
+	return flash_hal(&self->flash, &self->cache, cache_page_size, &self->hal);
+}
+
+static void Nvs_dealloc(NvsObject *self)
+{
+	flash_free(&self->flash);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* Nvs class definition */
+
+static PyMethodDef Nvs_methods[] = {
+	{"mount", (PyCFunction) Nvs_mount, METH_NOARGS, NULL},
+	{"read", (PyCFunction) Nvs_read, METH_VARARGS, NULL},
+	{"write", (PyCFunction) Nvs_write, METH_VARARGS, NULL},
+	{"delete", (PyCFunction) Nvs_delete, METH_VARARGS, NULL},
+	{"gc_step", (PyCFunction) Nvs_gc_step, METH_NOARGS, NULL},
+	{"power_loss_after", (PyCFunction) Nvs_power_loss_after, METH_VARARGS, NULL},
+	{"sync", (PyCFunction) Nvs_sync, METH_NOARGS, NULL},
+	{NULL, NULL, 0, NULL}};
+
+static PyGetSetDef Nvs_getset[] = {
+	{"gc_pending", (getter) Nvs_get_gc_pending, NULL, NULL, NULL},
+	{"free_sectors", (getter) Nvs_get_free_sectors, NULL, NULL, NULL},
+	{"keys", (getter) Nvs_get_keys, NULL, NULL, NULL},
+	{"image", (getter) Nvs_get_image, NULL, NULL, NULL},
+	{"erase_counts", (getter) Nvs_get_erase_counts, NULL, NULL, NULL},
+	{"program_bytes", (getter) Nvs_get_program_bytes, NULL, NULL, NULL},
+	{"busy_us", (getter) Nvs_get_busy_us, NULL, NULL, NULL},
+	{"overwrites", (getter) Nvs_get_overwrites, NULL, NULL, NULL},
+	{"program_count", (getter) Nvs_get_program_count, NULL, NULL, NULL},
+	{NULL, NULL, NULL, NULL, NULL}};
+
+static PyTypeObject NvsType = {
+	/* clang-format off */
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_testsuite.Nvs",
+	.tp_doc = "Key/value store on top of a RAM NOR flash",
+	.tp_basicsize = sizeof(NvsObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc) Nvs_init,
+	.tp_dealloc = (destructor) Nvs_dealloc,
+	.tp_methods = Nvs_methods,
+	.tp_getset = Nvs_getset,
+	/* clang-format on */
+};
+
+/* RamBlockdev class methods */
+
+static PyObject *RamBlockdev_read(RamBlockdevObject *self, PyObject *args)
+{
+	unsigned short block, offset, size;
+	PyObject *bytes;
+	int ret;
+
+	if (!PyArg_ParseTuple(args, "HHH", &block, &offset, &size))
+		return NULL;
+
+	bytes = PyBytes_FromStringAndSize(NULL, size);
+	if (!bytes)
+		return NULL;
+
+	ret = self->hal.read(self->hal, block, offset, PyBytes_AsString(bytes), size);
+	if (ret < 0) {
+		Py_DECREF(bytes);
+		return oserror(ret);
+	}
+
+	return bytes;
+}
+
+static PyObject *RamBlockdev_write(RamBlockdevObject *self, PyObject *args)
+{
+	unsigned short block, offset;
+	Py_buffer data;
+	int ret;
+
+	if (!PyArg_ParseTuple(args, "HHy*", &block, &offset, &data))
+		return NULL;
+
+	ret = data.len > UINT16_MAX ? -EINVAL : self->hal.write(self->hal, block, offset, data.buf, data.len);
+	PyBuffer_Release(&data);
+
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *RamBlockdev_erase(RamBlockdevObject *self, PyObject *args)
+{
+	unsigned short block;
+	int ret;
+
+	if (!PyArg_ParseTuple(args, "H", &block))
+		return NULL;
+
+	ret = self->hal.erase(self->hal, block);
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *RamBlockdev_sync(RamBlockdevObject *self, PyObject *Py_UNUSED(ignored))
+{
+	int ret = self->hal.sync(self->hal);
+
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *RamBlockdev_flush_step(RamBlockdevObject *self, PyObject *Py_UNUSED(ignored))
+{
+	int ret = block_cache_flush_step(&self->cache);
+
+	if (ret < 0)
+		return oserror(ret);
+
+	Py_RETURN_NONE;
+}
+
+static PyObject *RamBlockdev_get_dirty(RamBlockdevObject *self, void *closure)
+{
+	return PyBool_FromLong(block_cache_dirty(&self->cache));
+}
+
+static PyObject *RamBlockdev_get_image(RamBlockdevObject *self, void *closure)
+{
+	return flash_image(&self->flash);
+}
+
+static PyObject *RamBlockdev_get_erase_counts(RamBlockdevObject *self, void *closure)
+{
+	return flash_erase_counts(&self->flash);
+}
+
+static PyObject *RamBlockdev_get_program_count(RamBlockdevObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->flash.program_count);
+}
+
+static PyObject *RamBlockdev_get_program_bytes(RamBlockdevObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->flash.program_bytes);
+}
+
+static PyObject *RamBlockdev_get_read_bytes(RamBlockdevObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLongLong(self->flash.read_bytes);
+}
+
+static PyObject *RamBlockdev_get_overwrites(RamBlockdevObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLong(self->flash.overwrite_count);
+}
+
+static PyObject *RamBlockdev_get_busy_us(RamBlockdevObject *self, void *closure)
+{
+	return PyLong_FromUnsignedLongLong(self->flash.busy_us);
+}
+
+/* RamBlockdev constructor and destructor */
+
+static int RamBlockdev_init(RamBlockdevObject *self, PyObject *args, PyObject *kw)
+{
+	static char *keywords[] = {
+		"block_count", "block_size", "write_size", "erase_latency_us", "program_latency_us", "cache_page_size", NULL};
+	unsigned short block_count = 4, block_size = 4096, write_size = 16, cache_page_size = 0;
+	unsigned int erase_latency_us = 0, program_latency_us = 0;
+
+	if (!PyArg_ParseTupleAndKeywords(args,
+					 kw,
+					 "|HHHIIH",
+					 keywords,
+					 &block_count,
+					 &block_size,
+					 &write_size,
+					 &erase_latency_us,
+					 &program_latency_us,
+					 &cache_page_size))
+		return -1;
+
+	if (flash_alloc(&self->flash, block_count, block_size, write_size, NULL) < 0)
+		return -1;
+
+	self->flash.erase_latency_us = erase_latency_us;
+	self->flash.program_latency_us = program_latency_us;
+
+	return flash_hal(&self->flash, &self->cache, cache_page_size, &self->hal);
+}
+
+static void RamBlockdev_dealloc(RamBlockdevObject *self)
+{
+	flash_free(&self->flash);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* RamBlockdev class definition */
+
+static PyMethodDef RamBlockdev_methods[] = {
+	{"read", (PyCFunction) RamBlockdev_read, METH_VARARGS, NULL},
+	{"write", (PyCFunction) RamBlockdev_write, METH_VARARGS, NULL},
+	{"erase", (PyCFunction) RamBlockdev_erase, METH_VARARGS, NULL},
+	{"sync", (PyCFunction) RamBlockdev_sync, METH_NOARGS, NULL},
+	{"flush_step", (PyCFunction) RamBlockdev_flush_step, METH_NOARGS, NULL},
+	{NULL, NULL, 0, NULL}};
+
+static PyGetSetDef RamBlockdev_getset[] = {
+	{"dirty", (getter) RamBlockdev_get_dirty, NULL, NULL, NULL},
+	{"image", (getter) RamBlockdev_get_image, NULL, NULL, NULL},
+	{"erase_counts", (getter) RamBlockdev_get_erase_counts, NULL, NULL, NULL},
+	{"program_count", (getter) RamBlockdev_get_program_count, NULL, NULL, NULL},
+	{"program_bytes", (getter) RamBlockdev_get_program_bytes, NULL, NULL, NULL},
+	{"read_bytes", (getter) RamBlockdev_get_read_bytes, NULL, NULL, NULL},
+	{"overwrites", (getter) RamBlockdev_get_overwrites, NULL, NULL, NULL},
+	{"busy_us", (getter) RamBlockdev_get_busy_us, NULL, NULL, NULL},
+	{NULL, NULL, NULL, NULL, NULL}};
+
+static PyTypeObject RamBlockdevType = {
+	/* clang-format off */
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_testsuite.RamBlockdev",
+	.tp_doc = "NOR flash emulated in RAM, optionally behind a write-back cache",
+	.tp_basicsize = sizeof(RamBlockdevObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc) RamBlockdev_init,
+	.tp_dealloc = (destructor) RamBlockdev_dealloc,
+	.tp_methods = RamBlockdev_methods,
+	.tp_getset = RamBlockdev_getset,
+	/* clang-format on */
+};
+
+/* PartitionTable class methods */
+
+static PyObject *partition_entry(const struct partition_table_entry_t *entry)
+{
+	size_t name_len;
+
+	if (!entry)
+		Py_RETURN_NONE;
+
+	name_len = strnlen((const char *) entry->name, PARTITION_NAME_SIZE);
+
+	return Py_BuildValue(
+		"{s:B,s:B,s:B,s:I,s:I,s:N}",
+		"location",
+		entry->location,
+		"type",
+		entry->type,
+		"id",
+		entry->id,
+		"start",
+		entry->start_addr,
+		"end",
+		entry->end_addr,
+		"name",
+		PyBytes_FromStringAndSize((const char *) entry->name, name_len));
+}
+
+static PyObject *PartitionTable_from_index(PartitionTableObject *self, PyObject *args)
+{
+	unsigned char entry;
+
+	if (!PyArg_ParseTuple(args, "b", &entry))
+		return NULL;
+
+	return partition_entry(partition_from_index(&self->index, entry));
+}
+
+static PyObject *PartitionTable_from_type(PartitionTableObject *self, PyObject *args)
+{
+	unsigned char type;
+
+	if (!PyArg_ParseTuple(args, "b", &type))
+		return NULL;
+
+	return partition_entry(partition_from_type(&self->index, type));
+}
+
+static PyObject *PartitionTable_from_id(PartitionTableObject *self, PyObject *args)
+{
+	unsigned char id;
+
+	if (!PyArg_ParseTuple(args, "b", &id))
+		return NULL;
+
+	return partition_entry(partition_from_id(&self->index, id));
+}
+
+static PyObject *PartitionTable_from_name(PartitionTableObject *self, PyObject *args)
+{
+	const struct partition_table_entry_t *entry;
+	Py_buffer name;
+
+	if (!PyArg_ParseTuple(args, "s*", &name))
+		return NULL;
+
+	entry = partition_from_name(&self->index, name.buf, min(name.len, 0xFF));
+	PyBuffer_Release(&name);
+
+	return partition_entry(entry);
+}
+
+/* PartitionTable constructor and destructor */
+
+static int PartitionTable_init(PartitionTableObject *self, PyObject *args, PyObject *kw)
+{
+	static char *keywords[] = {"data", NULL};
+	PyObject *data;
+	int ret;
+
+	if (!PyArg_ParseTupleAndKeywords(args, kw, "S", keywords, &data))
+		return -1;
+
+	Py_INCREF(data);
+	Py_XSETREF(self->data, data);
+
+	ret = partition_table_read(&self->index, PyBytes_AsString(data), PyBytes_Size(data));
+	if (ret < 0) {
+		oserror(ret);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void PartitionTable_dealloc(PartitionTableObject *self)
+{
+	Py_XDECREF(self->data);
+	Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+/* PartitionTable class definition */
+
+static PyMethodDef PartitionTable_methods[] = {
+	{"from_index", (PyCFunction) PartitionTable_from_index, METH_VARARGS, NULL},
+	{"from_type", (PyCFunction) PartitionTable_from_type, METH_VARARGS, NULL},
+	{"from_id", (PyCFunction) PartitionTable_from_id, METH_VARARGS, NULL},
+	{"from_name", (PyCFunction) PartitionTable_from_name, METH_VARARGS, NULL},
+	{NULL, NULL, 0, NULL}};
+
+static PyTypeObject PartitionTableType = {
+	/* clang-format off */
+	PyVarObject_HEAD_INIT(NULL, 0)
+	.tp_name = "_testsuite.PartitionTable",
+	.tp_doc = "Validated and indexed partition table",
+	.tp_basicsize = sizeof(PartitionTableObject),
+	.tp_itemsize = 0,
+	.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,
+	.tp_new = PyType_GenericNew,
+	.tp_init = (initproc) PartitionTable_init,
+	.tp_dealloc = (destructor) PartitionTable_dealloc,
+	.tp_methods = PartitionTable_methods,
+	/* clang-format on */
+};
+
+/* module definition */
+
+static struct PyModuleDef testsuite_module = {
+	/* clang-format off */
+	PyModuleDef_HEAD_INIT,
+	"_testsuite",
+	"Wrapper module for the openinput testsuite target.",
+	-1,
+	testsuite_methods,
+	/* clang-format on */
+};
+
+PyMODINIT_FUNC PyInit__testsuite(void)
+{
+	Py_Initialize();
+
+	PyObject *m = NULL;
+
+	if (PyType_Ready(&DeviceType) < 0)
+		return NULL;
+
+	if (PyType_Ready(&PixartSensorType) < 0)
+		return NULL;
+
+	if (PyType_Ready(&EventLoopType) < 0)
+		return NULL;
+
+	if (PyType_Ready(&NvsType) < 0)
+		return NULL;
+
+	if (PyType_Ready(&RamBlockdevType) < 0)
+		return NULL;
+
+	if (PyType_Ready(&PartitionTableType) < 0)
+		return NULL;
+
+	if ((m = PyModule_Create(&testsuite_module)) == NULL)
+		return NULL;
+
+	Py_XINCREF(&DeviceType);
+
+	PyModule_AddObject(m, "Device", (PyObject *) &DeviceType);
+
+	Py_XINCREF(&PixartSensorType);
+
+	PyModule_AddObject(m, "PixartSensor", (PyObject *) &PixartSensorType);
+
+	Py_XINCREF(&EventLoopType);
+
+	PyModule_AddObject(m, "EventLoop", (PyObject *) &EventLoopType);
+
+	Py_XINCREF(&NvsType);
+
+	PyModule_AddObject(m, "Nvs", (PyObject *) &NvsType);
+
+	Py_XINCREF(&RamBlockdevType);
+
+	PyModule_AddObject(m, "RamBlockdev", (PyObject *) &RamBlockdevType);
+
+	Py_XINCREF(&PartitionTableType);
+
+	PyModule_AddObject(m, "PartitionTable", (PyObject *) &PartitionTableType);
 
 	return m;
 }
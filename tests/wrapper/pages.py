@@ -55,7 +55,26 @@ class Info(_Page, id=0x00):
 
 
 class GeneralProfiles(_Page, id=0x01):
-    pass
+    PROFILE_INFO = 0x00
+    GET_ACTIVE_PROFILE = 0x01
+    SET_ACTIVE_PROFILE = 0x02
+    GET_PROFILE = 0x03
+    SET_CPI = 0x04
+    SET_POLLING_RATE = 0x05
+    SET_BUTTON = 0x06
+    SET_LED = 0x07
+    SAVE_PROFILES = 0x08
+
+
+class FwUpdate(_Page, id=0x02):
+    INFO = 0x00
+    START = 0x01
+    WRITE = 0x02
+    FINISH = 0x03
+
+
+class Batch(_Page, id=0x03):
+    EXECUTE = 0x00
 
 
 class Gimmicks(_Page, id=0xFD):
@@ -63,7 +82,8 @@ class Gimmicks(_Page, id=0xFD):
 
 
 class Debug(_Page, id=0xFE):
-    pass
+    SOF_STATS = 0x00
+    TX_QUEUE_STATS = 0x01
 
 
 # Firmware internals
@@ -71,6 +91,9 @@ class Debug(_Page, id=0xFE):
 # enum supported_pages_index
 PAGE_INDEXES = [
     Info,
+    GeneralProfiles,
+    FwUpdate,
+    Batch,
     Gimmicks,
     Debug,
 ]
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import argparse
+import os
+import struct
+import sys
+import time
+import zlib
+
+from typing import List, Optional
+
+import hidraw
+
+
+PAGE_FW_UPDATE = 0x02
+PAGE_ERROR = 0xFF
+
+FUNCTION_INFO = 0x00
+FUNCTION_START = 0x01
+FUNCTION_WRITE = 0x02
+FUNCTION_FINISH = 0x03
+
+ACK = 0x00
+NAK = 0x01
+
+
+def report(function: int, data: bytes = b'') -> bytes:
+    if len(data) <= 5:
+        return bytes([0x20, PAGE_FW_UPDATE, function]) + data.ljust(5, b'\0')
+    return bytes([0x21, PAGE_FW_UPDATE, function]) + data.ljust(29, b'\0')
+
+
+class Updater:
+    def __init__(self, device: hidraw.Hidraw, verbose: bool = False) -> None:
+        self._device = device
+        self._verbose = verbose
+
+    def _send(self, buf: bytes) -> None:
+        if self._verbose:
+            print('>', buf.hex())
+        # one write per report, the file object would buffer them
+        os.write(self._device._fd.fileno(), buf)
+
+    def _receive(self, timeout: float) -> Optional[bytes]:
+        max_time = time.time() + timeout
+        while time.time() < max_time:
+            buf = self._device.read_raw()
+            if buf:
+                if self._verbose:
+                    print('<', buf.hex())
+                if buf[1] == PAGE_ERROR:
+                    description = bytes(buf[5:]).rstrip(b'\0').decode(errors='replace')
+                    raise RuntimeError(f'device error 0x{buf[2]:02x} {description}'.strip())
+                return bytes(buf)
+            time.sleep(0.0005)
+        return None
+
+    def command(self, function: int, data: bytes = b'') -> bytes:
+        self._send(report(function, data))
+        reply = self._receive(timeout=5)
+        if reply is None:
+            raise TimeoutError('no reply from the device')
+        return reply
+
+    def info(self) -> List[int]:
+        reply = self.command(FUNCTION_INFO)
+        return list(struct.unpack_from('<BBBBI', reply, 3))
+
+    def update(self, image: bytes) -> int:
+        running, boot, chunk_size, window, capacity = self.info()
+        if len(image) > capacity:
+            raise ValueError(f'image too big ({len(image)} bytes, the slot holds {capacity})')
+        print(f'running from slot {running}, writing slot {(running + 1) % 2}')
+
+        self.command(FUNCTION_START, struct.pack('<II', len(image), zlib.crc32(image)))
+
+        chunks = [image[i:i + chunk_size] for i in range(0, len(image), chunk_size)]
+        acked = sent = 0
+        start = time.time()
+
+        # keep the window full, the device only acknowledges every few chunks
+        while acked < len(chunks):
+            while sent < len(chunks) and sent - acked < window:
+                self._send(report(FUNCTION_WRITE, struct.pack('<H', sent & 0xFFFF) + chunks[sent]))
+                sent += 1
+
+            reply = self._receive(timeout=1)
+            if reply is None:
+                sent = acked  # lost acknowledgement, resend from the last one we got
+                continue
+
+            sequence, status = struct.unpack_from('<HB', reply, 3)
+            # sequence numbers are 16 bit, unwrap them relative to what was sent
+            sequence = sent - ((sent - sequence) & 0xFFFF)
+            acked = max(acked, sequence)
+            if status == NAK:
+                sent = sequence
+
+        elapsed = time.time() - start
+        print(f'{len(image)} bytes in {elapsed:.2f}s ({len(image) / elapsed / 1024:.1f} KiB/s)')
+
+        return self.command(FUNCTION_FINISH)[3]
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='openinput firmware update')
+    parser.add_argument('-v', '--verbose',
+                        action='store_true',
+                        help='Shows raw packets.')
+    parser.add_argument('device', metavar='/dev/hidrawX', type=str,
+                        help='Hidraw device on which to perform the update.')
+    parser.add_argument('firmware', metavar='firmware.bin', type=str,
+                        help='Firmware to write to the device.')
+    args = parser.parse_args()
+
+    try:
+        device = hidraw.Hidraw(args.device)
+    except (FileNotFoundError, PermissionError) as e:
+        print(f'can\'t open {args.device}: {str(e)}', file=sys.stderr)
+        exit(1)
+
+    try:
+        with open(args.firmware, 'rb') as f:
+            firmware = f.read()
+    except (FileNotFoundError, PermissionError) as e:
+        print(f'can\'t open {args.firmware}: {str(e)}', file=sys.stderr)
+        exit(1)
+
+    try:
+        slot = Updater(device, args.verbose).update(firmware)
+    except (RuntimeError, TimeoutError, ValueError) as e:
+        print(f'update failed: {str(e)}', file=sys.stderr)
+        exit(1)
+
+    print(f'done, the device boots from slot {slot} after the next reset')
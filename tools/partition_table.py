@@ -1,12 +1,13 @@
 #!/usr/bin/env python3
 
 # import argparse
+import binascii
 import struct
 
 
 BIN = 'partition_table.bin'
 # /* version */
-PARTITION_TABLE_VERSION = 0x00
+PARTITION_TABLE_VERSION = 0x01
 
 # /* magic words */
 PARTITION_TABLE_MW = 0x07AB1E00
@@ -22,21 +23,24 @@ PARTITION_TYPE_FW = 0
 PARTITION_TYPE_BLOB = 1
 PARTITION_TYPE_NVS = 2
 
+PARTITION_TABLE_MAX_ENTRIES = 16
 
-def table_header(numEntries: int = 1) -> bytes:
+
+def table_header(entries: bytes, numEntries: int = 1) -> bytes:
     # struct partition_table_t {
     # 	u32 magic_word;
-    # 	u8 reserved0;
-    # 	u8 reserved1;
-    # 	u8 reserved2;
+    # 	u16 crc;
+    # 	u8 reserved;
     # 	u8 num_entries;
-    # 	struct partition_table_entry_t *entries;
+    # 	struct partition_table_entry_t entries[];
     # } __attribute__((__packed__));
 
-    data = struct.pack('<I', PARTITION_TABLE_MW + PARTITION_TABLE_VERSION)
-    data += struct.pack('<B', 0x55)
-    data += struct.pack('<B', 0xAA)
-    data += struct.pack('<B', 0x55)
+    # CRC-16/CCITT-FALSE of num_entries and the entries
+    crc = binascii.crc_hqx(struct.pack('<B', numEntries) + entries, 0xFFFF)
+
+    data = struct.pack('<I', PARTITION_TABLE_MW | PARTITION_TABLE_VERSION)
+    data += struct.pack('<H', crc)
+    data += struct.pack('<B', 0x00)
     data += struct.pack('<B', numEntries)
 
     return data
@@ -67,21 +71,28 @@ def add_entry(
     data += struct.pack('<I', start_addr)
     data += struct.pack('<I', end_addr)
 
-    if(len(name) > 16):
-        exit(1)
+    name_bytes = bytes(name, 'utf-8')
+    if len(name_bytes) > 16:
+        raise ValueError(f'partition name too long: {name!r}')
 
-    for b in bytes(name, 'utf-8'):
-        data += struct.pack('<B', b)
-
-    data += bytes(16 - (len(name) % 16))
+    data += name_bytes + bytes(16 - len(name_bytes))
 
     return data
 
 
-if __name__ == '__main__':
+def partition_table(*entries: bytes) -> bytes:
+    if not 1 <= len(entries) <= PARTITION_TABLE_MAX_ENTRIES:
+        raise ValueError(f'the table needs between 1 and {PARTITION_TABLE_MAX_ENTRIES} entries')
 
-    bin = open(BIN, 'wb')
+    data = b''.join(entries)
+
+    return table_header(data, numEntries=len(entries)) + data
+
+
+if __name__ == '__main__':
 
-    bin.write(table_header(numEntries=2))  # @ 0x0047FE00
-    bin.write(add_entry(name='nv_data', ptype=PARTITION_TYPE_NVS, start_addr=0x00460000, end_addr=0x0047C000))
-    bin.write(add_entry(name='sensor_blob', ptype=PARTITION_TYPE_BLOB, start_addr=0x0047C000, end_addr=0x47E000))
+    with open(BIN, 'wb') as bin:
+        bin.write(partition_table(  # @ 0x0047FE00
+            add_entry(name='nv_data', ptype=PARTITION_TYPE_NVS, id=0, start_addr=0x00460000, end_addr=0x0047C000),
+            add_entry(name='sensor_blob', ptype=PARTITION_TYPE_BLOB, id=1, start_addr=0x0047C000, end_addr=0x47E000),
+        ))
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import argparse
+import os
+import select
+import sys
+import time
+
+from typing import List
+
+import hidraw
+
+
+REPORT_SHORT_PIPELINED = 0x22
+PAGE_ERROR = 0xFF
+
+# info page, version function, every device has it and the response is short
+VERSION_REQUEST = bytes([REPORT_SHORT_PIPELINED, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00])
+
+
+class Benchmark:
+    def __init__(self, device: hidraw.Hidraw, timeout: float = 1) -> None:
+        self._fd = device._fd.fileno()
+        self._poll = select.poll()
+        self._poll.register(self._fd, select.POLLIN)
+        self._timeout = timeout
+
+    def _send(self, sequence: int) -> None:
+        # one write per report, the file object would buffer them
+        os.write(self._fd, VERSION_REQUEST + bytes([sequence]))
+
+    def _receive(self) -> bytes:
+        if not self._poll.poll(self._timeout * 1000):
+            raise TimeoutError('no reply from the device, does it support pipelined requests?')
+        return os.read(self._fd, 64)
+
+    def run(self, count: int, window: int) -> float:
+        '''Runs ``count`` commands with up to ``window`` in flight, returns commands/second'''
+        sent = received = 0
+        start = time.perf_counter()
+
+        while received < count:
+            while sent < count and sent - received < window:
+                self._send(sent & 0xFF)
+                sent += 1
+
+            reply = self._receive()
+            if reply[0] != REPORT_SHORT_PIPELINED or reply[1] == PAGE_ERROR:
+                raise RuntimeError(f'unexpected reply {reply.hex()}')
+            # responses come back in order
+            if reply[8] != received & 0xFF:
+                raise RuntimeError(f'expected sequence number {received & 0xFF}, got {reply[8]}')
+            received += 1
+
+        return count / (time.perf_counter() - start)
+
+
+def windows(value: str) -> List[int]:
+    return [int(window) for window in value.split(',')]
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='openinput protocol pipelining benchmark (eg. against the linux-uhid target)')
+    parser.add_argument('-n', '--count',
+                        type=int,
+                        default=5000,
+                        help='Commands per window size.')
+    parser.add_argument('-w', '--windows',
+                        type=windows,
+                        default=[1, 2, 4, 8, 15],
+                        help='Comma separated window sizes, the firmware takes up to 15 requests in flight.')
+    parser.add_argument('device', metavar='/dev/hidrawX', type=str,
+                        help='Hidraw device of the openinput interface.')
+    args = parser.parse_args()
+
+    try:
+        device = hidraw.Hidraw(args.device)
+    except (FileNotFoundError, PermissionError) as e:
+        print(f'can\'t open {args.device}: {str(e)}', file=sys.stderr)
+        exit(1)
+
+    benchmark = Benchmark(device)
+    try:
+        baseline = None
+        for window in args.windows:
+            rate = benchmark.run(args.count, window)
+            baseline = baseline or rate
+            print(f'window {window:3}: {rate:10.0f} commands/s ({rate / baseline:.2f}x)')
+    except (RuntimeError, TimeoutError) as e:
+        print(f'benchmark failed: {str(e)}', file=sys.stderr)
+        exit(1)
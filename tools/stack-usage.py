@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: MIT
+# SPDX-FileCopyrightText: 2026 openinput contributors
+
+import argparse
+import pathlib
+
+from typing import Dict, Tuple
+
+
+def read_stack_usage(builddir: str, name_filter: str) -> Dict[str, Tuple[int, str]]:
+    entries = {}
+    for su_file in pathlib.Path(builddir).rglob('*.su'):
+        for line in su_file.read_text().splitlines():
+            # <file>:<line>:<column>:<function>\t<bytes>\t<qualifiers>
+            location, size, qualifiers = line.split('\t')
+            function = location.rsplit(':', 1)[-1]
+            if name_filter in function:
+                entries[function] = (int(size), qualifiers)
+    return entries
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Summarize the GCC -fstack-usage output of a build')
+    parser.add_argument('-f', '--filter', type=str, default='',
+                        help='Only show functions containing this string (eg. protocol_).')
+    parser.add_argument('-b', '--baseline', type=str,
+                        help='Build directory of an older build to compare against.')
+    parser.add_argument('builddir', metavar='build/stm32f1-generic', type=str,
+                        help='Build directory of the target.')
+    args = parser.parse_args()
+
+    entries = read_stack_usage(args.builddir, args.filter)
+
+    if not args.baseline:
+        for function, (size, qualifiers) in sorted(entries.items(), key=lambda item: item[1], reverse=True):
+            print(f'{size:>6} {function:<48} {qualifiers}')
+    else:
+        baseline = read_stack_usage(args.baseline, args.filter)
+        print(f'{"before":>6} {"after":>6} function')
+        for function in sorted(entries.keys() | baseline.keys(), key=lambda f: baseline.get(f, (0,))[0], reverse=True):
+            before = baseline[function][0] if function in baseline else '-'
+            after = entries[function][0] if function in entries else '-'
+            print(f'{before:>6} {after:>6} {function}')